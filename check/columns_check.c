@@ -0,0 +1,229 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * columns_check.c: the columns written by dwg-columns (see the head of
+ * programs/dwg-columns.c for the format) read back and checked: magic,
+ * directory, 64 bytes alignment of the columns, and their number of rows,
+ * against the drawing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dwg.h"
+
+#define COL_NONE 0xFFFFFFFF
+
+static uint8_t *data;
+static uint64_t data_size;
+
+static uint32_t
+get_u32 (uint64_t pos)
+{
+  return (data[pos] | (uint32_t) data[pos + 1] << 8 | (uint32_t) data[pos + 2] << 16
+          | (uint32_t) data[pos + 3] << 24);
+}
+
+static uint64_t
+get_u64 (uint64_t pos)
+{
+  return (get_u32 (pos) | (uint64_t) get_u32 (pos + 4) << 32);
+}
+
+/** Reads a whole file in data */
+static int
+read_data (char *filename)
+{
+  FILE *fp;
+
+  fp = fopen (filename, "rb");
+  if (fp == NULL)
+    return (-1);
+  fseek (fp, 0, SEEK_END);
+  data_size = ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+  data = (uint8_t *) malloc (data_size ? data_size : 1);
+  if (data == NULL || fread (data, 1, data_size, fp) != data_size)
+    {
+      fclose (fp);
+      return (-1);
+    }
+  fclose (fp);
+  return (0);
+}
+
+/** The column of a block, by name; COL_NONE if not there */
+static uint32_t
+find_column (uint64_t columns, uint32_t first, uint32_t num, const char *name)
+{
+  uint32_t i;
+
+  for (i = first; i < first + num; i++)
+    if (!strcmp ((char *) data + columns + 48 * (uint64_t) i, name))
+      return (i);
+  return (COL_NONE);
+}
+
+/** Checks the file, with the drawing it comes from; prints the first
+ * problem found.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+check_data (char *filename, Dwg_Struct * dwg)
+{
+  uint64_t columns, end, offset, count, bytes, rows, last;
+  uint32_t num_blocks, num_columns, i, j, k, first, num, type, c;
+  uint32_t num_entities, num_layers, *layers;
+  const char *name, *block;
+
+  /* Header */
+  if (data_size < 32 || memcmp (data, "DWGCOLS\0", 8) || get_u32 (8) != 1
+      || get_u64 (24) != data_size)
+    {
+      printf ("%s: wrong header\n", filename);
+      return (-1);
+    }
+  num_blocks = get_u32 (12);
+  num_columns = get_u32 (16);
+  columns = 32 + 32 * (uint64_t) num_blocks;
+  end = columns + 48 * (uint64_t) num_columns;
+  if (end > data_size)
+    {
+      printf ("%s: directory past the end of the file\n", filename);
+      return (-1);
+    }
+
+  /* Columns: ended names, known types, in order and on 64 bytes */
+  for (i = 0; i < num_columns; i++)
+    {
+      name = (char *) data + columns + 48 * (uint64_t) i;
+      type = get_u32 (columns + 48 * (uint64_t) i + 16);
+      count = get_u64 (columns + 48 * (uint64_t) i + 24);
+      offset = get_u64 (columns + 48 * (uint64_t) i + 32);
+      bytes = get_u64 (columns + 48 * (uint64_t) i + 40);
+      if (memchr (name, 0, 16) == NULL || type < 1 || type > 3
+          || bytes != count * (type == 3 ? 1 : type == 1 ? 4 : 8))
+        {
+          printf ("%s: wrong column %u\n", filename, i);
+          return (-1);
+        }
+      if (offset % 64 || offset < end || offset + bytes > data_size)
+        {
+          printf ("%s: column %u (%s) misplaced, at %lu\n", filename, i, name,
+                  (unsigned long) offset);
+          return (-1);
+        }
+      end = offset + bytes;
+    }
+
+  /* Blocks: covering the columns, in order; a row for each value, but for
+   * the offsets (one more) and characters of the string dictionaries */
+  num_entities = num_layers = 0;
+  for (i = 0; i < dwg->num_objects; i++)
+    if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+      num_entities++;
+  num_layers = dwg_entities_by_type (dwg, DWG_TYPE_LAYER, &layers);
+  for (i = c = 0; i < num_blocks; i++)
+    {
+      block = (char *) data + 32 + 32 * (uint64_t) i;
+      rows = get_u32 (32 + 32 * (uint64_t) i + 16);
+      first = get_u32 (32 + 32 * (uint64_t) i + 20);
+      num = get_u32 (32 + 32 * (uint64_t) i + 24);
+      if (memchr (block, 0, 16) == NULL || first != c || first + num > num_columns)
+        {
+          printf ("%s: wrong block %u\n", filename, i);
+          return (-1);
+        }
+      c += num;
+      if ((!strcmp (block, "ENTITIES") && rows != num_entities)
+          || (!strcmp (block, "LAYERS") && rows != num_layers))
+        {
+          printf ("%s: %lu rows of %s, not those of the drawing\n", filename,
+                  (unsigned long) rows, block);
+          return (-1);
+        }
+
+      k = find_column (columns, first, num, "offset");
+      last = 0;
+      if (k != COL_NONE)
+        {
+          count = get_u64 (columns + 48 * (uint64_t) k + 24);
+          offset = get_u64 (columns + 48 * (uint64_t) k + 32);
+          last = count ? get_u32 (offset + 4 * (count - 1)) : 0;
+        }
+      for (j = first; j < first + num; j++)
+        {
+          name = (char *) data + columns + 48 * (uint64_t) j;
+          count = get_u64 (columns + 48 * (uint64_t) j + 24);
+          if (!strcmp (name, "offset") || !strcmp (name, "first"))
+            k = count == rows + 1;
+          else if (!strcmp (name, "chars"))
+            k = count == last;
+          else
+            k = count == rows;
+          if (!k)
+            {
+              printf ("%s: %lu values in %s of %s, for %lu rows\n", filename,
+                      (unsigned long) count, name, block, (unsigned long) rows);
+              return (-1);
+            }
+        }
+    }
+  if (c != num_columns)
+    {
+      printf ("%s: columns out of the blocks\n", filename);
+      return (-1);
+    }
+  return (0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  int q;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwgc filename, next to its dwg.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    {
+      size_t size = strlen (argv[q]);
+      char *dwg_name;
+
+      dwg_name = (char *) malloc (size + 1);
+      if (dwg_name == NULL || size < 5)
+        return (-1);
+      strcpy (dwg_name, argv[q]);
+      strcpy (dwg_name + size - 5, ".dwg");
+      memset (&dwg, 0, sizeof (Dwg_Struct));
+      if (dwg_read_file (dwg_name, &dwg) || read_data (argv[q]))
+        {
+          printf ("%s: could not read it, or its drawing\n", argv[q]);
+          return (-1);
+        }
+      free (dwg_name);
+      if (check_data (argv[q], &dwg))
+        return (-1);
+      printf ("%s: %u blocks, %u columns, all on 64 bytes\n", argv[q], get_u32 (12), get_u32 (16));
+      free (data);
+      dwg_free (&dwg);
+    }
+  return (0);
+}
@@ -0,0 +1,111 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * eed_stats.c: the extended data of the objects of a drawing, by
+ * application, with every record parsed to its end
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dwg.h"
+
+#define MAX_APPS 64
+
+typedef struct
+{
+  uint32_t handle;
+  uint32_t records;
+  uint32_t values;
+  uint32_t bytes;
+} App_Stats;
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Object *obj;
+  Dwg_Eed *eed;
+  Dwg_Eed_Value value;
+  App_Stats app[MAX_APPS];
+  uint32_t i, j, k, n, num_apps, num_objects, pos, ix;
+  char name[256];
+  int q, r, bad;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+
+      num_apps = num_objects = 0;
+      bad = 0;
+      for (i = 0; i < dwg.num_objects; i++)
+        {
+          obj = &dwg.object[i];
+          n = dwg_object_eed (obj, &eed);
+          if (n > 0)
+            num_objects++;
+          for (j = 0; j < n; j++)
+            {
+              for (k = 0; k < num_apps && app[k].handle != eed[j].app.value; k++)
+                ;
+              if (k == num_apps)
+                {
+                  if (num_apps == MAX_APPS)
+                    continue;
+                  memset (&app[k], 0, sizeof (App_Stats));
+                  app[k].handle = eed[j].app.value;
+                  num_apps++;
+                }
+              app[k].records++;
+              app[k].bytes += eed[j].size;
+              pos = 0;
+              while ((r = dwg_eed_next (&dwg, &eed[j], &pos, &value)) > 0)
+                app[k].values++;
+              if (r < 0)
+                bad++;
+            }
+        }
+
+      printf ("%s: %lu records of extended data on %lu objects, %lu bytes\n", argv[q],
+              (unsigned long) dwg.num_eed, (unsigned long) num_objects, (unsigned long) dwg.eed_size);
+      for (k = 0; k < num_apps; k++)
+        {
+          strcpy (name, "?");
+          ix = dwg_handle_get_index (&dwg, app[k].handle);
+          if (ix < dwg.num_objects && dwg.object[ix].type == DWG_TYPE_APPID)
+            dwg_string_utf8 (&dwg, dwg.object[ix].as.nongraph.as.APPID.entry_name, name, sizeof (name));
+          printf ("  %-24s %6lu records, %7lu values, %8lu bytes\n", name,
+                  (unsigned long) app[k].records, (unsigned long) app[k].values,
+                  (unsigned long) app[k].bytes);
+        }
+      dwg_free (&dwg);
+      if (bad)
+        {
+          printf ("  %d malformed records!\n", bad);
+          return (-1);
+        }
+    }
+  return (0);
+}
@@ -0,0 +1,144 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * explode_bench.c: time to explode all the block insertions of a drawing,
+ * with the blocks tessellated for each insertion or once in a cache
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define MAX_VERTICES (1 << 20)
+#define MAX_POLYLINES (1 << 16)
+#define MIN_TIME 0.2
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+/** Explodes all the insertions, buf emptied as it fills up, with one cache
+ * for all of them or (if cache is NULL) one cache for each; returns the
+ * number of vertices
+ */
+static uint64_t
+explode_all (Dwg_Struct * dwg, Dwg_Block_Cache * cache, double tolerance, Dwg_Tess_Buffer * buf)
+{
+  static const uint32_t type[2] = { DWG_TYPE_INSERT, DWG_TYPE_MINSERT };
+  Dwg_Block_Cache *c;
+  uint64_t vertices = 0;
+  uint32_t next, num, *indexes;
+  int t;
+
+  for (t = 0; t < 2; t++)
+    {
+      num = dwg_entities_by_type (dwg, type[t], &indexes);
+      for (next = 0; next < num; next++)
+        {
+          c = cache ? cache : dwg_block_cache_new (dwg, tolerance);
+          buf->num_vertices = buf->num_polylines = 0;
+          dwg_explode (&dwg->object[indexes[next]], c, buf);
+          vertices += buf->num_vertices;
+          if (c != cache)
+            dwg_block_cache_free (c);
+        }
+    }
+  return (vertices);
+}
+
+static double
+bench (Dwg_Struct * dwg, int cached, double tolerance, Dwg_Tess_Buffer * buf, uint64_t * vertices)
+{
+  Dwg_Block_Cache *cache = NULL;
+  unsigned passes = 0;
+  double t;
+
+  if (cached)
+    cache = dwg_block_cache_new (dwg, tolerance);
+  t = now ();
+  do
+    {
+      *vertices = explode_all (dwg, cache, tolerance, buf);
+      passes++;
+    }
+  while (now () - t < MIN_TIME);
+  t = (now () - t) / passes;
+  if (cache)
+    {
+      printf ("  %lu blocks cached, %lu vertices\n",
+              (unsigned long) cache->num_blocks, (unsigned long) cache->num_vertices);
+      dwg_block_cache_free (cache);
+    }
+  return (t);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Tess_Buffer buf;
+  double tolerance = 0.01, t0, t1;
+  uint64_t vertices;
+  uint32_t *indexes;
+  int q = 1;
+
+  if (argc > 2 && !strcmp (argv[1], "-t"))
+    {
+      tolerance = atof (argv[2]);
+      q = 3;
+    }
+  if (q >= argc)
+    {
+      puts ("Need at least one argument: a dwg filename (-t tolerance before).");
+      return (-1);
+    }
+
+  buf.vertex = (double *) malloc (3 * MAX_VERTICES * sizeof (double));
+  buf.start = (uint32_t *) malloc (MAX_POLYLINES * sizeof (uint32_t));
+  buf.object = (uint32_t *) malloc (MAX_POLYLINES * sizeof (uint32_t));
+  if (!buf.vertex || !buf.start || !buf.object)
+    return (-1);
+  buf.max_vertices = MAX_VERTICES;
+  buf.max_polylines = MAX_POLYLINES;
+
+  for (; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+      printf ("%s: %lu INSERT, %lu MINSERT, tolerance %g\n", argv[q],
+              (unsigned long) dwg_entities_by_type (&dwg, DWG_TYPE_INSERT, &indexes),
+              (unsigned long) dwg_entities_by_type (&dwg, DWG_TYPE_MINSERT, &indexes), tolerance);
+      t0 = bench (&dwg, 0, tolerance, &buf, &vertices);
+      t1 = bench (&dwg, 1, tolerance, &buf, &vertices);
+      printf ("  %lu vertices: %.3f ms a block each time, %.3f ms cached (x%.1f)\n",
+              (unsigned long) vertices, t0 * 1e3, t1 * 1e3, t1 > 0 ? t0 / t1 : 0.0);
+      dwg_free (&dwg);
+    }
+
+  free (buf.vertex);
+  free (buf.start);
+  free (buf.object);
+  return (0);
+}
@@ -0,0 +1,191 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * geometry_bench.c: a pass over the lines, circles, arcs and polyline
+ * vertices (summing their lengths) through the objects, and through the
+ * geometry columns
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define MIN_TIME 0.2
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static double
+sweep (double start, double end)
+{
+  double a = fmod (end - start, 2 * M_PI);
+
+  return (a <= 0 ? a + 2 * M_PI : a);
+}
+
+/** Length of the lines, circles, arcs and straight polylines, object by
+ * object */
+static double
+length_objects (Dwg_Struct * dwg)
+{
+  Dwg_Object *obj;
+  double length = 0, dx, dy, dz;
+  uint32_t i, j;
+
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      obj = &dwg->object[i];
+      if (obj->supertype != DWG_SUPERTYPE_ENTITY)
+        continue;
+      if (obj->type == DWG_TYPE_LINE)
+        {
+          Dwg_Entity_LINE *e = &obj->as.entity.as.LINE;
+          dx = e->end.x - e->start.x;
+          dy = e->end.y - e->start.y;
+          dz = e->end.z - e->start.z;
+          length += sqrt (dx * dx + dy * dy + dz * dz);
+        }
+      else if (obj->type == DWG_TYPE_CIRCLE)
+        length += 2 * M_PI * obj->as.entity.as.CIRCLE.radius;
+      else if (obj->type == DWG_TYPE_ARC)
+        {
+          Dwg_Entity_ARC *e = &obj->as.entity.as.ARC;
+          length += e->radius * sweep (e->start_angle, e->end_angle);
+        }
+      else if (obj->type == DWG_TYPE_LWPLINE
+               || (obj->type >= 500 && obj->type - 500 < dwg->num_classes
+                   && dwg->dwg_class[obj->type - 500].vartype == DWG_CLASS_LWPLINE))
+        {
+          Dwg_Entity_LWPLINE *e = &obj->as.entity.as.LWPLINE;
+          for (j = 1; e->points && j < e->num_points; j++)
+            {
+              dx = e->points[j].x - e->points[j - 1].x;
+              dy = e->points[j].y - e->points[j - 1].y;
+              length += sqrt (dx * dx + dy * dy);
+            }
+        }
+    }
+  return (length);
+}
+
+/** The same, column by column */
+static double
+length_columns (Dwg_Geometry * geo)
+{
+  Dwg_Geometry_Line *line = &geo->line;
+  Dwg_Geometry_Lwpline *lw = &geo->lwpline;
+  double length = 0, dx, dy, dz;
+  uint32_t i, j;
+
+  for (i = 0; i < line->num; i++)
+    {
+      dx = line->end_x[i] - line->start_x[i];
+      dy = line->end_y[i] - line->start_y[i];
+      dz = line->end_z[i] - line->start_z[i];
+      length += sqrt (dx * dx + dy * dy + dz * dz);
+    }
+  for (i = 0; i < geo->circle.num; i++)
+    length += 2 * M_PI * geo->circle.radius[i];
+  for (i = 0; i < geo->arc.num; i++)
+    length += geo->arc.radius[i] * sweep (geo->arc.start_angle[i], geo->arc.end_angle[i]);
+  for (i = 0; i < lw->num; i++)
+    for (j = lw->first[i] + 1; j < lw->first[i + 1]; j++)
+      {
+        dx = lw->x[j] - lw->x[j - 1];
+        dy = lw->y[j] - lw->y[j - 1];
+        length += sqrt (dx * dx + dy * dy);
+      }
+  return (length);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Geometry *geo;
+  double t, t_objects, t_columns, l_objects, l_columns;
+  unsigned passes;
+  int q;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+      t = now ();
+      geo = dwg_geometry_new (&dwg);
+      t = now () - t;
+      if (geo == NULL)
+        {
+          dwg_free (&dwg);
+          return (-1);
+        }
+      printf ("%s: %lu lines, %lu circles, %lu arcs, %lu points, %lu polylines (%lu vertices) "
+              "in %lu bytes, packed in %.3f ms\n", argv[q], (unsigned long) geo->line.num,
+              (unsigned long) geo->circle.num, (unsigned long) geo->arc.num,
+              (unsigned long) geo->point.num, (unsigned long) geo->lwpline.num,
+              (unsigned long) geo->lwpline.num_vertices, (unsigned long) geo->size, t * 1e3);
+
+      passes = 0;
+      t = now ();
+      do
+        {
+          l_objects = length_objects (&dwg);
+          passes++;
+        }
+      while (now () - t < MIN_TIME);
+      t_objects = (now () - t) / passes;
+
+      passes = 0;
+      t = now ();
+      do
+        {
+          l_columns = length_columns (geo);
+          passes++;
+        }
+      while (now () - t < MIN_TIME);
+      t_columns = (now () - t) / passes;
+
+      printf ("  length %g: objects %.2f us, columns %.2f us (x%.1f)\n", l_columns,
+              t_objects * 1e6, t_columns * 1e6, t_objects / t_columns);
+      if (fabs (l_objects - l_columns) > 1e-9 * fabs (l_objects))
+        {
+          printf ("  different lengths: %g through the objects!\n", l_objects);
+          dwg_geometry_free (geo);
+          dwg_free (&dwg);
+          return (-1);
+        }
+      dwg_geometry_free (geo);
+      dwg_free (&dwg);
+    }
+  return (0);
+}
@@ -0,0 +1,69 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * intern_stats.c: strings and bytes saved by interning the strings of a batch
+ * of drawings in one shared pool, counted from the first drawing up to each
+ * one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dwg.h"
+
+static void
+print_stats (const char *name, Dwg_String_Pool * pool)
+{
+  printf ("%s: %lu strings interned (%lu bytes), %lu distinct (%lu bytes): "
+          "%lu allocations and %lu bytes saved (%.1f%%)\n", name,
+          (unsigned long) pool->num_refs, (unsigned long) pool->bytes_refs,
+          (unsigned long) pool->num_strings, (unsigned long) pool->bytes,
+          (unsigned long) (pool->num_refs - pool->num_strings),
+          (unsigned long) (pool->bytes_refs - pool->bytes),
+          pool->bytes_refs ? 100.0 * (pool->bytes_refs - pool->bytes) / pool->bytes_refs : 0.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_String_Pool *pool;
+  int q;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  pool = dwg_string_pool_new ();
+  if (pool == NULL)
+    return (-1);
+
+  for (q = 1; q < argc; q++)
+    {
+      if (dwg_read_file_interned (argv[q], &dwg, pool))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          dwg_free (&dwg);
+          dwg_string_pool_free (pool);
+          return (-1);
+        }
+      print_stats (argv[q], pool);
+      dwg_free (&dwg);
+    }
+  dwg_string_pool_free (pool);
+  return (0);
+}
@@ -0,0 +1,130 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * probe_bench.c: reading the header of a drawing with dwg_probe, compared
+ * with a full dwg_read_file, and checking that both agree
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define MIN_TIME 0.2
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+/** Are the probed header and classes those of the whole drawing? */
+static int
+same_header (Dwg_Probe * probe, Dwg_Struct * dwg)
+{
+  Dwg_Variables *a = &probe->variable, *b = &dwg->variable;
+  uint16_t i;
+
+  if (probe->version != dwg->header.version || probe->codepage != dwg->header.codepage
+      || memcmp (&a->EXTMIN, &b->EXTMIN, sizeof (a->EXTMIN))
+      || memcmp (&a->EXTMAX, &b->EXTMAX, sizeof (a->EXTMAX))
+      || a->TDCREATE_JULIAN_DAY != b->TDCREATE_JULIAN_DAY
+      || a->TDCREATE_MILLISECONDS != b->TDCREATE_MILLISECONDS
+      || a->TDUPDATE_JULIAN_DAY != b->TDUPDATE_JULIAN_DAY
+      || a->TDUPDATE_MILLISECONDS != b->TDUPDATE_MILLISECONDS
+      || a->HANDSEED.value != b->HANDSEED.value
+      || probe->num_classes != dwg->num_classes)
+    return (0);
+  for (i = 0; i < probe->num_classes; i++)
+    if (probe->dwg_class[i].number != dwg->dwg_class[i].number
+        || !probe->dwg_class[i].dxfname != !dwg->dwg_class[i].dxfname
+        || (probe->dwg_class[i].dxfname
+            && strcmp ((char *) probe->dwg_class[i].dxfname, (char *) dwg->dwg_class[i].dxfname)))
+      return (0);
+  return (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Probe probe;
+  double t, t_read, t_probe;
+  unsigned passes;
+  int q;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    {
+      passes = 0;
+      t = now ();
+      do
+        {
+          if (dwg_read_file (argv[q], &dwg))
+            {
+              printf ("%s: could not read it\n", argv[q]);
+              return (-1);
+            }
+          dwg_free (&dwg);
+          passes++;
+        }
+      while (now () - t < MIN_TIME);
+      t_read = (now () - t) / passes;
+
+      passes = 0;
+      t = now ();
+      do
+        {
+          if (dwg_probe (argv[q], &probe))
+            {
+              printf ("%s: could not probe it\n", argv[q]);
+              return (-1);
+            }
+          dwg_probe_free (&probe);
+          passes++;
+        }
+      while (now () - t < MIN_TIME);
+      t_probe = (now () - t) / passes;
+
+      dwg_read_file (argv[q], &dwg);
+      dwg_probe (argv[q], &probe);
+      printf ("%s: %s, codepage %u, %u classes, handseed %lX, extents (%g, %g)-(%g, %g)\n",
+              argv[q], dwg_version_code_from_id (probe.version), probe.codepage,
+              probe.num_classes, (unsigned long) probe.variable.HANDSEED.value,
+              probe.variable.EXTMIN.x, probe.variable.EXTMIN.y,
+              probe.variable.EXTMAX.x, probe.variable.EXTMAX.y);
+      printf ("  read %.1f us, probe %.1f us (x%.1f)\n", t_read * 1e6, t_probe * 1e6,
+              t_read / t_probe);
+      if (!same_header (&probe, &dwg))
+        {
+          puts ("  the probe and the drawing differ!");
+          dwg_probe_free (&probe);
+          dwg_free (&dwg);
+          return (-1);
+        }
+      dwg_probe_free (&probe);
+      dwg_free (&dwg);
+    }
+  return (0);
+}
@@ -0,0 +1,148 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * query_bench.c: window queries through the spatial index against a linear
+ * scan of the entity extents, and the extents of the drawing computed in one
+ * thread and in several
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define NUM_QUERIES 10000
+#define NUM_THREADS 4
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static uint32_t
+linear_query (Dwg_Struct * dwg, BITCODE_3BD * min, BITCODE_3BD * max)
+{
+  Dwg_Bbox box;
+  uint32_t i, found = 0;
+
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      if (dwg_entity_extents (&dwg->object[i], &box))
+        continue;
+      if (box.min.x > max->x || box.max.x < min->x
+          || box.min.y > max->y || box.max.y < min->y
+          || box.min.z > max->z || box.max.z < min->z)
+        continue;
+      found++;
+    }
+  return (found);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Rtree_Node *root;
+  BITCODE_3BD min, max;
+  double t, t_index, t_linear, w, h, size;
+  uint32_t i, n_index, n_linear, hits;
+  int q, mismatch;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+
+      t = now ();
+      dwg_compute_extents (&dwg, 1);
+      t = now () - t;
+      t_index = now ();
+      dwg_compute_extents (&dwg, NUM_THREADS);
+      t_index = now () - t_index;
+      printf ("%s: extents (%g, %g) to (%g, %g) of %lu entities, in %.3f ms (%d threads: %.3f ms)\n",
+              argv[q], dwg.extents.drawing.min.x, dwg.extents.drawing.min.y,
+              dwg.extents.drawing.max.x, dwg.extents.drawing.max.y,
+              (unsigned long) dwg.extents.num_entities, t * 1e3, NUM_THREADS, t_index * 1e3);
+
+      t = now ();
+      dwg_spatial_init (&dwg);
+      t = now () - t;
+      printf ("%s: %lu entities indexed in %lu nodes, built in %.3f ms\n", argv[q],
+              (unsigned long) dwg.num_rtree_entities, (unsigned long) dwg.num_rtree_nodes, t * 1e3);
+      if (dwg.num_rtree_nodes == 0)
+        {
+          dwg_free (&dwg);
+          continue;
+        }
+
+      /* Random windows of 0.1% to 10% of the drawing extents
+       */
+      root = &dwg.rtree[dwg.num_rtree_nodes - 1];
+      w = root->box.max.x - root->box.min.x;
+      h = root->box.max.y - root->box.min.y;
+      srand (1);
+      t_index = t_linear = 0;
+      hits = 0;
+      mismatch = 0;
+      for (i = 0; i < NUM_QUERIES; i++)
+        {
+          size = sqrt (0.001 + 0.099 * rand () / (double) RAND_MAX);
+          min.x = root->box.min.x + w * (1 - size) * rand () / (double) RAND_MAX;
+          min.y = root->box.min.y + h * (1 - size) * rand () / (double) RAND_MAX;
+          min.z = -HUGE_VAL;
+          max.x = min.x + w * size;
+          max.y = min.y + h * size;
+          max.z = HUGE_VAL;
+
+          t = now ();
+          n_index = dwg_query_box (&dwg, &min, &max, NULL, NULL);
+          t_index += now () - t;
+
+          t = now ();
+          n_linear = linear_query (&dwg, &min, &max);
+          t_linear += now () - t;
+
+          if (n_index != n_linear)
+            mismatch++;
+          hits += n_index;
+        }
+      printf ("  %d queries, %.1f hits each: index %.2f us, linear scan %.2f us (x%.1f)\n",
+              NUM_QUERIES, hits / (double) NUM_QUERIES, t_index * 1e6 / NUM_QUERIES,
+              t_linear * 1e6 / NUM_QUERIES, t_linear / t_index);
+      if (mismatch)
+        {
+          printf ("  %d queries with different results!\n", mismatch);
+          dwg_free (&dwg);
+          return (-1);
+        }
+      dwg_free (&dwg);
+    }
+  return (0);
+}
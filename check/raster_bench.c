@@ -0,0 +1,222 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * raster_bench.c: time to render a thumbnail of the model space, in grey and
+ * in colours, and the share of the pixels drawn; then the same with the model
+ * space entities replicated up to 100000 (or -r N) entities, which must give
+ * the same image
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define SIZE 256
+#define MIN_TIME 0.2
+#define REPLICA_ENTITIES 100000
+#define TARGET_TIME 0.05
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static double
+bench (Dwg_Struct * dwg, Dwg_Raster * raster, uint32_t channels, uint32_t * drawn)
+{
+  unsigned passes = 0;
+  uint32_t i;
+  double t;
+
+  raster->width = raster->height = SIZE;
+  raster->channels = channels;
+  t = now ();
+  do
+    {
+      if (dwg_render (dwg, raster))
+        return (-1);
+      passes++;
+    }
+  while (now () - t < MIN_TIME);
+  t = (now () - t) / passes;
+
+  *drawn = 0;
+  for (i = 0; i < SIZE * SIZE; i++)
+    if (raster->pixel[channels * i] != 255 || raster->pixel[channels * i + channels - 1] != 255)
+      (*drawn)++;
+  return (t);
+}
+
+/** Puts after the objects of dwg copies of its entities, in their order
+ * (the vertices after their polyline), until the extents (computed before,
+ * by a rendering) would count at least num_entities model space entities.
+ * The copies share the data of their entity, and so are drawn at the same
+ * place.
+ * Returns the previous objects, to be put back by unreplicate, or NULL (then
+ * nothing is changed).
+ */
+static Dwg_Object *
+replicate (Dwg_Struct * dwg, uint32_t num_entities, uint32_t * num_objects)
+{
+  Dwg_Object *object, *saved;
+  uint32_t i, n, model, entities = 0, copies;
+
+  model = dwg->extents.num_entities;
+  if (model == 0 || model >= num_entities)
+    return (NULL);
+  copies = (num_entities + model - 1) / model - 1;
+  for (i = 0; i < dwg->num_objects; i++)
+    if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+      entities++;
+  object = (Dwg_Object *) malloc ((dwg->num_objects + (size_t) copies * entities) * sizeof (Dwg_Object));
+  if (object == NULL)
+    return (NULL);
+
+  memcpy (object, dwg->object, dwg->num_objects * sizeof (Dwg_Object));
+  n = dwg->num_objects;
+  while (copies--)
+    for (i = 0; i < dwg->num_objects; i++)
+      if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+        {
+          object[n] = dwg->object[i];
+          object[n].index = n;
+          n++;
+        }
+
+  saved = dwg->object;
+  *num_objects = dwg->num_objects;
+  dwg_extents_free (dwg);
+  dwg->object = object;
+  dwg->num_objects = n;
+  if (dwg_index_init (dwg))
+    {
+      dwg->object = saved;
+      dwg->num_objects = *num_objects;
+      dwg_index_init (dwg);
+      free (object);
+      return (NULL);
+    }
+  return (saved);
+}
+
+/** Puts back the objects replaced by replicate */
+static void
+unreplicate (Dwg_Struct * dwg, Dwg_Object * saved, uint32_t num_objects)
+{
+  dwg_extents_free (dwg);
+  free (dwg->object);
+  dwg->object = saved;
+  dwg->num_objects = num_objects;
+  dwg_index_init (dwg);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Raster raster;
+  Dwg_Object *saved;
+  double t_grey, t_rgb;
+  uint32_t drawn_grey, drawn_rgb, replica_grey, replica_rgb;
+  uint32_t num_objects, num_entities = 0, replicas = REPLICA_ENTITIES;
+  uint8_t *image;
+  int q = 1, same;
+
+  if (argc > 2 && !strcmp (argv[1], "-r"))
+    {
+      replicas = strtoul (argv[2], NULL, 10);
+      q = 3;
+    }
+  if (q >= argc)
+    {
+      puts ("Need at least one argument: a dwg filename (-r entities before).");
+      return (-1);
+    }
+
+  memset (&raster, 0, sizeof (Dwg_Raster));
+  raster.pixel = (uint8_t *) malloc (3 * SIZE * SIZE);
+  image = (uint8_t *) malloc (3 * SIZE * SIZE);
+  if (raster.pixel == NULL || image == NULL)
+    {
+      free (raster.pixel);
+      free (image);
+      return (-1);
+    }
+
+  for (; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          free (raster.pixel);
+          free (image);
+          return (-1);
+        }
+      t_grey = bench (&dwg, &raster, 1, &drawn_grey);
+      t_rgb = bench (&dwg, &raster, 3, &drawn_rgb);
+      if (t_grey < 0 || t_rgb < 0 || drawn_grey != drawn_rgb)
+        {
+          printf ("%s: rendering failed\n", argv[q]);
+          dwg_free (&dwg);
+          free (raster.pixel);
+          free (image);
+          return (-1);
+        }
+      printf ("%s: %lu entities in %dx%d, %.1f%% drawn: grey %.3f ms, colours %.3f ms\n",
+              argv[q], (unsigned long) dwg.extents.num_entities, SIZE, SIZE,
+              100.0 * drawn_grey / (SIZE * SIZE), t_grey * 1e3, t_rgb * 1e3);
+
+      /* The same drawing, many times over */
+      saved = replicate (&dwg, replicas, &num_objects);
+      if (saved == NULL)
+        {
+          dwg_free (&dwg);
+          continue;
+        }
+      memcpy (image, raster.pixel, 3 * SIZE * SIZE);
+      if (dwg_compute_extents (&dwg, 1))
+        t_grey = t_rgb = -1;
+      else
+        {
+          num_entities = dwg.extents.num_entities;
+          t_grey = bench (&dwg, &raster, 1, &replica_grey);
+          t_rgb = bench (&dwg, &raster, 3, &replica_rgb);
+        }
+      same = t_grey >= 0 && t_rgb >= 0 && replica_grey == drawn_grey && replica_rgb == drawn_rgb
+        && !memcmp (image, raster.pixel, 3 * SIZE * SIZE);
+      unreplicate (&dwg, saved, num_objects);
+      dwg_free (&dwg);
+      if (!same)
+        {
+          printf ("  replicated: rendering failed or changed the image\n");
+          free (raster.pixel);
+          free (image);
+          return (-1);
+        }
+      printf ("  replicated to %lu entities: grey %.3f ms, colours %.3f ms%s\n",
+              (unsigned long) num_entities, t_grey * 1e3, t_rgb * 1e3,
+              t_rgb > TARGET_TIME ? " (over the 50 ms target)" : "");
+    }
+
+  free (raster.pixel);
+  free (image);
+  return (0);
+}
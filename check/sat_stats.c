@@ -0,0 +1,362 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * sat_stats.c: the SAT data of the ACIS entities of a drawing, each one
+ * extracted whole, and checked to start with its version line; before, as
+ * the samples have no ACIS entity, the de-obfuscation checked against its
+ * definition, and 3DSOLID entities decoded from chains built here, one of
+ * them failing in its SAT data
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dwg.h"
+#include "decode.h"
+#include "object.h"
+#include "variables.h"
+
+/*------------------------------------------------------------------------------
+ * De-obfuscation
+ */
+
+/** Every byte value, at every offset from 0 to 16 and for every length up
+ * to 300 bytes, de-obfuscated by dwg_solid_sat as by its definition: bytes
+ * above 32 become 159 - c, the others are kept.
+ * Returns the number of failed checks.
+ */
+static int
+check_decode (void)
+{
+  Dwg_Struct dwg;
+  Dwg_Object obj;
+  Dwg_Entity_3DSOLID *e;
+  uint8_t data[320], c;
+  char out[302];
+  uint32_t i, offset, length;
+  int bad = 0;
+
+  /* 7 is odd: all the byte values are in the first 256 bytes */
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = (uint8_t) (7 * i + 3);
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  memset (&obj, 0, sizeof (Dwg_Object));
+  dwg.sat_data = data;
+  dwg.sat_size = sizeof (data);
+  obj.parent = &dwg;
+  obj.type = DWG_TYPE_3DSOLID;
+  obj.supertype = DWG_SUPERTYPE_ENTITY;
+  e = &obj.as.entity.as._3DSOLID;
+  e->version = 1;
+  e->sat_size = 300;
+
+  for (offset = 0; offset <= 16; offset++)
+    {
+      e->sat_offset = offset;
+      for (length = 0; length <= 300; length++)
+        {
+          /* A cap of length + 1 gives length bytes */
+          memset (out, 0x55, sizeof (out));
+          if (dwg_solid_sat (&dwg, &obj, out, length + 1) != 300 || out[length] != '\0')
+            {
+              bad++;
+              continue;
+            }
+          for (i = 0; i < length; i++)
+            {
+              c = data[offset + i];
+              if ((uint8_t) out[i] != (c > 32 ? (uint8_t) (159 - c) : c))
+                break;
+            }
+          if (i < length || (length + 1 < sizeof (out) && (uint8_t) out[length + 1] != 0x55))
+            bad++;
+        }
+    }
+  return (bad);
+}
+
+/*------------------------------------------------------------------------------
+ * Decoding
+ */
+
+/* Bits written from the most significant one, as the decoder reads them */
+static uint8_t chain[1024];
+static uint32_t num_bits;
+
+static void
+put_bits (uint32_t value, int n)
+{
+  while (n--)
+    {
+      if (value >> n & 1)
+        chain[num_bits / 8] |= 0x80 >> (num_bits % 8);
+      num_bits++;
+    }
+}
+
+static void
+put_RC (uint8_t value)
+{
+  put_bits (value, 8);
+}
+
+static void
+put_RS (uint16_t value)
+{
+  put_RC (value & 0xff);
+  put_RC (value >> 8);
+}
+
+static void
+put_RL (uint32_t value)
+{
+  put_RS (value & 0xffff);
+  put_RS (value >> 16);
+}
+
+static void
+put_BS (uint16_t value)
+{
+  put_bits (0, 2);
+  put_RS (value);
+}
+
+static void
+put_BL (uint32_t value)
+{
+  put_bits (0, 2);
+  put_RL (value);
+}
+
+/** Handle of one byte, or none if value is 0 */
+static void
+put_H (uint8_t code, uint8_t value)
+{
+  put_RC (code << 4 | (value ? 1 : 0));
+  if (value)
+    put_RC (value);
+}
+
+/** SAT text as stored: bytes above 32 obfuscated */
+static void
+put_sat_block (const char *text)
+{
+  const char *p;
+
+  put_BL (strlen (text));
+  for (p = text; *p; p++)
+    put_RC ((uint8_t) * p > 32 ? 159 - (uint8_t) * p : (uint8_t) * p);
+}
+
+/** Writes at the current bit a R2000 3DSOLID with a 2 byte extended data
+ * record and the given SAT blocks; if broken, the last block claims more
+ * bytes than there are.
+ */
+static void
+put_3dsolid (uint8_t handle, const char **blocks, int num_blocks, int broken)
+{
+  int i;
+
+  /* Type, object bit size, handle, extended data */
+  put_BS (DWG_TYPE_3DSOLID);
+  put_RL (0);
+  put_H (0, handle);
+  put_BS (2);
+  put_H (0, 5);
+  put_RC ('e');
+  put_RC ('d');
+  put_BS (0);
+
+  /* Common entity data: no picture, model space, no reactors, no links,
+   * colour BYLAYER, linetype scale 1, all by layer, visible */
+  put_bits (0, 1);
+  put_bits (2, 2);
+  put_bits (2, 2);
+  put_bits (1, 1);
+  put_bits (3, 2);
+  put_bits (1, 2);
+  put_bits (0, 2);
+  put_bits (0, 2);
+  put_bits (2, 2);
+  put_RC (0);
+
+  /* ACIS data of version 1 */
+  put_bits (0, 1);
+  put_bits (0, 1);
+  put_BS (1);
+  for (i = 0; i < num_blocks; i++)
+    put_sat_block (blocks[i]);
+  if (broken)
+    {
+      put_BL (1000000);
+      return;
+    }
+  put_bits (2, 2);
+  put_bits (0, 1);
+  put_bits (1, 1);
+
+  /* Handles: extension dictionary, layer */
+  put_H (3, 0);
+  put_H (5, 0);
+}
+
+/** 3DSOLID entities decoded from chains: two good ones around one whose
+ * second SAT block goes beyond its data, which must leave neither its
+ * extended nor its SAT data behind.
+ * Returns the number of failed checks.
+ */
+static int
+check_chain (void)
+{
+  static const Dwg_Decoder decoder = { dwg_decode_r2000_variables, dwg_decode_r2000_object };
+  const char *first[2] = { "400 0 1 0\n", "@7 unknown 14 ACIS 4.00 NT 24 Thu Jan 01\n" };
+  const char *broken[2] = { "400 0 1 0\n", "lost" };
+  const char *last[1] = { "700 0 1 0\n" };
+  Dwg_Struct dwg;
+  Bit_Chain dat;
+  uint32_t start[3], eed_size, sat_size;
+  char sat[128];
+  int i, bad = 0;
+
+  memset (chain, 0, sizeof (chain));
+  num_bits = 0;
+  start[0] = 0;
+  put_3dsolid (0x10, first, 2, 0);
+  start[1] = num_bits = (num_bits + 7) / 8 * 8;
+  put_3dsolid (0x11, broken, 2, 1);
+  start[2] = num_bits = (num_bits + 7) / 8 * 8;
+  put_3dsolid (0x12, last, 1, 0);
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  dwg.header.version = R_2000;
+  dwg.header.decoder = &decoder;
+  dwg.variable.HANDSEED.value = 0x100;
+  memset (&dat, 0, sizeof (Bit_Chain));
+  dat.chain = chain;
+  dat.size = (num_bits + 7) / 8;
+  dat.version = R_2000;
+
+  dwg_object_add_from_chain (&dwg, &dat, start[0] / 8);
+  eed_size = dwg.eed_size;
+  sat_size = dwg.sat_size;
+  dwg_object_add_from_chain (&dwg, &dat, start[1] / 8);
+  if (dwg.num_objects != 1 || dwg.num_eed != 1 || dwg.eed_size != eed_size || dwg.sat_size != sat_size)
+    {
+      printf ("  failed 3DSOLID: %lu objects, %lu bytes of SAT data left\n",
+              (unsigned long) dwg.num_objects, (unsigned long) dwg.sat_size);
+      bad++;
+    }
+  dwg_object_add_from_chain (&dwg, &dat, start[2] / 8);
+  if (dwg.num_objects != 2 || dwg.num_eed != 2)
+    {
+      dwg_free (&dwg);
+      return (bad + 1);
+    }
+
+  /* Both blocks of the first one, whole, then the one of the last one */
+  i = dwg_solid_sat (&dwg, &dwg.object[0], sat, sizeof (sat));
+  if (i != (int) (strlen (first[0]) + strlen (first[1])) || strncmp (sat, first[0], strlen (first[0]))
+      || strcmp (sat + strlen (first[0]), first[1]))
+    bad++;
+  if (dwg.object[1].as.entity.as._3DSOLID.sat_offset != sat_size
+      || dwg_solid_sat (&dwg, &dwg.object[1], sat, sizeof (sat)) != (int) strlen (last[0])
+      || strcmp (sat, last[0]))
+    bad++;
+  if (dwg.object[1].handle.value != 0x12 || dwg.object[1].as.entity.entity_mode != 2)
+    bad++;
+  dwg_free (&dwg);
+  return (bad);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Object *obj;
+  uint32_t i, num_solids, num_sat, bytes, cap;
+  char *sat, *p;
+  int q, len, bad;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  bad = check_decode ();
+  if (bad)
+    {
+      printf ("De-obfuscation: %d failed checks!\n", bad);
+      return (-1);
+    }
+  bad = check_chain ();
+  if (bad)
+    {
+      printf ("Decoding of 3DSOLID chains: %d failed checks!\n", bad);
+      return (-1);
+    }
+  puts ("Checks OK: de-obfuscation, decoding and rollback of 3DSOLID chains.");
+
+  cap = 0;
+  sat = NULL;
+  for (q = 1; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+
+      num_solids = num_sat = bytes = 0;
+      bad = 0;
+      for (i = 0; i < dwg.num_objects; i++)
+        {
+          obj = &dwg.object[i];
+          if (obj->type != DWG_TYPE_REGION && obj->type != DWG_TYPE_3DSOLID && obj->type != DWG_TYPE_BODY)
+            continue;
+          num_solids++;
+          len = dwg_solid_sat (&dwg, obj, sat, cap);
+          if (len < 0)
+            continue;
+          if ((uint32_t) len >= cap)
+            {
+              cap = len + 1;
+              p = (char *) realloc (sat, cap);
+              if (p == NULL)
+                break;
+              sat = p;
+              dwg_solid_sat (&dwg, obj, sat, cap);
+            }
+          num_sat++;
+          bytes += len;
+          /* The header starts with the version number */
+          if (len == 0 || sat[0] < '0' || sat[0] > '9')
+            bad++;
+        }
+
+      printf ("%s: %lu ACIS entities, %lu with SAT data, %lu bytes\n", argv[q],
+              (unsigned long) num_solids, (unsigned long) num_sat, (unsigned long) bytes);
+      dwg_free (&dwg);
+      if (bad)
+        {
+          printf ("  %d SAT data without header!\n", bad);
+          free (sat);
+          return (-1);
+        }
+    }
+  free (sat);
+  return (0);
+}
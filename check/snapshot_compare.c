@@ -0,0 +1,407 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * snapshot_compare.c: snapshots of a drawing, opened at their preferred
+ * base and relocated, compared with a fresh read of the drawing;
+ * dwg_snapshot_check, with the drawing touched and then changed; and
+ * snapshots of interned drawings, which keep their equal strings shared
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "dwg.h"
+
+#define WORK_DWG "snapshot_compare.dwg"
+#define WORK_SNAP "snapshot_compare.snap"
+#define MAX_VERTICES (1 << 16)
+#define MAX_POLYLINES (1 << 12)
+
+static double vertex[2][3 * MAX_VERTICES];
+static uint32_t start[2][MAX_POLYLINES], object[2][MAX_POLYLINES];
+
+static int
+same_string (unsigned char *a, unsigned char *b)
+{
+  if (a == NULL || b == NULL)
+    return (a == b);
+  return (!strcmp ((char *) a, (char *) b));
+}
+
+/** Are the header variables the same? */
+static int
+same_variables (Dwg_Variables * a, Dwg_Variables * b)
+{
+  return (!memcmp (&a->INSBASE, &b->INSBASE, sizeof (a->INSBASE))
+          && !memcmp (&a->EXTMIN, &b->EXTMIN, sizeof (a->EXTMIN))
+          && !memcmp (&a->EXTMAX, &b->EXTMAX, sizeof (a->EXTMAX))
+          && !memcmp (&a->LIMMIN, &b->LIMMIN, sizeof (a->LIMMIN))
+          && !memcmp (&a->LIMMAX, &b->LIMMAX, sizeof (a->LIMMAX))
+          && a->LTSCALE == b->LTSCALE && a->TEXTSIZE == b->TEXTSIZE
+          && a->ORTHOMODE == b->ORTHOMODE && a->PROXYGRAPHICS == b->PROXYGRAPHICS
+          && a->MEASUREMENT == b->MEASUREMENT
+          && a->TDCREATE_JULIAN_DAY == b->TDCREATE_JULIAN_DAY
+          && a->TDCREATE_MILLISECONDS == b->TDCREATE_MILLISECONDS
+          && a->TDUPDATE_JULIAN_DAY == b->TDUPDATE_JULIAN_DAY
+          && a->TDUPDATE_MILLISECONDS == b->TDUPDATE_MILLISECONDS
+          && a->HANDSEED.value == b->HANDSEED.value
+          && a->CLAYER.value == b->CLAYER.value
+          && same_string (a->MENU, b->MENU)
+          && same_string (a->DIMPOST, b->DIMPOST)
+          && same_string (a->DIMAPOST, b->DIMAPOST)
+          && same_string (a->HYPERLINKBASE, b->HYPERLINKBASE)
+          && same_string (a->STYLESHEET, b->STYLESHEET)
+          && same_string (a->FINGERPRINTGUID, b->FINGERPRINTGUID)
+          && same_string (a->VERSIONGUID, b->VERSIONGUID)
+          && same_string (a->PROJECTNAME, b->PROJECTNAME));
+}
+
+/** Is the object the same in both drawings, by its data, extended data,
+ * extents, tessellation and text strings? */
+static int
+same_object (Dwg_Struct * dwg_a, Dwg_Object * a, Dwg_Struct * dwg_b, Dwg_Object * b)
+{
+  Dwg_Tess_Buffer buf[2];
+  Dwg_Bbox box_a, box_b;
+  Dwg_Eed *eed_a, *eed_b;
+  uint32_t i, n;
+  char str_a[1024], str_b[1024];
+  int ra, rb;
+
+  if (a->type != b->type || a->supertype != b->supertype || a->handle.value != b->handle.value
+      || a->num_reactors != b->num_reactors || a->xdicobjhandle.value != b->xdicobjhandle.value)
+    return (0);
+  for (i = 0; i < a->num_reactors; i++)
+    if (a->reactors[i].value != b->reactors[i].value)
+      return (0);
+
+  n = dwg_object_eed (a, &eed_a);
+  if (n != dwg_object_eed (b, &eed_b))
+    return (0);
+  for (i = 0; i < n; i++)
+    if (eed_a[i].app.value != eed_b[i].app.value || eed_a[i].size != eed_b[i].size
+        || memcmp (dwg_a->eed_data + eed_a[i].offset, dwg_b->eed_data + eed_b[i].offset, eed_a[i].size))
+      return (0);
+
+  if (a->type == DWG_TYPE_LAYER)
+    {
+      dwg_string_utf8 (dwg_a, a->as.nongraph.as.LAYER.entry_name, str_a, sizeof (str_a));
+      dwg_string_utf8 (dwg_b, b->as.nongraph.as.LAYER.entry_name, str_b, sizeof (str_b));
+      if (strcmp (str_a, str_b))
+        return (0);
+    }
+  if (a->type == DWG_TYPE_TEXT)
+    {
+      dwg_string_utf8 (dwg_a, a->as.entity.as.TEXT.text_value, str_a, sizeof (str_a));
+      dwg_string_utf8 (dwg_b, b->as.entity.as.TEXT.text_value, str_b, sizeof (str_b));
+      if (strcmp (str_a, str_b))
+        return (0);
+    }
+
+  if (a->supertype != DWG_SUPERTYPE_ENTITY)
+    return (1);
+  if (a->as.entity.layer.value != b->as.entity.layer.value)
+    return (0);
+  ra = dwg_entity_extents (a, &box_a);
+  rb = dwg_entity_extents (b, &box_b);
+  if (ra != rb || (ra == 0 && memcmp (&box_a, &box_b, sizeof (Dwg_Bbox))))
+    return (0);
+
+  for (i = 0; i < 2; i++)
+    {
+      buf[i].vertex = vertex[i];
+      buf[i].max_vertices = MAX_VERTICES;
+      buf[i].num_vertices = 0;
+      buf[i].start = start[i];
+      buf[i].object = object[i];
+      buf[i].max_polylines = MAX_POLYLINES;
+      buf[i].num_polylines = 0;
+    }
+  ra = dwg_tessellate (a, 0.01, &buf[0]);
+  rb = dwg_tessellate (b, 0.01, &buf[1]);
+  if (ra != rb || buf[0].num_vertices != buf[1].num_vertices
+      || buf[0].num_polylines != buf[1].num_polylines
+      || memcmp (vertex[0], vertex[1], 3 * buf[0].num_vertices * sizeof (double))
+      || memcmp (start[0], start[1], buf[0].num_polylines * sizeof (uint32_t)))
+    return (0);
+  return (1);
+}
+
+/** Are the type and layer indexes the same? */
+static int
+same_indexes (Dwg_Struct * snap, Dwg_Struct * dwg)
+{
+  uint32_t i, n, *a, *b;
+
+  if (snap->num_types != dwg->num_types)
+    return (0);
+  for (i = 0; i < dwg->num_types; i++)
+    {
+      n = dwg_entities_by_type (dwg, i, &b);
+      if (dwg_entities_by_type (snap, i, &a) != n || (n && memcmp (a, b, n * sizeof (uint32_t))))
+        return (0);
+    }
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      n = dwg_entities_on_layer (dwg, i, &b);
+      if (dwg_entities_on_layer (snap, i, &a) != n || (n && memcmp (a, b, n * sizeof (uint32_t))))
+        return (0);
+    }
+  return (1);
+}
+
+/** Is the snapshot the same drawing as the one read? */
+static int
+same_drawing (Dwg_Struct * snap, Dwg_Struct * dwg)
+{
+  uint32_t i;
+
+  if (snap->header.version != dwg->header.version || snap->header.codepage != dwg->header.codepage
+      || snap->num_objects != dwg->num_objects || snap->num_classes != dwg->num_classes
+      || snap->num_eed != dwg->num_eed || snap->eed_size != dwg->eed_size
+      || !same_variables (&snap->variable, &dwg->variable))
+    {
+      puts ("  the header or the counts differ");
+      return (0);
+    }
+  for (i = 0; i < dwg->num_classes; i++)
+    if (!same_string (snap->dwg_class[i].dxfname, dwg->dwg_class[i].dxfname))
+      {
+        printf ("  class %lu differs\n", (unsigned long) i);
+        return (0);
+      }
+  for (i = 0; i < dwg->num_objects; i++)
+    if (!same_object (snap, &snap->object[i], dwg, &dwg->object[i]))
+      {
+        printf ("  object %lu differs\n", (unsigned long) i);
+        return (0);
+      }
+  return (1);
+}
+
+/** Copies a file, as it is */
+static int
+copy_file (char *from, char *to)
+{
+  char data[65536];
+  size_t n;
+  FILE *in, *out;
+  int fail = 0;
+
+  in = fopen (from, "rb");
+  if (!in)
+    return (-1);
+  out = fopen (to, "wb");
+  if (!out)
+    {
+      fclose (in);
+      return (-1);
+    }
+  while ((n = fread (data, 1, sizeof (data), in)) > 0)
+    if (fwrite (data, 1, n, out) != n)
+      fail = -1;
+  fclose (in);
+  if (fclose (out))
+    fail = -1;
+  return (fail);
+}
+
+/** Sets the modification time of a file, some hours after the current one */
+static void
+touch_later (char *path, int hours)
+{
+  struct stat attrib;
+  struct utimbuf times;
+
+  stat (path, &attrib);
+  times.actime = attrib.st_atime;
+  times.modtime = attrib.st_mtime + hours * 3600;
+  utime (path, &times);
+}
+
+/** Snapshot of a drawing, compared with a fresh read */
+static int
+check_file (char *filename)
+{
+  Dwg_Struct dwg, fresh, *snap;
+  uint64_t base;
+  struct stat attrib;
+  void *blocker;
+  FILE *fp;
+  int relocated, wrong, c;
+
+  if (copy_file (filename, WORK_DWG) || dwg_read_file (WORK_DWG, &dwg))
+    {
+      printf ("%s: could not read it\n", filename);
+      return (-1);
+    }
+  if (dwg_snapshot_write (&dwg, WORK_SNAP))
+    {
+      printf ("%s: could not write the snapshot\n", filename);
+      dwg_free (&dwg);
+      return (-1);
+    }
+  dwg_free (&dwg);
+  dwg_read_file (WORK_DWG, &fresh);
+
+  /* Preferred base, at byte 32 of the snapshot */
+  fp = fopen (WORK_SNAP, "rb");
+  stat (WORK_SNAP, &attrib);
+  if (fp == NULL || fseek (fp, 32, SEEK_SET) || fread (&base, 8, 1, fp) != 1)
+    base = 0;
+  if (fp)
+    fclose (fp);
+
+  /* At the preferred base */
+  snap = dwg_snapshot_open (WORK_SNAP);
+  if (snap == NULL || (uintptr_t) snap->snapshot != (uintptr_t) base || !same_drawing (snap, &fresh))
+    {
+      printf ("%s: the snapshot differs from the drawing%s\n", filename,
+              snap && (uintptr_t) snap->snapshot != (uintptr_t) base ? " (not at its base)" : "");
+      dwg_free (&fresh);
+      return (-1);
+    }
+
+  /* Its indexes come with it, and are not built again */
+  if (dwg_index_init (snap) || !same_indexes (snap, &fresh))
+    {
+      printf ("%s: the indexes of the snapshot differ\n", filename);
+      dwg_free (snap);
+      dwg_free (&fresh);
+      return (-1);
+    }
+  dwg_free (snap);
+
+  /* Elsewhere, with the preferred base taken before */
+  blocker = mmap ((void *) (uintptr_t) base, attrib.st_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  snap = dwg_snapshot_open (WORK_SNAP);
+  relocated = snap && (uintptr_t) snap->snapshot != (uintptr_t) base;
+  if (snap == NULL || !relocated || !same_drawing (snap, &fresh))
+    {
+      printf ("%s: the relocated snapshot differs from the drawing%s\n", filename,
+              snap && !relocated ? " (not relocated)" : "");
+      dwg_free (&fresh);
+      return (-1);
+    }
+  if (blocker != MAP_FAILED)
+    munmap (blocker, attrib.st_size);
+  dwg_free (&fresh);
+
+  /* Only touched, then changed with the same size, then longer */
+  touch_later (WORK_DWG, 1);
+  wrong = dwg_snapshot_check (snap, WORK_DWG) != 0;
+  fp = fopen (WORK_DWG, "r+b");
+  if (fp)
+    {
+      fseek (fp, 0x200, SEEK_SET);
+      c = fgetc (fp);
+      fseek (fp, 0x200, SEEK_SET);
+      fputc (c ^ 0xFF, fp);
+      fclose (fp);
+    }
+  touch_later (WORK_DWG, 2);
+  wrong = wrong || dwg_snapshot_check (snap, WORK_DWG) == 0;
+  fp = fopen (WORK_DWG, "ab");
+  if (fp)
+    {
+      fputc (0, fp);
+      fclose (fp);
+    }
+  wrong = wrong || dwg_snapshot_check (snap, WORK_DWG) == 0;
+  dwg_free (snap);
+  if (wrong)
+    {
+      printf ("%s: wrong staleness of the snapshot\n", filename);
+      return (-1);
+    }
+
+  printf ("%s: snapshot same as the drawing, at its base and relocated\n", filename);
+  remove (WORK_DWG);
+  remove (WORK_SNAP);
+  return (0);
+}
+
+/** Snapshot of an interned drawing: no pool, but the interned class names
+ * which were the same pointer still are */
+static int
+check_interned (char *filename)
+{
+  Dwg_Struct dwg, *snap;
+  unsigned i, j, shared, wrong;
+
+  if (copy_file (filename, WORK_DWG) || dwg_read_file_interned (WORK_DWG, &dwg, NULL))
+    {
+      printf ("%s: could not read it interned\n", filename);
+      return (-1);
+    }
+  if (dwg_snapshot_write (&dwg, WORK_SNAP))
+    {
+      printf ("%s: could not write the snapshot of the interned drawing\n", filename);
+      dwg_free (&dwg);
+      return (-1);
+    }
+  snap = dwg_snapshot_open (WORK_SNAP);
+  if (snap == NULL)
+    {
+      printf ("%s: could not open the snapshot of the interned drawing\n", filename);
+      dwg_free (&dwg);
+      return (-1);
+    }
+
+  shared = wrong = snap->header.string_pool != NULL || snap->header.string_pool_owned
+    || snap->num_classes != dwg.num_classes;
+  for (i = 0; !wrong && i < dwg.num_classes; i++)
+    for (j = i + 1; j < dwg.num_classes; j++)
+      if (dwg.dwg_class[i].appname == dwg.dwg_class[j].appname)
+        {
+          shared++;
+          if (snap->dwg_class[i].appname != snap->dwg_class[j].appname
+              || !same_string (snap->dwg_class[i].appname, dwg.dwg_class[i].appname))
+            wrong = 1;
+        }
+  dwg_free (snap);
+  dwg_free (&dwg);
+  if (wrong)
+    {
+      printf ("%s: the snapshot of the interned drawing lost its sharing\n", filename);
+      return (-1);
+    }
+
+  printf ("%s: interned snapshot without a pool, %u shared names kept\n", filename, shared);
+  remove (WORK_DWG);
+  remove (WORK_SNAP);
+  return (0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int q;
+
+  if (argc < 2)
+    {
+      puts ("Need at least one argument: a dwg filename.");
+      return (-1);
+    }
+
+  for (q = 1; q < argc; q++)
+    if (check_file (argv[q]) || check_interned (argv[q]))
+      return (-1);
+  return (0);
+}
@@ -0,0 +1,497 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/*
+ * tess_bench.c: throughput of the tessellation of each curved entity type,
+ * in vertices per second; and checks of the output: arcs and circles on
+ * their curve within the tolerance, the same output with small buffers,
+ * and LWPLINE and HATCH entities built here (the samples have none)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dwg.h"
+
+#define MAX_VERTICES (1 << 20)
+#define MAX_POLYLINES (1 << 16)
+#define MIN_TIME 0.2
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+/** Tessellates a whole type, buf emptied as it fills up; returns the number
+ * of vertices
+ */
+static uint64_t
+tessellate_type (Dwg_Struct * dwg, uint32_t type, double tolerance, Dwg_Tess_Buffer * buf)
+{
+  uint64_t vertices = 0;
+  uint32_t next = 0, num, *indexes;
+
+  num = dwg_entities_by_type (dwg, type, &indexes);
+  while (next < num)
+    {
+      buf->num_vertices = buf->num_polylines = 0;
+      dwg_tessellate_type (dwg, type, tolerance, &next, buf);
+      vertices += buf->num_vertices;
+    }
+  return (vertices);
+}
+
+static void
+bench_type (Dwg_Struct * dwg, uint32_t type, const char *name, double tolerance, Dwg_Tess_Buffer * buf)
+{
+  uint32_t num, *indexes;
+  uint64_t vertices, total;
+  unsigned passes;
+  double t;
+
+  num = dwg_entities_by_type (dwg, type, &indexes);
+  if (num == 0)
+    return;
+
+  vertices = tessellate_type (dwg, type, tolerance, buf);
+  if (vertices == 0)
+    {
+      printf ("  %-8s %6lu entities, no vertices\n", name, (unsigned long) num);
+      return;
+    }
+  total = 0;
+  passes = 0;
+  t = now ();
+  do
+    {
+      total += tessellate_type (dwg, type, tolerance, buf);
+      passes++;
+    }
+  while (now () - t < MIN_TIME);
+  t = now () - t;
+  printf ("  %-8s %6lu entities, %8lu vertices: %8.2f Mvertices/s\n", name,
+          (unsigned long) num, (unsigned long) vertices, total / t * 1e-6);
+}
+
+/*------------------------------------------------------------------------------
+ * Checks
+ */
+
+#define SMALL_VERTICES 4096
+#define SMALL_POLYLINES 64
+
+static double small_vertex[3 * SMALL_VERTICES];
+static uint32_t small_start[SMALL_POLYLINES], small_object[SMALL_POLYLINES];
+
+static void
+buffer_init (Dwg_Tess_Buffer * buf, uint32_t max_vertices, uint32_t max_polylines)
+{
+  buf->vertex = small_vertex;
+  buf->start = small_start;
+  buf->object = small_object;
+  buf->max_vertices = max_vertices;
+  buf->max_polylines = max_polylines;
+  buf->num_vertices = buf->num_polylines = 0;
+}
+
+/** Counts the vertices from v, n of them, not on the circle of center c and
+ * radius r, or whose chords are farther than tol from it */
+static int
+check_arc_vertices (const double *v, uint32_t n, const double *c, double r, double tol)
+{
+  double d, chord, sagitta, eps = 1e-9 * (r + 1);
+  uint32_t i;
+  int bad = 0;
+
+  for (i = 0; i < n; i++)
+    {
+      d = sqrt ((v[3 * i] - c[0]) * (v[3 * i] - c[0]) + (v[3 * i + 1] - c[1]) * (v[3 * i + 1] - c[1])
+                + (v[3 * i + 2] - c[2]) * (v[3 * i + 2] - c[2]));
+      if (fabs (d - r) > eps)
+        bad++;
+      if (i == 0)
+        continue;
+      chord = sqrt ((v[3 * i] - v[3 * i - 3]) * (v[3 * i] - v[3 * i - 3])
+                    + (v[3 * i + 1] - v[3 * i - 2]) * (v[3 * i + 1] - v[3 * i - 2])
+                    + (v[3 * i + 2] - v[3 * i - 1]) * (v[3 * i + 2] - v[3 * i - 1]));
+      sagitta = r - sqrt (fmax (r * r - chord * chord / 4, 0));
+      if (sagitta > tol + eps)
+        bad++;
+    }
+  return (bad);
+}
+
+/** ARC and CIRCLE entities of the drawing: every vertex on the curve, and
+ * every chord within the tolerance. Returns the number of bad entities.
+ */
+static int
+check_circles (Dwg_Struct * dwg, uint32_t type, double tolerance)
+{
+  Dwg_Tess_Buffer buf;
+  Dwg_Object *obj;
+  BITCODE_3BD *center, *ext, ax, ay, az;
+  double c[3], r;
+  uint32_t i, num, *indexes;
+  int bad = 0;
+
+  num = dwg_entities_by_type (dwg, type, &indexes);
+  for (i = 0; i < num; i++)
+    {
+      obj = &dwg->object[indexes[i]];
+      if (type == DWG_TYPE_ARC)
+        {
+          center = &obj->as.entity.as.ARC.center;
+          ext = &obj->as.entity.as.ARC.extrusion;
+          r = obj->as.entity.as.ARC.radius;
+        }
+      else
+        {
+          center = &obj->as.entity.as.CIRCLE.center;
+          ext = &obj->as.entity.as.CIRCLE.extrusion;
+          r = obj->as.entity.as.CIRCLE.radius;
+        }
+      if (dwg_ocs_axes (ext, &ax, &ay, &az))
+        {
+          c[0] = center->x * ax.x + center->y * ay.x + center->z * az.x;
+          c[1] = center->x * ax.y + center->y * ay.y + center->z * az.y;
+          c[2] = center->x * ax.z + center->y * ay.z + center->z * az.z;
+        }
+      else
+        {
+          c[0] = center->x;
+          c[1] = center->y;
+          c[2] = center->z;
+        }
+      buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+      if (dwg_tessellate (obj, tolerance, &buf) != 0 || buf.num_polylines != 1
+          || check_arc_vertices (buf.vertex, buf.num_vertices, c, r, tolerance))
+        bad++;
+    }
+  return (bad);
+}
+
+/** A whole type tessellated by dwg_tessellate_type in a buffer just big
+ * enough for its biggest entity, as the entities done one at a time.
+ * Returns 1 if the outputs differ, 0 otherwise.
+ */
+static int
+check_small_buffers (Dwg_Struct * dwg, uint32_t type, double tolerance)
+{
+  Dwg_Tess_Buffer buf;
+  double *ref;
+  uint32_t *ref_object;
+  uint32_t i, j, num, *indexes, next;
+  uint32_t num_ref, num_ref_polylines, max_vertices, max_polylines, pos, polyline;
+  int bad = 0;
+
+  num = dwg_entities_by_type (dwg, type, &indexes);
+  if (num == 0)
+    return (0);
+
+  /* Reference: one entity at a time */
+  num_ref = num_ref_polylines = max_vertices = max_polylines = 0;
+  for (i = 0; i < num; i++)
+    {
+      buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+      dwg_tessellate (&dwg->object[indexes[i]], tolerance, &buf);
+      num_ref += buf.num_vertices;
+      num_ref_polylines += buf.num_polylines;
+      if (buf.num_vertices > max_vertices)
+        max_vertices = buf.num_vertices;
+      if (buf.num_polylines > max_polylines)
+        max_polylines = buf.num_polylines;
+    }
+  ref = (double *) malloc ((3 * num_ref + 1) * sizeof (double));
+  ref_object = (uint32_t *) malloc ((num_ref_polylines + 1) * sizeof (uint32_t));
+  if (!ref || !ref_object || max_vertices == 0)
+    {
+      free (ref);
+      free (ref_object);
+      return (max_vertices == 0 ? 0 : 1);
+    }
+  pos = polyline = 0;
+  for (i = 0; i < num; i++)
+    {
+      buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+      dwg_tessellate (&dwg->object[indexes[i]], tolerance, &buf);
+      memcpy (ref + 3 * pos, buf.vertex, 3 * buf.num_vertices * sizeof (double));
+      memcpy (ref_object + polyline, buf.object, buf.num_polylines * sizeof (uint32_t));
+      pos += buf.num_vertices;
+      polyline += buf.num_polylines;
+    }
+
+  /* The same through the smallest buffer */
+  pos = polyline = 0;
+  next = 0;
+  while (next < num && !bad)
+    {
+      buffer_init (&buf, max_vertices, max_polylines);
+      if (dwg_tessellate_type (dwg, type, tolerance, &next, &buf) == 0)
+        bad = 1;
+      if (pos + buf.num_vertices > num_ref || polyline + buf.num_polylines > num_ref_polylines)
+        bad = 1;
+      else
+        {
+          if (memcmp (ref + 3 * pos, buf.vertex, 3 * buf.num_vertices * sizeof (double)))
+            bad = 1;
+          for (j = 0; j < buf.num_polylines; j++)
+            if (buf.object[j] != ref_object[polyline + j])
+              bad = 1;
+        }
+      pos += buf.num_vertices;
+      polyline += buf.num_polylines;
+    }
+  if (pos != num_ref || polyline != num_ref_polylines)
+    bad = 1;
+  free (ref);
+  free (ref_object);
+  return (bad);
+}
+
+static int
+same_point (const double *v, double x, double y)
+{
+  return (fabs (v[0] - x) < 1e-12 && fabs (v[1] - y) < 1e-12 && v[2] == 0);
+}
+
+/** LWPLINE from (0, 0) to (2, 0) with a bulge of 1, a half circle below
+ * the X axis; its last bulge is only used, by the tessellation and the
+ * extents, once it is closed.
+ * Returns the number of failed checks.
+ */
+static int
+check_lwpline (double tolerance)
+{
+  Dwg_Struct dwg;
+  Dwg_Object obj;
+  Dwg_Entity_LWPLINE *e;
+  Dwg_Tess_Buffer buf;
+  Dwg_Bbox box;
+  BITCODE_2RD points[2] = { {0, 0}, {2, 0} };
+  double bulges[2] = { 1, 0.5 }, c[3] = { 1, 0, 0 };
+  uint32_t i, open_vertices;
+  int bad = 0;
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  memset (&obj, 0, sizeof (Dwg_Object));
+  obj.parent = &dwg;
+  obj.type = DWG_TYPE_LWPLINE;
+  obj.supertype = DWG_SUPERTYPE_ENTITY;
+  e = &obj.as.entity.as.LWPLINE;
+  e->normal.z = 1;
+  e->num_points = 2;
+  e->points = points;
+  e->num_bulges = 2;
+  e->bulges = bulges;
+
+  buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+  if (dwg_tessellate (&obj, tolerance, &buf) != 0 || buf.num_polylines != 1 || buf.num_vertices < 3)
+    return (1);
+  open_vertices = buf.num_vertices;
+  if (!same_point (buf.vertex, 0, 0) || !same_point (buf.vertex + 3 * (open_vertices - 1), 2, 0))
+    bad++;
+  if (check_arc_vertices (buf.vertex, open_vertices, c, 1, tolerance))
+    bad++;
+  for (i = 0; i < open_vertices; i++)
+    if (buf.vertex[3 * i + 1] > 1e-12)
+      bad++;
+  if (!same_point (buf.vertex + 3 * (open_vertices / 2), 1, -1) && open_vertices % 2)
+    bad++;
+
+  /* Closed: the second bulge brings it back to (0, 0) */
+  e->flags = 512;
+  buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+  if (dwg_tessellate (&obj, tolerance, &buf) != 0 || buf.num_vertices <= open_vertices
+      || !same_point (buf.vertex + 3 * (buf.num_vertices - 1), 0, 0))
+    bad++;
+
+  /* Its extents too: a straight line while open, whatever its last bulge */
+  bulges[0] = 0;
+  bulges[1] = 1;
+  if (dwg_entity_extents (&obj, &box) != 0 || box.max.y < 1 - 1e-12)
+    bad++;
+  e->flags = 0;
+  if (dwg_entity_extents (&obj, &box) != 0 || box.min.y != 0 || box.max.y != 0)
+    bad++;
+  return (bad);
+}
+
+/** HATCH with two boundary paths: a polyline path making a circle of radius
+ * 1 from two bulges, and a segment path of a line and a half circle.
+ * Returns the number of failed checks.
+ */
+static int
+check_hatch (double tolerance)
+{
+  Dwg_Struct dwg;
+  Dwg_Class klass;
+  Dwg_Object obj;
+  Dwg_Entity_HATCH *e;
+  Dwg_Entity_HATCH_Path paths[2];
+  Dwg_Entity_HATCH_PolylinePath polyline[2];
+  Dwg_Entity_HATCH_PathSeg segs[2];
+  Dwg_Tess_Buffer buf;
+  double c1[3] = { 1, 0, 0 }, c2[3] = { 2, 0, 0 };
+  uint32_t i, first, n;
+  int bad = 0;
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  memset (&klass, 0, sizeof (Dwg_Class));
+  memset (&obj, 0, sizeof (Dwg_Object));
+  memset (paths, 0, sizeof (paths));
+  memset (polyline, 0, sizeof (polyline));
+  memset (segs, 0, sizeof (segs));
+  klass.vartype = DWG_CLASS_HATCH;
+  dwg.num_classes = 1;
+  dwg.dwg_class = &klass;
+  obj.parent = &dwg;
+  obj.type = 500;
+  obj.supertype = DWG_SUPERTYPE_ENTITY;
+  e = &obj.as.entity.as.HATCH;
+  e->extrusion.z = 1;
+  e->num_paths = 2;
+  e->paths = paths;
+
+  polyline[1].point.x = 2;
+  polyline[0].bulge = polyline[1].bulge = 1;
+  paths[0].flag = 2;
+  paths[0].num_path_segs = 2;
+  paths[0].bulges_present = 1;
+  paths[0].polyline_paths = polyline;
+
+  segs[0].type_status = 1;
+  segs[0].second_endpoint.x = 4;
+  segs[1].type_status = 2;
+  segs[1].center.x = 2;
+  segs[1].radius = 2;
+  segs[1].start_angle = 0;
+  segs[1].end_angle = M_PI;
+  segs[1].is_ccw = 1;
+  paths[1].num_path_segs = 2;
+  paths[1].segs = segs;
+
+  buffer_init (&buf, SMALL_VERTICES, SMALL_POLYLINES);
+  if (dwg_tessellate (&obj, tolerance, &buf) != 0 || buf.num_polylines != 2)
+    return (1);
+
+  /* Whole circle, back to its start */
+  n = buf.start[1];
+  if (n < 4 || !same_point (buf.vertex, 0, 0) || !same_point (buf.vertex + 3 * (n - 1), 0, 0)
+      || check_arc_vertices (buf.vertex, n, c1, 1, tolerance))
+    bad++;
+
+  /* Line to (4, 0), then the half circle above back to (0, 0) */
+  first = buf.start[1];
+  n = buf.num_vertices - first;
+  if (n < 4 || !same_point (buf.vertex + 3 * first, 0, 0) || !same_point (buf.vertex + 3 * (first + 1), 4, 0)
+      || !same_point (buf.vertex + 3 * (buf.num_vertices - 1), 0, 0)
+      || check_arc_vertices (buf.vertex + 3 * (first + 1), n - 1, c2, 2, tolerance))
+    bad++;
+  for (i = first + 1; i < buf.num_vertices; i++)
+    if (buf.vertex[3 * i + 1] < -1e-12)
+      bad++;
+  return (bad);
+}
+
+/** Checks of the tessellation of a drawing, printed.
+ * Returns the number of failed checks.
+ */
+static int
+check_drawing (Dwg_Struct * dwg, double tolerance)
+{
+  int bad, bad_arcs;
+  uint32_t i;
+
+  bad_arcs = check_circles (dwg, DWG_TYPE_ARC, tolerance) + check_circles (dwg, DWG_TYPE_CIRCLE, tolerance);
+  bad = check_small_buffers (dwg, DWG_TYPE_ARC, tolerance) + check_small_buffers (dwg, DWG_TYPE_CIRCLE, tolerance)
+    + check_small_buffers (dwg, DWG_TYPE_ELLIPSE, tolerance) + check_small_buffers (dwg, DWG_TYPE_SPLINE, tolerance);
+  for (i = 0; i < dwg->num_classes; i++)
+    if (dwg->dwg_class[i].vartype == DWG_CLASS_LWPLINE || dwg->dwg_class[i].vartype == DWG_CLASS_HATCH)
+      bad += check_small_buffers (dwg, 500 + i, tolerance);
+  if (bad_arcs)
+    printf ("  %d arcs or circles off their curve!\n", bad_arcs);
+  if (bad)
+    printf ("  %d types with a different output in small buffers!\n", bad);
+  return (bad_arcs + bad);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  Dwg_Tess_Buffer buf;
+  double tolerance = 0.01;
+  uint32_t i;
+  int q = 1, bad = 0, r;
+
+  if (argc > 2 && !strcmp (argv[1], "-t"))
+    {
+      tolerance = atof (argv[2]);
+      q = 3;
+    }
+  if (q >= argc)
+    {
+      puts ("Need at least one argument: a dwg filename (-t tolerance before).");
+      return (-1);
+    }
+
+  buf.vertex = (double *) malloc (3 * MAX_VERTICES * sizeof (double));
+  buf.start = (uint32_t *) malloc (MAX_POLYLINES * sizeof (uint32_t));
+  buf.object = (uint32_t *) malloc (MAX_POLYLINES * sizeof (uint32_t));
+  if (!buf.vertex || !buf.start || !buf.object)
+    return (-1);
+  buf.max_vertices = MAX_VERTICES;
+  buf.max_polylines = MAX_POLYLINES;
+
+  for (; q < argc; q++)
+    {
+      if (dwg_read_file (argv[q], &dwg))
+        {
+          printf ("%s: could not read it\n", argv[q]);
+          return (-1);
+        }
+      printf ("%s: tolerance %g\n", argv[q], tolerance);
+      bench_type (&dwg, DWG_TYPE_ARC, "ARC", tolerance, &buf);
+      bench_type (&dwg, DWG_TYPE_CIRCLE, "CIRCLE", tolerance, &buf);
+      bench_type (&dwg, DWG_TYPE_ELLIPSE, "ELLIPSE", tolerance, &buf);
+      bench_type (&dwg, DWG_TYPE_SPLINE, "SPLINE", tolerance, &buf);
+      for (i = 0; i < dwg.num_classes; i++)
+        if (dwg.dwg_class[i].vartype == DWG_CLASS_LWPLINE || dwg.dwg_class[i].vartype == DWG_CLASS_HATCH)
+          bench_type (&dwg, 500 + i, (char *) dwg.dwg_class[i].dxfname, tolerance, &buf);
+      bad += check_drawing (&dwg, tolerance);
+      dwg_free (&dwg);
+    }
+
+  r = check_lwpline (tolerance);
+  if (r)
+    printf ("LWPLINE: %d failed checks!\n", r);
+  bad += r;
+  r = check_hatch (tolerance);
+  if (r)
+    printf ("HATCH: %d failed checks!\n", r);
+  bad += r;
+  if (!bad)
+    puts ("Checks OK: arcs on their curve, small buffers, LWPLINE and HATCH.");
+
+  free (buf.vertex);
+  free (buf.start);
+  free (buf.object);
+  return (bad ? -1 : 0);
+}
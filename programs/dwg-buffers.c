@@ -0,0 +1,782 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       dwg-buffers.c
+ *     \brief      Export the model space of a DWG file as vertex and index
+ *                 buffers, ready to be drawn
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* The lines, curves (tessellated) and block insertions (exploded) of the
+ * model space go by layer and colour into groups of line segments: float32
+ * x, y, z vertices, less an origin (the center of the drawing) to keep their
+ * precision, and uint32 index pairs, from 0 in each group. The groups are
+ * packed, vertices then indices, in one little-endian binary file; a JSON
+ * manifest gives the origin, and the layer, colour, offsets (in bytes) and
+ * counts of each group.
+ *
+ * The layers are shared among threads. Each thread reuses its own buffers
+ * (grown as needed) for all its layers, and the blocks are tessellated once,
+ * before, in a cache the threads only read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "config.h"
+
+#include "dwg.h"
+
+#define COLOR_BYBLOCK 0
+#define COLOR_BYLAYER 256
+#define COLOR_DEFAULT 7
+
+/**
+ *    \struct  _buf_group
+ *    \brief   Segments of one layer and colour, in the arrays of a thread
+ */
+typedef struct _buf_group
+{
+  uint32_t layer;
+  uint32_t color;
+  uint32_t first_vertex;
+  uint32_t num_vertices;
+  uint32_t first_index;
+  uint32_t num_indices;
+} Buf_Group;
+
+/**
+ *    \struct  _buf_thread
+ *    \brief   Buffers of a thread, for all the layers it takes
+ */
+typedef struct _buf_thread
+{
+  Dwg_Tess_Buffer tess;
+
+  float *vertex; /* x, y, z of each vertex */
+  uint32_t num_vertices;
+  uint32_t max_vertices;
+  uint32_t *index;
+  uint32_t num_indices;
+  uint32_t max_indices;
+
+  Buf_Group *group;
+  uint32_t num_groups;
+  uint32_t max_groups;
+
+  /* Entities of the current layer, then sorted by colour */
+  uint32_t *order;
+  uint32_t *sorted;
+  uint8_t *order_color;
+  uint32_t max_order;
+
+  uint32_t id;
+  int fail;
+} Buf_Thread;
+
+/**
+ *    \struct  _buf_layer
+ *    \brief   A layer, and where its groups are
+ */
+typedef struct _buf_layer
+{
+  uint32_t object;
+  uint32_t color;
+  uint32_t thread;
+  uint32_t first_group;
+  uint32_t num_groups;
+} Buf_Layer;
+
+Dwg_Struct dwg;
+Dwg_Block_Cache *cache = NULL;
+double origin[3] = { 0, 0, 0 };
+double tolerance = 0;
+int num_threads = 1;
+
+Buf_Layer *layers = NULL;
+uint32_t num_layers = 0;
+uint32_t next_layer = 0;
+pthread_mutex_t next_layer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+show_usage ()
+{
+  printf ("Usage: dwg-buffers [-j N] [-t TOL] FILE\n");
+  printf ("       dwg-buffers OPTION\n");
+  puts ("");
+  printf ("FILE must be a DWG file, with a .dwg extension. Its model space\n"
+          "goes, tessellated, by layer and colour, to float32 vertex and uint32\n"
+          "index buffers (line segments), packed in a file with same basename\n"
+          "of FILE, but with its extension being bin, and described in a\n"
+          "manifest with the json extension.\n");
+  puts ("");
+  printf ("Options:\n");
+  printf ("-h, --help      show simple usage information and exit.\n");
+  printf ("-v, --version   show the program version and exit.\n");
+  printf ("-j, --jobs N    share the layers among N threads.\n");
+  printf ("-t, --tolerance TOL\n"
+          "                tessellate curves no farther than TOL from them\n"
+          "                (default: 1/10000 of the size of the drawing).\n");
+  puts ("");
+}
+
+/** Checks the extension of a dwg filename.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+check_extension (char *filename)
+{
+  char *fn;
+
+  fn = strrchr (filename, '.');
+  if (fn == NULL)
+    return (-1);
+  if (tolower (fn[1]) != 'd' || tolower (fn[2]) != 'w' || tolower (fn[3]) != 'g')
+    return (-1);
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Buffers of a thread
+ */
+
+/** Makes room in the tessellation buffer, twice as big.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+tess_grow (Dwg_Tess_Buffer * tess)
+{
+  uint32_t max_vertices, max_polylines;
+  void *p;
+
+  max_vertices = tess->max_vertices ? tess->max_vertices * 2 : 4096;
+  max_polylines = tess->max_polylines ? tess->max_polylines * 2 : 256;
+  if (max_vertices >= UINT32_MAX / 6 || max_polylines >= UINT32_MAX / 2)
+    return (-1);
+  p = realloc (tess->vertex, 3 * max_vertices * sizeof (double));
+  if (p == NULL)
+    return (-1);
+  tess->vertex = (double *) p;
+  p = realloc (tess->start, max_polylines * sizeof (uint32_t));
+  if (p == NULL)
+    return (-1);
+  tess->start = (uint32_t *) p;
+  p = realloc (tess->object, max_polylines * sizeof (uint32_t));
+  if (p == NULL)
+    return (-1);
+  tess->object = (uint32_t *) p;
+  tess->max_vertices = max_vertices;
+  tess->max_polylines = max_polylines;
+  return (0);
+}
+
+/** Makes room for count more items of size bytes in array, of *max items.
+ * Returns the array, moved or not, or NULL if out of memory (array being
+ * left as it was).
+ */
+void *
+array_reserve (void *array, uint32_t * max, uint32_t num, uint64_t count, size_t size)
+{
+  uint64_t need = num + count, m = *max ? *max : 1024;
+
+  if (need <= *max)
+    return (array);
+  while (m < need)
+    m *= 2;
+  if (m > UINT32_MAX)
+    return (NULL);
+  array = realloc (array, m * size);
+  if (array)
+    *max = m;
+  return (array);
+}
+
+/** Adds the polylines of the tessellation buffer to the last group, as
+ * segments.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+group_add_tess (Buf_Thread * t)
+{
+  Dwg_Tess_Buffer *tess = &t->tess;
+  Buf_Group *g = &t->group[t->num_groups - 1];
+  uint32_t i, j, end, base;
+  float *v;
+  double *src;
+  void *p;
+
+  p = array_reserve (t->vertex, &t->max_vertices, t->num_vertices, tess->num_vertices,
+                     3 * sizeof (float));
+  if (p == NULL)
+    return (-1);
+  t->vertex = (float *) p;
+  p = array_reserve (t->index, &t->max_indices, t->num_indices, 2 * (uint64_t) tess->num_vertices,
+                     sizeof (uint32_t));
+  if (p == NULL)
+    return (-1);
+  t->index = (uint32_t *) p;
+
+  v = t->vertex + 3 * t->num_vertices;
+  src = tess->vertex;
+  for (i = 0; i < tess->num_vertices; i++)
+    {
+      v[3 * i] = (float) (src[3 * i] - origin[0]);
+      v[3 * i + 1] = (float) (src[3 * i + 1] - origin[1]);
+      v[3 * i + 2] = (float) (src[3 * i + 2] - origin[2]);
+    }
+
+  base = t->num_vertices - g->first_vertex;
+  for (i = 0; i < tess->num_polylines; i++)
+    {
+      end = i + 1 < tess->num_polylines ? tess->start[i + 1] : tess->num_vertices;
+      for (j = tess->start[i]; j + 1 < end; j++)
+        {
+          t->index[t->num_indices++] = base + j;
+          t->index[t->num_indices++] = base + j + 1;
+        }
+    }
+  t->num_vertices += tess->num_vertices;
+  g->num_vertices += tess->num_vertices;
+  g->num_indices = t->num_indices - g->first_index;
+  return (0);
+}
+
+/** Colour of an entity, BYLAYER and BYBLOCK resolved */
+uint32_t
+entity_color (Dwg_Object * obj, Buf_Layer * layer)
+{
+  uint32_t color = obj->as.entity.color.index;
+
+  if (color == COLOR_BYLAYER)
+    color = layer->color;
+  if (color == COLOR_BYBLOCK || color > 255)
+    color = COLOR_DEFAULT;
+  return (color);
+}
+
+/** Tessellates an entity of the model space into the tessellation buffer:
+ * LINE, curves, or insertions.
+ * Returns 0 == OK; 1 == nothing to draw; -1 == FAIL.
+ */
+int
+entity_tessellate (Buf_Thread * t, Dwg_Object * obj)
+{
+  Dwg_Tess_Buffer *tess = &t->tess;
+  int ret;
+
+  do
+    {
+      tess->num_vertices = tess->num_polylines = 0;
+      if (obj->type == DWG_TYPE_LINE)
+        {
+          Dwg_Entity_LINE *e = &obj->as.entity.as.LINE;
+          if (tess->max_vertices < 2 || tess->max_polylines < 1)
+            ret = 1;
+          else
+            {
+              memcpy (tess->vertex, &e->start, 3 * sizeof (double));
+              memcpy (tess->vertex + 3, &e->end, 3 * sizeof (double));
+              tess->start[0] = 0;
+              tess->object[0] = obj->index;
+              tess->num_vertices = 2;
+              tess->num_polylines = 1;
+              ret = 0;
+            }
+        }
+      else if (obj->type == DWG_TYPE_INSERT || obj->type == DWG_TYPE_MINSERT)
+        ret = dwg_explode (obj, cache, tess);
+      else
+        ret = dwg_tessellate (obj, tolerance, tess);
+    }
+  while (ret == 1 && tess_grow (tess) == 0);
+  if (ret == 1)
+    return (-1);
+  return (ret == 0 && tess->num_vertices > 0 ? 0 : 1);
+}
+
+/** Makes the groups of a layer, one by colour.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+layer_groups (Buf_Thread * t, Buf_Layer * layer)
+{
+  Dwg_Object *obj;
+  Buf_Group *g;
+  uint32_t count[257];
+  uint32_t *entities;
+  uint32_t i, n, num, color;
+  void *p;
+
+  n = dwg_entities_on_layer (&dwg, layer->object, &entities);
+  if (n > t->max_order)
+    {
+      free (t->order);
+      free (t->sorted);
+      free (t->order_color);
+      t->order = (uint32_t *) malloc (n * sizeof (uint32_t));
+      t->sorted = (uint32_t *) malloc (n * sizeof (uint32_t));
+      t->order_color = (uint8_t *) malloc (n);
+      t->max_order = n;
+      if (t->order == NULL || t->sorted == NULL || t->order_color == NULL)
+        {
+          t->max_order = 0;
+          return (-1);
+        }
+    }
+
+  /* Model space entities, then sorted by colour (counting sort, keeping
+   * index order within a colour) */
+  memset (count, 0, sizeof (count));
+  for (i = num = 0; i < n; i++)
+    {
+      obj = &dwg.object[entities[i]];
+      if (obj->as.entity.entity_mode != 2)
+        continue;
+      t->order_color[num] = entity_color (obj, layer);
+      count[t->order_color[num] + 1]++;
+      t->order[num++] = entities[i];
+    }
+  for (color = 1; color < 257; color++)
+    count[color] += count[color - 1];
+  for (i = 0; i < num; i++)
+    t->sorted[count[t->order_color[i]]++] = t->order[i];
+
+  layer->thread = t->id;
+  layer->first_group = t->num_groups;
+  for (i = 0; i < num; i++)
+    {
+      obj = &dwg.object[t->sorted[i]];
+      color = entity_color (obj, layer);
+      g = t->num_groups > layer->first_group ? &t->group[t->num_groups - 1] : NULL;
+      if (g == NULL || g->color != color)
+        {
+          /* A new group, in place of the last one if that is empty */
+          if (g && g->num_vertices == 0)
+            t->num_groups--;
+          p = array_reserve (t->group, &t->max_groups, t->num_groups, 1, sizeof (Buf_Group));
+          if (p == NULL)
+            return (-1);
+          t->group = (Buf_Group *) p;
+          g = &t->group[t->num_groups++];
+          g->layer = layer - layers;
+          g->color = color;
+          g->first_vertex = t->num_vertices;
+          g->num_vertices = 0;
+          g->first_index = t->num_indices;
+          g->num_indices = 0;
+        }
+      switch (entity_tessellate (t, obj))
+        {
+        case 0:
+          if (group_add_tess (t))
+            return (-1);
+          break;
+        case -1:
+          return (-1);
+        }
+    }
+  if (t->num_groups > layer->first_group && t->group[t->num_groups - 1].num_vertices == 0)
+    t->num_groups--;
+  layer->num_groups = t->num_groups - layer->first_group;
+  return (0);
+}
+
+/** Thread: makes the groups of the layers not yet taken by other threads.
+ */
+void *
+buffers_thread (void *arg)
+{
+  Buf_Thread *t = (Buf_Thread *) arg;
+  uint32_t i;
+
+  while (!t->fail)
+    {
+      pthread_mutex_lock (&next_layer_mutex);
+      i = next_layer++;
+      pthread_mutex_unlock (&next_layer_mutex);
+      if (i >= num_layers)
+        break;
+      if (layer_groups (t, &layers[i]))
+        t->fail = 1;
+    }
+  return (NULL);
+}
+
+/*------------------------------------------------------------------------------
+ * Output
+ */
+
+/** Writes count values of 4 bytes, little-endian.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+write_values (FILE * fp, const void *data, uint32_t count)
+{
+  const union
+  {
+    uint32_t u;
+    uint8_t c[4];
+  } one = { 1 };
+  const uint8_t *src = (const uint8_t *) data;
+  uint8_t buf[4096];
+  uint32_t i, n, k;
+
+  if (one.c[0] == 1)
+    return (count && fwrite (data, 4, count, fp) != count ? -1 : 0);
+
+  /* Big-endian host: each value reversed */
+  for (i = 0; i < count; i += n)
+    {
+      n = count - i < sizeof (buf) / 4 ? count - i : sizeof (buf) / 4;
+      for (k = 0; k < 4 * n; k++)
+        buf[k] = src[(k & ~3) + 3 - (k & 3)];
+      src += 4 * n;
+      if (fwrite (buf, 4, n, fp) != n)
+        return (-1);
+    }
+  return (0);
+}
+
+/** Writes the characters of s escaped for a JSON string, without the
+ * quotes around them */
+void
+write_json_chars (FILE * fp, const char *s)
+{
+  const char *p;
+
+  for (p = s; *p; p++)
+    {
+      if (*p == '"' || *p == '\\')
+        fprintf (fp, "\\%c", *p);
+      else if ((unsigned char) *p < 0x20)
+        fprintf (fp, "\\u%04x", (unsigned char) *p);
+      else
+        fputc (*p, fp);
+    }
+}
+
+/** Writes a string of the drawing as a JSON string */
+void
+write_json_string (FILE * fp, BITCODE_TV str)
+{
+  char buf[1024];
+  char *s;
+  int length;
+
+  s = buf;
+  length = dwg_string_utf8 (&dwg, str, buf, sizeof (buf));
+  if (length < 0)
+    buf[0] = '\0';
+  else if (length >= (int) sizeof (buf))
+    {
+      /* Too long for buf: whole, or cut if out of memory */
+      s = (char *) malloc (length + 1);
+      if (s)
+        dwg_string_utf8 (&dwg, str, s, length + 1);
+      else
+        s = buf;
+    }
+
+  fputc ('"', fp);
+  write_json_chars (fp, s);
+  fputc ('"', fp);
+  if (s != buf)
+    free (s);
+}
+
+/** Writes the groups, layer by layer, to filename.bin, and the manifest to
+ * filename.json (filename being without extension).
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+write_buffers (char *filename, char *source, Buf_Thread * threads)
+{
+  FILE *bin, *json;
+  Buf_Thread *t;
+  Buf_Group *g;
+  char *name, *base;
+  uint64_t offset = 0;
+  uint32_t i, j, num_groups = 0;
+  int fail = 0;
+
+  name = (char *) malloc (strlen (filename) + 6);
+  if (name == NULL)
+    return (-1);
+  sprintf (name, "%s.bin", filename);
+  bin = fopen (name, "wb");
+  if (!bin)
+    {
+      printf ("Unable to write to file '%s'\n", name);
+      free (name);
+      return (-1);
+    }
+  setvbuf (bin, NULL, _IOFBF, 1 << 20);
+  sprintf (name, "%s.json", filename);
+  json = fopen (name, "w");
+  if (!json)
+    {
+      printf ("Unable to write to file '%s'\n", name);
+      fclose (bin);
+      free (name);
+      return (-1);
+    }
+  base = strrchr (filename, '/');
+  base = base ? base + 1 : filename;
+  source = strrchr (source, '/') ? strrchr (source, '/') + 1 : source;
+
+  fprintf (json, "{\n  \"version\": 1,\n  \"source\": \"");
+  write_json_chars (json, source);
+  fprintf (json, "\",\n  \"buffer\": \"");
+  write_json_chars (json, base);
+  fprintf (json, ".bin\",\n");
+  fprintf (json, "  \"origin\": [%.17g, %.17g, %.17g],\n  \"tolerance\": %.17g,\n",
+           origin[0], origin[1], origin[2], tolerance);
+  fprintf (json, "  \"primitive\": \"lines\",\n  \"vertexFormat\": \"float32x3\",\n"
+           "  \"indexFormat\": \"uint32\",\n  \"littleEndian\": true,\n  \"groups\": [");
+  for (i = 0; i < num_layers; i++)
+    {
+      t = &threads[layers[i].thread];
+      for (j = 0; j < layers[i].num_groups; j++)
+        {
+          g = &t->group[layers[i].first_group + j];
+          fail |= write_values (bin, t->vertex + 3 * (uint64_t) g->first_vertex, 3 * g->num_vertices);
+          fail |= write_values (bin, t->index + g->first_index, g->num_indices);
+
+          fprintf (json, "%s\n    { \"layer\": ", num_groups++ ? "," : "");
+          write_json_string (json, dwg.object[layers[i].object].as.nongraph.as.LAYER.entry_name);
+          fprintf (json, ", \"color\": %lu, \"vertexOffset\": %llu, \"vertexCount\": %lu, ",
+                   (unsigned long) g->color, (unsigned long long) offset,
+                   (unsigned long) g->num_vertices);
+          offset += 12 * (uint64_t) g->num_vertices;
+          fprintf (json, "\"indexOffset\": %llu, \"indexCount\": %lu }",
+                   (unsigned long long) offset, (unsigned long) g->num_indices);
+          offset += 4 * (uint64_t) g->num_indices;
+        }
+    }
+  fprintf (json, "\n  ],\n  \"byteLength\": %llu\n}\n", (unsigned long long) offset);
+
+  if (fclose (bin))
+    fail = 1;
+  if (fclose (json))
+    fail = 1;
+  if (fail)
+    printf ("Unable to write to file '%s.bin'\n", filename);
+  free (name);
+  return (fail ? -1 : 0);
+}
+
+/*------------------------------------------------------------------------------
+ * Main
+ */
+
+/** Exports the model space of a dwg file to buffers.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+buffers_convert_file (char *filename)
+{
+  Buf_Thread *threads;
+  pthread_t *thread;
+  Dwg_Bbox *box;
+  uint32_t *indexes;
+  uint64_t num_vertices = 0, num_indices = 0, num_groups = 0;
+  uint32_t i;
+  struct timespec t0, t1;
+  char *outfile;
+  int16_t color;
+  int started, fail = 0;
+
+  if (dwg_read_file (filename, &dwg))
+    return (-1);
+
+  /* Origin at the center of the drawing; tolerance from its size */
+  if (dwg_compute_extents (&dwg, num_threads) == 0)
+    {
+      box = &dwg.extents.drawing;
+      if (box->min.x <= box->max.x)
+        {
+          origin[0] = (box->min.x + box->max.x) / 2;
+          origin[1] = (box->min.y + box->max.y) / 2;
+          origin[2] = (box->min.z + box->max.z) / 2;
+          if (tolerance <= 0)
+            tolerance = 1e-4 * sqrt ((box->max.x - box->min.x) * (box->max.x - box->min.x)
+                                     + (box->max.y - box->min.y) * (box->max.y - box->min.y)
+                                     + (box->max.z - box->min.z) * (box->max.z - box->min.z));
+        }
+    }
+  if (!(tolerance > 0))
+    tolerance = 0.01;
+
+  clock_gettime (CLOCK_MONOTONIC, &t0);
+  cache = dwg_block_cache_new (&dwg, tolerance);
+  if (cache == NULL || dwg_block_cache_fill (cache))
+    {
+      puts ("Not enough memory for the blocks.");
+      dwg_block_cache_free (cache);
+      return (-1);
+    }
+
+  num_layers = dwg_entities_by_type (&dwg, DWG_TYPE_LAYER, &indexes);
+  layers = (Buf_Layer *) calloc (num_layers + 1, sizeof (Buf_Layer));
+  threads = (Buf_Thread *) calloc (num_threads, sizeof (Buf_Thread));
+  thread = (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+  if (layers == NULL || threads == NULL || thread == NULL)
+    {
+      puts ("Not enough memory for the layers.");
+      free (layers);
+      free (threads);
+      free (thread);
+      dwg_block_cache_free (cache);
+      return (-1);
+    }
+  for (i = 0; i < num_layers; i++)
+    {
+      layers[i].object = indexes[i];
+      /* Negative when the layer is off */
+      color = (int16_t) dwg.object[indexes[i]].as.nongraph.as.LAYER.color.index;
+      layers[i].color = color < 0 ? -color : color;
+    }
+
+  /* Layers shared among the threads, this one being the first */
+  next_layer = 0;
+  for (i = 0; i < (uint32_t) num_threads; i++)
+    threads[i].id = i;
+  for (started = 1; started < num_threads; started++)
+    if (pthread_create (&thread[started], NULL, buffers_thread, &threads[started]))
+      break;
+  buffers_thread (&threads[0]);
+  for (i = 1; i < (uint32_t) started; i++)
+    pthread_join (thread[i], NULL);
+  free (thread);
+  clock_gettime (CLOCK_MONOTONIC, &t1);
+
+  for (i = 0; i < (uint32_t) num_threads; i++)
+    {
+      fail |= threads[i].fail;
+      num_vertices += threads[i].num_vertices;
+      num_indices += threads[i].num_indices;
+      num_groups += threads[i].num_groups;
+    }
+  if (fail)
+    puts ("Not enough memory for the buffers.");
+  else
+    {
+      outfile = strdup (filename);
+      outfile[strlen (outfile) - 4] = '\0';
+      fail = write_buffers (outfile, filename, threads);
+      if (!fail)
+        printf ("%s.bin: %lu layers, %llu groups, %llu vertices, %llu indices "
+                "(%.3f ms, %d threads)\n", outfile, (unsigned long) num_layers,
+                (unsigned long long) num_groups, (unsigned long long) num_vertices,
+                (unsigned long long) num_indices, (t1.tv_sec - t0.tv_sec) * 1e3
+                + (t1.tv_nsec - t0.tv_nsec) / 1e6, num_threads);
+      free (outfile);
+    }
+
+  for (i = 0; i < (uint32_t) num_threads; i++)
+    {
+      free (threads[i].tess.vertex);
+      free (threads[i].tess.start);
+      free (threads[i].tess.object);
+      free (threads[i].vertex);
+      free (threads[i].index);
+      free (threads[i].group);
+      free (threads[i].order);
+      free (threads[i].sorted);
+      free (threads[i].order_color);
+    }
+  free (threads);
+  free (layers);
+  dwg_block_cache_free (cache);
+  return (fail ? -1 : 0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  char *filename = NULL;
+  int i, fail;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp ("-h", argv[i]) == 0 || strcmp ("--help", argv[i]) == 0)
+        {
+          show_usage ();
+          return (0);
+        }
+      if (strcmp ("-v", argv[i]) == 0 || strcmp ("--version", argv[i]) == 0)
+        {
+          printf ("dwg-buffers %s\n", PACKAGE_VERSION);
+          return (0);
+        }
+      if (strcmp ("-j", argv[i]) == 0 || strcmp ("--jobs", argv[i]) == 0)
+        {
+          if (i + 1 == argc || atoi (argv[i + 1]) < 1)
+            {
+              show_usage ();
+              printf ("Option %s needs a number of jobs.\n", argv[i]);
+              return (-1);
+            }
+          num_threads = atoi (argv[++i]);
+          continue;
+        }
+      if (strcmp ("-t", argv[i]) == 0 || strcmp ("--tolerance", argv[i]) == 0)
+        {
+          if (i + 1 == argc || !(atof (argv[i + 1]) > 0))
+            {
+              show_usage ();
+              printf ("Option %s needs a tolerance above 0.\n", argv[i]);
+              return (-1);
+            }
+          tolerance = atof (argv[++i]);
+          continue;
+        }
+      if (argv[i][0] == '-')
+        {
+          show_usage ();
+          printf ("Option not available: %s\n", argv[i]);
+          return (-1);
+        }
+      if (filename)
+        {
+          show_usage ();
+          printf ("Only one input file at a time: %s\n", argv[i]);
+          return (-1);
+        }
+      filename = argv[i];
+    }
+  if (filename == NULL)
+    {
+      show_usage ();
+      printf ("No input file specified.\n");
+      return (-1);
+    }
+  if (check_extension (filename))
+    {
+      show_usage ();
+      printf ("The input file extension should be like .dwg: %s\n", filename);
+      return (-1);
+    }
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  fail = buffers_convert_file (filename);
+  dwg_free (&dwg);
+  return (fail ? -1 : 0);
+}
@@ -0,0 +1,775 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       dwg-columns.c
+ *     \brief      Export the geometry of a DWG file in columns, binary mode.
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* The output file is made of blocks of columns, each column an array of
+ * values of one type. Everything is little-endian, and each column starts on
+ * 64 bytes, so that a reader may map the file and use the columns in place:
+ *
+ *   header     "DWGCOLS\0", uint32 version (1), uint32 number of blocks,
+ *              uint32 number of columns, uint32 0, uint64 file size
+ *   blocks     for each: char name[16], uint32 number of rows, uint32 first
+ *              column, uint32 number of columns, uint32 0
+ *   columns    for each: char name[16], uint32 type (1 == uint32, 2 ==
+ *              float64, 3 == uint8), uint32 0, uint64 number of values,
+ *              uint64 offset of the values in the file, uint64 bytes
+ *   values     of each column, in order
+ *
+ * Names are ended by '\0' (at most 15 characters). The blocks are:
+ *
+ *   LAYERS     the layer table: "offset" (rows + 1 values) and "chars"
+ *              (UTF-8) give the name of each layer, from chars[offset[i]] to
+ *              chars[offset[i + 1]] (names may repeat); "handle"
+ *   STRINGS    the text values, a string dictionary: as LAYERS, but with a
+ *              row for each distinct string
+ *   ENTITIES   "handle", "type" and "layer" of every entity, the layer being a
+ *              row of LAYERS (0xFFFFFFFF if none)
+ *   LINE, CIRCLE, ARC, POINT, LWPLINE, TEXT
+ *              "handle" and "layer" of the entities of a type, then their
+ *              geometry (see Dwg_Geometry); LWPLINE gives the vertices of
+ *              polyline i from "first"[i] to "first"[i + 1] in
+ *   LWPLINE_VERTEX
+ *              "x", "y" and "bulge"; TEXT (TEXT and MTEXT) gives "value" as a
+ *              row of STRINGS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "config.h"
+
+#include "dwg.h"
+
+#define COL_MAGIC "DWGCOLS"
+#define COL_VERSION 1
+#define COL_ALIGN 64
+#define COL_BUFFER (1 << 20)
+#define COL_MAX_BLOCKS 16
+#define COL_MAX_COLUMNS 96
+#define COL_MAX_ARRAYS 64
+#define COL_NONE 0xFFFFFFFF
+
+/* Column types */
+#define COL_U32 1
+#define COL_F64 2
+#define COL_U8 3
+
+typedef struct _col_block
+{
+  const char *name;
+  uint32_t num_rows;
+  uint32_t first;
+  uint32_t num_columns;
+} Col_Block;
+
+typedef struct _col_column
+{
+  const char *name;
+  uint32_t type;
+  uint64_t count;
+  const void *data;
+  uint64_t offset;
+} Col_Column;
+
+/**
+ *    \struct  _col_dict
+ *    \brief   Dictionary of strings, each given a row in the order they come:
+ *             distinct strings (see dict_add), or all of them (see
+ *             dict_append)
+ */
+typedef struct _col_dict
+{
+  uint32_t num;
+  uint32_t max;
+  uint32_t *offset;
+  uint8_t *chars;
+  uint32_t num_chars;
+  uint32_t max_chars;
+
+  /* Open addressing hash table of the rows (+ 1, 0 == empty) */
+  uint32_t size;
+  uint32_t *slot;
+} Col_Dict;
+
+Col_Block blocks[COL_MAX_BLOCKS];
+uint32_t num_blocks = 0;
+Col_Column columns[COL_MAX_COLUMNS];
+uint32_t num_columns = 0;
+
+/* Arrays made for the columns, freed at the end */
+void *arrays[COL_MAX_ARRAYS];
+uint32_t num_arrays = 0;
+
+void
+show_usage ()
+{
+  printf ("Usage: dwg-columns FILE\n");
+  printf ("       dwg-columns OPTION\n");
+  puts ("");
+  printf ("FILE must be a DWG file, with a .dwg extension. The geometry of\n"
+          "its entities, with their handles and layers, goes in columns to a\n"
+          "binary file with same basename of FILE, but with its extension\n"
+          "being dwgc (see the head of dwg-columns.c for the format).\n");
+  puts ("");
+  printf ("Options:\n");
+  printf ("-h, --help      show simple usage information and exit.\n");
+  printf ("-v, --version   show the program version and exit.\n");
+  puts ("");
+}
+
+/** Checks the extension of a dwg filename.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+check_extension (char *filename)
+{
+  char *fn;
+
+  fn = strrchr (filename, '.');
+  if (fn == NULL)
+    return (-1);
+  if (tolower (fn[1]) != 'd' || tolower (fn[2]) != 'w' || tolower (fn[3]) != 'g')
+    return (-1);
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Blocks, columns and dictionaries
+ */
+
+void
+block_begin (const char *name, uint32_t num_rows)
+{
+  Col_Block *b = &blocks[num_blocks++];
+
+  b->name = name;
+  b->num_rows = num_rows;
+  b->first = num_columns;
+  b->num_columns = 0;
+}
+
+void
+column_add (const char *name, uint32_t type, uint64_t count, const void *data)
+{
+  Col_Column *c = &columns[num_columns++];
+
+  c->name = name;
+  c->type = type;
+  c->count = count;
+  c->data = data;
+  blocks[num_blocks - 1].num_columns++;
+}
+
+/** Allocates an array for a column, freed at the end; NULL if out of memory */
+void *
+array_new (uint64_t size)
+{
+  void *p;
+
+  if (num_arrays == COL_MAX_ARRAYS)
+    return (NULL);
+  p = malloc (size ? size : 1);
+  if (p)
+    arrays[num_arrays++] = p;
+  return (p);
+}
+
+uint32_t
+dict_hash (const uint8_t * str, uint32_t length)
+{
+  uint32_t h = 2166136261u, i;
+
+  for (i = 0; i < length; i++)
+    h = (h ^ str[i]) * 16777619u;
+  return (h);
+}
+
+/** Doubles the hash table of a dictionary.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dict_grow (Col_Dict * dict)
+{
+  uint32_t *slot, size, i, j, row;
+
+  size = dict->size ? dict->size * 2 : 256;
+  slot = (uint32_t *) calloc (size, sizeof (uint32_t));
+  if (slot == NULL)
+    return (-1);
+  for (i = 0; i < dict->size; i++)
+    {
+      if ((row = dict->slot[i]) == 0)
+        continue;
+      j = dict_hash (dict->chars + dict->offset[row - 1],
+                     dict->offset[row] - dict->offset[row - 1]) & (size - 1);
+      while (slot[j])
+        j = (j + 1) & (size - 1);
+      slot[j] = row;
+    }
+  free (dict->slot);
+  dict->slot = slot;
+  dict->size = size;
+  return (0);
+}
+
+/** Adds a row for a string to a dictionary, without looking for it (the
+ * hash table is not kept).
+ * Returns the row, or COL_NONE if out of memory.
+ */
+uint32_t
+dict_append (Col_Dict * dict, const char *str, uint32_t length)
+{
+  void *p;
+
+  if (dict->num + 2 > dict->max)
+    {
+      dict->max = dict->max ? dict->max * 2 : 256;
+      p = realloc (dict->offset, dict->max * sizeof (uint32_t));
+      if (p == NULL)
+        return (COL_NONE);
+      dict->offset = (uint32_t *) p;
+    }
+  if (dict->num_chars + length > dict->max_chars)
+    {
+      while (dict->num_chars + length > dict->max_chars)
+        dict->max_chars = dict->max_chars ? dict->max_chars * 2 : 4096;
+      p = realloc (dict->chars, dict->max_chars);
+      if (p == NULL)
+        return (COL_NONE);
+      dict->chars = (uint8_t *) p;
+    }
+  if (dict->num == 0)
+    dict->offset[0] = 0;
+  /* An empty string has no characters, and maybe none to copy them to */
+  if (length)
+    memcpy (dict->chars + dict->num_chars, str, length);
+  dict->num_chars += length;
+  dict->num++;
+  dict->offset[dict->num] = dict->num_chars;
+  return (dict->num - 1);
+}
+
+/** Gets the row of a string of a dictionary, adding it if needed.
+ * Returns the row, or COL_NONE if out of memory.
+ */
+uint32_t
+dict_add (Col_Dict * dict, const char *str, uint32_t length)
+{
+  uint32_t i, row;
+
+  if (2 * (dict->num + 1) > dict->size && dict_grow (dict))
+    return (COL_NONE);
+  for (i = dict_hash ((uint8_t *) str, length) & (dict->size - 1); (row = dict->slot[i]);
+       i = (i + 1) & (dict->size - 1))
+    if (dict->offset[row] - dict->offset[row - 1] == length
+        && (length == 0 || !memcmp (dict->chars + dict->offset[row - 1], str, length)))
+      return (row - 1);
+
+  row = dict_append (dict, str, length);
+  if (row != COL_NONE)
+    dict->slot[i] = row + 1;
+  return (row);
+}
+
+/** Converts a text string of the drawing to UTF-8, in a buffer kept for the
+ * next call; no string is an empty one.
+ * Returns the UTF-8 string, of length bytes, or NULL if out of memory.
+ */
+const char *
+string_utf8 (Dwg_Struct * dwg, BITCODE_TV str, uint32_t * length)
+{
+  static char *buf = NULL;
+  static uint32_t cap = 0;
+  int n;
+
+  *length = 0;
+  n = dwg_string_utf8 (dwg, str, buf, cap);
+  if (n <= 0)
+    return ("");
+  if ((uint32_t) n >= cap)
+    {
+      free (buf);
+      cap = n + 1 > 4096 ? n + 1 : 4096;
+      buf = (char *) malloc (cap);
+      if (buf == NULL)
+        {
+          cap = 0;
+          return (NULL);
+        }
+      dwg_string_utf8 (dwg, str, buf, cap);
+    }
+  *length = n;
+  return (buf);
+}
+
+/** Adds a text string of the drawing to a dictionary, in UTF-8.
+ * Returns its row, or COL_NONE if out of memory.
+ */
+uint32_t
+dict_add_string (Col_Dict * dict, Dwg_Struct * dwg, BITCODE_TV str)
+{
+  const char *buf;
+  uint32_t length;
+
+  buf = string_utf8 (dwg, str, &length);
+  if (buf == NULL)
+    return (COL_NONE);
+  return (dict_add (dict, buf, length));
+}
+
+/** Adds the "offset" and "chars" columns of a dictionary.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dict_columns (Col_Dict * dict)
+{
+  if (dict->num == 0)
+    {
+      /* A single offset, of the empty dictionary */
+      dict->offset = (uint32_t *) calloc (1, sizeof (uint32_t));
+      if (dict->offset == NULL)
+        return (-1);
+    }
+  column_add ("offset", COL_U32, (uint64_t) dict->num + 1, dict->offset);
+  column_add ("chars", COL_U8, dict->num_chars, dict->chars);
+  return (0);
+}
+
+void
+dict_free (Col_Dict * dict)
+{
+  free (dict->offset);
+  free (dict->chars);
+  free (dict->slot);
+}
+
+/*------------------------------------------------------------------------------
+ * Output
+ */
+
+/** Writes count values of a column, of size bytes each, little-endian.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+write_values (FILE * fp, const void *data, uint64_t count, uint32_t size)
+{
+  const union
+  {
+    uint32_t u;
+    uint8_t c[4];
+  } one = { 1 };
+  const uint8_t *src = (const uint8_t *) data;
+  uint8_t buf[4096];
+  uint64_t i, n;
+  uint32_t k;
+
+  if (one.c[0] == 1 || size == 1)
+    return (count && fwrite (data, size, count, fp) != count ? -1 : 0);
+
+  /* Big-endian host: each value reversed */
+  for (i = 0; i < count; i += n)
+    {
+      n = count - i < sizeof (buf) / size ? count - i : sizeof (buf) / size;
+      for (k = 0; k < n * size; k++)
+        buf[k] = src[(k / size) * size + size - 1 - k % size];
+      src += n * size;
+      if (fwrite (buf, size, n, fp) != n)
+        return (-1);
+    }
+  return (0);
+}
+
+int
+write_u32 (FILE * fp, uint32_t v)
+{
+  return (write_values (fp, &v, 1, 4));
+}
+
+int
+write_u64 (FILE * fp, uint64_t v)
+{
+  return (write_values (fp, &v, 1, 8));
+}
+
+int
+write_name (FILE * fp, const char *name)
+{
+  char buf[16];
+
+  memset (buf, 0, 16);
+  strncpy (buf, name, 15);
+  return (fwrite (buf, 1, 16, fp) != 16 ? -1 : 0);
+}
+
+uint32_t
+type_size (uint32_t type)
+{
+  return (type == COL_U8 ? 1 : type == COL_U32 ? 4 : 8);
+}
+
+/** Writes the blocks and columns to a file, in one sequential pass.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+write_file (const char *filename)
+{
+  static const char zero[COL_ALIGN] = { 0 };
+  FILE *fp;
+  uint64_t offset, size;
+  uint32_t i;
+  int fail = 0;
+
+  /* Layout: the directory, then the columns, each on 64 bytes */
+  offset = 32 + 32 * num_blocks + 48 * num_columns;
+  for (i = 0; i < num_columns; i++)
+    {
+      offset = (offset + COL_ALIGN - 1) & ~(uint64_t) (COL_ALIGN - 1);
+      columns[i].offset = offset;
+      offset += columns[i].count * type_size (columns[i].type);
+    }
+  size = offset;
+
+  fp = fopen (filename, "wb");
+  if (!fp)
+    {
+      printf ("Unable to write to file '%s'\n", filename);
+      return (-1);
+    }
+  setvbuf (fp, NULL, _IOFBF, COL_BUFFER);
+
+  fail |= fwrite (COL_MAGIC, 1, 8, fp) != 8;
+  fail |= write_u32 (fp, COL_VERSION);
+  fail |= write_u32 (fp, num_blocks);
+  fail |= write_u32 (fp, num_columns);
+  fail |= write_u32 (fp, 0);
+  fail |= write_u64 (fp, size);
+  for (i = 0; i < num_blocks; i++)
+    {
+      fail |= write_name (fp, blocks[i].name);
+      fail |= write_u32 (fp, blocks[i].num_rows);
+      fail |= write_u32 (fp, blocks[i].first);
+      fail |= write_u32 (fp, blocks[i].num_columns);
+      fail |= write_u32 (fp, 0);
+    }
+  offset = 32 + 32 * num_blocks;
+  for (i = 0; i < num_columns; i++)
+    {
+      fail |= write_name (fp, columns[i].name);
+      fail |= write_u32 (fp, columns[i].type);
+      fail |= write_u32 (fp, 0);
+      fail |= write_u64 (fp, columns[i].count);
+      fail |= write_u64 (fp, columns[i].offset);
+      fail |= write_u64 (fp, columns[i].count * type_size (columns[i].type));
+      offset += 48;
+    }
+  for (i = 0; i < num_columns && !fail; i++)
+    {
+      fail |= fwrite (zero, 1, columns[i].offset - offset, fp) != columns[i].offset - offset;
+      fail |= write_values (fp, columns[i].data, columns[i].count, type_size (columns[i].type));
+      offset = columns[i].offset + columns[i].count * type_size (columns[i].type);
+    }
+  if (fclose (fp))
+    fail = 1;
+  if (fail)
+    {
+      printf ("Unable to write to file '%s'\n", filename);
+      return (-1);
+    }
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Blocks of the drawing
+ */
+
+/** Adds the "handle" and "layer" columns of the entities of objects */
+int
+entity_columns (Dwg_Struct * dwg, uint32_t * layer_of, uint32_t * objects, uint32_t num)
+{
+  uint32_t *handle, *layer, i;
+
+  handle = (uint32_t *) array_new ((uint64_t) num * sizeof (uint32_t));
+  layer = (uint32_t *) array_new ((uint64_t) num * sizeof (uint32_t));
+  if (handle == NULL || layer == NULL)
+    return (-1);
+  for (i = 0; i < num; i++)
+    {
+      handle[i] = dwg->object[objects[i]].handle.value;
+      layer[i] = layer_of[objects[i]];
+    }
+  column_add ("handle", COL_U32, num, handle);
+  column_add ("layer", COL_U32, num, layer);
+  return (0);
+}
+
+void
+arc_columns (Dwg_Geometry_Arc * arc)
+{
+  column_add ("center_x", COL_F64, arc->num, arc->center_x);
+  column_add ("center_y", COL_F64, arc->num, arc->center_y);
+  column_add ("center_z", COL_F64, arc->num, arc->center_z);
+  column_add ("radius", COL_F64, arc->num, arc->radius);
+  column_add ("start_angle", COL_F64, arc->num, arc->start_angle);
+  column_add ("end_angle", COL_F64, arc->num, arc->end_angle);
+  column_add ("normal_x", COL_F64, arc->num, arc->normal_x);
+  column_add ("normal_y", COL_F64, arc->num, arc->normal_y);
+  column_add ("normal_z", COL_F64, arc->num, arc->normal_z);
+}
+
+/** Adds the TEXT block: TEXT (insertion point in its object coordinate
+ * system, at its elevation) and MTEXT entities.
+ */
+int
+text_columns (Dwg_Struct * dwg, uint32_t * layer_of, Col_Dict * strings)
+{
+  uint32_t *texts, *mtexts, *objects, *value;
+  uint32_t num_texts, num_mtexts, num, i;
+  double *x, *y, *z, *height;
+
+  num_texts = dwg_entities_by_type (dwg, DWG_TYPE_TEXT, &texts);
+  num_mtexts = dwg_entities_by_type (dwg, DWG_TYPE_MTEXT, &mtexts);
+  num = num_texts + num_mtexts;
+  objects = (uint32_t *) array_new ((uint64_t) num * sizeof (uint32_t));
+  value = (uint32_t *) array_new ((uint64_t) num * sizeof (uint32_t));
+  x = (double *) array_new ((uint64_t) num * sizeof (double));
+  y = (double *) array_new ((uint64_t) num * sizeof (double));
+  z = (double *) array_new ((uint64_t) num * sizeof (double));
+  height = (double *) array_new ((uint64_t) num * sizeof (double));
+  if (!objects || !value || !x || !y || !z || !height)
+    return (-1);
+
+  for (i = 0; i < num_texts; i++)
+    {
+      Dwg_Entity_TEXT *e = &dwg->object[texts[i]].as.entity.as.TEXT;
+      objects[i] = texts[i];
+      x[i] = e->insertion_pt.x;
+      y[i] = e->insertion_pt.y;
+      z[i] = e->elevation;
+      height[i] = e->height;
+      value[i] = dict_add_string (strings, dwg, e->text_value);
+      if (value[i] == COL_NONE)
+        return (-1);
+    }
+  for (i = 0; i < num_mtexts; i++)
+    {
+      Dwg_Entity_MTEXT *e = &dwg->object[mtexts[i]].as.entity.as.MTEXT;
+      objects[num_texts + i] = mtexts[i];
+      x[num_texts + i] = e->insertion_pt.x;
+      y[num_texts + i] = e->insertion_pt.y;
+      z[num_texts + i] = e->insertion_pt.z;
+      height[num_texts + i] = e->text_height;
+      value[num_texts + i] = dict_add_string (strings, dwg, e->text);
+      if (value[num_texts + i] == COL_NONE)
+        return (-1);
+    }
+
+  block_begin ("TEXT", num);
+  if (entity_columns (dwg, layer_of, objects, num))
+    return (-1);
+  column_add ("x", COL_F64, num, x);
+  column_add ("y", COL_F64, num, y);
+  column_add ("z", COL_F64, num, z);
+  column_add ("height", COL_F64, num, height);
+  column_add ("value", COL_U32, num, value);
+  return (0);
+}
+
+/** Exports one dwg file to columns.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+columns_convert_file (char *filename, Dwg_Struct * dwg)
+{
+  Dwg_Geometry *geo;
+  Col_Dict layers, strings;
+  uint32_t *layer_of, *layer_handle, *indexes, *entities, *handle, *type, *layer;
+  uint32_t i, j, k, n, length, num_layers, num_entities;
+  const char *name;
+  char *outfile;
+  long size;
+  int fail = -1;
+
+  if (dwg_read_file (filename, dwg))
+    return (-1);
+  geo = dwg_geometry_new (dwg);
+  memset (&layers, 0, sizeof (Col_Dict));
+  memset (&strings, 0, sizeof (Col_Dict));
+  layer_of = (uint32_t *) malloc ((dwg->num_objects + 1) * sizeof (uint32_t));
+  if (geo == NULL || layer_of == NULL)
+    goto end;
+
+  /* Layers, from the layer index */
+  num_layers = dwg_entities_by_type (dwg, DWG_TYPE_LAYER, &indexes);
+  layer_handle = (uint32_t *) array_new ((uint64_t) num_layers * sizeof (uint32_t));
+  if (layer_handle == NULL)
+    goto end;
+  for (i = 0; i < dwg->num_objects; i++)
+    layer_of[i] = COL_NONE;
+  for (i = 0; i < num_layers; i++)
+    {
+      /* A name for each layer, the same name twice included: the rows are
+       * those of the layers */
+      name = string_utf8 (dwg, dwg->object[indexes[i]].as.nongraph.as.LAYER.entry_name, &length);
+      if (name == NULL || dict_append (&layers, name, length) == COL_NONE)
+        goto end;
+      layer_handle[i] = dwg->object[indexes[i]].handle.value;
+      n = dwg_entities_on_layer (dwg, indexes[i], &entities);
+      for (j = 0; j < n; j++)
+        layer_of[entities[j]] = i;
+    }
+
+  /* Entities */
+  num_entities = 0;
+  for (i = 0; i < dwg->num_objects; i++)
+    if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+      num_entities++;
+  handle = (uint32_t *) array_new ((uint64_t) num_entities * sizeof (uint32_t));
+  type = (uint32_t *) array_new ((uint64_t) num_entities * sizeof (uint32_t));
+  layer = (uint32_t *) array_new ((uint64_t) num_entities * sizeof (uint32_t));
+  if (!handle || !type || !layer)
+    goto end;
+  for (i = k = 0; i < dwg->num_objects; i++)
+    {
+      if (dwg->object[i].supertype != DWG_SUPERTYPE_ENTITY)
+        continue;
+      handle[k] = dwg->object[i].handle.value;
+      type[k] = dwg->object[i].type;
+      layer[k] = layer_of[i];
+      k++;
+    }
+
+  block_begin ("LAYERS", num_layers);
+  if (dict_columns (&layers))
+    goto end;
+  column_add ("handle", COL_U32, num_layers, layer_handle);
+
+  block_begin ("ENTITIES", num_entities);
+  column_add ("handle", COL_U32, num_entities, handle);
+  column_add ("type", COL_U32, num_entities, type);
+  column_add ("layer", COL_U32, num_entities, layer);
+
+  block_begin ("LINE", geo->line.num);
+  if (entity_columns (dwg, layer_of, geo->line.object, geo->line.num))
+    goto end;
+  column_add ("start_x", COL_F64, geo->line.num, geo->line.start_x);
+  column_add ("start_y", COL_F64, geo->line.num, geo->line.start_y);
+  column_add ("start_z", COL_F64, geo->line.num, geo->line.start_z);
+  column_add ("end_x", COL_F64, geo->line.num, geo->line.end_x);
+  column_add ("end_y", COL_F64, geo->line.num, geo->line.end_y);
+  column_add ("end_z", COL_F64, geo->line.num, geo->line.end_z);
+
+  block_begin ("CIRCLE", geo->circle.num);
+  if (entity_columns (dwg, layer_of, geo->circle.object, geo->circle.num))
+    goto end;
+  arc_columns (&geo->circle);
+
+  block_begin ("ARC", geo->arc.num);
+  if (entity_columns (dwg, layer_of, geo->arc.object, geo->arc.num))
+    goto end;
+  arc_columns (&geo->arc);
+
+  block_begin ("POINT", geo->point.num);
+  if (entity_columns (dwg, layer_of, geo->point.object, geo->point.num))
+    goto end;
+  column_add ("x", COL_F64, geo->point.num, geo->point.x);
+  column_add ("y", COL_F64, geo->point.num, geo->point.y);
+  column_add ("z", COL_F64, geo->point.num, geo->point.z);
+
+  block_begin ("LWPLINE", geo->lwpline.num);
+  if (entity_columns (dwg, layer_of, geo->lwpline.object, geo->lwpline.num))
+    goto end;
+  column_add ("first", COL_U32, (uint64_t) geo->lwpline.num + 1, geo->lwpline.first);
+  column_add ("flags", COL_U32, geo->lwpline.num, geo->lwpline.flags);
+  column_add ("elevation", COL_F64, geo->lwpline.num, geo->lwpline.elevation);
+  column_add ("normal_x", COL_F64, geo->lwpline.num, geo->lwpline.normal_x);
+  column_add ("normal_y", COL_F64, geo->lwpline.num, geo->lwpline.normal_y);
+  column_add ("normal_z", COL_F64, geo->lwpline.num, geo->lwpline.normal_z);
+
+  block_begin ("LWPLINE_VERTEX", geo->lwpline.num_vertices);
+  column_add ("x", COL_F64, geo->lwpline.num_vertices, geo->lwpline.x);
+  column_add ("y", COL_F64, geo->lwpline.num_vertices, geo->lwpline.y);
+  column_add ("bulge", COL_F64, geo->lwpline.num_vertices, geo->lwpline.bulge);
+
+  if (text_columns (dwg, layer_of, &strings))
+    goto end;
+  block_begin ("STRINGS", strings.num);
+  if (dict_columns (&strings))
+    goto end;
+
+  /* Output filename: the input one, with the dwgc extension */
+  size = strlen (filename);
+  outfile = (char *) malloc (size + 2);
+  if (outfile == NULL)
+    goto end;
+  strcpy (outfile, filename);
+  strcpy (outfile + size - 4, ".dwgc");
+  fail = write_file (outfile);
+  if (!fail)
+    printf ("%s: %lu blocks, %lu columns, %lu entities\n", outfile, (unsigned long) num_blocks,
+            (unsigned long) num_columns, (unsigned long) num_entities);
+  free (outfile);
+
+end:
+  if (fail)
+    puts ("Failed, sorry.");
+  for (i = 0; i < num_arrays; i++)
+    free (arrays[i]);
+  dict_free (&layers);
+  dict_free (&strings);
+  free (layer_of);
+  dwg_geometry_free (geo);
+  return (fail);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Dwg_Struct dwg;
+  int fail;
+
+  if (argc != 2)
+    {
+      show_usage ();
+      printf ("No input file specified.\n");
+      return (-1);
+    }
+  if (strcmp ("-h", argv[1]) == 0 || strcmp ("--help", argv[1]) == 0)
+    {
+      show_usage ();
+      return (0);
+    }
+  if (strcmp ("-v", argv[1]) == 0 || strcmp ("--version", argv[1]) == 0)
+    {
+      printf ("dwg-columns %s\n", PACKAGE_VERSION);
+      return (0);
+    }
+  if (check_extension (argv[1]))
+    {
+      show_usage ();
+      printf ("The input file extension should be like .dwg: %s\n", argv[1]);
+      return (-1);
+    }
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  fail = columns_convert_file (argv[1], &dwg);
+  dwg_free (&dwg);
+  return (fail ? -1 : 0);
+}
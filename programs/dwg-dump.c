@@ -280,46 +280,69 @@ dump_objects (Dwg_Struct * dwg)
 	  j = obj->type - 500;
 	  if (j >= dwg->num_classes)
 	    printf ("Unknown type, not dumping: %u\n", obj->type);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "DICTIONARYVAR"))
-	    dump_DICTIONARYVAR (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "ACDBDICTIONARYWDFLT"))
-	    dump_DICTIONARYWDLFT (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "HATCH"))
-	    dump_HATCH (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "IDBUFFER"))
-	    dump_IDBUFFER (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "IMAGE"))
-	    dump_IMAGE (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "IMAGEDEF"))
-	    dump_IMAGEDEF (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "IMAGEDEF_REACTOR"))
-	    dump_IMAGEDEFREACTOR (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "LAYER_INDEX"))
-	    dump_LAYER_INDEX (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "LAYOUT"))
-	    dump_LAYOUT (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "LWPLINE"))
-	    dump_LWPLINE (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "OLE2FRAME"))
-	    dump_OLE2FRAME (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "ACDBPLACEHOLDER"))
-	    dump_PLACEHOLDER (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "RASTERVARIABLES"))
-	    dump_RASTERVARIABLES (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "SORTENTSTABLE"))
-	    dump_SORTENTSTABLE (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "SPATIAL_FILTER"))
-	    dump_SPATIAL_FILTER (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "SPATIAL_INDEX"))
-	    dump_SPATIAL_INDEX (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "XRECORD"))
-	    dump_XRECORD (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "WIPEOUT"))
-	    dump_IMAGE (&dat, obj);
-	  else if (!strcmp ((const char *) dwg->dwg_class[j].dxfname, "WIPEOUTVARIABLES"))
-	    dump_WIPEOUTVARIABLES (&dat, obj);
 	  else
-	    printf ("Unknown variable type, not dumping: %u\n", obj->type);
+	    switch (dwg->dwg_class[j].vartype)
+	      {
+	    case DWG_CLASS_DICTIONARYVAR:
+	      dump_DICTIONARYVAR (&dat, obj);
+	      break;
+	    case DWG_CLASS_DICTIONARYWDLFT:
+	      dump_DICTIONARYWDLFT (&dat, obj);
+	      break;
+	    case DWG_CLASS_HATCH:
+	      dump_HATCH (&dat, obj);
+	      break;
+	    case DWG_CLASS_IDBUFFER:
+	      dump_IDBUFFER (&dat, obj);
+	      break;
+	    case DWG_CLASS_IMAGE:
+	      dump_IMAGE (&dat, obj);
+	      break;
+	    case DWG_CLASS_IMAGEDEF:
+	      dump_IMAGEDEF (&dat, obj);
+	      break;
+	    case DWG_CLASS_IMAGEDEFREACTOR:
+	      dump_IMAGEDEFREACTOR (&dat, obj);
+	      break;
+	    case DWG_CLASS_LAYER_INDEX:
+	      dump_LAYER_INDEX (&dat, obj);
+	      break;
+	    case DWG_CLASS_LAYOUT:
+	      dump_LAYOUT (&dat, obj);
+	      break;
+	    case DWG_CLASS_LWPLINE:
+	      dump_LWPLINE (&dat, obj);
+	      break;
+	    case DWG_CLASS_OLE2FRAME:
+	      dump_OLE2FRAME (&dat, obj);
+	      break;
+	    case DWG_CLASS_PLACEHOLDER:
+	      dump_PLACEHOLDER (&dat, obj);
+	      break;
+	    case DWG_CLASS_RASTERVARIABLES:
+	      dump_RASTERVARIABLES (&dat, obj);
+	      break;
+	    case DWG_CLASS_SORTENTSTABLE:
+	      dump_SORTENTSTABLE (&dat, obj);
+	      break;
+	    case DWG_CLASS_SPATIAL_FILTER:
+	      dump_SPATIAL_FILTER (&dat, obj);
+	      break;
+	    case DWG_CLASS_SPATIAL_INDEX:
+	      dump_SPATIAL_INDEX (&dat, obj);
+	      break;
+	    case DWG_CLASS_XRECORD:
+	      dump_XRECORD (&dat, obj);
+	      break;
+	    case DWG_CLASS_WIPEOUT:
+	      dump_IMAGE (&dat, obj);
+	      break;
+	    case DWG_CLASS_WIPEOUTVARIABLES:
+	      dump_WIPEOUTVARIABLES (&dat, obj);
+	      break;
+	      default:
+		printf ("Unknown variable type, not dumping: %u\n", obj->type);
+	      }
 	}
     }
   free (dat.chain);
@@ -25,120 +25,233 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
+#include <time.h>
+#include <pthread.h>
 #include "config.h"
 
 #include "dwg.h"
 #include "logging.h"
 #include "dwg-dxf.h"
 
-/* Global vars
+/* Global vars, one set for each converting thread
  */
-FILE * fp;
-char tmp[4096];
-char * format_s;
-int * checked_obj;
+LOG_THREAD FILE * fp;
+LOG_THREAD char tmp[4096];
+LOG_THREAD char * format_s;
+LOG_THREAD int * checked_obj;
+LOG_THREAD int viewport_stack;
+
+/* Batch mode: list of files to convert and its results
+ */
+typedef struct _dxf_file
+{
+  char *filename;
+  int fail;
+  double seconds;
+  char *error;
+} Dxf_File;
+
+Dxf_File *files = NULL;
+uint32_t num_files = 0;
+uint32_t next_file = 0;
+int num_threads = 0;
+pthread_mutex_t next_file_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void
 show_usage ()
 {
   printf ("Usage: dwg-dxf FILE\n");
+  printf ("       dwg-dxf [-j N] FILE FILE...\n");
+  printf ("       dwg-dxf [-j N] -\n");
   printf ("       dwg-dxf OPTION\n");
   puts ("");
   printf ("FILE must be a DWG file, with a .dwg extension. Only versions\n"
 	  "%s to %s are accepted for now. The output goes to a file\n"
 	  "with same basename of FILE, but with its extension being dxf.\n",
 	  "R13", "R2004");
+  printf ("With more than one FILE, or with '-' (the FILE names are read\n"
+	  "from stdin, one per line), the files are converted in batch mode,\n"
+	  "and a report of the time spent and of the failures is shown.\n");
   puts ("");
-  printf ("Options (one at time):\n");
+  printf ("Options:\n");
   printf ("-h, --help      show simple usage information and exit.\n");
   printf ("-v, --version   show the program version and exit.\n");
+  printf ("-j, --jobs N    convert N files at a time, in batch mode.\n");
   puts ("");
 }
 
+/** Checks the extension of a dwg filename.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
 int
-parse_options (int argc, char *argv[])
+check_extension (char *filename)
 {
   char *fn;
 
-  if (1 == argc)
-    {
-      show_usage ();
-      printf ("No input file specified.\n");
-      return (-1);
-    }
-  if (argc > 2)
-    {
-      show_usage ();
-      printf ("Only 1 argument at time is acceptable.\n");
-      return (-1);
-    }
-  if (strcmp ("-h", argv[1]) == 0 || strcmp ("--help", argv[1]) == 0)
+  fn = strrchr (filename, '.');
+  if (fn == NULL)
+    return (-1);
+  if (tolower (fn[1]) != 'd' ||
+      tolower (fn[2]) != 'w' || tolower (fn[3]) != 'g')
+    return (-1);
+
+  return (0);
+}
+
+/** Appends a filename to the list of files of the batch mode.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+add_file (char *filename)
+{
+  Dxf_File *more;
+
+  if (filename == NULL)
+    return (-1);
+  if (num_files % 256 == 0)
     {
-      show_usage ();
-      exit (0);
+      more = (Dxf_File *) realloc (files, (num_files + 256) * sizeof (Dxf_File));
+      if (more == NULL)
+	return (-1);
+      files = more;
     }
-  if (strcmp ("-v", argv[1]) == 0 || strcmp ("--version", argv[1]) == 0)
+  memset (&files[num_files], 0, sizeof (Dxf_File));
+  files[num_files].filename = filename;
+  num_files++;
+  return (0);
+}
+
+/** Reads the list of files of the batch mode from stdin, one per line.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+read_file_list ()
+{
+  char line[4096], *name;
+  size_t len;
+
+  while (fgets (line, 4096, stdin))
     {
-      printf ("dwg-dxf %s\n", PACKAGE_VERSION);
-      exit (0);
+      len = strlen (line);
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+	line[--len] = '\0';
+      if (len == 0)
+	continue;
+      name = strdup (line);
+      if (add_file (name))
+	{
+	  free (name);
+	  return (-1);
+	}
     }
-  if (argv[1][0] == '-')
+  return (0);
+}
+
+int
+parse_options (int argc, char *argv[])
+{
+  int i;
+
+  if (1 == argc)
     {
       show_usage ();
-      printf ("Option not available: %s\n", argv[1]);
+      printf ("No input file specified.\n");
       return (-1);
     }
-  fn = strrchr (argv[1], '.');
-  if (fn == NULL)
+  for (i = 1; i < argc; i++)
     {
-      show_usage ();
-      printf ("The input file extension should be .dwg\n");
-      return (-1);
+      if (strcmp ("-h", argv[i]) == 0 || strcmp ("--help", argv[i]) == 0)
+	{
+	  show_usage ();
+	  exit (0);
+	}
+      if (strcmp ("-v", argv[i]) == 0 || strcmp ("--version", argv[i]) == 0)
+	{
+	  printf ("dwg-dxf %s\n", PACKAGE_VERSION);
+	  exit (0);
+	}
+      if (strcmp ("-j", argv[i]) == 0 || strcmp ("--jobs", argv[i]) == 0)
+	{
+	  if (i + 1 == argc || atoi (argv[i + 1]) < 1)
+	    {
+	      show_usage ();
+	      printf ("Option %s needs a number of jobs.\n", argv[i]);
+	      return (-1);
+	    }
+	  num_threads = atoi (argv[++i]);
+	  continue;
+	}
+      if (strcmp ("-", argv[i]) == 0)
+	{
+	  if (read_file_list ())
+	    {
+	      printf ("Not enough memory for the list of files.\n");
+	      return (-1);
+	    }
+	  continue;
+	}
+      if (argv[i][0] == '-')
+	{
+	  show_usage ();
+	  printf ("Option not available: %s\n", argv[i]);
+	  return (-1);
+	}
+      if (check_extension (argv[i]))
+	{
+	  show_usage ();
+	  printf ("The input file extension should be like .dwg: %s\n", argv[i]);
+	  return (-1);
+	}
+      if (add_file (argv[i]))
+	{
+	  printf ("Not enough memory for the list of files.\n");
+	  return (-1);
+	}
     }
-  if (tolower (fn[1]) != 'd' ||
-      tolower (fn[2]) != 'w' || tolower (fn[3]) != 'g')
+  if (num_files == 0)
     {
       show_usage ();
-      printf ("The input file extension should be like .dwg\n");
+      printf ("No input file specified.\n");
       return (-1);
     }
 
   return (0);
 }
 
+/** Converts one dwg file to dxf, using the given dwg structure, which must be
+ * zeroed or cleared with dwg_reset; it is cleared again at the end, so that
+ * its buffers can be reused for the next file.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
 int
-main (int argc, char *argv[])
+dxf_convert_file (char *filename, Dwg_Struct * dwg)
 {
   char *outfile;
-  int fail;
   long size;
-  uint32_t i, missing;
-  Dwg_Struct dwg;
 
-  fail = parse_options (argc, argv);
-  if (fail)
-    return (-1);
+  if (check_extension (filename))
+    {
+      printf ("The input file extension should be like .dwg: %s\n", filename);
+      return (-1);
+    }
 
-  dwg.num_classes = 0;
-  dwg.num_objects = 0;
-  fail = dwg_read_file (argv[1], &dwg);
-  if (fail)
+  if (dwg_read_file_reuse (filename, dwg))
     {
-      printf ("Failed, sorry.\n");
+      dwg_reset (dwg);
       return (-1);
     }
 
   /* Make output filename and open for writing
    */
-  size = strlen (argv[1]);
+  size = strlen (filename);
   if (size < 5)
     size = 5;
-  outfile = (char *) malloc (size);
+  outfile = (char *) malloc (size + 1);
   if (size == 5)
     strcpy (outfile, "a.dxf");
   else
     {
-      strcpy (outfile, argv[1]);
+      strcpy (outfile, filename);
       strcpy (outfile + size - 4, ".dxf");
     }
   fp = fopen (outfile, "w");
@@ -146,32 +259,146 @@ main (int argc, char *argv[])
     {
       printf ("Unable to write to file '%s'\n", outfile);
       free (outfile);
-      return -1;
+      dwg_reset (dwg);
+      return (-1);
     }
 
   /* Prepare object output control: 1 means written; 0 not written
    */
-  checked_obj = (int *) calloc (dwg.num_objects, sizeof (int));
+  checked_obj = (int *) calloc (dwg->num_objects, sizeof (int));
+  viewport_stack = 1;
 
   /* Write out all sections
    */
-  dxf_header_write (&dwg);
-  dxf_classes_write (&dwg);
-  dxf_tables_write (&dwg);
-  dxf_blocks_write (&dwg);
-  dxf_entities_write (&dwg);
-  dxf_nongraphs_write (&dwg);
-
-  /* Statistics
-  missing = dwg.num_objects;
-  for (i = 0; i < dwg.num_objects; i++)
-    if (checked_obj[i])
-      missing--;
-  printf ("Objects written: %lu\n", dwg.num_objects - missing);
-  printf ("And not written: %lu\n", missing);
-   */
+  dxf_header_write (dwg);
+  dxf_classes_write (dwg);
+  dxf_tables_write (dwg);
+  dxf_blocks_write (dwg);
+  dxf_entities_write (dwg);
+  dxf_nongraphs_write (dwg);
 
   free (checked_obj);
+  fclose (fp);
+  free (outfile);
+  dwg_reset (dwg);
+
+  return (0);
+}
+
+/** Batch mode thread: converts the files of the list not yet taken by
+ * other threads, reusing the same dwg structure for all of them.
+ */
+void *
+dxf_batch_thread (void *arg)
+{
+  char *msg;
+  uint32_t i;
+  struct timespec t0, t1;
+  Dwg_Struct dwg;
+
+  (void) arg;
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  while (1)
+    {
+      pthread_mutex_lock (&next_file_mutex);
+      i = next_file++;
+      pthread_mutex_unlock (&next_file_mutex);
+      if (i >= num_files)
+	break;
+
+      clock_gettime (CLOCK_MONOTONIC, &t0);
+      files[i].fail = dxf_convert_file (files[i].filename, &dwg);
+      clock_gettime (CLOCK_MONOTONIC, &t1);
+      files[i].seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1.0e9;
+
+      /* Keep the first error message of this file, discard the others
+       */
+      while ((msg = dwg_error_pop ()) != NULL)
+	if (files[i].fail && files[i].error == NULL)
+	  files[i].error = strdup (msg);
+    }
+  dwg_free (&dwg);
+
+  return (NULL);
+}
+
+/** Converts all the files of the list, with num_threads threads, and
+ * reports the time spent with each file and the failures.
+ * Returns the number of failed files.
+ */
+uint32_t
+dxf_batch_convert ()
+{
+  int i;
+  uint32_t j, failures;
+  double total;
+  struct timespec t0, t1;
+  pthread_t *threads;
+
+  if (num_threads < 1)
+    num_threads = 1;
+  if ((uint32_t) num_threads > num_files)
+    num_threads = num_files;
+
+  clock_gettime (CLOCK_MONOTONIC, &t0);
+  threads = (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+  for (i = 0; i < num_threads; i++)
+    pthread_create (&threads[i], NULL, dxf_batch_thread, NULL);
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
+  free (threads);
+  clock_gettime (CLOCK_MONOTONIC, &t1);
+  total = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1.0e9;
+
+  puts ("");
+  puts ("-- Batch report --");
+  failures = 0;
+  for (j = 0; j < num_files; j++)
+    {
+      printf ("%10.3f s  %-6s  %s\n", files[j].seconds,
+	      files[j].fail ? "FAILED" : "ok", files[j].filename);
+      if (files[j].fail)
+	failures++;
+    }
+  if (failures > 0)
+    {
+      puts ("");
+      puts ("-- Failures --");
+      for (j = 0; j < num_files; j++)
+	if (files[j].fail)
+	  printf ("%s: %s", files[j].filename,
+		  files[j].error ? files[j].error : "failed to convert.\n");
+    }
+  puts ("");
+  printf ("Converted %u of %u files in %.3f s, with %i jobs.\n",
+	  num_files - failures, num_files, total, num_threads);
+
+  return (failures);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int fail;
+  Dwg_Struct dwg;
+
+  fail = parse_options (argc, argv);
+  if (fail)
+    return (-1);
+
+  /* Batch mode
+   */
+  if (num_files > 1 || num_threads > 0)
+    return (dxf_batch_convert () ? -1 : 0);
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  fail = dxf_convert_file (files[0].filename, &dwg);
+  dwg_free (&dwg);
+  if (fail)
+    {
+      printf ("Failed, sorry.\n");
+      return (-1);
+    }
 
   return 0;
 }
@@ -476,7 +703,7 @@ dxf_table_vport_write (Dwg_Struct * dwg)
   Dwg_Nongraph_VPORT_CONTROL *ngr;
   Dwg_Nongraph_VPORT *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.VPORT_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.VPORT_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -489,7 +716,7 @@ dxf_table_vport_write (Dwg_Struct * dwg)
     {
       if (ngr->vports[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->vports[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->vports[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("VPORT Handle %X: not found!\n", ngr->vports[i].value);
@@ -550,7 +777,7 @@ dxf_table_ltype_write (Dwg_Struct * dwg)
   Dwg_Nongraph_LTYPE_CONTROL *ngr;
   Dwg_Nongraph_LTYPE *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.LINETYPE_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.LINETYPE_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -563,7 +790,7 @@ dxf_table_ltype_write (Dwg_Struct * dwg)
     {
       if (ngr->linetypes[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->linetypes[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->linetypes[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("LTYPE Handle %X: not found!\n", ngr->linetypes[i].value);
@@ -625,7 +852,7 @@ dxf_table_layer_write (Dwg_Struct * dwg)
   Dwg_Nongraph_LAYER_CONTROL *ngr;
   Dwg_Nongraph_LAYER *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.LAYER_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.LAYER_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -638,7 +865,7 @@ dxf_table_layer_write (Dwg_Struct * dwg)
     {
       if (ngr->layers[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->layers[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->layers[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("LAYER Handle %X: not found!\n", ngr->layers[i].value);
@@ -650,7 +877,7 @@ dxf_table_layer_write (Dwg_Struct * dwg)
       VAL (5, ngr->layers[i].value);
       if (dwg->object[idx].xdic_missing_flag == 0)
         {
-          idx2 = dwg_handle_get_index (dwg->object[idx].xdicobjhandle.value);
+          idx2 = dwg_handle_get_index (dwg, dwg->object[idx].xdicobjhandle.value);
           if (idx2 < dwg->num_objects)
             {
               VAL (102, "{ACAD_XDICTIONARY");
@@ -674,7 +901,7 @@ dxf_table_layer_write (Dwg_Struct * dwg)
       VAL (2, rec->entry_name);
       VAL (70, (rec->xrefdep << 4));
       VAL (62, rec->color.index);
-      idx = dwg_handle_get_index (rec->linetype.value);
+      idx = dwg_handle_get_index (dwg, rec->linetype.value);
       if (idx >= dwg->num_objects)
 	{
 	  VAL (6, dwg->object[idx].as.nongraph.as.LTYPE.entry_name);
@@ -699,7 +926,7 @@ dxf_table_style_write (Dwg_Struct * dwg)
   Dwg_Nongraph_SHAPEFILE_CONTROL *ngr;
   Dwg_Nongraph_SHAPEFILE *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.STYLE_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.STYLE_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -712,7 +939,7 @@ dxf_table_style_write (Dwg_Struct * dwg)
     {
       if (ngr->shapefiles[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->shapefiles[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->shapefiles[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("STYLE (shapefile) Handle %X: not found!\n", ngr->shapefiles[i].value);
@@ -748,7 +975,7 @@ dxf_table_view_write (Dwg_Struct * dwg)
   Dwg_Nongraph_VIEW_CONTROL *ngr;
   Dwg_Nongraph_VIEW *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.VIEW_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.VIEW_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -761,7 +988,7 @@ dxf_table_view_write (Dwg_Struct * dwg)
     {
       if (ngr->views[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->views[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->views[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("VIEW Handle %X: not found!\n", ngr->views[i].value);
@@ -812,7 +1039,7 @@ dxf_table_ucs_write (Dwg_Struct * dwg)
   Dwg_Nongraph_UCS_CONTROL *ngr;
   Dwg_Nongraph_UCS *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.UCS_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.UCS_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -825,7 +1052,7 @@ dxf_table_ucs_write (Dwg_Struct * dwg)
     {
       if (ngr->ucs[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->ucs[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->ucs[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("UCS Handle %X: not found!\n", ngr->ucs[i].value);
@@ -864,7 +1091,7 @@ dxf_table_appid_write (Dwg_Struct * dwg)
   Dwg_Nongraph_APPID_CONTROL *ngr;
   Dwg_Nongraph_APPID *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.APPID_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.APPID_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -877,7 +1104,7 @@ dxf_table_appid_write (Dwg_Struct * dwg)
     {
       if (ngr->apps[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->apps[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->apps[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("APPID Handle %X: not found!\n", ngr->apps[i].value);
@@ -907,7 +1134,7 @@ dxf_table_dimstyle_write (Dwg_Struct * dwg)
   Dwg_Nongraph_DIMSTYLE_CONTROL *ngr;
   Dwg_Nongraph_DIMSTYLE *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.DIMSTYLE_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.DIMSTYLE_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -923,7 +1150,7 @@ dxf_table_dimstyle_write (Dwg_Struct * dwg)
     {
       if (ngr->dimstyles[i].value == 0)
         continue;
-      idx = dwg_handle_get_index (ngr->dimstyles[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->dimstyles[i].value);
       if (idx >= dwg->num_objects)
         {
           printf ("DIMSTYLE Handle %X: not found!\n", ngr->dimstyles[i].value);
@@ -1021,7 +1248,7 @@ dxf_table_block_record_write (Dwg_Struct * dwg)
   Dwg_Nongraph_BLOCK_CONTROL *ngr;
   Dwg_Nongraph_BLOCK_HEADER *rec;
 
-  idx = dwg_handle_get_index (dwg->variable.BLOCK_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.BLOCK_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     return;
   checked_obj[idx] = 1;
@@ -1032,7 +1259,7 @@ dxf_table_block_record_write (Dwg_Struct * dwg)
   TAB (BLOCK_RECORD);
 
   /* Model-space block */
-  idx = dwg_handle_get_index (ngr->model_space.value);
+  idx = dwg_handle_get_index (dwg, ngr->model_space.value);
   if (idx < dwg->num_objects)
     {
       checked_obj[idx] = 1;
@@ -1048,7 +1275,7 @@ dxf_table_block_record_write (Dwg_Struct * dwg)
     }
 
   /* Paper-space block */
-  idx = dwg_handle_get_index (ngr->paper_space.value);
+  idx = dwg_handle_get_index (dwg, ngr->paper_space.value);
   if (idx < dwg->num_objects)
     {
       checked_obj[idx] = 1;
@@ -1065,7 +1292,7 @@ dxf_table_block_record_write (Dwg_Struct * dwg)
 
   for (i = 0; i < ngr->num_entries; i++)
     {
-      idx = dwg_handle_get_index (ngr->block_headers[i].value);
+      idx = dwg_handle_get_index (dwg, ngr->block_headers[i].value);
       if (idx >= dwg->num_objects)
 	continue;
       checked_obj[idx] = 1;
@@ -1116,7 +1343,7 @@ dxf_nongraph_common (Dwg_Object * obj)
   VAL (5, obj->handle.value);
   if (obj->xdic_missing_flag == 0)
     {
-      idx = dwg_handle_get_index (obj->xdicobjhandle.value);
+      idx = dwg_handle_get_index (dwg, obj->xdicobjhandle.value);
       if (idx < dwg->num_objects)
         {
           VAL (102, "{ACAD_XDICTIONARY");
@@ -1147,7 +1374,7 @@ dxf_entity_common (Dwg_Object * obj)
   VAL (5, obj->handle.value);
   if (obj->xdic_missing_flag == 0)
     {
-      idx = dwg_handle_get_index (obj->xdicobjhandle.value);
+      idx = dwg_handle_get_index (dwg, obj->xdicobjhandle.value);
       if (idx < dwg->num_objects)
         {
           VAL (102, "{ACAD_XDICTIONARY");
@@ -1174,7 +1401,7 @@ dxf_entity_common (Dwg_Object * obj)
     }
   VAL (100, "AcDbEntity");
 
-  idx = dwg_handle_get_index (ent->layer.value);
+  idx = dwg_handle_get_index (dwg, ent->layer.value);
   if (idx < dwg->num_objects)
     {
       VAL (8, dwg->object[idx].as.nongraph.as.LAYER.entry_name);
@@ -1194,7 +1421,7 @@ dxf_entity_common (Dwg_Object * obj)
     }
   else if (ent->linetype_flags == 3)
     {
-      idx = dwg_handle_get_index (ent->ltype.value);
+      idx = dwg_handle_get_index (dwg, ent->ltype.value);
       if (idx < dwg->num_objects)
 	{
 	  VAL (6, dwg->object[idx].as.nongraph.as.LTYPE.entry_name);
@@ -1234,7 +1461,12 @@ dxf_object_write (Dwg_Object * obj)
       i = obj->type - 500;
       if (i >= dwg->num_classes || i < 0)
 	return;
-      OBJECT_VARTYPE_ELSEIF_SET (dxf_);
+      switch (dwg->dwg_class[i].vartype)
+	{
+	  OBJECT_VARTYPE_CASE_SET (dxf_);
+	default:
+	  break;
+	}
     }
 }
 
@@ -1253,7 +1485,7 @@ dxf_blocks_write (Dwg_Struct * dwg)
 
   SEC (BLOCKS);
 
-  idx = dwg_handle_get_index (dwg->variable.BLOCK_CONTROL_OBJECT.value);
+  idx = dwg_handle_get_index (dwg, dwg->variable.BLOCK_CONTROL_OBJECT.value);
   if (idx >= dwg->num_objects)
     {
       puts ("WARN: no blocks found.");
@@ -1265,7 +1497,7 @@ dxf_blocks_write (Dwg_Struct * dwg)
   /* First block: empty Model_Space
    */
   blk = NULL;
-  idx = dwg_handle_get_index (ktl->model_space.value);
+  idx = dwg_handle_get_index (dwg, ktl->model_space.value);
   if (idx < dwg->num_objects)
     {
       obj = &dwg->object[idx];
@@ -1285,7 +1517,7 @@ dxf_blocks_write (Dwg_Struct * dwg)
   /* Second block: empty Paper_Space
    */
   blk = NULL;
-  idx = dwg_handle_get_index (ktl->paper_space.value);
+  idx = dwg_handle_get_index (dwg, ktl->paper_space.value);
   if (idx < dwg->num_objects)
     {
       obj = &dwg->object[idx];
@@ -1305,7 +1537,7 @@ dxf_blocks_write (Dwg_Struct * dwg)
   /* Other blocks */
   for (i = 0; i < ktl->num_entries; i++)
     {
-      idx = dwg_handle_get_index (ktl->block_headers[i].value);
+      idx = dwg_handle_get_index (dwg, ktl->block_headers[i].value);
       if (idx >= dwg->num_objects)
 	continue;
       obj = &dwg->object[idx];
@@ -1316,7 +1548,7 @@ dxf_blocks_write (Dwg_Struct * dwg)
 	  for (hdl = blk->first_entity.value; hdl <= blk->last_entity.value; hdl++)
 	    {
 	      Dwg_Object * subo;
-	      idx = dwg_handle_get_index (hdl);
+	      idx = dwg_handle_get_index (dwg, hdl);
 	      if (idx >= dwg->num_objects)
 		continue;
 	      subo = &dwg->object[idx];
@@ -1354,7 +1586,7 @@ dxf_entities_write (Dwg_Struct * dwg)
       if (checked_obj[idx])
         continue;
       subhd = dwg_handle_absolute (&obj->as.entity.subentity, obj->handle.value);
-      if (obj->as.entity.entity_mode == 0 && dwg_handle_get_index (subhd) >= dwg->num_objects)
+      if (obj->as.entity.entity_mode == 0 && dwg_handle_get_index (dwg, subhd) >= dwg->num_objects)
         continue;
       checked_obj[idx] = 1;
       dxf_object_write (obj);
@@ -132,7 +132,7 @@
  * of a 'type' nongraph, through the handle of the variable.
  */
 #define VAR_H2N(name, gcode, type) \
-  idx = dwg_handle_get_index (dwg->variable.name.value);\
+  idx = dwg_handle_get_index (dwg, dwg->variable.name.value);\
   if (idx > 0 && idx <  dwg->num_objects)\
   {\
     VAR (name, gcode, dwg->object[idx].as.nongraph.as.type);\
@@ -204,7 +204,7 @@
         }\
       VAL (8, "0"); /* XXX Where is the layer info? */\
       VAL (100, "AcDbBlockBegin");\
-      idx2 = dwg_handle_get_index (blk->block_entity.value);\
+      idx2 = dwg_handle_get_index (dwg, blk->block_entity.value);\
       if (idx2 < dwg->num_objects)\
         {\
           VAL (2, dwg->object[idx2].as.entity.as.BLOCK.name);\
@@ -227,7 +227,7 @@
  */
 #define REC_ENDBLK(is_pspace) \
       REC (ENDBLK);\
-      idx = dwg_handle_get_index (blk->endblk_entity.value);\
+      idx = dwg_handle_get_index (dwg, blk->endblk_entity.value);\
       if (idx < dwg->num_objects) {VAL (5, dwg->object[idx].handle.value);}\
       else {VAL (5, dwg->variable.HANDSEED.value++);}\
       VAL (330, obj->handle.value);\
@@ -404,44 +404,63 @@ char * dxf_format_s (int gcode);
         action##LAYOUT(obj);\
         break;
 
-#define OBJECT_VARTYPE_ELSEIF_SET(action) \
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "DICTIONARYVAR"))\
-	  action##DICTIONARYVAR (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "ACDBDICTIONARYWDFLT"))\
-	  action##DICTIONARYWDLFT (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "HATCH"))\
-	  action##HATCH (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IDBUFFER"))\
-	  action##IDBUFFER (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGE"))\
-	  action##IMAGE (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGEDEF"))\
-	action##IMAGEDEF (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGEDEF_REACTOR"))\
-	action##IMAGEDEFREACTOR (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LAYER_INDEX"))\
-	action##LAYER_INDEX (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LAYOUT"))\
-	action##LAYOUT (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LWPLINE"))\
-	action##LWPLINE (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "OLE2FRAME"))\
-	action##OLE2FRAME (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "ACDBPLACEHOLDER"))\
-	action##PLACEHOLDER (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "RASTERVARIABLES"))\
-	action##RASTERVARIABLES (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "SORTENTSTABLE"))\
-	action##SORTENTSTABLE (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "SPATIAL_FILTER"))\
-	action##SPATIAL_FILTER (obj);\
-      else if (!strcmp((const char *) dwg->dwg_class[i].dxfname, "SPATIAL_INDEX"))\
-	action##SPATIAL_INDEX (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "XRECORD"))\
-	action##XRECORD (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "WIPEOUT"))\
-	action##WIPEOUT (obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "WIPEOUTVARIABLES"))\
-	action##WIPEOUTVARIABLES (obj);
+#define OBJECT_VARTYPE_CASE_SET(action) \
+      case DWG_CLASS_DICTIONARYVAR:\
+        action##DICTIONARYVAR(obj);\
+        break;\
+      case DWG_CLASS_DICTIONARYWDLFT:\
+        action##DICTIONARYWDLFT(obj);\
+        break;\
+      case DWG_CLASS_HATCH:\
+        action##HATCH(obj);\
+        break;\
+      case DWG_CLASS_IDBUFFER:\
+        action##IDBUFFER(obj);\
+        break;\
+      case DWG_CLASS_IMAGE:\
+        action##IMAGE(obj);\
+        break;\
+      case DWG_CLASS_IMAGEDEF:\
+        action##IMAGEDEF(obj);\
+        break;\
+      case DWG_CLASS_IMAGEDEFREACTOR:\
+        action##IMAGEDEFREACTOR(obj);\
+        break;\
+      case DWG_CLASS_LAYER_INDEX:\
+        action##LAYER_INDEX(obj);\
+        break;\
+      case DWG_CLASS_LAYOUT:\
+        action##LAYOUT(obj);\
+        break;\
+      case DWG_CLASS_LWPLINE:\
+        action##LWPLINE(obj);\
+        break;\
+      case DWG_CLASS_OLE2FRAME:\
+        action##OLE2FRAME(obj);\
+        break;\
+      case DWG_CLASS_PLACEHOLDER:\
+        action##PLACEHOLDER(obj);\
+        break;\
+      case DWG_CLASS_RASTERVARIABLES:\
+        action##RASTERVARIABLES(obj);\
+        break;\
+      case DWG_CLASS_SORTENTSTABLE:\
+        action##SORTENTSTABLE(obj);\
+        break;\
+      case DWG_CLASS_SPATIAL_FILTER:\
+        action##SPATIAL_FILTER(obj);\
+        break;\
+      case DWG_CLASS_SPATIAL_INDEX:\
+        action##SPATIAL_INDEX(obj);\
+        break;\
+      case DWG_CLASS_XRECORD:\
+        action##XRECORD(obj);\
+        break;\
+      case DWG_CLASS_WIPEOUT:\
+        action##WIPEOUT(obj);\
+        break;\
+      case DWG_CLASS_WIPEOUTVARIABLES:\
+        action##WIPEOUTVARIABLES(obj);\
+        break;
 
 #endif
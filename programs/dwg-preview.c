@@ -13,7 +13,7 @@
 /*****************************************************************************/
 
 /*
- * dwg-preview.c: get the bmp and wmf thumbnails of a dwg file
+ * dwg-preview.c: get the bmp and wmf thumbnails of a dwg file, or render one
  * written by Felipe Castro
  * modified by Felipe Corrêa da Silva Sances
  * modified by Thien-Thi Nguyen
@@ -23,16 +23,47 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include <dwg.h>
 
+/* Rendering options */
+int render = 0;
+int grey = 0;
+int ppm = 0;
+int thumb_size = 256;
+
+/** Makes the output filename: the input one, with the extension ext (of 3
+ * letters), or "a" with it if the input one is too short.
+ */
+char *
+make_outfile (char *filename, const char *ext)
+{
+  char *outfile;
+  long size;
+
+  size = strlen (filename);
+  if (size < 5)
+    size = 5;
+  outfile = (char *) malloc (size + 1);
+  if (outfile == NULL)
+    return (NULL);
+  if (size == 5)
+    sprintf (outfile, "a.%s", ext);
+  else
+    {
+      strcpy (outfile, filename);
+      sprintf (outfile + size - 4, ".%s", ext);
+    }
+  return (outfile);
+}
+
 int
 write_bmp (char *filename)
 {
   char *outfile;
   int i, j;
   int fail;
-  long size;
   long bmadr;
   size_t retval;
   FILE *fh;
@@ -98,17 +129,7 @@ write_bmp (char *filename)
 
   /* Make output filename and open for writing
    */
-  size = strlen (filename);
-  if (size < 5)
-    size = 5;
-  outfile = (char *) malloc (size);
-  if (size == 5)
-    strcpy (outfile, "a.bmp");
-  else
-    {
-      strcpy (outfile, filename);
-      strcpy (outfile + size - 4, ".bmp");
-    }
+  outfile = make_outfile (filename, "bmp");
   fh = fopen (outfile, "w");
   if (!fh)
     {
@@ -153,20 +174,200 @@ write_bmp (char *filename)
   return 0;
 }
 
+/** Writes a 32 bits little-endian value */
+void
+put_u32 (uint8_t * p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+/** Writes a rendered image, in BMP (bottom-up rows of 4 bytes multiple, BGR
+ * or 8 bits with a grey palette) or PPM (P6, or P5 for grey) format.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+write_image (FILE * fh, Dwg_Raster * raster)
+{
+  uint8_t head[54 + 1024], *row, *src;
+  uint32_t x, y, stride, offset;
+  int fail = 0;
+
+  if (ppm)
+    {
+      fprintf (fh, "P%d\n%u %u\n255\n", raster->channels == 1 ? 5 : 6, raster->width,
+	       raster->height);
+      return (fwrite (raster->pixel, raster->width * raster->channels, raster->height, fh)
+	      != raster->height ? -1 : 0);
+    }
+
+  stride = (raster->width * raster->channels + 3) & ~3;
+  offset = 54 + (raster->channels == 1 ? 1024 : 0);
+  memset (head, 0, sizeof (head));
+  head[0] = 'B';
+  head[1] = 'M';
+  put_u32 (head + 2, offset + stride * raster->height);
+  put_u32 (head + 10, offset);
+  put_u32 (head + 14, 40);
+  put_u32 (head + 18, raster->width);
+  put_u32 (head + 22, raster->height);
+  head[26] = 1;
+  head[28] = 8 * raster->channels;
+  put_u32 (head + 34, stride * raster->height);
+  put_u32 (head + 38, 2835);
+  put_u32 (head + 42, 2835);
+  if (raster->channels == 1)
+    {
+      put_u32 (head + 46, 256);
+      for (x = 0; x < 256; x++)
+	head[54 + 4 * x] = head[55 + 4 * x] = head[56 + 4 * x] = x;
+    }
+  if (fwrite (head, 1, offset, fh) != offset)
+    return (-1);
+
+  row = (uint8_t *) calloc (stride, 1);
+  if (row == NULL)
+    return (-1);
+  for (y = raster->height; y-- > 0 && !fail;)
+    {
+      src = raster->pixel + y * raster->width * raster->channels;
+      if (raster->channels == 1)
+	memcpy (row, src, raster->width);
+      else
+	for (x = 0; x < raster->width; x++)
+	  {
+	    row[3 * x] = src[3 * x + 2];
+	    row[3 * x + 1] = src[3 * x + 1];
+	    row[3 * x + 2] = src[3 * x];
+	  }
+      fail = fwrite (row, 1, stride, fh) != stride;
+    }
+  free (row);
+  return (fail ? -1 : 0);
+}
+
+/** Renders a thumbnail of the model space, of thumb_size pixels square.
+ */
+int
+write_render (char *filename)
+{
+  Dwg_Struct dwg;
+  Dwg_Raster raster;
+  char *outfile;
+  FILE *fh;
+  int fail;
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  if (dwg_read_file (filename, &dwg))
+    {
+      puts ("Failed to read the drawing.");
+      dwg_free (&dwg);
+      return -1;
+    }
+
+  memset (&raster, 0, sizeof (Dwg_Raster));
+  raster.width = raster.height = thumb_size;
+  raster.channels = grey ? 1 : 3;
+  raster.pixel = (uint8_t *) malloc (raster.width * raster.height * raster.channels);
+  if (raster.pixel == NULL || dwg_render (&dwg, &raster))
+    {
+      puts ("Failed to render the drawing.");
+      free (raster.pixel);
+      dwg_free (&dwg);
+      return -1;
+    }
+  dwg_free (&dwg);
+
+  outfile = make_outfile (filename, ppm ? (grey ? "pgm" : "ppm") : "bmp");
+  fh = fopen (outfile, "wb");
+  if (!fh)
+    {
+      printf ("Unable to write to file '%s'\n", outfile);
+      free (outfile);
+      free (raster.pixel);
+      return -1;
+    }
+  fail = write_image (fh, &raster);
+  if (fclose (fh))
+    fail = -1;
+  if (fail)
+    printf ("Fail! Could not write '%s'.\n", outfile);
+  else
+    printf ("Success! See the file '%s'\n", outfile);
+
+  free (outfile);
+  free (raster.pixel);
+  return fail;
+}
+
+void
+show_usage ()
+{
+  printf ("Usage: dwg-preview [-r] [-g] [-p] [-s SIZE] FILE\n");
+  puts ("");
+  printf ("FILE must be a DWG file, with a .dwg extension. Its embedded\n"
+	  "preview goes to a bmp file with same basename of FILE; if it has\n"
+	  "none, or with -r, a thumbnail of its model space is rendered.\n");
+  puts ("");
+  printf ("Options:\n");
+  printf ("-r, --render    render a thumbnail, even if there is a preview.\n");
+  printf ("-g, --grey      render in grey levels, not in colours.\n");
+  printf ("-p, --ppm       write the rendering in PPM (or PGM) format.\n");
+  printf ("-s, --size N    render N pixels square (default 256).\n");
+  puts ("");
+}
+
 int
 main (int argc, char *argv[])
 {
-  char * fn;
+  char *fn;
+  char *filename = NULL;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp ("-r", argv[i]) == 0 || strcmp ("--render", argv[i]) == 0)
+	render = 1;
+      else if (strcmp ("-g", argv[i]) == 0 || strcmp ("--grey", argv[i]) == 0)
+	grey = 1;
+      else if (strcmp ("-p", argv[i]) == 0 || strcmp ("--ppm", argv[i]) == 0)
+	ppm = 1;
+      else if (strcmp ("-s", argv[i]) == 0 || strcmp ("--size", argv[i]) == 0)
+	{
+	  if (i + 1 == argc || atoi (argv[i + 1]) < 1 || atoi (argv[i + 1]) > 8192)
+	    {
+	      show_usage ();
+	      printf ("Option %s needs a size, from 1 to 8192.\n", argv[i]);
+	      return -1;
+	    }
+	  thumb_size = atoi (argv[++i]);
+	}
+      else if (strcmp ("-h", argv[i]) == 0 || strcmp ("--help", argv[i]) == 0)
+	{
+	  show_usage ();
+	  return 0;
+	}
+      else if (argv[i][0] == '-' || filename)
+	{
+	  show_usage ();
+	  printf ("Option not available: %s\n", argv[i]);
+	  return -1;
+	}
+      else
+	filename = argv[i];
+    }
 
   /* Test for one argument */
-  if (argc < 2)
+  if (filename == NULL)
     {
       puts ("Need 1 filename argument");
       return -1;
     }
 
   /* Test for .dwg */
-  fn = strrchr (argv[1], '.');
+  fn = strrchr (filename, '.');
   if (fn == NULL)
     {
       printf ("The input file extension should be .dwg\n");
@@ -178,6 +379,11 @@ main (int argc, char *argv[])
       return -1;
     }
 
-  write_bmp (argv[1]);
+  if (render || write_bmp (filename))
+    {
+      if (!render)
+	puts ("Rendering a thumbnail instead.");
+      return write_render (filename) ? -1 : 0;
+    }
   return 0;
 }
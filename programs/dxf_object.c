@@ -63,7 +63,7 @@ dxf_TEXT (Dwg_Object * obj)
     {
       VAL_1D (51, _obj->oblique_ang * 180/M_PI);
     }
-  idx = dwg_handle_get_index (_obj->style.value);
+  idx = dwg_handle_get_index (dwg, _obj->style.value);
   if (idx < dwg->num_objects)
     {
       if (strcmp (dwg->object[idx].as.nongraph.as.SHAPEFILE.entry_name, "Standard") != 0)
@@ -124,7 +124,7 @@ dxf_ATTRIB (Dwg_Object * obj)
     {
       VAL_1D (51, _obj->oblique_ang * 180/M_PI);
     }
-  idx = dwg_handle_get_index (_obj->style.value);
+  idx = dwg_handle_get_index (dwg, _obj->style.value);
   if (idx < dwg->num_objects)
     {
       VAL (7, dwg->object[idx].as.nongraph.as.SHAPEFILE.entry_name);
@@ -185,7 +185,7 @@ dxf_ATTDEF (Dwg_Object * obj)
     {
       VAL_1D (51, _obj->oblique_ang * 180/M_PI);
     }
-  idx = dwg_handle_get_index (_obj->style.value);
+  idx = dwg_handle_get_index (dwg, _obj->style.value);
   if (idx < dwg->num_objects)
     {
       VAL (7, dwg->object[idx].as.nongraph.as.SHAPEFILE.entry_name);
@@ -246,7 +246,7 @@ dxf_INSERT (Dwg_Object * obj)
       VAL (66, _obj->has_attribs);
     }
 
-  idx = dwg_handle_get_index (_obj->block_header.value);
+  idx = dwg_handle_get_index (dwg, _obj->block_header.value);
   if (idx < dwg->num_objects)
     {
       VAL (2, dwg->object[idx].as.nongraph.as.BLOCK_HEADER.entry_name);
@@ -297,7 +297,7 @@ dxf_MINSERT (Dwg_Object * obj)
       VAL (66, _obj->has_attribs);
     }
 
-  idx = dwg_handle_get_index (_obj->block_header.value);
+  idx = dwg_handle_get_index (dwg, _obj->block_header.value);
   if (idx < dwg->num_objects)
     {
       VAL (2, dwg->object[idx].as.nongraph.as.BLOCK_HEADER.entry_name);
@@ -553,7 +553,7 @@ dxf_DIMENSION_ORDINATE (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -600,7 +600,7 @@ dxf_DIMENSION_ORDINATE (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -630,7 +630,7 @@ dxf_DIMENSION_LINEAR (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -673,7 +673,7 @@ dxf_DIMENSION_LINEAR (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -718,7 +718,7 @@ dxf_DIMENSION_ALIGNED (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -765,7 +765,7 @@ dxf_DIMENSION_ALIGNED (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -796,7 +796,7 @@ dxf_DIMENSION_ANG3PT (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -843,7 +843,7 @@ dxf_DIMENSION_ANG3PT (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -876,7 +876,7 @@ dxf_DIMENSION_ANG2LN (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -923,7 +923,7 @@ dxf_DIMENSION_ANG2LN (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -958,7 +958,7 @@ dxf_DIMENSION_RADIUS (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -1005,7 +1005,7 @@ dxf_DIMENSION_RADIUS (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -1031,7 +1031,7 @@ dxf_DIMENSION_DIAMETER (Dwg_Object * obj)
   dxf_entity_common (obj);
   VAL (100, "AcDbDimension");
 
-  idx = dwg_handle_get_index (_obj->block.value);
+  idx = dwg_handle_get_index (dwg, _obj->block.value);
   if (idx >= dwg->num_objects)
   {
     VAL (2, "*");
@@ -1078,7 +1078,7 @@ dxf_DIMENSION_DIAMETER (Dwg_Object * obj)
   {
     VAL_3D (210, 220, 230, _obj->extrusion);
   }
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx >= dwg->num_objects)
     {
       VAL (3, "Standard");
@@ -1274,7 +1274,6 @@ dxf_SHAPE (Dwg_Object * obj)
 void
 dxf_VIEWPORT (Dwg_Object * obj)
 {
-  static int stack = 1;
   Dwg_Struct *dwg = obj->parent;
   Dwg_Entity_VIEWPORT *_obj = &obj->as.entity.as.VIEWPORT;
 
@@ -1286,8 +1285,8 @@ dxf_VIEWPORT (Dwg_Object * obj)
   VAL_3D (10, 20, 30, _obj->center);
   VAL_1D (40, _obj->width);
   VAL_1D (41, _obj->height);
-  VAL (68, stack); // FIXME how to know if it is active or not, and the stack order?
-  VAL (69, stack++); // and what about its ID?
+  VAL (68, viewport_stack); // FIXME how to know if it is active or not, and the stack order?
+  VAL (69, viewport_stack++); // and what about its ID?
   VAL_2D (12, 22, _obj->view_center);
   VAL_2D (13, 23, _obj->snap_base);
   VAL_2D (14, 24, _obj->snap_spacing);
@@ -1578,7 +1577,7 @@ dxf_MTEXT (Dwg_Object * obj)
     }
   VAL (1, txt);
 
-  idx = dwg_handle_get_index (_obj->style.value);
+  idx = dwg_handle_get_index (dwg, _obj->style.value);
   if (idx < dwg->num_objects)
     {
       txt = dwg->object[idx].as.nongraph.as.SHAPEFILE.entry_name;
@@ -1679,7 +1678,7 @@ dxf_TOLERANCE (Dwg_Object * obj)
   dxf_entity_common (obj);
 
   VAL (100, "AcDbFcf");
-  idx = dwg_handle_get_index (_obj->dimstyle.value);
+  idx = dwg_handle_get_index (dwg, _obj->dimstyle.value);
   if (idx < dwg->num_objects)
     {
           VAL (3, dwg->object[idx].as.nongraph.as.DIMSTYLE.entry_name);
@@ -1707,7 +1706,7 @@ dxf_MLINE (Dwg_Object * obj)
   dxf_entity_common (obj);
 
   VAL (100, "AcDbMline");
-  idx =  dwg_handle_get_index (_obj->mline_style.value);
+  idx =  dwg_handle_get_index (dwg, _obj->mline_style.value);
   if (idx < dwg->num_objects)
     {
       VAL (2, dwg->object[idx].as.nongraph.as.MLINESTYLE.name);
@@ -382,6 +382,7 @@ bit_read_H (Bit_Chain * dat, Dwg_Handle * handle)
   handle->code = (handle->code & 0xf0) >> 4;
 
   handle->value = 0;
+  handle->index = (uint32_t) -1;
   if (handle->size > 4)
     {
       handle->size = 0;
@@ -395,6 +396,268 @@ bit_read_H (Bit_Chain * dat, Dwg_Handle * handle)
   return (0);
 }
 
+/* Bulk readers ******************************************************
+ *
+ * Runs of values are read in a tight loop. Far enough from the end of the
+ * chain, bits are taken straight from the bytes, without the bound checks of
+ * bit_advance_position; the last values go through the usual readers.
+ */
+
+/* Room for the longest value read by the fast paths (a bitdouble), plus the
+ * byte needed by an unaligned read
+ */
+#define BULK_MARGIN 10
+
+/* Same limits as the sanity test of decoded doubles (see dwg_object.in.c) */
+#define BULK_MAX_POS 1.0e27
+#define BULK_MIN_POS 1.0e-31
+
+/** 2 bits far from the end of the chain */
+static inline uint8_t
+bulk_read_BB (Bit_Chain * dat)
+{
+  uint8_t *p = dat->chain + dat->byte;
+  uint8_t result;
+
+  result = ((((uint16_t) p[0] << 8) | p[1]) >> (14 - dat->bit)) & 0x03;
+  dat->bit += 2;
+  dat->byte += dat->bit >> 3;
+  dat->bit &= 7;
+  return (result);
+}
+
+/** 8 raw bytes far from the end of the chain */
+static inline void
+bulk_read_8RC (Bit_Chain * dat, uint8_t byte[8])
+{
+  uint8_t *p = dat->chain + dat->byte;
+  int i;
+
+  if (dat->bit == 0)
+    memcpy (byte, p, 8);
+  else
+    for (i = 0; i < 8; i++)
+      byte[i] = (p[i] << dat->bit) | (p[i + 1] >> (8 - dat->bit));
+  dat->byte += 8;
+}
+
+/** Raw double far from the end of the chain */
+static inline double
+bulk_read_RD (Bit_Chain * dat)
+{
+  double result;
+  uint8_t byte[8];
+
+  bulk_read_8RC (dat, byte);
+  memcpy (&result, byte, 8);
+  return (result);
+}
+
+/** Bit-double with default far from the end of the chain */
+static inline double
+bulk_read_DD (Bit_Chain * dat, double default_value)
+{
+  uint8_t byte[8];
+  uint8_t *result = (uint8_t *) & default_value;
+
+  switch (bulk_read_BB (dat))
+    {
+    case 0:
+      return (default_value);
+    case 3:
+      return (bulk_read_RD (dat));
+    case 2:
+      bulk_read_8RC (dat, byte);
+      dat->byte -= 2;
+      result[4] = byte[0];
+      result[5] = byte[1];
+      memcpy (result, byte + 2, 4);
+      return (default_value);
+    default:
+      bulk_read_8RC (dat, byte);
+      dat->byte -= 4;
+      memcpy (result, byte, 4);
+      return (default_value);
+    }
+}
+
+/** Tells whether the chain was read up to its end */
+static inline int
+bulk_at_end (Bit_Chain * dat)
+{
+  return (dat->byte >= dat->size - 1 && dat->bit == 7);
+}
+
+/** Checks that doubles are 0 or of a sane magnitude.
+ * Returns 0 if they all are, -1 otherwise.
+ */
+static int
+bulk_check_D (double *values, uint32_t num)
+{
+  uint32_t i;
+  int bad = 0;
+
+  for (i = 0; i < num; i++)
+    bad |= values[i] > BULK_MAX_POS || values[i] < -BULK_MAX_POS
+      || (values[i] < BULK_MIN_POS && values[i] > -BULK_MIN_POS && values[i] != 0);
+  return (bad ? -1 : 0);
+}
+
+/** Read num raw chars */
+void
+bit_read_RC_array (Bit_Chain * dat, BITCODE_RC * dest, uint32_t num)
+{
+  uint32_t i;
+
+  i = 0;
+  if (dat->byte + BULK_MARGIN < dat->size)
+    {
+      i = dat->size - dat->byte - BULK_MARGIN;
+      if (i > num)
+        i = num;
+      if (dat->bit == 0)
+        memcpy (dest, dat->chain + dat->byte, i);
+      else
+        {
+          uint8_t *p = dat->chain + dat->byte;
+          uint32_t j;
+
+          for (j = 0; j < i; j++)
+            dest[j] = (p[j] << dat->bit) | (p[j + 1] >> (8 - dat->bit));
+        }
+      dat->byte += i;
+    }
+  for (; i < num; i++)
+    dest[i] = bit_read_RC (dat);
+}
+
+/** Read num raw doubles.
+ * Returns -1 if the chain ends before, or if a value is not sane; 0 otherwise.
+ */
+int
+bit_read_RD_array (Bit_Chain * dat, BITCODE_RD * dest, uint32_t num)
+{
+  uint32_t i;
+
+  for (i = 0; i < num; i++)
+    {
+      if (dat->byte + BULK_MARGIN < dat->size)
+        dest[i] = bulk_read_RD (dat);
+      else if (bulk_at_end (dat))
+        return (-1);
+      else
+        dest[i] = bit_read_RD (dat);
+    }
+  return (bulk_check_D (dest, num));
+}
+
+/** Read num bitdoubles.
+ * Returns -1 if the chain ends before, or if a value is not sane; 0 otherwise.
+ */
+int
+bit_read_BD_array (Bit_Chain * dat, BITCODE_BD * dest, uint32_t num)
+{
+  uint32_t i;
+
+  for (i = 0; i < num; i++)
+    {
+      if (dat->byte + BULK_MARGIN < dat->size)
+        {
+          switch (bulk_read_BB (dat))
+            {
+            case 0:
+              dest[i] = bulk_read_RD (dat);
+              break;
+            case 1:
+              dest[i] = 1.0;
+              break;
+            case 2:
+              dest[i] = 0.0;
+              break;
+            default:
+              /* the same Not-A-Number as bit_read_BD */
+              memset (&dest[i], 0xff, sizeof (double));
+            }
+        }
+      else if (bulk_at_end (dat))
+        return (-1);
+      else
+        dest[i] = bit_read_BD (dat);
+    }
+  return (bulk_check_D (dest, num));
+}
+
+/** Read num 2D points, the first in raw doubles and the others in
+ * bit-doubles with default, each defaulting to the previous point.
+ * Returns -1 if the chain ends before, or if a value is not sane; 0 otherwise.
+ */
+int
+bit_read_2DD_array (Bit_Chain * dat, BITCODE_2RD * dest, uint32_t num)
+{
+  uint32_t i;
+
+  if (num == 0)
+    return (0);
+  if (bit_read_RD_array (dat, &dest[0].x, 2))
+    return (-1);
+  for (i = 1; i < num; i++)
+    {
+      if (dat->byte + 2 * BULK_MARGIN < dat->size)
+        {
+          dest[i].x = bulk_read_DD (dat, dest[i - 1].x);
+          dest[i].y = bulk_read_DD (dat, dest[i - 1].y);
+        }
+      else if (bulk_at_end (dat))
+        return (-1);
+      else
+        {
+          dest[i].x = bit_read_DD (dat, dest[i - 1].x);
+          dest[i].y = bit_read_DD (dat, dest[i - 1].y);
+        }
+    }
+  return (bulk_check_D (&dest[0].x, 2 * num));
+}
+
+/** Read num handle-references.
+ * Returns -1 if the chain ends before, or at the first bad handle; 0 otherwise.
+ */
+int
+bit_read_H_array (Bit_Chain * dat, Dwg_Handle * dest, uint32_t num)
+{
+  uint8_t byte[8];
+  uint8_t *val;
+  uint32_t i;
+  int j;
+
+  for (i = 0; i < num; i++)
+    {
+      if (dat->byte + BULK_MARGIN < dat->size)
+        {
+          /* The code byte and at most 4 value bytes, in one go */
+          bulk_read_8RC (dat, byte);
+          dest[i].code = byte[0] >> 4;
+          dest[i].size = byte[0] & 0x0f;
+          dest[i].value = 0;
+          dest[i].index = (uint32_t) -1;
+          if (dest[i].size > 4)
+            {
+              dest[i].size = 0;
+              dat->byte -= 7;
+              return (-1);
+            }
+          val = (uint8_t *) & dest[i].value;
+          for (j = 0; j < dest[i].size; j++)
+            val[dest[i].size - 1 - j] = byte[1 + j];
+          dat->byte -= 7 - dest[i].size;
+        }
+      else if (bulk_at_end (dat))
+        return (-1);
+      else if (bit_read_H (dat, &dest[i]))
+        return (-1);
+    }
+  return (0);
+}
+
 /** Only read CRC-numbers, without checking, only in order to go to
  * the next byte, while jumping contingent non-used bits
  */
@@ -452,13 +715,23 @@ bit_check_CRC (Bit_Chain * dat, uint32_t start_address, uint16_t seed)
 BITCODE_TV
 bit_read_TV (Bit_Chain * dat)
 {
-  uint16_t i;
   uint16_t length;
-  uint8_t *chain;
 
   length = bit_read_BS (dat);
   if (length > 5000)
     return (NULL);
+  return (bit_decode_TV (dat, length));
+}
+
+/** Decodes the length characters of a simple text (after its size), as
+ * bit_read_TV does. After usage, the allocated memory must be properly freed.
+ */
+uint8_t *
+bit_decode_TV (Bit_Chain * dat, uint16_t length)
+{
+  uint16_t i;
+  uint8_t *chain;
+
   chain = (uint8_t *) malloc (length + 64);
   for (i = 0; i < length; i++)
     {
@@ -488,6 +761,49 @@ bit_read_TV (Bit_Chain * dat)
   return (chain);
 }
 
+/** Read simple text as a view into the chain, without copying it: the view
+ * keeps the position and the number of characters before any '\0', and the
+ * same bytes as bit_read_TV are skipped. bit_decode_TV gives the text back.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+bit_read_TV_view (Bit_Chain * dat, Dwg_String_View * view)
+{
+  uint16_t i;
+  uint16_t length;
+  uint8_t *end;
+
+  length = bit_read_BS (dat);
+  if (length > 5000)
+    return (-1);
+  view->chain = dat->chain + dat->byte;
+  view->bit = dat->bit;
+
+  /* Aligned strings well inside the chain are searched directly
+   */
+  if (dat->bit == 0 && dat->byte + length + 1 < dat->size)
+    {
+      end = (uint8_t *) memchr (dat->chain + dat->byte, 0, length);
+      if (end)
+	{
+	  view->length = end - (dat->chain + dat->byte);
+	  dat->byte += view->length + 1;
+	}
+      else
+	{
+	  view->length = length;
+	  dat->byte += length;
+	}
+      return (0);
+    }
+
+  for (i = 0; i < length; i++)
+    if (bit_read_RC (dat) == '\0')
+      break;
+  view->length = i;
+  return (0);
+}
+
 /** Read 1 bitlong according to normal order */
 uint32_t
 bit_read_L (Bit_Chain * dat)
@@ -665,16 +981,9 @@ bit_crc8 (uint16_t dx, uint8_t * adr, int32_t n)
   return (dx);
 }
 
-/** 32-bit CRC */
-/* See spec version 5.1 at page number 16.
- */
-uint32_t
-bit_crc32 (uint16_t seed, uint8_t * adr, uint16_t n)
-{
-  uint16_t invertedckr = ~seed;
-
-  static unsigned int ckr32table[256] =
-    { 0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+/** Table for the 32-bit CRC functions */
+static const uint32_t ckr32table[256] =
+  { 0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
     0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
     0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
@@ -719,6 +1028,31 @@ bit_crc32 (uint16_t seed, uint8_t * adr, uint16_t n)
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
   };
 
+/** 32-bit CRC */
+/* See spec version 5.1 at page number 16.
+ */
+uint32_t
+bit_crc32 (uint16_t seed, uint8_t * adr, uint16_t n)
+{
+  uint16_t invertedckr = ~seed;
+
+  for (; n > 0; n--)
+    {
+      uint8_t byte = *adr++;
+      invertedckr =
+	(invertedckr >> 8) ^ ckr32table[(invertedckr ^ byte) & 0xff];
+    }
+  return ~invertedckr;
+}
+
+/** 32-bit CRC of a large block (e.g. a whole file). Unlike bit_crc32, the
+ * seed, the accumulator and the length are 32 bits wide.
+ */
+uint32_t
+bit_crc32_long (uint32_t seed, uint8_t * adr, uint32_t n)
+{
+  uint32_t invertedckr = ~seed;
+
   for (; n > 0; n--)
     {
       uint8_t byte = *adr++;
@@ -93,6 +93,23 @@ bit_read_BT(Bit_Chain *bit_chain);
 int
 bit_read_H(Bit_Chain *bit_chain, Dwg_Handle *handle);
 
+/* Functions for reading runs of values into preallocated arrays
+ */
+void
+bit_read_RC_array(Bit_Chain *bit_chain, BITCODE_RC *dest, uint32_t num);
+
+int
+bit_read_RD_array(Bit_Chain *bit_chain, BITCODE_RD *dest, uint32_t num);
+
+int
+bit_read_BD_array(Bit_Chain *bit_chain, BITCODE_BD *dest, uint32_t num);
+
+int
+bit_read_2DD_array(Bit_Chain *bit_chain, BITCODE_2RD *dest, uint32_t num);
+
+int
+bit_read_H_array(Bit_Chain *bit_chain, Dwg_Handle *dest, uint32_t num);
+
 uint16_t
 bit_read_CRC(Bit_Chain *bit_chain);
 
@@ -102,6 +119,12 @@ bit_check_CRC(Bit_Chain *bit_chain, uint32_t start_address, uint16_t semo);
 uint8_t *
 bit_read_TV(Bit_Chain *dat);
 
+uint8_t *
+bit_decode_TV(Bit_Chain *dat, uint16_t length);
+
+int
+bit_read_TV_view(Bit_Chain *dat, Dwg_String_View *view);
+
 uint32_t
 bit_read_L(Bit_Chain *dat);
 
@@ -128,6 +151,9 @@ bit_crc8 (uint16_t dx, uint8_t *adr, int32_t n);
 uint32_t
 bit_crc32 (uint16_t seed, uint8_t *adr, uint16_t n);
 
+uint32_t
+bit_crc32_long (uint32_t seed, uint8_t *adr, uint32_t n);
+
 
 /*******************************************************************
  * Writing stuff, deprecated
@@ -0,0 +1,201 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       codepage.c
+ *     \brief      Transcoding of the strings of a drawing to UTF-8
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Strings are kept in the codepage of the drawing (dwg->header.codepage).
+ * Most of them are plain ASCII, which is copied 16 bytes at a time while no
+ * byte of a block needs work (SSE2), or 8 bytes at a time otherwise; the
+ * other bytes go through the table of the codepage. Control characters are
+ * handled as bit_read_TV does: '\n' becomes "^J" and the others are dropped.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dwg.h"
+
+/* DWG codepage numbers */
+#define CODEPAGE_US_ASCII 1
+#define CODEPAGE_ISO_8859_1 2
+#define CODEPAGE_ANSI_1252 30
+
+/* Windows-1252 characters 0x80 to 0x9F (0 == undefined); the others are the
+ * same as in ISO 8859-1
+ */
+static const uint16_t ansi_1252[32] = {
+  0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+  0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+  0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+  0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0
+};
+
+/** Gets the Unicode character of a byte above 0x7F (0 == none) */
+static uint32_t
+codepage_char (uint16_t codepage, uint8_t c)
+{
+  switch (codepage)
+    {
+    case CODEPAGE_US_ASCII:
+      return (0);
+    case CODEPAGE_ISO_8859_1:
+      return (c);
+    case CODEPAGE_ANSI_1252:
+    default:
+      /* Also assumed for unknown codepages, as dwg-dxf does */
+      if (c < 0xA0)
+        return (ansi_1252[c - 0x80]);
+      return (c);
+    }
+}
+
+/** Number of leading bytes of src, at most length, that are printable ASCII
+ * and copied as they are.
+ */
+static uint32_t
+ascii_run (const uint8_t * src, uint32_t length)
+{
+  uint32_t i = 0;
+
+#ifdef __SSE2__
+  const __m128i space = _mm_set1_epi8 (0x20);
+  const __m128i del = _mm_set1_epi8 (0x7F);
+  __m128i x;
+
+  /* Bytes above 0x7F are negative, so below space too */
+  for (; i + 16 <= length; i += 16)
+    {
+      x = _mm_loadu_si128 ((const __m128i *) (src + i));
+      if (_mm_movemask_epi8 (_mm_or_si128 (_mm_cmplt_epi8 (x, space), _mm_cmpeq_epi8 (x, del))))
+        break;
+    }
+#else
+  uint64_t x, d;
+
+  for (; i + 8 <= length; i += 8)
+    {
+      memcpy (&x, src + i, 8);
+      /* Bytes above 0x7F, below 0x20, or equal to 0x7F */
+      d = x ^ 0x7F7F7F7F7F7F7F7FULL;
+      if ((x | ((x - 0x2020202020202020ULL) & ~x) | ((d - 0x0101010101010101ULL) & ~d))
+          & 0x8080808080808080ULL)
+        break;
+    }
+#endif
+  for (; i < length; i++)
+    if (src[i] < 0x20 || src[i] > 0x7E)
+      break;
+  return (i);
+}
+
+/** Transcodes length bytes of src to UTF-8, as dwg_string_utf8. Output
+ * stops at the first character that does not fit, but the length counts on.
+ */
+static int
+codepage_to_utf8 (uint16_t codepage, const uint8_t * src, uint32_t length, char *out, uint32_t cap)
+{
+  uint32_t i, n, u, len, pos, written, room;
+  char buf[3];
+
+  room = cap > 0 ? cap - 1 : 0;
+  pos = written = 0;
+  for (i = 0; i < length;)
+    {
+      /* Run of ASCII, copied in bulk */
+      n = ascii_run (src + i, length - i);
+      if (n > 0)
+        {
+          if (written == pos && pos < room)
+            {
+              len = room - pos < n ? room - pos : n;
+              memcpy (out + pos, src + i, len);
+              written += len;
+            }
+          pos += n;
+          i += n;
+          continue;
+        }
+
+      u = src[i++];
+      if (u == '\n')
+        {
+          buf[0] = '^';
+          buf[1] = 'J';
+          len = 2;
+        }
+      else if (u < 0x80 || (u = codepage_char (codepage, u)) == 0)
+        continue;
+      else if (u < 0x800)
+        {
+          buf[0] = 0xC0 | (u >> 6);
+          buf[1] = 0x80 | (u & 0x3F);
+          len = 2;
+        }
+      else
+        {
+          buf[0] = 0xE0 | (u >> 12);
+          buf[1] = 0x80 | ((u >> 6) & 0x3F);
+          buf[2] = 0x80 | (u & 0x3F);
+          len = 3;
+        }
+      if (written == pos && pos + len <= room)
+        {
+          memcpy (out + pos, buf, len);
+          written += len;
+        }
+      pos += len;
+    }
+
+  if (cap > 0)
+    out[written] = '\0';
+  return (pos);
+}
+
+/** Writes a text string field of an object (plain, interned or view) in
+ * UTF-8 to out, of cap bytes, truncated if needed and always ended by '\0'
+ * (unless cap is 0). A view is transcoded from the source bytes, so the
+ * characters above 0x7F, dropped from plain strings, are kept.
+ * Returns the length of the whole UTF-8 text, as snprintf: it was truncated
+ * if this is cap or more; -1 if there is no string.
+ */
+int
+dwg_string_utf8 (Dwg_Struct * dwg, BITCODE_TV str, char *out, uint32_t cap)
+{
+  const Dwg_String_View *view;
+  uint8_t raw[5000];
+  uint32_t i;
+
+  if (dwg == NULL || str == NULL)
+    return (-1);
+
+  view = dwg_string_view (dwg, str);
+  if (view == NULL)
+    return (codepage_to_utf8 (dwg->header.codepage, str, strlen ((char *) str), out, cap));
+  if (view->bit == 0)
+    return (codepage_to_utf8 (dwg->header.codepage, view->chain, view->length, out, cap));
+
+  /* Unaligned views are realigned first */
+  for (i = 0; i < view->length && i < sizeof (raw); i++)
+    raw[i] = (view->chain[i] << view->bit) | (view->chain[i + 1] >> (8 - view->bit));
+  return (codepage_to_utf8 (dwg->header.codepage, raw, i, out, cap));
+}
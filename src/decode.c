@@ -32,22 +32,38 @@
 #include "decode.h"
 #include "decode_r2000.h"
 #include "decode_r2004.h"
+#include "variables.h"
+#include "object.h"
 #include "logging.h"
 
 /* Decode entity handles function (auto-generated) */
-#include "auto_entity_handle.c"
-
-/* Shared sections information struct */
-Dwg_Header_Section header;
-
-/** Decode DWG file */
-int
-dwg_decode_data (Bit_Chain * dat, Dwg_Struct * dwg)
+#include "auto_entity_handle_r13.c"
+#include "auto_entity_handle_r2000.c"
+#include "auto_entity_handle_r2004.c"
+
+static const Dwg_Decoder dwg_decoder_r13 = {
+  dwg_decode_r13_variables,
+  dwg_decode_r13_object
+};
+
+static const Dwg_Decoder dwg_decoder_r2000 = {
+  dwg_decode_r2000_variables,
+  dwg_decode_r2000_object
+};
+
+static const Dwg_Decoder dwg_decoder_r2004 = {
+  dwg_decode_r2004_variables,
+  dwg_decode_r2004_object
+};
+
+/** Reads the version code of a DWG file and sets the decoder of its family.
+ * Returns 0 if OK, -1 if the version is unknown or not supported.
+ */
+static int
+decode_version (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char version[7];
   char tmp[1024];
-  dwg->num_classes = 0;
-  dwg->num_objects = 0;
 
   /* Version */
   dat->byte = 0;
@@ -80,22 +96,175 @@ dwg_decode_data (Bit_Chain * dat, Dwg_Struct * dwg)
   LOG_INFO (tmp);
   dat->version = dwg->header.version;
 
-  if (dwg->header.version == R_13)
-    return (decode_r2000 (dat, dwg));
+  if (dwg->header.version == R_13 || dwg->header.version == R_14)
+    dwg->header.decoder = &dwg_decoder_r13;
+  else if (dwg->header.version == R_2000)
+    dwg->header.decoder = &dwg_decoder_r2000;
+  else if (dwg->header.version == R_2004)
+    dwg->header.decoder = &dwg_decoder_r2004;
+  else
+    {
+      snprintf (tmp, 1024, "LibDWG does not support this version: %s.\n",
+		version);
+      LOG_ERROR (tmp);
+      return (-1);
+    }
+  return (0);
+}
+
+/** Decode DWG file */
+int
+dwg_decode_data (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  dwg->num_classes = 0;
+  dwg->num_objects = 0;
+
+  if (decode_version (dat, dwg))
+    return (-1);
+  if (dwg->header.version == R_2004)
+    return (decode_r2004 (dat, dwg));
+  return (decode_r2000 (dat, dwg));
+}
 
-  if (dwg->header.version == R_14)
-    return (decode_r2000 (dat, dwg));
+/** Decodes the header of a DWG file only: codepage, header variables and
+ * classes. The objects section is not read at all.
+ */
+int
+dwg_decode_header (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  int error;
 
-  if (dwg->header.version == R_2000)
-    return (decode_r2000 (dat, dwg));
+  dwg->num_classes = 0;
+  dwg->num_objects = 0;
 
+  if (decode_version (dat, dwg))
+    return (-1);
   if (dwg->header.version == R_2004)
-      return (decode_r2004 (dat, dwg));
+    error = decode_r2004_header (dat, dwg);
+  else
+    error = decode_r2000_header (dat, dwg);
+  decode_header_free (dwg);
+  return (error);
+}
+
+/** Read 1 modular char from a byte pointer, the same way as bit_read_MC. With
+ * 4 bytes at hand, the continuation bits of all of them are looked at in one
+ * go, and the 7 bit groups are joined without a loop.
+ */
+static inline int32_t
+object_map_read_MC (const uint8_t ** pp, const uint8_t * end)
+{
+  const uint8_t *p = *pp;
+  uint32_t word, stops, result;
+  int len, negative;
+
+  if (end - p >= 4)
+    {
+      word = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+      stops = ~word & 0x80808080;
+      if (stops == 0)
+	{
+	  /* 4 continuation bits, like bit_read_MC */
+	  *pp = p + 4;
+	  return (0);
+	}
+#ifdef __GNUC__
+      len = __builtin_ctz (stops) / 8 + 1;
+#else
+      for (len = 1; !(stops & (0x80 << (8 * (len - 1)))); len++);
+#endif
+      if (len < 4)
+	word &= (1u << (8 * len)) - 1;
+      result = (word & 0x7f) | ((word >> 1) & 0x3f80) | ((word >> 2) & 0x1fc000) | ((word >> 3) & 0xfe00000);
+      negative = (word >> (8 * len - 2)) & 1;
+      result &= ~((uint32_t) negative << (7 * len - 1));
+      *pp = p + len;
+      return (negative ? -((int32_t) result) : (int32_t) result);
+    }
+
+  /* End of the map: byte after byte */
+  result = 0;
+  for (len = 0; len < 4 && p < end; len++, p++)
+    {
+      if (!(*p & 0x80))
+	{
+	  negative = (*p & 0x40) != 0;
+	  result |= ((uint32_t) (*p & 0x3f)) << (7 * len);
+	  *pp = p + 1;
+	  return (negative ? -((int32_t) result) : (int32_t) result);
+	}
+      result |= ((uint32_t) (*p & 0x7f)) << (7 * len);
+    }
+  *pp = p;
+  return (0);
+}
+
+/** Decode an object map (the handles section of R13 to R2004 files), from
+ * raw bytes. It is made of sections of at most 2032 bytes, each with its size
+ * (big-endian, counting itself), pairs of handle and offset deltas (modular
+ * chars, both starting from 0 in each section) and a CRC; the last section is
+ * empty.
+ * Returns the number of entries, whose absolute handles and offsets are stored
+ * in two arrays allocated here, to be freed by the caller.
+ */
+uint32_t
+dwg_decode_object_map (uint8_t * map, uint32_t size, uint32_t ** handles, uint32_t ** offsets)
+{
+  const uint8_t *p, *section, *section_end, *end;
+  uint32_t num, max, last_handle, last_offset;
+  uint16_t section_size;
+
+  *handles = NULL;
+  *offsets = NULL;
+
+  /* At least 2 bytes per entry */
+  max = size / 2;
+  if (max == 0)
+    return (0);
+  *handles = (uint32_t *) malloc (max * sizeof (uint32_t));
+  *offsets = (uint32_t *) malloc (max * sizeof (uint32_t));
+  if (*handles == NULL || *offsets == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the object map.\n");
+      free (*handles);
+      free (*offsets);
+      *handles = NULL;
+      *offsets = NULL;
+      return (0);
+    }
+
+  num = 0;
+  p = map;
+  end = map + size;
+  while (end - p >= 2)
+    {
+      section = p;
+      section_size = (p[0] << 8) | p[1];
+      if (section_size <= 2)
+	break;
+      if (section_size > 2032)
+	LOG_TRACE ("Object-map section size greater than 2032!\n");
+      section_end = section + section_size;
+      if (section_end > end)
+	section_end = end;
+
+      p += 2;
+      last_handle = 0;
+      last_offset = 0;
+      while (p < section_end && num < max)
+	{
+	  last_handle += object_map_read_MC (&p, end);
+	  last_offset += object_map_read_MC (&p, end);
+	  (*handles)[num] = last_handle;
+	  (*offsets)[num] = last_offset;
+	  num++;
+	}
+
+      /* CRC */
+      p += 2;
+    }
 
-  snprintf (tmp, 1024, "LibDWG does not support this version: %s.\n",
-	    version);
-  LOG_ERROR (tmp);
-  return (-1);
+  return (num);
 }
 
 /** Decode DWG object */
@@ -104,10 +273,8 @@ dwg_decode_object (Bit_Chain * dat, Dwg_Object * obj)
 {
   char tmp[1024];
   int16_t len;
-  int16_t len2;
   uint32_t bsize;
   Dwg_Handle hdl;
-  Bit_Chain bc;
 
   if (dat->version >= R_2000)	// SINCE R_2000
     {
@@ -141,7 +308,10 @@ dwg_decode_object (Bit_Chain * dat, Dwg_Object * obj)
       return 0;
     }
 
-  // XXX: discarding extended data (old code was wrong, and extended data is not usable)
+  /* Extended data: each record is kept whole, as it is, and skipped by its
+   * size (see dwg_eed_add) */
+  obj->eed_start = obj->parent->num_eed;
+  obj->num_eed = 0;
   while ((len = bit_read_BS (dat)) != 0)
     {
       /* Max acceptable data size (my pref) */
@@ -166,64 +336,7 @@ dwg_decode_object (Bit_Chain * dat, Dwg_Object * obj)
           LOG_INSANE ("FAIL: extended data, handle == 0\n");
 	  return 0;
 	}
-      /* Check valid DXF group-codes */
-      bit_advance_position (dat, len * 8);
-      bc.byte = dat->byte;
-      bit_advance_position (dat, -len * 8);
-      while (dat->byte < bc.byte)
-	{
-	  /* Read group-code */
-	  switch (bit_read_RC (dat))
-	    {
-	    case 0:
-	      if (dat->version <= R_2004)
-		{
-		  len2 = bit_read_RC (dat);
-		  bit_read_RS (dat);
-		  bit_advance_position (dat, len2 * 8);
-		}
-	      else
-		{
-		  len2 = bit_read_RS (dat);
-		  bit_advance_position (dat, 2 * len2 * 8);
-		}
-	      break;
-	    case 2:
-	      bit_read_RC (dat);
-	      break;
-	    case 3:
-	    case 5:
-	      bit_advance_position (dat, 8 * 8);
-	      break;
-	    case 4:
-	      len2 = bit_read_RC (dat);
-	      bit_advance_position (dat, len2 * 8);
-	      break;
-	    case 10:
-	    case 11:
-	    case 12:
-	    case 13:
-	      bit_read_RD (dat);
-	      bit_read_RD (dat);
-	      bit_read_RD (dat);
-	      break;
-	    case 40:
-	    case 41:
-	    case 42:
-	      bit_read_RD (dat);
-	      break;
-	    case 70:
-	      bit_read_RS (dat);
-	      break;
-	    case 71:
-	      bit_read_RL (dat);
-	      break;
-	    default:
-              LOG_INSANE ("FAIL: extended data, unknown DXF group-code\n");
-	      return 0;
-	    }
-	}
-      dat->byte = bc.byte;
+      dwg_eed_add (obj, &hdl, dat, len);
       snprintf (tmp, 1024, "Extended data: app HANDLE (%X.%d.%X), length %d.\n", hdl.code,
 	      hdl.size, hdl.value, len);
       LOG_TRACE (tmp);
@@ -423,25 +536,30 @@ dwg_decode_nongraph (Bit_Chain * dat, Dwg_Object_Nongraph * ord)
   return 1;
 }
 
+/** Frees the section tables used while decoding */
 void
-decode_header_free ()
+decode_header_free (Dwg_Struct * dwg)
 {
   int i;
 
-  if (header.section)
-    free (header.section);
-  header.section = NULL;
-  header.num_sections = 0;
-  for (i = 0; i < header.num_descriptions; i++)
+  if (dwg->header.section)
+    free (dwg->header.section);
+  dwg->header.section = NULL;
+  dwg->header.num_sections = 0;
+  if (dwg->header.section_page)
+    free (dwg->header.section_page);
+  dwg->header.section_page = NULL;
+  dwg->header.num_section_pages = 0;
+  for (i = 0; i < dwg->header.num_descriptions; i++)
     {
-      free (header.section_info[i].sections);
-      header.section_info[i].sections = NULL;
-      header.section_info[i].num_sections = 0;
+      free (dwg->header.section_info[i].sections);
+      dwg->header.section_info[i].sections = NULL;
+      dwg->header.section_info[i].num_sections = 0;
     }
-  if (header.section_info)
-    free (header.section_info);
-  header.section_info = NULL;
-  header.num_descriptions = 0;
+  if (dwg->header.section_info)
+    free (dwg->header.section_info);
+  dwg->header.section_info = NULL;
+  dwg->header.num_descriptions = 0;
 }
 
 /** DWG sentinel */
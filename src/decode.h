@@ -68,60 +68,41 @@ typedef enum DWG_SECTION_TYPE
 } Dwg_Section_Type;
 
 /**
- *    \struct  _dwg_section
- *    \brief   Struct for DWG section
+ *    \struct  _dwg_decoder
+ *    \brief   Decoding functions generated for one family of versions, with
+ *             the version checks resolved at compile time
  */
-typedef struct _dwg_section
+typedef struct _dwg_decoder
 {
-  int32_t number;
-  uint32_t address;
-  uint32_t size;
-  uint32_t parent;
-  uint32_t left;
-  uint32_t right;
-  uint32_t x00;
-} Dwg_Section;
-
-typedef struct _dwg_section_info
-{ 
-  uint32_t size;
-  uint32_t unknown1;	   
-  uint32_t num_sections;  
-  uint32_t max_decomp_size;  
-  uint32_t unknown2;	   
-  uint32_t compressed;
-  uint32_t type;
-  uint32_t encrypted;
-  char name[64];
-  Dwg_Section **sections;
-} Dwg_Section_Info;
-
-typedef struct _header_sections
-{
-  uint16_t num_sections;
-  Dwg_Section *section;
-  uint16_t num_descriptions;
-  Dwg_Section_Info *section_info;
-} Dwg_Header_Section;
+  int (*variables) (Bit_Chain * dat, Dwg_Struct * dwg);
+  int (*object) (Bit_Chain * dat, Dwg_Object * obj);
+} Dwg_Decoder;
 
 int dwg_decode_data (Bit_Chain *bit_chain, Dwg_Struct * dwg_data);
 
+int dwg_decode_header (Bit_Chain *bit_chain, Dwg_Struct * dwg_data);
+
+uint32_t dwg_decode_object_map (uint8_t * map, uint32_t size, uint32_t ** handles, uint32_t ** offsets);
+
 int dwg_decode_object (Bit_Chain * dat, Dwg_Object * obj);
 
 int dwg_decode_entity (Bit_Chain *dat, Dwg_Object_Entity * ent);
 
-int dwg_decode_entity_handles (Bit_Chain *dat, Dwg_Object * obj);
+int dwg_decode_r13_entity_handles (Bit_Chain *dat, Dwg_Object * obj);
+
+int dwg_decode_r2000_entity_handles (Bit_Chain *dat, Dwg_Object * obj);
+
+int dwg_decode_r2004_entity_handles (Bit_Chain *dat, Dwg_Object * obj);
 
 int dwg_decode_nongraph (Bit_Chain *dat, Dwg_Object_Nongraph * ngr);
 
 void dwg_decode_common_entity_handle_data (Bit_Chain *dat, Dwg_Object *obj);
 
-void decode_header_free (void);
+void decode_header_free (Dwg_Struct * dwg);
 
 unsigned char * decode_sentinel (Dwg_Sentinel sentinel);
 
 /* XXX Functions defined in dwg_objects.spe.c (encoding is deprecated) */
-int decode_3dsolid(Bit_Chain* dat, Dwg_Object* obj, Dwg_Entity_3DSOLID* _obj);
 int encode_3dsolid(Bit_Chain* dat, Dwg_Object* obj, Dwg_Entity_3DSOLID* _obj);
 
 #endif
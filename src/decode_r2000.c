@@ -34,16 +34,35 @@
 #include "logging.h"
 #include "object.h"
 
-extern Dwg_Header_Section header;
-
 /** Decode R13-R15 */
 int
 decode_r2000 (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  if (decode_r2000_header (dat, dwg))
+    {
+      decode_header_free (dwg);
+      return -1;
+    }
+
+  /* Objects scanning */
+  dec_r2000_objects (dat, dwg);
+
+  /* Section Measurement */
+  dec_r2000_measurement (dat, dwg);
+
+  /* Clean up
+   */
+  decode_header_free (dwg);
+
+  return 0;
+}
+
+/** Decode the header of R13-R15, up to the classes: only the first bytes of
+ * the file and the variables and classes sections are read */
+int
+decode_r2000_header (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char tmp[1024];
-  unsigned char sig;
-  long unsigned pvz;
-  unsigned i;
 
   /* Codepage */
   dat->byte = 0x13;
@@ -54,18 +73,18 @@ decode_r2000 (Bit_Chain * dat, Dwg_Struct * dwg)
   /* Section Locator Records */
   dat->byte = 0x15;
   dec_r2000_section_locator (dat, dwg);
+  if (dwg->header.num_sections < 2)
+    {
+      LOG_ERROR ("No sections for Variables and Classes.\n");
+      return -1;
+    }
 
   /* Header Variables */
   dec_r2000_variables (dat, dwg);
 
   /* Classes */
   dec_r2000_classes (dat, dwg);
-
-  /* Objects scanning */
-  dec_r2000_objects (dat, dwg);
-
-  /* Section Measurement */
-  dec_r2000_measurement (dat, dwg);
+  dwg_classes_init (dwg);
 
   return 0;
 }
@@ -76,20 +95,20 @@ dec_r2000_section_locator (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char tmp[1024];
   uint8_t crc, crc2;
-  int i;
+  uint32_t i;
 
-  header.num_sections = bit_read_RL (dat);
-  header.section = (Dwg_Section *) malloc (header.num_sections * sizeof (Dwg_Section));
-  snprintf (tmp, 1024, "HEADER sections: %u\n", header.num_sections);
+  dwg->header.num_sections = bit_read_RL (dat);
+  dwg->header.section = (Dwg_Section *) malloc (dwg->header.num_sections * sizeof (Dwg_Section));
+  snprintf (tmp, 1024, "HEADER sections: %u\n", dwg->header.num_sections);
   LOG_TRACE (tmp);
 
-  for (i = 0; i < header.num_sections; i++)
+  for (i = 0; i < dwg->header.num_sections; i++)
     {
-      header.section[i].number = bit_read_RC (dat);
-      header.section[i].address = bit_read_RL (dat);
-      header.section[i].size = bit_read_RL (dat);
+      dwg->header.section[i].number = bit_read_RC (dat);
+      dwg->header.section[i].address = bit_read_RL (dat);
+      dwg->header.section[i].size = bit_read_RL (dat);
       snprintf (tmp, 1024, "  [%i] Adress: 0x%X; Size: %lu\n",
-		header.section[i].number, header.section[i].address, header.section[i].size);
+		dwg->header.section[i].number, dwg->header.section[i].address, dwg->header.section[i].size);
       LOG_TRACE (tmp);
     }
 
@@ -119,24 +138,24 @@ dec_r2000_variables (Bit_Chain * dat, Dwg_Struct * dwg)
   uint32_t size;
   uint8_t ckr, ckr2;
 
-  snprintf (tmp, 1024, "\nVARIABLES:\t %8X \n", (unsigned int) header.section[0].address);
+  snprintf (tmp, 1024, "\nVARIABLES:\t %8X \n", (unsigned int) dwg->header.section[0].address);
   LOG_TRACE (tmp);
-  snprintf (tmp, 1024, "VARIABLES (end): %8X \n", (unsigned int) (header.section[0].address + header.section[0].size));
+  snprintf (tmp, 1024, "VARIABLES (end): %8X \n", (unsigned int) (dwg->header.section[0].address + dwg->header.section[0].size));
   LOG_TRACE (tmp);
 
-  dat->byte = header.section[0].address + 16;
+  dat->byte = dwg->header.section[0].address + 16;
   size = bit_read_RL (dat);
   snprintf (tmp, 1024, "Length: %lu\n", size);
   LOG_TRACE (tmp);
 
   dat->bit = 0;
-  dwg_decode_variables (dat, dwg);
+  dwg->header.decoder->variables (dat, dwg);
 
   /* Check CRC */
-  dat->byte = header.section[0].address + header.section[0].size - 18;
+  dat->byte = dwg->header.section[0].address + dwg->header.section[0].size - 18;
   dat->bit = 0;
   ckr = bit_read_RS (dat);
-  ckr2 = bit_crc8 (0xc0c1, dat->chain + header.section[0].address + 16, header.section[0].size - 34);
+  ckr2 = bit_crc8 (0xc0c1, dat->chain + dwg->header.section[0].address + 16, dwg->header.section[0].size - 34);
   if (ckr != ckr2)
     {
       snprintf (tmp, 1024, "Variables CRC failed! CRC:%x CRC2:%x \n", ckr, ckr2);
@@ -152,12 +171,12 @@ dec_r2000_classes (Bit_Chain * dat, Dwg_Struct * dwg)
   uint32_t size, last, pvz;
   uint8_t ckr, ckr2;
 
-  snprintf (tmp, 1024, "\nCLASS:\t %8X\n", (unsigned) header.section[1].address);
+  snprintf (tmp, 1024, "\nCLASS:\t %8X\n", (unsigned) dwg->header.section[1].address);
   LOG_TRACE (tmp);
-  snprintf (tmp, 1024, "CLASS (end): %8X\n", (unsigned) (header.section[1].address + header.section[1].size));
+  snprintf (tmp, 1024, "CLASS (end): %8X\n", (unsigned) (dwg->header.section[1].address + dwg->header.section[1].size));
   LOG_TRACE (tmp);
 
-  dat->byte = header.section[1].address + 16;
+  dat->byte = dwg->header.section[1].address + 16;
   dat->bit = 0;
   size = bit_read_RL (dat);
   last = dat->byte + size;
@@ -179,9 +198,9 @@ dec_r2000_classes (Bit_Chain * dat, Dwg_Struct * dwg)
 
       dwg->dwg_class[idc].number = bit_read_BS (dat);
       dwg->dwg_class[idc].version = bit_read_BS (dat);
-      dwg->dwg_class[idc].appname = bit_read_TV (dat);
-      dwg->dwg_class[idc].cppname = bit_read_TV (dat);
-      dwg->dwg_class[idc].dxfname = bit_read_TV (dat);
+      dwg->dwg_class[idc].appname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (dat));
+      dwg->dwg_class[idc].cppname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (dat));
+      dwg->dwg_class[idc].dxfname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (dat));
       dwg->dwg_class[idc].wasazombie = bit_read_B (dat);
       dwg->dwg_class[idc].item_class_id = bit_read_BS (dat);
 
@@ -200,10 +219,10 @@ dec_r2000_classes (Bit_Chain * dat, Dwg_Struct * dwg)
   while (dat->byte < (last - 1));
 
   /* Check CRC */
-  dat->byte = header.section[1].address + header.section[1].size - 18;
+  dat->byte = dwg->header.section[1].address + dwg->header.section[1].size - 18;
   dat->bit = 0;
   ckr = bit_read_RS (dat);
-  ckr2 = bit_crc8 (0xc0c1, dat->chain + header.section[1].address + 16, header.section[1].size - 34);
+  ckr2 = bit_crc8 (0xc0c1, dat->chain + dwg->header.section[1].address + 16, dwg->header.section[1].size - 34);
   if (ckr != ckr2)
     {
       snprintf (tmp, 1024, "Classes CRC failed! CRC:%x CRC2:%x\n", ckr, ckr2);
@@ -221,20 +240,19 @@ dec_r2000_classes (Bit_Chain * dat, Dwg_Struct * dwg)
 }
 
 #define MAX_SECTIONS_R2000 7
-/** Scan R13-R15 objects */
-void
-dec_r2000_objects (Bit_Chain * dat, Dwg_Struct * dwg)
+/** Scan R13-R15 objects, byte after byte, when there is no object map */
+static void
+dec_r2000_objects_scan (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char tmp[1024];
   uint32_t obj_begin, obj_end;
-  uint16_t lastcrc;
   uint32_t adra[MAX_SECTIONS_R2000], adrb[MAX_SECTIONS_R2000];
-  int i;
+  uint32_t i;
 
-  for (i = 0; i < header.num_sections; i++)
+  for (i = 0; i < dwg->header.num_sections && i < MAX_SECTIONS_R2000; i++)
     {
-      adra[i] = header.section[i].address;
-      adrb[i] = adra[i] + header.section[i].size;
+      adra[i] = dwg->header.section[i].address;
+      adrb[i] = adra[i] + dwg->header.section[i].size;
     }
   dat->byte = 70;
   dat->bit = 0;
@@ -247,7 +265,7 @@ dec_r2000_objects (Bit_Chain * dat, Dwg_Struct * dwg)
   dwg->num_objects = 0;
   while (dat->byte < obj_end)
     {
-      uint32_t prevadr, n_obj, objtype;
+      uint32_t prevadr, n_obj;
 
       /* Skip variables and class sections
        */
@@ -272,7 +290,52 @@ dec_r2000_objects (Bit_Chain * dat, Dwg_Struct * dwg)
     }
   snprintf (tmp, 1024, "===== SCANNING ===== End\n");
   LOG_TRACE (tmp);
-  snprintf (tmp, 1024, "Num objects scanned: %lu \n", dwg->num_objects);
+}
+
+/** Read R13-R15 objects, at the addresses of the object map (section 2) */
+void
+dec_r2000_objects (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  char tmp[1024];
+  uint32_t i, num_entries;
+  uint32_t *handles, *offsets;
+
+  num_entries = 0;
+  if (dwg->header.num_sections > 2
+      && dwg->header.section[2].address < dat->size
+      && dwg->header.section[2].size <= dat->size - dwg->header.section[2].address)
+    num_entries = dwg_decode_object_map (dat->chain + dwg->header.section[2].address,
+					 dwg->header.section[2].size, &handles, &offsets);
+  if (num_entries == 0)
+    {
+      LOG_WARN ("No object map, scanning for objects.\n");
+      dec_r2000_objects_scan (dat, dwg);
+    }
+  else
+    {
+      snprintf (tmp, 1024, "\nOBJECT MAP:\t %8X (%lu entries)\n",
+		(unsigned int) dwg->header.section[2].address, (long unsigned) num_entries);
+      LOG_TRACE (tmp);
+      dwg->num_objects = 0;
+      dwg_objects_reserve (dwg, num_entries);
+      for (i = 0; i < num_entries; i++)
+	{
+	  if (offsets[i] >= dat->size)
+	    {
+	      LOG_ERROR ("Object address beyond the end of the file.\n");
+	      break;
+	    }
+	  /* Skip the size, not read by dwg_object_add_from_chain before R2004 */
+	  dat->byte = offsets[i];
+	  dat->bit = 0;
+	  bit_read_MS (dat);
+	  dwg_object_add_from_chain (dwg, dat, dat->byte);
+	}
+      free (handles);
+      free (offsets);
+    }
+
+  snprintf (tmp, 1024, "Num objects read: %lu \n", dwg->num_objects);
   LOG_TRACE (tmp);
 }
 
@@ -282,11 +345,11 @@ dec_r2000_measurement (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char tmp[1024];
 
-  snprintf (tmp, 1024, "\nUNKNOWN 2:\t %8X \n", (unsigned) header.section[4].address);
+  snprintf (tmp, 1024, "\nUNKNOWN 2:\t %8X \n", (unsigned) dwg->header.section[4].address);
   LOG_TRACE (tmp);
-  snprintf (tmp, 1024, "UNKNOWN 2 (end): %8X \n", (unsigned) (header.section[4].address + header.section[4].size));
+  snprintf (tmp, 1024, "UNKNOWN 2 (end): %8X \n", (unsigned) (dwg->header.section[4].address + dwg->header.section[4].size));
   LOG_TRACE (tmp);
-  dat->byte = header.section[4].address;
+  dat->byte = dwg->header.section[4].address;
   dat->bit = 0;
   dwg->variable.MEASUREMENT = bit_read_RL (dat);
   snprintf (tmp, 1024, "\nSize bytes :\t%lu \n", dat->size);
@@ -29,6 +29,8 @@
 
 int decode_r2000 (Bit_Chain *dat, Dwg_Struct *dwg);
 
+int decode_r2000_header (Bit_Chain *dat, Dwg_Struct *dwg);
+
 void dec_r2000_section_locator (Bit_Chain *dat, Dwg_Struct *dwg);
 
 void dec_r2000_variables (Bit_Chain *dat, Dwg_Struct *dwg);
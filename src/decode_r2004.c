@@ -35,14 +35,40 @@
 #include "logging.h"
 #include "object.h"
 
-extern Dwg_Header_Section header;
-
 /** Decode R2004 version */
 int
 decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  if (decode_r2004_header (dat, dwg))
+    {
+      decode_header_free (dwg);
+      return -1;
+    }
+
+  /* Objects scanning */
+  dec_r2004_section_handles (dat, dwg);
+
+  /* Clean up
+   */
+  decode_header_free (dwg);
+
+  if (dwg->num_objects == 0)
+    {
+       LOG_ERROR ("No objects found.\n");
+       return -1;
+    }
+
+  return 0;
+}
+
+/** Decode the header of R2004, up to the classes: only the pages of the
+ * section map, of the section info, and of the variables and classes
+ * sections are read and decompressed */
+int
+decode_r2004_header (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   int i;
-  int rseed;
+  uint32_t rseed;
   char tmp[1024];
   Dwg_Section *section;
 
@@ -165,16 +191,16 @@ decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg)
       fprintf (stderr, "Checksum: %x \n\n", ss.fields.checksum);
     }
 
-  dec_r2004_section_map (dat, ss.fields.comp_data_size, ss.fields.decomp_data_size);
+  dec_r2004_section_map (dat, dwg, ss.fields.comp_data_size, ss.fields.decomp_data_size);
 
-  if (header.section == NULL)
+  if (dwg->header.section == NULL)
     {
       LOG_ERROR ("Failed to read R2004 Section Page Map.\n");
       return -1;
     }
 
   /* Section Info */
-  section = find_section (hdat.fields.section_info_id);
+  section = find_section (dwg, hdat.fields.section_info_id);
 
   if (section)
     {
@@ -197,7 +223,7 @@ decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg)
 	  fprintf (stderr, "Checksum: %x \n\n", ss.fields.checksum);
 	}
 
-      dec_r2004_section_info (dat, ss.fields.comp_data_size, ss.fields.decomp_data_size);
+      dec_r2004_section_info (dat, dwg, ss.fields.comp_data_size, ss.fields.decomp_data_size);
     }
   else
     {
@@ -210,19 +236,7 @@ decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg)
 
   /* Classes */
   dec_r2004_section_classes (dat, dwg);
-
-  /* Objects scanning */
-  dec_r2004_section_handles (dat, dwg);
-
-  /* Clean up
-   */
-  decode_header_free ();
-
-  if (dwg->num_objects == 0)
-    {
-       LOG_ERROR ("No objects found.\n");
-       return -1;
-    }
+  dwg_classes_init (dwg);
 
   return 0;
 }
@@ -232,11 +246,12 @@ decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg)
  * to locate the sections in the file.
  */
 void
-dec_r2004_section_map (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp_data_size)
+dec_r2004_section_map (Bit_Chain * dat, Dwg_Struct * dwg, uint32_t comp_data_size, uint32_t decomp_data_size)
 {
   char tmp[1024];
   char *decomp, *ptr;
-  uint32_t i;
+  uint32_t i, num, max_number;
+  int32_t number;
   uint32_t section_address, bytes_remaining;
   uint32_t crc, crc2;
 
@@ -252,55 +267,95 @@ dec_r2004_section_map (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp
   decompress_r2004_section (dat, decomp, comp_data_size);
 
   LOG_COMPRESS ("\n#### Section Map fields R2004 ####\n");
-  i = 0;
-  section_address = 0x100;	// starting address
+  dwg->header.num_sections = 0;
+  dwg->header.section = NULL;
+  dwg->header.num_section_pages = 0;
+  dwg->header.section_page = NULL;
+
+  /* Count the entries and find the highest page number, so that the section
+   * array and the page table are allocated once
+   */
+  num = 0;
+  max_number = 0;
   bytes_remaining = decomp_data_size;
   ptr = decomp;
-  header.num_sections = 0;
-  header.section = NULL;
+  while (bytes_remaining >= 8)
+    {
+      number = *((int32_t *) ptr);
+      bytes_remaining -= 8;
+      ptr += 8;
+      if (number < 0)
+	{
+	  if (bytes_remaining < 16)
+	    break;
+	  bytes_remaining -= 16;
+	  ptr += 16;
+	}
+      else if ((uint32_t) number > max_number)
+	max_number = number;
+      num++;
+    }
+  if (num == 0)
+    {
+      free (decomp);
+      return;
+    }
 
-  while (bytes_remaining)
+  dwg->header.section = (Dwg_Section *) calloc (num, sizeof (Dwg_Section));
+  if (dwg->header.section == NULL)
     {
-      if (header.num_sections == 0)
-	header.section = (Dwg_Section *) malloc (sizeof (Dwg_Section));
-      else
-	header.section = (Dwg_Section *) realloc (header.section, sizeof (Dwg_Section) * (header.num_sections + 1));
+      LOG_ERROR ("Not enough memory for the Section Map.\n");
+      free (decomp);
+      return;
+    }
 
-      header.section[i].number = *((int32_t *) ptr);
-      header.section[i].size = *((uint32_t *) ptr + 1);
-      header.section[i].address = section_address;
-      section_address += header.section[i].size;
-      bytes_remaining -= 8;
+  /* Page numbers are small and dense; the table is left out if they are not */
+  if (max_number < 4 * num + 256)
+    {
+      dwg->header.section_page = (Dwg_Section **) calloc (max_number + 1, sizeof (Dwg_Section *));
+      if (dwg->header.section_page)
+	dwg->header.num_section_pages = max_number + 1;
+    }
+
+  section_address = 0x100;	// starting address
+  ptr = decomp;
+  for (i = 0; i < num; i++)
+    {
+      dwg->header.section[i].number = *((int32_t *) ptr);
+      dwg->header.section[i].size = *((uint32_t *) ptr + 1);
+      dwg->header.section[i].address = section_address;
+      section_address += dwg->header.section[i].size;
       ptr += 8;
 
       if (log_level_get () >= LOG_LEVEL_COMPRESS)
 	{
-	  fprintf (stderr, "SectionNumber: %ld \n", header.section[i].number);
-	  fprintf (stderr, "  SectionSize: %x \n", header.section[i].size);
-	  fprintf (stderr, "  SectionAddr: %x \n", header.section[i].address);
+	  fprintf (stderr, "SectionNumber: %ld \n", dwg->header.section[i].number);
+	  fprintf (stderr, "  SectionSize: %x \n", dwg->header.section[i].size);
+	  fprintf (stderr, "  SectionAddr: %x \n", dwg->header.section[i].address);
 	}
 
-      if (header.section[i].number < 0)
+      if (dwg->header.section[i].number < 0)
 	{
-	  header.section[i].parent = *((uint32_t *) ptr);
-	  header.section[i].left = *((uint32_t *) ptr + 1);
-	  header.section[i].right = *((uint32_t *) ptr + 2);
-	  header.section[i].x00 = *((uint32_t *) ptr + 3);
-	  bytes_remaining -= 16;
+	  dwg->header.section[i].parent = *((uint32_t *) ptr);
+	  dwg->header.section[i].left = *((uint32_t *) ptr + 1);
+	  dwg->header.section[i].right = *((uint32_t *) ptr + 2);
+	  dwg->header.section[i].x00 = *((uint32_t *) ptr + 3);
 	  ptr += 16;
 
 	  if (log_level_get () >= LOG_LEVEL_COMPRESS)
 	    {
-	      fprintf (stderr, "+++\n  Parent: %ld \n", header.section[i].parent);
-	      fprintf (stderr, "  Left: %ld \n", header.section[i].left);
-	      fprintf (stderr, "  Right: %ld \n", header.section[i].right);
-	      fprintf (stderr, "  0x00: %ld \n", header.section[i].x00);
+	      fprintf (stderr, "+++\n  Parent: %ld \n", dwg->header.section[i].parent);
+	      fprintf (stderr, "  Left: %ld \n", dwg->header.section[i].left);
+	      fprintf (stderr, "  Right: %ld \n", dwg->header.section[i].right);
+	      fprintf (stderr, "  0x00: %ld \n", dwg->header.section[i].x00);
 	    }
 	}
-
-      header.num_sections++;
-      i++;
+      /* The first page of a given number wins, as in a linear search */
+      else if ((uint32_t) dwg->header.section[i].number < dwg->header.num_section_pages
+	       && dwg->header.section_page[dwg->header.section[i].number] == NULL)
+	dwg->header.section_page[dwg->header.section[i].number] = &dwg->header.section[i];
     }
+  dwg->header.num_sections = num;
 
   /* Check CRC TODO
   crc = bit_crc32 (0xc0c1, dat->chain, dat->byte);
@@ -318,7 +373,7 @@ dec_r2004_section_map (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp
 
 /** Read R2004 Section Info */
 void
-dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp_data_size)
+dec_r2004_section_info (Bit_Chain * dat, Dwg_Struct * dwg, uint32_t comp_data_size, uint32_t decomp_data_size)
 {
   char tmp[1024];
   char *decomp, *ptr;
@@ -336,8 +391,8 @@ dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decom
 
   decompress_r2004_section (dat, decomp, comp_data_size);
 
-  memcpy (&header.num_descriptions, decomp, 4);
-  header.section_info = (Dwg_Section_Info *) malloc (sizeof (Dwg_Section_Info) * header.num_descriptions);
+  memcpy (&dwg->header.num_descriptions, decomp, 4);
+  dwg->header.section_info = (Dwg_Section_Info *) malloc (sizeof (Dwg_Section_Info) * dwg->header.num_descriptions);
 
   if (log_level_get () >= LOG_LEVEL_COMPRESS)
     {
@@ -350,43 +405,43 @@ dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decom
     }
 
   ptr = decomp + 20;
-  for (i = 0; i < header.num_descriptions; ++i)
-    {
-      header.section_info[i].size = *((int *) ptr);
-      header.section_info[i].unknown1 = *((int *) ptr + 1);
-      header.section_info[i].num_sections = *((int *) ptr + 2);
-      header.section_info[i].max_decomp_size = *((int *) ptr + 3);
-      header.section_info[i].unknown2 = *((int *) ptr + 4);
-      header.section_info[i].compressed = *((int *) ptr + 5);
-      header.section_info[i].type = *((int *) ptr + 6);
-      header.section_info[i].encrypted = *((int *) ptr + 7);
+  for (i = 0; i < dwg->header.num_descriptions; ++i)
+    {
+      dwg->header.section_info[i].size = *((int *) ptr);
+      dwg->header.section_info[i].unknown1 = *((int *) ptr + 1);
+      dwg->header.section_info[i].num_sections = *((int *) ptr + 2);
+      dwg->header.section_info[i].max_decomp_size = *((int *) ptr + 3);
+      dwg->header.section_info[i].unknown2 = *((int *) ptr + 4);
+      dwg->header.section_info[i].compressed = *((int *) ptr + 5);
+      dwg->header.section_info[i].type = *((int *) ptr + 6);
+      dwg->header.section_info[i].encrypted = *((int *) ptr + 7);
       ptr += 32;
-      memcpy (header.section_info[i].name, ptr, 64);
+      memcpy (dwg->header.section_info[i].name, ptr, 64);
       ptr += 64;
 
       if (log_level_get () >= LOG_LEVEL_COMPRESS)
 	{
 	  fprintf (stderr, "\n**** Section Info description fields ****\n");
-	  fprintf (stderr, "Size: %d\n", (int) header.section_info[i].size);
-	  fprintf (stderr, "Unknown: %d\n", (int) header.section_info[i].unknown1);
-	  fprintf (stderr, "Number of sections:  %d\n", (int) header.section_info[i].num_sections);
-	  fprintf (stderr, "Max decompressed size: %d\n", (int) header.section_info[i].max_decomp_size);
-	  fprintf (stderr, "Unknown: %d\n", (int) header.section_info[i].unknown2);
-	  fprintf (stderr, "Compressed (0x02): %x\n", (unsigned int) header.section_info[i].compressed);
-	  fprintf (stderr, "Section Type: %d\n", (int) header.section_info[i].type);
-	  fprintf (stderr, "Encrypted: %d\n", (int) header.section_info[i].encrypted);
-	  fprintf (stderr, "Section Name: %s\n\n", header.section_info[i].name);
+	  fprintf (stderr, "Size: %d\n", (int) dwg->header.section_info[i].size);
+	  fprintf (stderr, "Unknown: %d\n", (int) dwg->header.section_info[i].unknown1);
+	  fprintf (stderr, "Number of sections:  %d\n", (int) dwg->header.section_info[i].num_sections);
+	  fprintf (stderr, "Max decompressed size: %d\n", (int) dwg->header.section_info[i].max_decomp_size);
+	  fprintf (stderr, "Unknown: %d\n", (int) dwg->header.section_info[i].unknown2);
+	  fprintf (stderr, "Compressed (0x02): %x\n", (unsigned int) dwg->header.section_info[i].compressed);
+	  fprintf (stderr, "Section Type: %d\n", (int) dwg->header.section_info[i].type);
+	  fprintf (stderr, "Encrypted: %d\n", (int) dwg->header.section_info[i].encrypted);
+	  fprintf (stderr, "Section Name: %s\n\n", dwg->header.section_info[i].name);
 	}
 
-      header.section_info[i].sections = (Dwg_Section **) malloc
-	(header.section_info[i].num_sections * sizeof (Dwg_Section *));
+      dwg->header.section_info[i].sections = (Dwg_Section **) malloc
+	(dwg->header.section_info[i].num_sections * sizeof (Dwg_Section *));
 
-      if (header.section_info[i].num_sections < 1000)
+      if (dwg->header.section_info[i].num_sections < 1000)
 	{
-	  snprintf (tmp, 1024, "Section count %ld in area %d\n", header.section_info[i].num_sections, i);
+	  snprintf (tmp, 1024, "Section count %ld in area %d\n", dwg->header.section_info[i].num_sections, i);
 	  LOG_COMPRESS (tmp);
 
-	  for (j = 0; j < header.section_info[i].num_sections; j++)
+	  for (j = 0; j < dwg->header.section_info[i].num_sections; j++)
 	    {
 	      section_number = *((int *) ptr);	// Index into SectionMap
 	      data_size = *((int *) ptr + 1);
@@ -395,7 +450,7 @@ dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decom
 	      unknown = *((int *) ptr + 3);
 	      ptr += 16;
 
-	      header.section_info[i].sections[j] = find_section (section_number);
+	      dwg->header.section_info[i].sections[j] = find_section (dwg, section_number);
 
 	      if (log_level_get () >= LOG_LEVEL_COMPRESS)
 		{
@@ -409,7 +464,7 @@ dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decom
       else /* sanity check */
 	{
 	  snprintf (tmp, 1024,
-		    "section count %ld in area %d too high! Skipping.\n", header.section_info[i].num_sections, i);
+		    "section count %ld in area %d too high! Skipping.\n", dwg->header.section_info[i].num_sections, i);
 	  LOG_ERROR (tmp);
 	}
     }
@@ -427,7 +482,7 @@ dec_r2004_section_variables (Bit_Chain * dat, Dwg_Struct * dwg)
   uint32_t ckr, ckr2;
   Bit_Chain sec_dat;
 
-  error = dec_r2004_compressed_section (dat, &sec_dat, SECTION_VARIABLES);
+  error = dec_r2004_compressed_section (dat, dwg, &sec_dat, SECTION_VARIABLES);
   if (error == 1)
     {
       LOG_ERROR ("No section for Variables found!\n");
@@ -446,17 +501,17 @@ dec_r2004_section_variables (Bit_Chain * dat, Dwg_Struct * dwg)
       size = bit_read_RL (&sec_dat);
       snprintf (tmp, 1024, "Length: %lu\n", size);
       LOG_TRACE (tmp);
-      dwg_decode_variables (&sec_dat, dwg);
+      dwg->header.decoder->variables (&sec_dat, dwg);
     }
 
   /* Check CRC TODO
-  sec_dat.byte = header.section[0].address + header.section[0].size - 18;
+  sec_dat.byte = dwg->header.section[0].address + dwg->header.section[0].size - 18;
   sec_dat.bit = 0;
   ckr = bit_read_RL (&sec_dat);
-  ckr2 = bit_crc32 (0xc0c1, sec_dat.chain + header.section[0].address + 16, header.section[0].size - 34);
+  ckr2 = bit_crc32 (0xc0c1, sec_dat.chain + dwg->header.section[0].address + 16, dwg->header.section[0].size - 34);
   if (ckr != ckr2)
     {
-      snprintf (tmp, 1024, "Variables CRC failed! CRC:%x CRC2:%x \n", header.section[0].number, ckr, ckr2);
+      snprintf (tmp, 1024, "Variables CRC failed! CRC:%x CRC2:%x \n", dwg->header.section[0].number, ckr, ckr2);
       LOG_ERROR (tmp);
     }
    */
@@ -475,7 +530,7 @@ dec_r2004_section_classes (Bit_Chain * dat, Dwg_Struct * dwg)
   uint32_t pvz, ckr, ckr2;
   Bit_Chain sec_dat;
 
-  error = dec_r2004_compressed_section (dat, &sec_dat, SECTION_CLASSES);
+  error = dec_r2004_compressed_section (dat, dwg, &sec_dat, SECTION_CLASSES);
   if (error == 1)
     {
       LOG_ERROR ("No section for Classes found!\n");
@@ -511,9 +566,9 @@ dec_r2004_section_classes (Bit_Chain * dat, Dwg_Struct * dwg)
 
 	  dwg->dwg_class[idc].number = bit_read_BS (&sec_dat);
 	  dwg->dwg_class[idc].version = bit_read_BS (&sec_dat);
-	  dwg->dwg_class[idc].appname = bit_read_TV (&sec_dat);
-	  dwg->dwg_class[idc].cppname = bit_read_TV (&sec_dat);
-	  dwg->dwg_class[idc].dxfname = bit_read_TV (&sec_dat);
+	  dwg->dwg_class[idc].appname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (&sec_dat));
+	  dwg->dwg_class[idc].cppname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (&sec_dat));
+	  dwg->dwg_class[idc].dxfname = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV (&sec_dat));
 	  dwg->dwg_class[idc].wasazombie = bit_read_B (&sec_dat);
 	  dwg->dwg_class[idc].item_class_id = bit_read_BS (&sec_dat);
 
@@ -538,13 +593,13 @@ dec_r2004_section_classes (Bit_Chain * dat, Dwg_Struct * dwg)
     }
 
   /* Check CRC TODO
-  sec_dat.byte = header.section[1].address + header.section[1].size - 18;
+  sec_dat.byte = dwg->header.section[1].address + dwg->header.section[1].size - 18;
   sec_dat.bit = 0;
   ckr = bit_read_RL (dat);
-  ckr2 = bit_crc32 (0xc0c1, dat->chain + header.section[1].address + 16, header.section[1].size - 34);
+  ckr2 = bit_crc32 (0xc0c1, dat->chain + dwg->header.section[1].address + 16, dwg->header.section[1].size - 34);
   if (ckr != ckr2)
     {
-      snprintf (tmp, 1024, "Section %d crc todo ckr:%x ckr2:%x \n\n", header.section[1].number, ckr, ckr2);
+      snprintf (tmp, 1024, "Section %d crc todo ckr:%x ckr2:%x \n\n", dwg->header.section[1].number, ckr, ckr2);
       LOG_ERROR (tmp);
     }
    */
@@ -556,19 +611,46 @@ dec_r2004_section_classes (Bit_Chain * dat, Dwg_Struct * dwg)
   free (sec_dat.chain);
 }
 
-/** R2004 Handles Section */
+/* Bytes kept readable after the end of an object, as some decoders read a
+ * little past it (e.g. the strings area of LTYPE)
+ */
+#define OBJECT_SLACK 1024
+
+/** R2004 Handles Section.
+ * The objects section is not decompressed as a whole: each object is read
+ * in place from its page in the page cache, or copied out of the pages it
+ * spans. With string views the objects must stay in memory, so the section
+ * is decompressed whole and kept until dwg_reset.
+ */
 void
 dec_r2004_section_handles (Bit_Chain * dat, Dwg_Struct * dwg)
 {
   char tmp[1024];
   int error;
-  uint16_t section_size = 0;
-  unsigned char sgdc[2];
-  uint32_t duabyte, maplasta;
+  uint32_t i, num_entries, size, total, capacity, start, section_size;
+  uint32_t *handles, *offsets;
+  unsigned char head[4];
+  char *buffer;
   Bit_Chain hdl_dat;
   Bit_Chain obj_dat;
+  Bit_Chain sec_dat;
+  Dwg_Page_Cache cache;
 
-  error = dec_r2004_compressed_section (dat, &obj_dat, SECTION_DBOBJECTS);
+  memset (&cache, 0, sizeof (Dwg_Page_Cache));
+  if (dwg->header.string_views)
+    {
+      error = dec_r2004_compressed_section (dat, dwg, &sec_dat, SECTION_DBOBJECTS);
+      if (error == 0)
+	{
+	  dwg->header.view_chain[1] = sec_dat.chain;
+	  section_size = sec_dat.size;
+	}
+    }
+  else
+    {
+      error = dec_r2004_page_cache_init (&cache, dat, dwg, SECTION_DBOBJECTS);
+      section_size = cache.size;
+    }
   if (error == 1)
     {
       LOG_ERROR ("No section for Objects found!\n");
@@ -580,111 +662,111 @@ dec_r2004_section_handles (Bit_Chain * dat, Dwg_Struct * dwg)
       return;
     }
 
-  error = dec_r2004_compressed_section (dat, &hdl_dat, SECTION_HANDLES);
+  error = dec_r2004_compressed_section (dat, dwg, &hdl_dat, SECTION_HANDLES);
   if (error == 1)
     {
       LOG_ERROR ("No section for Handles found!\n");
-      free (obj_dat.chain);
+      dec_r2004_page_cache_free (&cache);
       return;
     }
   else if (error != 0)
     {
       LOG_ERROR ("Not enough memory for Handles.\n");
-      free (obj_dat.chain);
+      dec_r2004_page_cache_free (&cache);
       return;
     }
 
   LOG_TRACE ("\nOBJECTS (begin)\n");
 
-  maplasta = hdl_dat.byte + hdl_dat.size;
+  num_entries = dwg_decode_object_map (hdl_dat.chain, hdl_dat.size, &handles, &offsets);
   dwg->num_objects = 0;
-
-  do
+  dwg_objects_reserve (dwg, num_entries);
+  capacity = 0;
+  buffer = NULL;
+  obj_dat.bit = 0;
+  obj_dat.version = dat->version;
+  for (i = 0; i < num_entries; i++)
     {
-      uint32_t last_offset, last_handle, previous_address = 0;
-      uint32_t ckr, ckr2;
-
-      duabyte = hdl_dat.byte;
-      sgdc[0] = bit_read_RC (&hdl_dat);
-      sgdc[1] = bit_read_RC (&hdl_dat);
-      section_size = (sgdc[0] << 8) | sgdc[1];
-
-      if (log_level_get () >= LOG_LEVEL_TRACE)
+      if (offsets[i] > section_size)
 	{
-	  fprintf (stderr, "section_size: %u \n", section_size);
-	  if (section_size > 2032)
-	    fprintf (stderr, "[ERROR] Object-map section size greater than 2032!\n");
+	  LOG_ERROR ("Offset address greater than object section size.\n");
+	  break;
 	}
-
-      last_handle = 0;
-      last_offset = 0;
-      while (hdl_dat.byte - duabyte < section_size)
+      if (dwg->header.string_views)
 	{
-	  int32_t tmphdl, tmpadr;
-
-	  previous_address = hdl_dat.byte;
-
-	  tmphdl = bit_read_MC (&hdl_dat);
-	  last_handle += tmphdl;
-
-	  tmpadr = bit_read_MC (&hdl_dat);
-	  last_offset += tmpadr;
-
-	  //fprintf (stderr, "Hdl: %lu\nAdr: %lu\n", last_handle, last_offset);
-	  if (last_offset > obj_dat.size)
-	  {
-              free (hdl_dat.chain);
-              free (obj_dat.chain);
-	      LOG_ERROR ("Offset address greater than object section size.\n");
-	      return;
-	  }
-	  dwg_object_add_from_chain (dwg, &obj_dat, last_offset);
+	  obj_dat = sec_dat;
+	  dwg_object_add_from_chain (dwg, &obj_dat, offsets[i]);
+	  continue;
 	}
 
-      if (hdl_dat.byte == previous_address)
-	break;
-
-      if (hdl_dat.bit > 0)
+      /* Object size, then the whole object with its CRC */
+      memset (head, 0, 4);
+      obj_dat.chain = head;
+      obj_dat.size = dec_r2004_page_cache_read (&cache, offsets[i], (char *) head, 4);
+      if (obj_dat.size == 0)
+	continue;
+      obj_dat.byte = 0;
+      size = bit_read_MS (&obj_dat);
+      total = obj_dat.byte + size + 2 + OBJECT_SLACK;
+      if (total < size)
+	continue;
+      start = offsets[i] % cache.info->max_decomp_size;
+      if (total > capacity && start + total > cache.info->max_decomp_size)
 	{
-	  hdl_dat.byte += 2;
-	  hdl_dat.bit = 0;
+	  char *grown = (char *) realloc (buffer, total);
+	  if (grown == NULL)
+	    {
+	      LOG_ERROR ("Not enough memory for an object.\n");
+	      break;
+	    }
+	  buffer = grown;
+	  capacity = total;
 	}
-      sgdc[0] = bit_read_RC (&hdl_dat);
-      sgdc[1] = bit_read_RC (&hdl_dat);
-      /* Check CRC 
-      ckr = (sgdc[0] << 8) | sgdc[1];
-      ckr2 = bit_crc32 (0xc0c1, hdl_dat.chain + duabyte, section_size);
-      if (ckr != ckr2)
+      if (start + total <= cache.info->max_decomp_size)
 	{
-	  snprintf (tmp, 1024, "Section Obj-handles CRC failed! CRC:%x CRC2:%x\n", ckr, ckr2);
-	  LOG_ERROR (tmp);
-          free (hdl_dat.chain);
-          free (obj_dat.chain);
-	  return;
+	  obj_dat.chain = (unsigned char *) dec_r2004_page_cache_get (&cache, offsets[i] / cache.info->max_decomp_size);
+	  obj_dat.size = cache.info->max_decomp_size;
 	}
-       */
-
-      if (hdl_dat.byte >= maplasta)
-	break;
+      else
+	{
+	  obj_dat.chain = (unsigned char *) buffer;
+	  obj_dat.size = dec_r2004_page_cache_read (&cache, offsets[i], buffer, total);
+	  start = 0;
+	}
+      obj_dat.byte = 0;
+      dwg_object_add_from_chain (dwg, &obj_dat, start);
     }
-  while (section_size > 2);
+  free (handles);
+  free (offsets);
+  if (buffer)
+    free (buffer);
 
   snprintf (tmp, 1024, "\n Num objects: %lu \n", dwg->num_objects);
   LOG_TRACE (tmp);
   LOG_TRACE ("\nOBJECTS (end)\n");
 
   free (hdl_dat.chain);
-  free (obj_dat.chain);
+  dec_r2004_page_cache_free (&cache);
 }
 
-/** Compressed system section of a 2004 DWG file */
-int
-dec_r2004_compressed_section (Bit_Chain * dat, Bit_Chain * sec_dat, uint32_t section_type)
+/** Finds the description of a section type */
+static Dwg_Section_Info *
+find_section_info (Dwg_Struct * dwg, uint32_t section_type)
 {
-  unsigned i, j;
-  char *decomp;
-  int32_t address, sec_mask, max_decomp_size;
-  Dwg_Section_Info *info = NULL;
+  unsigned i;
+
+  for (i = 0; i < dwg->header.num_descriptions; ++i)
+    if (dwg->header.section_info[i].type == section_type)
+      return (&dwg->header.section_info[i]);
+  return (NULL);
+}
+
+/** Decompresses one page of a section, of info->max_decomp_size bytes */
+void
+dec_r2004_page (Bit_Chain * dat, Dwg_Section_Info * info, uint32_t page, char *decomp)
+{
+  unsigned j;
+  int32_t address, sec_mask;
 
   /* Encrypted Section Header */
   union _encrypted_section_header
@@ -704,16 +786,57 @@ dec_r2004_compressed_section (Bit_Chain * dat, Bit_Chain * sec_dat, uint32_t sec
     } fields;
   } es;
 
-  for (i = 0; i < header.num_descriptions && info == 0; ++i)
-    if (header.section_info[i].type == section_type)
-      info = &header.section_info[i];
+  if (info->sections[page] == NULL)
+    {
+      LOG_ERROR ("Missing page in the Section Map.\n");
+      memset (decomp, 0, info->max_decomp_size);
+      return;
+    }
+
+  address = info->sections[page]->address;
+  dat->byte = address;
+  dat->bit = 0;
+
+  for (j = 0; j < 0x20; j++)
+    es.char_data[j] = bit_read_RC (dat);
 
+  sec_mask = 0x4164536b ^ address;
+
+  for (j = 0; j < 8; ++j)
+    es.long_data[j] ^= sec_mask;
+
+  if (log_level_get () >= LOG_LEVEL_COMPRESS)
+    {
+      fprintf (stderr, "\n=== Compressed Section ===\n");
+      fprintf (stderr, "Section Tag (should be 0x41630?3b): %x \n", (unsigned int) es.fields.tag);
+      fprintf (stderr, "Section Type: %x \n", (unsigned int) es.fields.section_type);
+      // this is the number of bytes that is read in decompress_r2004_section (+ 2bytes)
+      fprintf (stderr, "Data size: %x\n", (unsigned int) es.fields.data_size);
+      fprintf (stderr, "Comp. data size: %x\n", (unsigned int) es.fields.section_size);
+      fprintf (stderr, "StartOffset: %x \n", (unsigned int) es.fields.start_offset);
+      fprintf (stderr, "Unknown: %x \n", (unsigned int) es.fields.unknown);
+      fprintf (stderr, "Checksum1: %x \n", (unsigned int) es.fields.checksum_1);
+      fprintf (stderr, "Checksum2: %x \n\n", (unsigned int) es.fields.checksum_2);
+    }
+
+  decompress_r2004_section (dat, decomp, es.fields.data_size);
+}
+
+/** Compressed system section of a 2004 DWG file */
+int
+dec_r2004_compressed_section (Bit_Chain * dat, Dwg_Struct * dwg, Bit_Chain * sec_dat, uint32_t section_type)
+{
+  unsigned i;
+  char *decomp;
+  int32_t max_decomp_size;
+  Dwg_Section_Info *info;
+
+  info = find_section_info (dwg, section_type);
   if (info == 0)
     {
       return 1;
     }
 
-
   max_decomp_size = info->num_sections * info->max_decomp_size;
 
   decomp = (char *) malloc (max_decomp_size * sizeof (char));
@@ -722,42 +845,123 @@ dec_r2004_compressed_section (Bit_Chain * dat, Bit_Chain * sec_dat, uint32_t sec
     return 2;			// No memory
 
   for (i = 0; i < info->num_sections; ++i)
-    {
-      address = info->sections[i]->address;
-      dat->byte = address;
+    dec_r2004_page (dat, info, i, &decomp[i * info->max_decomp_size]);
 
-      for (j = 0; j < 0x20; j++)
-	es.char_data[j] = bit_read_RC (dat);
+  sec_dat->bit = 0;
+  sec_dat->byte = 0;
+  sec_dat->chain = (unsigned char *) decomp;
+  sec_dat->size = max_decomp_size;
+  sec_dat->version = dat->version;
 
-      sec_mask = 0x4164536b ^ address;
+  return 0;
+}
 
-      for (j = 0; j < 8; ++j)
-	es.long_data[j] ^= sec_mask;
+/** Prepares the random access to a compressed section, through a cache of
+ * its decompressed pages (see dec_r2004_page_cache_read). Nothing is
+ * decompressed yet.
+ * Returns 0 if OK, 1 if there is no such section, 2 if out of memory.
+ */
+int
+dec_r2004_page_cache_init (Dwg_Page_Cache * cache, Bit_Chain * dat, Dwg_Struct * dwg, uint32_t section_type)
+{
+  uint32_t i;
 
-      if (log_level_get () >= LOG_LEVEL_COMPRESS)
+  memset (cache, 0, sizeof (Dwg_Page_Cache));
+  cache->info = find_section_info (dwg, section_type);
+  if (cache->info == NULL || cache->info->max_decomp_size == 0)
+    return (1);
+
+  cache->dat = dat;
+  cache->size = cache->info->num_sections * cache->info->max_decomp_size;
+  cache->num_slots = PAGE_CACHE_SLOTS;
+  if (cache->num_slots > cache->info->num_sections)
+    cache->num_slots = cache->info->num_sections;
+  if (cache->num_slots == 0)
+    return (0);
+
+  cache->slot = (Dwg_Page_Slot *) calloc (cache->num_slots, sizeof (Dwg_Page_Slot));
+  if (cache->slot == NULL)
+    return (2);
+  for (i = 0; i < cache->num_slots; i++)
+    {
+      cache->slot[i].page = (uint32_t) -1;
+      cache->slot[i].data = (char *) malloc (cache->info->max_decomp_size);
+      if (cache->slot[i].data == NULL)
 	{
-	  fprintf (stderr, "\n=== Compressed Section ===\n");
-	  fprintf (stderr, "Section Tag (should be 0x41630?3b): %x \n", (unsigned int) es.fields.tag);
-	  fprintf (stderr, "Section Type: %x \n", (unsigned int) es.fields.section_type);
-	  // this is the number of bytes that is read in decompress_r2004_section (+ 2bytes)
-	  fprintf (stderr, "Data size: %x\n", (unsigned int) es.fields.data_size);
-	  fprintf (stderr, "Comp. data size: %x\n", (unsigned int) es.fields.section_size);
-	  fprintf (stderr, "StartOffset: %x \n", (unsigned int) es.fields.start_offset);
-	  fprintf (stderr, "Unknown: %x \n", (unsigned int) es.fields.unknown);
-	  fprintf (stderr, "Checksum1: %x \n", (unsigned int) es.fields.checksum_1);
-	  fprintf (stderr, "Checksum2: %x \n\n", (unsigned int) es.fields.checksum_2);
+	  dec_r2004_page_cache_free (cache);
+	  return (2);
 	}
+    }
+  return (0);
+}
 
-      decompress_r2004_section (dat, &decomp[i * info->max_decomp_size], es.fields.data_size);
+/** Gets a decompressed page, decompressing it on the first touch, in place of
+ * the least recently used one.
+ */
+char *
+dec_r2004_page_cache_get (Dwg_Page_Cache * cache, uint32_t page)
+{
+  Dwg_Page_Slot *slot, *lru;
+  uint32_t i;
+
+  lru = slot = cache->slot;
+  for (i = 0; i < cache->num_slots; i++, slot++)
+    {
+      if (slot->page == page)
+	{
+	  slot->stamp = ++cache->clock;
+	  return (slot->data);
+	}
+      if (slot->stamp < lru->stamp)
+	lru = slot;
     }
 
-  sec_dat->bit = 0;
-  sec_dat->byte = 0;
-  sec_dat->chain = (unsigned char *) decomp;
-  sec_dat->size = max_decomp_size;
-  sec_dat->version = dat->version;
+  dec_r2004_page (cache->dat, cache->info, page, lru->data);
+  lru->page = page;
+  lru->stamp = ++cache->clock;
+  return (lru->data);
+}
 
-  return 0;
+/** Copies size bytes of the section from the given offset, across pages.
+ * Returns the number of bytes copied, less than size at the end of the
+ * section.
+ */
+uint32_t
+dec_r2004_page_cache_read (Dwg_Page_Cache * cache, uint32_t offset, char *dest, uint32_t size)
+{
+  uint32_t page, start, n, copied;
+
+  if (offset >= cache->size)
+    return (0);
+  if (size > cache->size - offset)
+    size = cache->size - offset;
+
+  copied = 0;
+  while (copied < size)
+    {
+      page = (offset + copied) / cache->info->max_decomp_size;
+      start = (offset + copied) % cache->info->max_decomp_size;
+      n = cache->info->max_decomp_size - start;
+      if (n > size - copied)
+	n = size - copied;
+      memcpy (dest + copied, dec_r2004_page_cache_get (cache, page) + start, n);
+      copied += n;
+    }
+  return (copied);
+}
+
+void
+dec_r2004_page_cache_free (Dwg_Page_Cache * cache)
+{
+  uint32_t i;
+
+  for (i = 0; cache->slot && i < cache->num_slots; i++)
+    if (cache->slot[i].data)
+      free (cache->slot[i].data);
+  if (cache->slot)
+    free (cache->slot);
+  cache->slot = NULL;
+  cache->num_slots = 0;
 }
 
 /** R2004 Literal Length */
@@ -910,17 +1114,25 @@ decompress_r2004_section (Bit_Chain * dat, char *decomp, uint32_t comp_data_size
   return 0;			// Success
 }
 
+/** Finds the page of a given number, in the page table of the Section Map
+ * when it has one */
 Dwg_Section *
-find_section (uint32_t index)
+find_section (Dwg_Struct * dwg, uint32_t index)
 {
-  int i;
+  uint32_t i;
 
-  if (header.section == NULL || index == 0)
+  if (dwg->header.section == NULL || index == 0)
     return NULL;
-  for (i = 0; i < header.num_sections; ++i)
+  if (dwg->header.section_page)
+    {
+      if (index < dwg->header.num_section_pages)
+	return (dwg->header.section_page[index]);
+      return NULL;
+    }
+  for (i = 0; i < dwg->header.num_sections; ++i)
     {
-      if ((unsigned) header.section[i].number == index)
-	return (&header.section[i]);
+      if ((unsigned) dwg->header.section[i].number == index)
+	return (&dwg->header.section[i]);
     }
   return NULL;
 }
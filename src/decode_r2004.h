@@ -29,11 +29,42 @@
 
 #include "dwg.h"
 
+#define PAGE_CACHE_SLOTS 16
+
+/**
+ *    \struct  _dwg_page_slot
+ *    \brief   Decompressed page held by a page cache
+ */
+typedef struct _dwg_page_slot
+{
+  uint32_t page;
+  uint32_t stamp;
+  char *data;
+} Dwg_Page_Slot;
+
+/**
+ *    \struct  _dwg_page_cache
+ *    \brief   Random access to a compressed section, decompressing its pages
+ *             on demand, with at most PAGE_CACHE_SLOTS of them kept (the least
+ *             recently used is dropped first)
+ */
+typedef struct _dwg_page_cache
+{
+  Bit_Chain *dat;
+  Dwg_Section_Info *info;
+  uint32_t size;
+  uint32_t num_slots;
+  Dwg_Page_Slot *slot;
+  uint32_t clock;
+} Dwg_Page_Cache;
+
 int decode_r2004 (Bit_Chain * dat, Dwg_Struct * dwg);
 
-void dec_r2004_section_map (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp_data_size);
+int decode_r2004_header (Bit_Chain * dat, Dwg_Struct * dwg);
 
-void dec_r2004_section_info (Bit_Chain * dat, uint32_t comp_data_size, uint32_t decomp_data_size);
+void dec_r2004_section_map (Bit_Chain * dat, Dwg_Struct * dwg, uint32_t comp_data_size, uint32_t decomp_data_size);
+
+void dec_r2004_section_info (Bit_Chain * dat, Dwg_Struct * dwg, uint32_t comp_data_size, uint32_t decomp_data_size);
 
 void dec_r2004_section_variables (Bit_Chain * dat, Dwg_Struct * dwg);
 
@@ -41,7 +72,17 @@ void dec_r2004_section_classes (Bit_Chain * dat, Dwg_Struct * dwg);
 
 void dec_r2004_section_handles (Bit_Chain * dat, Dwg_Struct * dwg);
 
-int dec_r2004_compressed_section (Bit_Chain * dat, Bit_Chain * sec_dat, uint32_t section_type);
+void dec_r2004_page (Bit_Chain * dat, Dwg_Section_Info * info, uint32_t page, char *decomp);
+
+int dec_r2004_compressed_section (Bit_Chain * dat, Dwg_Struct * dwg, Bit_Chain * sec_dat, uint32_t section_type);
+
+int dec_r2004_page_cache_init (Dwg_Page_Cache * cache, Bit_Chain * dat, Dwg_Struct * dwg, uint32_t section_type);
+
+char *dec_r2004_page_cache_get (Dwg_Page_Cache * cache, uint32_t page);
+
+uint32_t dec_r2004_page_cache_read (Dwg_Page_Cache * cache, uint32_t offset, char *dest, uint32_t size);
+
+void dec_r2004_page_cache_free (Dwg_Page_Cache * cache);
 
 int read_literal_length (Bit_Chain * dat, unsigned char *opcode);
 
@@ -51,7 +92,7 @@ int read_two_byte_offset (Bit_Chain * dat, int *lit_length);
 
 int decompress_r2004_section (Bit_Chain * dat, char *decomp, uint32_t comp_data_size);
 
-Dwg_Section *find_section (uint32_t index);
+Dwg_Section *find_section (Dwg_Struct * dwg, uint32_t index);
 
 int32_t page_checksum (int32_t seed, unsigned char *data, int32_t size);
 
@@ -26,6 +26,9 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <mcheck.h>
 #include "config.h"
@@ -49,10 +52,22 @@ char version_codes[9][7] = {
   "------"
 };
 
+/* View records are allocated by blocks, which never move (see
+ * dwg_string_view_new)
+ */
+#define STRING_BLOCK_SIZE 4096
+
+typedef struct _dwg_string_block
+{
+  struct _dwg_string_block *next;
+  uint32_t used;
+  Dwg_String_View view[STRING_BLOCK_SIZE];
+} Dwg_String_Block;
+
 /* Forward functions
  */
 FILE * dwg_load_file (char *filename, Bit_Chain * dat);
-void dwg_handle_close (void);
+void dwg_handle_close (Dwg_Struct * dwg);
 
 /** Reads a dwg file and decodes its data, filling the dwg_data structure
  * with the information available for classes, variables and objects.
@@ -60,30 +75,192 @@ void dwg_handle_close (void);
  */
 int
 dwg_read_file (char *filename, Dwg_Struct * dwg_data)
+{
+  memset (dwg_data, 0, sizeof (Dwg_Struct));
+  return (dwg_read_file_reuse (filename, dwg_data));
+}
+
+/** The same as dwg_read_file, but the object slots and the handle index
+ * already reserved in dwg_data are reused, instead of allocated again.
+ * The dwg_data structure must be zeroed, or cleared by dwg_reset, before.
+ * Useful for decoding many files in a row with the same structure.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_read_file_reuse (char *filename, Dwg_Struct * dwg_data)
 {
   Bit_Chain bit_chain;
+  struct stat attrib;
 
   if (dwg_load_file (filename, &bit_chain))
     return (-1);
 
+  /* Source file identity (see dwg_snapshot_check). Its CRC would be a
+   * whole extra pass over the data, left to dwg_snapshot_write
+   */
+  dwg_data->header.file_size = bit_chain.size;
+  dwg_data->header.file_crc = 0;
+  dwg_data->header.file_mtime = 0;
+  if (!stat (filename, &attrib))
+    dwg_data->header.file_mtime = attrib.st_mtime;
+
+  /* String views point into the file data, which is then kept until
+   * dwg_reset
+   */
+  if (dwg_data->header.string_views)
+    dwg_data->header.view_chain[0] = bit_chain.chain;
+
   /* Decode the dwg structure
    */
   if (dwg_decode_data (&bit_chain, dwg_data))
     {
       LOG_ERROR ("Failed to decode DWG data.\n");
-      free (bit_chain.chain);
+      if (!dwg_data->header.string_views)
+        free (bit_chain.chain);
       bit_chain.chain = NULL;
       return (-1);
     }
-  free (bit_chain.chain);
+  if (!dwg_data->header.string_views)
+    free (bit_chain.chain);
 
   /* Step II of objects parsing: handle index
    */
   dwg_handle_init (dwg_data);
 
+  /* Type and layer indexes
+   */
+  dwg_index_init (dwg_data);
+
+  dwg_data->header.file_name = strdup (filename);
   return (0);
 }
 
+/** The same as dwg_read_file, but the text strings of the objects are not
+ * decoded: each one is a view into the file data (see dwg_string_view), and
+ * dwg_string_decode gives the text on demand. The file data stays in memory
+ * until dwg_free. Header variables and class names are still plain strings.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_read_file_views (char *filename, Dwg_Struct * dwg_data)
+{
+  memset (dwg_data, 0, sizeof (Dwg_Struct));
+  dwg_data->header.string_views = 1;
+  return (dwg_read_file_reuse (filename, dwg_data));
+}
+
+/** The same as dwg_read_file, but the text strings of the objects and the
+ * class names are interned in pool (see dwg_string_intern), so that each
+ * distinct string is stored once, and compared by pointer. The pool may be
+ * shared by the drawings of a batch, read in turn, and must then outlive
+ * them; with a NULL pool, the drawing gets its own, freed by dwg_free.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_read_file_interned (char *filename, Dwg_Struct * dwg_data, Dwg_String_Pool * pool)
+{
+  memset (dwg_data, 0, sizeof (Dwg_Struct));
+  if (pool == NULL)
+    {
+      pool = dwg_string_pool_new ();
+      if (pool == NULL)
+        return (-1);
+      dwg_data->header.string_pool_owned = 1;
+    }
+  dwg_data->header.string_pool = pool;
+  return (dwg_read_file_reuse (filename, dwg_data));
+}
+
+/** Allocates the record of one string view of a dwg structure. Records live
+ * until dwg_reset or dwg_free. Returns NULL if there is not enough memory.
+ */
+Dwg_String_View *
+dwg_string_view_new (Dwg_Struct * dwg)
+{
+  Dwg_String_Block *block;
+
+  block = dwg->header.string_block;
+  if (block == NULL || block->used == STRING_BLOCK_SIZE)
+    {
+      block = (Dwg_String_Block *) malloc (sizeof (Dwg_String_Block));
+      if (block == NULL)
+        {
+          LOG_ERROR ("Not enough memory for the string views.\n");
+          return (NULL);
+        }
+      block->next = dwg->header.string_block;
+      block->used = 0;
+      dwg->header.string_block = block;
+    }
+  return (&block->view[block->used++]);
+}
+
+/** Gets the view behind a text string field of an object, if the dwg
+ * structure was read by dwg_read_file_views (NULL otherwise).
+ */
+const Dwg_String_View *
+dwg_string_view (Dwg_Struct * dwg, BITCODE_TV str)
+{
+  if (dwg == NULL || str == NULL || !dwg->header.string_views)
+    return (NULL);
+  return ((const Dwg_String_View *) str);
+}
+
+/** Gets a copy of a text string field of an object, decoded the same way
+ * whether it is a view or a plain string. After usage, the allocated memory
+ * must be properly freed.
+ */
+uint8_t *
+dwg_string_decode (Dwg_Struct * dwg, BITCODE_TV str)
+{
+  const Dwg_String_View *view;
+  Bit_Chain dat;
+  uint8_t *copy;
+
+  if (str == NULL)
+    return (NULL);
+
+  view = dwg_string_view (dwg, str);
+  if (view == NULL)
+    {
+      copy = (uint8_t *) malloc (strlen ((char *) str) + 1);
+      if (copy)
+        strcpy ((char *) copy, (char *) str);
+      return (copy);
+    }
+
+  /* The last character may end in the next byte
+   */
+  dat.chain = (uint8_t *) view->chain;
+  dat.size = view->length + 1;
+  dat.byte = 0;
+  dat.bit = view->bit;
+  dat.version = dwg->header.version;
+  return (bit_decode_TV (&dat, view->length));
+}
+
+/** Frees the string views of a dwg structure, with the data they point to.
+ */
+static void
+dwg_string_views_free (Dwg_Struct * dwg)
+{
+  Dwg_String_Block *block;
+  int i;
+
+  while (dwg->header.string_block)
+    {
+      block = dwg->header.string_block;
+      dwg->header.string_block = block->next;
+      free (block);
+    }
+  for (i = 0; i < 2; i++)
+    {
+      if (dwg->header.view_chain[i])
+        free (dwg->header.view_chain[i]);
+      dwg->header.view_chain[i] = NULL;
+    }
+}
+
 /** Gets the preview bitmap image of a dwg file. The raw bitmap data is
  * put in a bit-chain, whose dat.byte locator is set to the start of this
  * data. Returns a fail status (0 == OK; -1 == FAIL).
@@ -169,44 +346,179 @@ dwg_read_file_preview (char *filename, Bit_Chain * dat)
   }
 }
 
+/** Reads the header of a dwg file only: its version, codepage, header
+ * variables and classes, but nothing of the objects section. The file is
+ * mapped rather than loaded, and only the pages of the sections the header
+ * decoders jump to are read, so that probing many large drawings is bound
+ * by the disk seeks. The probe is freed with dwg_probe_free.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_probe (char *filename, Dwg_Probe * probe)
+{
+  Dwg_Struct dwg;
+  Bit_Chain dat;
+  struct stat attrib;
+  void *addr;
+  int fd, error;
+  char tmp[1024];
+
+#ifdef ENABLE_TRACE
+  log_level_init ();
+#endif
+
+  memset (probe, 0, sizeof (Dwg_Probe));
+  fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    {
+      snprintf (tmp, 1024, "Could not open file: %s\n", filename);
+      LOG_ERROR (tmp);
+      return (-1);
+    }
+  if (fstat (fd, &attrib) || !S_ISREG (attrib.st_mode) || attrib.st_size < 0x100)
+    {
+      snprintf (tmp, 1024, "Not a dwg file: %s\n", filename);
+      LOG_ERROR (tmp);
+      close (fd);
+      return (-1);
+    }
+  addr = mmap (NULL, attrib.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (addr == MAP_FAILED)
+    {
+      snprintf (tmp, 1024, "Could not map the file: %s\n", filename);
+      LOG_ERROR (tmp);
+      return (-1);
+    }
+  /* A few scattered sections: read ahead would only fetch object data */
+  madvise (addr, attrib.st_size, MADV_RANDOM);
+
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  dat.chain = (uint8_t *) addr;
+  dat.size = attrib.st_size;
+  dat.byte = 0;
+  dat.bit = 0;
+  error = dwg_decode_header (&dat, &dwg);
+  munmap (addr, attrib.st_size);
+
+  probe->version = dwg.header.version;
+  probe->codepage = dwg.header.codepage;
+  probe->file_size = attrib.st_size;
+  probe->variable = dwg.variable;
+  probe->num_classes = dwg.num_classes;
+  probe->dwg_class = dwg.dwg_class;
+  if (error)
+    {
+      dwg_probe_free (probe);
+      return (-1);
+    }
+  return (0);
+}
+
+/** Frees the variables and classes of a probe (see dwg_probe).
+ */
+void
+dwg_probe_free (Dwg_Probe * probe)
+{
+  Dwg_Struct dwg;
+
+  if (probe == NULL)
+    return;
+  memset (&dwg, 0, sizeof (Dwg_Struct));
+  dwg.header.version = probe->version;
+  dwg.variable = probe->variable;
+  dwg.num_classes = probe->num_classes;
+  dwg.dwg_class = probe->dwg_class;
+  dwg_reset (&dwg);
+  memset (probe, 0, sizeof (Dwg_Probe));
+}
+
 /** 
  * Frees the internal strings allocated for each item inside all objects present
  * in a dwg structure. The dwg structure itself is left intact, the user is 
  * supposed to free it (dynamically allocated) or not (statically declared).
  * Side effects: dwg.num_classes and dwg.num_objects are set to 0.
+ * For a structure returned by dwg_snapshot_open, the snapshot is closed and
+ * the structure itself is no longer valid after the call.
  */
 void
 dwg_free (Dwg_Struct * dwg)
 {
-  uint32_t i;
-
   if (dwg == NULL)
     return;
 
-  /* Objects (order matters here)
+  /* Nothing was allocated for a snapshot: the whole structure is mapped
    */
-  for (i = 0; i < dwg->num_objects; i++)
+  if (dwg->snapshot)
     {
-      if (&dwg->object[i])
-        dwg_object_free (&dwg->object[i]);
+      dwg_snapshot_close (dwg);
+      return;
     }
+
+  /* Objects, variables and classes (order matters here)
+   */
+  dwg_reset (dwg);
+
   if (dwg->object)
     free (dwg->object);
   dwg->object = NULL;
-  dwg->num_objects = 0;
-  dwg_objects_reset ();
+  dwg->res_objects = 0;
+  dwg_eed_free (dwg);
+  dwg_sat_free (dwg);
 
   /* Internal object handle map
    */
-  dwg_handle_close ();
+  dwg_handle_close (dwg);
 
-  /* Variables
+  /* String pool, unless shared with other drawings
+   */
+  if (dwg->header.string_pool_owned)
+    dwg_string_pool_free (dwg->header.string_pool);
+  dwg->header.string_pool = NULL;
+  dwg->header.string_pool_owned = 0;
+}
+
+/** 
+ * Frees the decoded data of a dwg structure, like dwg_free, but keeps the
+ * object slots and the handle index reserved, so that the next call of
+ * dwg_read_file_reuse with this structure does not need to allocate them.
+ * The string pool, if any, is kept too, and the next drawing is interned in
+ * it. A dwg_free is still needed at the end.
+ */
+void
+dwg_reset (Dwg_Struct * dwg)
+{
+  Dwg_String_Pool *string_pool;
+  int string_views, string_pool_owned;
+  uint32_t i;
+
+  if (dwg == NULL || dwg->snapshot)
+    return;
+
+  /* Spatial, type and layer indexes, and extents
+   */
+  dwg_spatial_free (dwg);
+  dwg_extents_free (dwg);
+  dwg_index_free (dwg);
+
+  /* Objects (order matters here)
+   */
+  dwg_objects_reset (dwg);
+  dwg->num_handles = 0;
+  dwg->num_eed = 0;
+  dwg->eed_size = 0;
+  dwg->sat_size = 0;
+  dwg_string_views_free (dwg);
+
+  /* Variables: the scalars too, as a drawing of another version does not
+   * read them all
    */
   dwg_variables_free (dwg);
+  memset (&dwg->variable, 0, sizeof (Dwg_Variables));
 
-  /* Classes
+  /* Classes (interned names belong to the string pool)
    */
-  for (i = 0; i < dwg->num_classes; i++)
+  for (i = 0; i < dwg->num_classes && !dwg->header.string_pool; i++)
     {
       if (dwg->dwg_class[i].appname)
         free (dwg->dwg_class[i].appname);
@@ -219,6 +531,19 @@ dwg_free (Dwg_Struct * dwg)
     free (dwg->dwg_class);
   dwg->dwg_class = NULL;
   dwg->num_classes = 0;
+
+  /* Decoded header, but for the settings of the string views and the pool
+   */
+  decode_header_free (dwg);
+  if (dwg->header.file_name)
+    free (dwg->header.file_name);
+  string_views = dwg->header.string_views;
+  string_pool = dwg->header.string_pool;
+  string_pool_owned = dwg->header.string_pool_owned;
+  memset (&dwg->header, 0, sizeof (dwg->header));
+  dwg->header.string_views = string_views;
+  dwg->header.string_pool = string_pool;
+  dwg->header.string_pool_owned = string_pool_owned;
 }
 
 /** 
@@ -245,22 +570,14 @@ dwg_version_code (Dwg_Struct * dwg)
 /******************
  * Handle functions
  */
-typedef struct _handle_map
-{
-  uint32_t hd;
-  uint32_t ix;
-} Handle_Map;
-
-static uint32_t hmap_size = 0;
-static Handle_Map *hmap = NULL;
-static Dwg_Struct *hmap_dwg = NULL;
-
 void
-dwg_handle_close ()
+dwg_handle_close (Dwg_Struct * dwg)
 {
-  if (hmap_size > 0)
-    free (hmap);
-  hmap_size = 0;
+  if (dwg->res_handles > 0)
+    free (dwg->handle_map);
+  dwg->handle_map = NULL;
+  dwg->res_handles = 0;
+  dwg->num_handles = 0;
 }
 
 /** 
@@ -273,32 +590,27 @@ dwg_handle_init (Dwg_Struct * dwg)
   int j, y;
   double factor;
   char space[101];
+  Dwg_Handle_Map *hmap;
   space[100] = '\0';
 
   if (dwg == NULL)
-    {
-      hmap_dwg = NULL;
-      return;
-    }
+    return;
 
+  dwg->num_handles = 0;
   if (dwg->num_objects == 0)
-    {
-      hmap_dwg = NULL;
-      return;
-    }
-
-  hmap_dwg = dwg;
+    return;
 
-  if (hmap_size == 0)
+  if (dwg->res_handles == 0)
     {
-      hmap_size = dwg->num_objects;
-      hmap = (Handle_Map *) malloc (hmap_size * sizeof (Handle_Map));
+      dwg->res_handles = dwg->num_objects;
+      dwg->handle_map = (Dwg_Handle_Map *) malloc (dwg->res_handles * sizeof (Dwg_Handle_Map));
     }
-  else if (hmap_size < dwg->num_objects)
+  else if (dwg->res_handles < dwg->num_objects)
     {
-      hmap_size = dwg->num_objects;
-      hmap = (Handle_Map *) realloc (hmap, hmap_size * sizeof (Handle_Map));
+      dwg->res_handles = dwg->num_objects;
+      dwg->handle_map = (Dwg_Handle_Map *) realloc (dwg->handle_map, dwg->res_handles * sizeof (Dwg_Handle_Map));
     }
+  hmap = dwg->handle_map;
 
   LOG_PLOT ("\nCollected handles:\n");
   LOG_PLOT
@@ -348,7 +660,7 @@ dwg_handle_init (Dwg_Struct * dwg)
       if (hdtmp >= hmap[b].hd)
 	b++;
 
-      memmove (&hmap[b + 1], &hmap[b], (i - b) * sizeof (Handle_Map));
+      memmove (&hmap[b + 1], &hmap[b], (i - b) * sizeof (Dwg_Handle_Map));
       hmap[b].hd = hdtmp;
       hmap[b].ix = ixtmp;
     }
@@ -395,21 +707,24 @@ dwg_handle_init (Dwg_Struct * dwg)
     }
   LOG_PLOT
     ("-------------------------------------------------------------------------------------------------------\n");
+
+  dwg->num_handles = dwg->num_objects;
 }
 
 /** 
  * Finds the index of an object given it's id (handle)
  */
 uint32_t
-dwg_handle_get_index (uint32_t hdl)
+dwg_handle_get_index (Dwg_Struct * dwg, uint32_t hdl)
 {
   uint32_t a, b, mid;
   char tmp[1024];
+  Dwg_Handle_Map *hmap;
 
   if (hdl == 0)
     return -1;
 
-  if (hmap_dwg == NULL)
+  if (dwg->num_handles == 0)
     {
       snprintf (tmp, 1024, "dwg_handle_get_index(0x%X): "
 			   "please initialize the handle mapper (dwg_handle_init)\n"
@@ -420,8 +735,9 @@ dwg_handle_get_index (uint32_t hdl)
 
   /* Binary searching
    */
+  hmap = dwg->handle_map;
   a = 0;
-  b = hmap_dwg->num_objects - 1;
+  b = dwg->num_handles - 1;
   while (b > a + 1)
     {
       mid = (b - a) / 2 + a;
@@ -442,6 +758,176 @@ dwg_handle_get_index (uint32_t hdl)
   return (-1);
 }
 
+/******************
+ * Type and layer indexes
+ */
+
+/** Frees the type and layer indexes of a dwg structure (those of a
+ * snapshot are part of its image, and stay)
+ */
+void
+dwg_index_free (Dwg_Struct * dwg)
+{
+  if (dwg == NULL || dwg->snapshot)
+    return;
+  if (dwg->type_start)
+    free (dwg->type_start);
+  if (dwg->type_index)
+    free (dwg->type_index);
+  if (dwg->layer_start)
+    free (dwg->layer_start);
+  if (dwg->layer_index)
+    free (dwg->layer_index);
+  dwg->type_start = NULL;
+  dwg->type_index = NULL;
+  dwg->layer_start = NULL;
+  dwg->layer_index = NULL;
+  dwg->num_types = 0;
+}
+
+/** Returns the object index of the layer of an entity, or num_objects if
+ * it is not found.
+ */
+static uint32_t
+dwg_entity_layer_index (Dwg_Struct * dwg, Dwg_Object * obj)
+{
+  uint32_t idx;
+
+  idx = dwg_handle_get_index (dwg, obj->as.entity.layer.value);
+  if (idx >= dwg->num_objects || dwg->object[idx].type != DWG_TYPE_LAYER)
+    return (dwg->num_objects);
+  return (idx);
+}
+
+/** 
+ * Builds the indexes of the objects by type and of the entities by layer,
+ * sorting them in two passes of counting (the index order is kept inside
+ * each group). Needs the handle index (see dwg_handle_init). The indexes
+ * of a snapshot come with it, and are not built again.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_index_init (Dwg_Struct * dwg)
+{
+  uint32_t i, t, count;
+  uint32_t *layer_of;
+  char tmp[1024];
+
+  if (dwg == NULL)
+    return (-1);
+  if (dwg->snapshot)
+    {
+      if (dwg->type_start)
+        return (0);
+      LOG_ERROR ("Can't build the indexes of a snapshot.\n");
+      return (-1);
+    }
+  dwg_index_free (dwg);
+
+  /* Fixed types go below 500, variable ones follow their class
+   */
+  dwg->num_types = 500 + dwg->num_classes;
+  dwg->type_start = (uint32_t *) calloc (dwg->num_types + 1, sizeof (uint32_t));
+  dwg->type_index = (uint32_t *) malloc ((dwg->num_objects + 1) * sizeof (uint32_t));
+  dwg->layer_start = (uint32_t *) calloc (dwg->num_objects + 1, sizeof (uint32_t));
+  layer_of = (uint32_t *) malloc ((dwg->num_objects + 1) * sizeof (uint32_t));
+  if (!dwg->type_start || !dwg->type_index || !dwg->layer_start || !layer_of)
+    {
+      LOG_ERROR ("Not enough memory for the type and layer indexes.\n");
+      if (layer_of)
+        free (layer_of);
+      dwg_index_free (dwg);
+      return (-1);
+    }
+
+  /* Group sizes
+   */
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      t = dwg->object[i].type;
+      if (t < dwg->num_types)
+        dwg->type_start[t + 1]++;
+      if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+        {
+          layer_of[i] = dwg_entity_layer_index (dwg, &dwg->object[i]);
+          if (layer_of[i] < dwg->num_objects)
+            dwg->layer_start[layer_of[i] + 1]++;
+        }
+    }
+
+  /* Group starts, then the indexes themselves
+   */
+  for (t = 0; t < dwg->num_types; t++)
+    dwg->type_start[t + 1] += dwg->type_start[t];
+  for (i = 0; i < dwg->num_objects; i++)
+    dwg->layer_start[i + 1] += dwg->layer_start[i];
+  count = dwg->layer_start[dwg->num_objects];
+  dwg->layer_index = (uint32_t *) malloc ((count + 1) * sizeof (uint32_t));
+  if (!dwg->layer_index)
+    {
+      LOG_ERROR ("Not enough memory for the type and layer indexes.\n");
+      free (layer_of);
+      dwg_index_free (dwg);
+      return (-1);
+    }
+
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      t = dwg->object[i].type;
+      if (t < dwg->num_types)
+        dwg->type_index[dwg->type_start[t]++] = i;
+      if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY && layer_of[i] < dwg->num_objects)
+        dwg->layer_index[dwg->layer_start[layer_of[i]]++] = i;
+    }
+  free (layer_of);
+
+  /* The filling moved each start to the next group: shift them back
+   */
+  for (t = dwg->num_types; t > 0; t--)
+    dwg->type_start[t] = dwg->type_start[t - 1];
+  dwg->type_start[0] = 0;
+  for (i = dwg->num_objects; i > 0; i--)
+    dwg->layer_start[i] = dwg->layer_start[i - 1];
+  dwg->layer_start[0] = 0;
+
+  snprintf (tmp, 1024, "Indexed %lu objects by type and %lu entities by layer\n",
+            (unsigned long) dwg->type_start[dwg->num_types], (unsigned long) count);
+  LOG_INFO (tmp);
+  return (0);
+}
+
+/** 
+ * Gets the objects of a given type (one of DWG_TYPE_*, or 500 + the class
+ * index for variable types), in index order. Despite the name, this works
+ * for non graphical objects too. *indexes is set to the first of the
+ * returned number of object indexes, which stay valid until dwg_reset or
+ * dwg_free.
+ */
+uint32_t
+dwg_entities_by_type (Dwg_Struct * dwg, uint32_t type, uint32_t ** indexes)
+{
+  *indexes = NULL;
+  if (dwg == NULL || dwg->type_start == NULL || type >= dwg->num_types)
+    return (0);
+  *indexes = &dwg->type_index[dwg->type_start[type]];
+  return (dwg->type_start[type + 1] - dwg->type_start[type]);
+}
+
+/** 
+ * Gets the entities on a layer, given the object index of the LAYER, in
+ * index order. *indexes is set to the first of the returned number of
+ * entity indexes, which stay valid until dwg_reset or dwg_free.
+ */
+uint32_t
+dwg_entities_on_layer (Dwg_Struct * dwg, uint32_t layer, uint32_t ** indexes)
+{
+  *indexes = NULL;
+  if (dwg == NULL || dwg->layer_start == NULL || layer >= dwg->num_objects)
+    return (0);
+  *indexes = &dwg->layer_index[dwg->layer_start[layer]];
+  return (dwg->layer_start[layer + 1] - dwg->layer_start[layer]);
+}
+
 /** 
  * Finds the absolute id of a handle from a referenced one.
  */
@@ -464,7 +950,7 @@ dwg_handle_absolute (Dwg_Handle *hd, uint32_t refhd)
   return 0;
 }
 
-extern Error_Fifo err;
+extern LOG_THREAD Error_Fifo dwg_error_fifo;
 /** 
  * Returns an error output by the library operations from a fifo, if any.
  * If none, returns a NULL.
@@ -472,23 +958,23 @@ extern Error_Fifo err;
 char *
 dwg_error_pop ()
 {
-	static char msg[1024];
+	static LOG_THREAD char msg[1024];
 
-	if (err.first != err.last)
+	if (dwg_error_fifo.first != dwg_error_fifo.last)
 	{
-		strcpy (msg, err.msg[err.first]);
-		if (++err.first >= ERR_FIFO_LEVELS)
-			err.first = 0;
+		strcpy (msg, dwg_error_fifo.msg[dwg_error_fifo.first]);
+		if (++dwg_error_fifo.first >= ERR_FIFO_LEVELS)
+			dwg_error_fifo.first = 0;
 		return (msg);
 	}
 
-	if (err.msg[err.first][0] == '\0')
+	if (dwg_error_fifo.msg[dwg_error_fifo.first][0] == '\0')
 	{
 		return (NULL);
 	}
 
-	strcpy (msg, err.msg[err.first]);
-	err.msg[err.first][0] = '\0';
+	strcpy (msg, dwg_error_fifo.msg[dwg_error_fifo.first]);
+	dwg_error_fifo.msg[dwg_error_fifo.first][0] = '\0';
 	return (msg);
 }
 
@@ -241,6 +241,34 @@ typedef enum DWG_OBJECT_TYPE
   DWG_TYPE_LAYOUT = 0x52
 } Dwg_Object_Type;
 
+/**
+ *    \enum    DWG_CLASS_TYPE
+ *    \brief   Known variable object types, by class (see Dwg_Class.vartype)
+ */
+typedef enum DWG_CLASS_TYPE
+{
+  DWG_CLASS_UNKNOWN = 0,
+  DWG_CLASS_DICTIONARYVAR,
+  DWG_CLASS_DICTIONARYWDLFT,
+  DWG_CLASS_HATCH,
+  DWG_CLASS_IDBUFFER,
+  DWG_CLASS_IMAGE,
+  DWG_CLASS_IMAGEDEF,
+  DWG_CLASS_IMAGEDEFREACTOR,
+  DWG_CLASS_LAYER_INDEX,
+  DWG_CLASS_LAYOUT,
+  DWG_CLASS_LWPLINE,
+  DWG_CLASS_OLE2FRAME,
+  DWG_CLASS_PLACEHOLDER,
+  DWG_CLASS_RASTERVARIABLES,
+  DWG_CLASS_SORTENTSTABLE,
+  DWG_CLASS_SPATIAL_FILTER,
+  DWG_CLASS_SPATIAL_INDEX,
+  DWG_CLASS_XRECORD,
+  DWG_CLASS_WIPEOUT,
+  DWG_CLASS_WIPEOUTVARIABLES
+} Dwg_Class_Type;
+
 /**
  *    \struct  _dwg_handle
  *    \brief   Struct for handles
@@ -250,6 +278,10 @@ typedef struct _dwg_handle
   uint8_t code;
   uint8_t size;
   uint32_t value;
+
+  /* Index of the object referred to, once resolved (see dwg_handle_resolve)
+   */
+  uint32_t index;
 } Dwg_Handle;
 
 /**
@@ -1262,8 +1294,8 @@ typedef struct _dwg_entity_3DSOLID
   BITCODE_B acis_empty;
   BITCODE_B unknown;
   BITCODE_BS version;
-  BITCODE_BL* block_size;
-  BITCODE_RC** sat_data;
+  uint32_t sat_offset; /* of the SAT data (version 1) in dwg->sat_data */
+  uint32_t sat_size; /* in bytes, of all the blocks (see dwg_solid_sat) */
   BITCODE_RC* acis_data;
   BITCODE_B wireframe_data_present;
   BITCODE_B point_present;
@@ -1279,7 +1311,6 @@ typedef struct _dwg_entity_3DSOLID
   BITCODE_BL unknown_2007;
   BITCODE_H history_id;
   BITCODE_B ACIS_empty_bit;
-  uint8_t* raw_sat_data;
 } Dwg_Entity_3DSOLID;
 
 /** Struct for REGION (37) */
@@ -2626,8 +2657,54 @@ typedef struct _dwg_class
   uint8_t *dxfname;
   uint8_t wasazombie;
   uint16_t item_class_id;
+
+  /* Known type of the objects of this class, from dxfname */
+  Dwg_Class_Type vartype;
 } Dwg_Class;
 
+/**
+ *    \struct  _dwg_section
+ *    \brief   Struct for DWG section
+ */
+typedef struct _dwg_section
+{
+  int32_t number;
+  uint32_t address;
+  uint32_t size;
+  uint32_t parent;
+  uint32_t left;
+  uint32_t right;
+  uint32_t x00;
+} Dwg_Section;
+
+/**
+ *    \struct  _dwg_section_info
+ *    \brief   Struct for R2004 section descriptions
+ */
+typedef struct _dwg_section_info
+{ 
+  uint32_t size;
+  uint32_t unknown1;	   
+  uint32_t num_sections;  
+  uint32_t max_decomp_size;  
+  uint32_t unknown2;	   
+  uint32_t compressed;
+  uint32_t type;
+  uint32_t encrypted;
+  char name[64];
+  Dwg_Section **sections;
+} Dwg_Section_Info;
+
+/**
+ *    \struct  _dwg_handle_map
+ *    \brief   Entry of the handle index: object handle and its object index
+ */
+typedef struct _dwg_handle_map
+{
+  uint32_t hd;
+  uint32_t ix;
+} Dwg_Handle_Map;
+
 /**
  *    \struct  _dwg_object_entity
  *    \brief   Structure for common entity attributes
@@ -2774,6 +2851,50 @@ typedef struct _dwg_object_nongraph
   struct _dwg_object  * parent;
 } Dwg_Object_Nongraph;
 
+/**
+ *    \struct  _dwg_eed
+ *    \brief   Extended data of one application on an object: a slice of
+ *             dwg->eed_data, kept as read and parsed on request (see
+ *             dwg_eed_next)
+ */
+typedef struct _dwg_eed
+{
+  BITCODE_H app; /* APPID object */
+  uint32_t offset; /* of the first byte in dwg->eed_data */
+  uint32_t size; /* in bytes */
+} Dwg_Eed;
+
+/**
+ *    \struct  _dwg_eed_value
+ *    \brief   One value of an extended data record (see dwg_eed_next),
+ *             with its DXF group code; strings and binary chunks point
+ *             into dwg->eed_data
+ */
+typedef struct _dwg_eed_value
+{
+  uint16_t code; /* 1000 to 1071 */
+  union
+  {
+    struct
+    {
+      uint16_t codepage;
+      uint16_t length;
+      uint8_t *chars; /* not null-terminated; UTF-16 from R2007 on */
+    } string; /* 1000 */
+    uint8_t brace; /* 1002: 0 == "{"; 1 == "}" */
+    uint64_t handle; /* 1003 (layer), 1005 */
+    struct
+    {
+      uint8_t length;
+      uint8_t *data;
+    } binary; /* 1004 */
+    BITCODE_3RD point; /* 1010 to 1013 */
+    double real; /* 1040 to 1042 */
+    int16_t short_int; /* 1070 */
+    int32_t long_int; /* 1071 */
+  } u;
+} Dwg_Eed_Value;
+
 /**
  *    \struct  _dwg_object
  *    \brief   General object struct
@@ -2794,12 +2915,251 @@ typedef struct _dwg_object
   BITCODE_H* reactors;
   BITCODE_B xdic_missing_flag;
   BITCODE_H xdicobjhandle;
+
+  /* Extended data: num_eed records from dwg->eed[eed_start] on */
+  uint32_t eed_start;
+  uint32_t num_eed;
  
   uint32_t index;
   struct _dwg_struct *parent;
 
 } Dwg_Object;
 
+/**
+ *    \struct  _dwg_bbox
+ *    \brief   Axis aligned bounding box, in world coordinates
+ */
+typedef struct _dwg_bbox
+{
+  BITCODE_3BD min;
+  BITCODE_3BD max;
+} Dwg_Bbox;
+
+/**
+ *    \struct  _dwg_extents
+ *    \brief   Bounding boxes of the entities by object index, one array per
+ *             coordinate (see dwg_compute_extents); objects without extents
+ *             get an empty box (min above max).
+ */
+typedef struct _dwg_extents
+{
+  uint32_t num_boxes;
+  double *min_x;
+  double *min_y;
+  double *min_z;
+  double *max_x;
+  double *max_y;
+  double *max_z;
+
+  /* Extents of the drawing: those of its model space entities */
+  Dwg_Bbox drawing;
+  uint32_t num_entities;
+} Dwg_Extents;
+
+/**
+ *    \struct  _dwg_string_view
+ *    \brief   Text string left in the source buffer, undecoded (see
+ *             dwg_read_file_views)
+ */
+typedef struct _dwg_string_view
+{
+  const uint8_t *chain;
+  uint16_t length;
+  uint8_t bit;
+} Dwg_String_View;
+
+/**
+ *    \struct  _dwg_string_pool
+ *    \brief   Table of interned strings, each stored once (see
+ *             dwg_read_file_interned)
+ */
+typedef struct _dwg_string_pool
+{
+  /* Open addressing hash table, of a power of 2 slots */
+  uint32_t size;
+  uint32_t num_strings;
+  uint8_t **slot;
+  uint32_t *hash;
+
+  /* Statistics: bytes of the distinct strings, and of all the strings
+   * interned, repeated or not */
+  uint64_t num_refs;
+  uint64_t bytes;
+  uint64_t bytes_refs;
+} Dwg_String_Pool;
+
+/**
+ *    \struct  _dwg_rtree_node
+ *    \brief   Node of the spatial index (see dwg_spatial_init). For entity
+ *             entries, count is 0 and first is the object index; otherwise
+ *             the children are the count nodes from index first.
+ */
+typedef struct _dwg_rtree_node
+{
+  Dwg_Bbox box;
+  uint32_t first;
+  uint32_t count;
+} Dwg_Rtree_Node;
+
+/**
+ *    \struct  _dwg_tess_buffer
+ *    \brief   Buffers given by the caller for tessellated curves (see
+ *             dwg_tessellate). Polyline i is made of the vertices from
+ *             start[i] up to the start of the next one, and comes from the
+ *             object of index object[i].
+ */
+typedef struct _dwg_tess_buffer
+{
+  double *vertex; /* x, y, z of each vertex, in world coordinates */
+  uint32_t max_vertices;
+  uint32_t num_vertices;
+  uint32_t *start;
+  uint32_t *object;
+  uint32_t max_polylines;
+  uint32_t num_polylines;
+} Dwg_Tess_Buffer;
+
+/**
+ *    \struct  _dwg_geometry_line
+ *    \brief   LINE entities, in world coordinates
+ */
+typedef struct _dwg_geometry_line
+{
+  uint32_t num;
+  uint32_t *object;
+  double *start_x;
+  double *start_y;
+  double *start_z;
+  double *end_x;
+  double *end_y;
+  double *end_z;
+} Dwg_Geometry_Line;
+
+/**
+ *    \struct  _dwg_geometry_arc
+ *    \brief   CIRCLE or ARC entities, in the object coordinate system of
+ *             their normal (circles from angle 0 to 2 pi)
+ */
+typedef struct _dwg_geometry_arc
+{
+  uint32_t num;
+  uint32_t *object;
+  double *center_x;
+  double *center_y;
+  double *center_z;
+  double *radius;
+  double *start_angle;
+  double *end_angle;
+  double *normal_x;
+  double *normal_y;
+  double *normal_z;
+} Dwg_Geometry_Arc;
+
+/**
+ *    \struct  _dwg_geometry_point
+ *    \brief   POINT entities, in world coordinates
+ */
+typedef struct _dwg_geometry_point
+{
+  uint32_t num;
+  uint32_t *object;
+  double *x;
+  double *y;
+  double *z;
+} Dwg_Geometry_Point;
+
+/**
+ *    \struct  _dwg_geometry_lwpline
+ *    \brief   LWPLINE entities. The vertices of polyline i are those from
+ *             first[i] to first[i + 1] (excluded), in the object coordinate
+ *             system of its normal, at its elevation.
+ */
+typedef struct _dwg_geometry_lwpline
+{
+  uint32_t num;
+  uint32_t *object;
+  uint32_t *first;
+  uint32_t *flags;
+  double *elevation;
+  double *normal_x;
+  double *normal_y;
+  double *normal_z;
+
+  uint32_t num_vertices;
+  double *x;
+  double *y;
+  double *bulge;
+} Dwg_Geometry_Lwpline;
+
+/**
+ *    \struct  _dwg_geometry
+ *    \brief   Geometry of the most common entity types, packed by type in
+ *             columns aligned on 64 bytes (see dwg_geometry_new). Entry i of
+ *             a type comes from the object of index object[i].
+ */
+typedef struct _dwg_geometry
+{
+  Dwg_Geometry_Line line;
+  Dwg_Geometry_Arc circle;
+  Dwg_Geometry_Arc arc;
+  Dwg_Geometry_Point point;
+  Dwg_Geometry_Lwpline lwpline;
+
+  /* All the columns, in one allocation */
+  void *block;
+  size_t size;
+} Dwg_Geometry;
+
+/**
+ *    \struct  _dwg_block_cache
+ *    \brief   Blocks tessellated once for all their insertions (see
+ *             dwg_explode), by object index of the block header.
+ */
+typedef struct _dwg_block_cache
+{
+  struct _dwg_struct *dwg;
+  double tolerance;
+  struct _dwg_block_geometry **block;
+  uint32_t num_blocks; /* blocks tessellated so far */
+  uint32_t num_vertices; /* in all of them */
+} Dwg_Block_Cache;
+
+/**
+ *    \struct  _dwg_raster
+ *    \brief   Image given by the caller for a rendering (see dwg_render),
+ *             with the world to pixel transform it was drawn with: pixel
+ *             (x - origin_x) scale, (origin_y - y) scale
+ */
+typedef struct _dwg_raster
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels; /* 1 == grey; 3 == RGB */
+  uint8_t *pixel; /* rows from the top, width * channels bytes each */
+
+  double origin_x;
+  double origin_y;
+  double scale;
+} Dwg_Raster;
+
+/**
+ *    \struct  _dwg_probe
+ *    \brief   Header of a dwg file, as read by dwg_probe: version,
+ *             codepage, header variables (EXTMIN, TDCREATE, HANDSEED...)
+ *             and classes, without any object
+ */
+typedef struct _dwg_probe
+{
+  Dwg_Version_Type version;
+  uint16_t codepage;
+  uint32_t file_size;
+
+  Dwg_Variables variable;
+
+  uint16_t num_classes;
+  Dwg_Class *dwg_class;
+} Dwg_Probe;
+
 /**
  *    \struct  _dwg_struct
  *    \brief   Main DWG struct
@@ -2810,6 +3170,36 @@ typedef struct _dwg_struct
   {
     Dwg_Version_Type version;
     uint16_t codepage;
+    uint32_t num_sections;
+    Dwg_Section *section;
+    /* R2004 pages by page number (see find_section) */
+    uint32_t num_section_pages;
+    Dwg_Section **section_page;
+    uint16_t num_descriptions;
+    Dwg_Section_Info *section_info;
+
+    /* Identity of the source file, used as key by the snapshot cache; the
+     * CRC is only computed by dwg_snapshot_write, from file_name (NULL
+     * once it is done) */
+    uint32_t file_size;
+    uint32_t file_crc;
+    int64_t file_mtime;
+    char *file_name;
+
+    /* Decoding functions of the version family (see dwg_decode_data) */
+    const struct _dwg_decoder *decoder;
+
+    /* Object strings kept as views into the source data (see
+     * dwg_read_file_views): the file, the R2004 objects section and the
+     * blocks of view records */
+    int string_views;
+    uint8_t *view_chain[2];
+    struct _dwg_string_block *string_block;
+
+    /* Pool of the object strings and class names, if interned (see
+     * dwg_read_file_interned), and whether dwg_reset frees it */
+    Dwg_String_Pool *string_pool;
+    int string_pool_owned;
   } header;
 
   Dwg_Variables variable;
@@ -2820,6 +3210,60 @@ typedef struct _dwg_struct
   uint32_t num_objects;
   Dwg_Object *object;
 
+  /* Handle index, sorted by handle (see dwg_handle_init)
+   */
+  uint32_t num_handles;
+  Dwg_Handle_Map *handle_map;
+
+  /* Object indexes by type, and entity indexes by layer (see
+   * dwg_index_init): the objects of type t are type_index[type_start[t]] up
+   * to type_index[type_start[t + 1] - 1], and likewise the entities on the
+   * layer object of index l with layer_start and layer_index
+   */
+  uint32_t num_types;
+  uint32_t *type_start;
+  uint32_t *type_index;
+  uint32_t *layer_start;
+  uint32_t *layer_index;
+
+  /* Extended data of all the objects, in object order: the records, and
+   * their bytes, copied whole from the objects without being parsed
+   */
+  uint32_t num_eed;
+  Dwg_Eed *eed;
+  uint32_t eed_size;
+  uint8_t *eed_data;
+
+  /* SAT data of the ACIS entities, in object order: the blocks of each
+   * entity copied one after the other, still obfuscated
+   */
+  uint32_t sat_size;
+  uint8_t *sat_data;
+
+  /* Reserved slots of the buffers above, kept by dwg_reset for reuse
+   */
+  uint32_t res_objects;
+  uint32_t res_handles;
+  uint32_t res_eed;
+  uint32_t res_eed_data;
+  uint32_t res_sat_data;
+
+  /* Mapped snapshot file holding this structure, if opened by
+   * dwg_snapshot_open (NULL otherwise)
+   */
+  void *snapshot;
+  uint64_t snapshot_size;
+
+  /* Spatial index of the entities, root last (see dwg_spatial_init)
+   */
+  uint32_t num_rtree_nodes;
+  uint32_t num_rtree_entities;
+  Dwg_Rtree_Node *rtree;
+
+  /* Entity extents (see dwg_compute_extents)
+   */
+  Dwg_Extents extents;
+
 } Dwg_Struct;
 
 /* *****************************************************************
@@ -2827,22 +3271,115 @@ typedef struct _dwg_struct
  */
 int dwg_read_file (char *filename, Dwg_Struct * dwg);
 
+int dwg_read_file_reuse (char *filename, Dwg_Struct * dwg);
+
 int dwg_read_file_preview (char *filename, Bit_Chain * dat);
 
+int dwg_probe (char *filename, Dwg_Probe * probe);
+
+void dwg_probe_free (Dwg_Probe * probe);
+
+int dwg_read_file_views (char *filename, Dwg_Struct * dwg);
+
+Dwg_String_View * dwg_string_view_new (Dwg_Struct * dwg);
+
+const Dwg_String_View * dwg_string_view (Dwg_Struct * dwg, BITCODE_TV str);
+
+uint8_t * dwg_string_decode (Dwg_Struct * dwg, BITCODE_TV str);
+
+int dwg_read_file_interned (char *filename, Dwg_Struct * dwg, Dwg_String_Pool * pool);
+
+Dwg_String_Pool * dwg_string_pool_new (void);
+
+void dwg_string_pool_free (Dwg_String_Pool * pool);
+
+uint8_t * dwg_string_intern (Dwg_String_Pool * pool, const uint8_t * str);
+
+uint8_t * dwg_string_pool_adopt (Dwg_String_Pool * pool, uint8_t * str);
+
+uint32_t dwg_string_pool_slot (Dwg_String_Pool * pool, const uint8_t * str);
+
+int dwg_string_utf8 (Dwg_Struct * dwg, BITCODE_TV str, char *out, uint32_t cap);
+
 void dwg_free (Dwg_Struct * dwg);
 
+void dwg_reset (Dwg_Struct * dwg);
+
 char * dwg_version_code (Dwg_Struct * dwg);
 
 char * dwg_version_code_from_id (Dwg_Version_Type id);
 
 void dwg_handle_init (Dwg_Struct * dwg);
 
-uint32_t dwg_handle_get_index (uint32_t hd);
+uint32_t dwg_handle_get_index (Dwg_Struct * dwg, uint32_t hd);
 
 uint32_t dwg_handle_absolute (Dwg_Handle *hd, uint32_t refhd);
 
+int dwg_handle_resolve (Dwg_Struct * dwg, int num_threads);
+
+Dwg_Object * dwg_handle_object (Dwg_Struct * dwg, Dwg_Handle * hd);
+
+int dwg_index_init (Dwg_Struct * dwg);
+
+void dwg_index_free (Dwg_Struct * dwg);
+
+uint32_t dwg_entities_by_type (Dwg_Struct * dwg, uint32_t type, uint32_t ** indexes);
+
+uint32_t dwg_entities_on_layer (Dwg_Struct * dwg, uint32_t layer, uint32_t ** indexes);
+
+uint32_t dwg_object_eed (Dwg_Object * obj, Dwg_Eed ** eed);
+
+int dwg_eed_next (Dwg_Struct * dwg, Dwg_Eed * eed, uint32_t * pos, Dwg_Eed_Value * value);
+
+int dwg_solid_sat (Dwg_Struct * dwg, Dwg_Object * obj, char *out, uint32_t cap);
+
 char * dwg_error_pop (void);
 
+int dwg_snapshot_write (Dwg_Struct * dwg, char *path);
+
+Dwg_Struct * dwg_snapshot_open (char *path);
+
+int dwg_snapshot_check (Dwg_Struct * dwg, char *filename);
+
+void dwg_snapshot_close (Dwg_Struct * dwg);
+
+int dwg_entity_extents (Dwg_Object * obj, Dwg_Bbox * box);
+
+int dwg_ocs_axes (BITCODE_3BD * ext, BITCODE_3BD * ax, BITCODE_3BD * ay, BITCODE_3BD * az);
+
+int dwg_tessellate (Dwg_Object * obj, double tolerance, Dwg_Tess_Buffer * buf);
+
+uint32_t dwg_tessellate_type (Dwg_Struct * dwg, uint32_t type, double tolerance, uint32_t * next,
+                              Dwg_Tess_Buffer * buf);
+
+Dwg_Geometry * dwg_geometry_new (Dwg_Struct * dwg);
+
+void dwg_geometry_free (Dwg_Geometry * geo);
+
+Dwg_Block_Cache * dwg_block_cache_new (Dwg_Struct * dwg, double tolerance);
+
+int dwg_block_cache_fill (Dwg_Block_Cache * cache);
+
+void dwg_block_cache_free (Dwg_Block_Cache * cache);
+
+int dwg_explode (Dwg_Object * obj, Dwg_Block_Cache * cache, Dwg_Tess_Buffer * buf);
+
+uint32_t dwg_explode_type (Dwg_Struct * dwg, uint32_t type, Dwg_Block_Cache * cache,
+                           uint32_t * next, Dwg_Tess_Buffer * buf);
+
+int dwg_compute_extents (Dwg_Struct * dwg, int num_threads);
+
+void dwg_extents_free (Dwg_Struct * dwg);
+
+int dwg_render (Dwg_Struct * dwg, Dwg_Raster * raster);
+
+int dwg_spatial_init (Dwg_Struct * dwg);
+
+void dwg_spatial_free (Dwg_Struct * dwg);
+
+uint32_t dwg_query_box (Dwg_Struct * dwg, BITCODE_3BD * min, BITCODE_3BD * max,
+                        int (*callback) (Dwg_Object * obj, void *data), void *data);
+
 #ifdef __cplusplus
 //}
 #endif
@@ -77,7 +77,7 @@
 
 /** Decode entity data */
 int
-dwg_decode_entity_handles (Bit_Chain * dat, Dwg_Object * obj)
+DWG_DECODE_NAME(entity_handles) (Bit_Chain * dat, Dwg_Object * obj)
 {
   int i;
   char tmp[1024];
@@ -26,15 +26,45 @@
 #ifndef _DWG_MACROS_H_
 #define _DWG_MACROS_H_
 
+#ifdef DWG_VERSION_MIN
+
+/* Code generated for the versions DWG_VERSION_MIN to DWG_VERSION_MAX only:
+ * the checks are constant, and left to the compiler, unless v falls inside
+ * the range
+ */
+#define PRE(v) if (DWG_VERSION_MAX < v || (DWG_VERSION_MIN < v && dwg->header.version < v))
+#define UNTIL(v) if (DWG_VERSION_MAX <= v || (DWG_VERSION_MIN <= v && dwg->header.version <= v))
+#define VERSION(v) if ((DWG_VERSION_MIN == v && DWG_VERSION_MAX == v) \
+  || (DWG_VERSION_MIN <= v && DWG_VERSION_MAX >= v && dwg->header.version == v))
+#define VERSIONS(v1,v2) if ((DWG_VERSION_MIN >= v1 && DWG_VERSION_MAX <= v2) \
+  || (DWG_VERSION_MAX >= v1 && DWG_VERSION_MIN <= v2 \
+      && dwg->header.version >= v1 && dwg->header.version <= v2))
+#define SINCE(v) if (DWG_VERSION_MIN >= v || (DWG_VERSION_MAX >= v && dwg->header.version >= v))
+
+#else
+
 #define PRE(v) if (dwg->header.version < v)
 #define UNTIL(v) if (dwg->header.version <= v)
-#define LATER_VERSIONS else
 #define VERSION(v) if (dwg->header.version == v)
 #define VERSIONS(v1,v2) if (dwg->header.version >= v1 && dwg->header.version <= v2)
-#define OTHER_VERSIONS else
 #define SINCE(v) if (dwg->header.version >= v)
+
+#endif
+
+#define LATER_VERSIONS else
+#define OTHER_VERSIONS else
 #define PRIOR_VERSIONS else
 
+/* Name of a decoding function: dwg_decode_<name>, or with the prefix of the
+ * version family it was generated for
+ */
+#ifndef DWG_DECODE_PREFIX
+#define DWG_DECODE_PREFIX dwg_decode_
+#endif
+#define DWG_DECODE_CAT(a, b) a##b
+#define DWG_DECODE_XCAT(a, b) DWG_DECODE_CAT(a, b)
+#define DWG_DECODE_NAME(name) DWG_DECODE_XCAT(DWG_DECODE_PREFIX, name)
+
 #define ANYCODE -1
 
 #define FIELD_B(name) FIELD(name, B);
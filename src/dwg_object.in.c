@@ -35,12 +35,30 @@
 #define SKIP(name) bit_read_##name(dat)
 
 #define FIELD_TV(name) \
-  FIELD(name, TV); \
+  if (dwg->header.string_views) \
+    {\
+      FIELD_VALUE(name) = object_read_TV_view (dat, dwg);\
+      TRACE_TV_VIEW(name, FIELD_VALUE(name));\
+    }\
+  else\
+    {\
+      FIELD(name, TV);\
+      FIELD_VALUE(name) = dwg_string_pool_adopt (dwg->header.string_pool, FIELD_VALUE(name));\
+    }\
   if (FIELD_VALUE(name) == NULL) \
     {\
       return (0);\
     }
 
+/* Views are traced by their size only, the text is not decoded */
+#define TRACE_TV_VIEW(name, value)\
+  if (TRACE_ON && (value))\
+    {\
+      snprintf (tmp, 1024, "  " #name ": (%u characters)\n",\
+                (unsigned) ((Dwg_String_View *) (value))->length);\
+      LOG_TRACE (tmp);\
+    }
+
 #define FIELD_T FIELD_TV	/*TODO: implement version dependant string fields */
 
 /* XXX: this is really dirty! */
@@ -61,7 +79,18 @@
 
 #define FIELD_BD(name) FIELD(name, BD); TEST_D(name);
 #define FIELD_RD(name) FIELD(name, RD); TEST_D(name);
-#define FIELD_BT(name) FIELD(name, BT); TEST_D(name);
+#define FIELD_BT(name) \
+  SINCE(R_2000)\
+    {\
+      FIELD_VALUE(name) = bit_read_B (dat) ? 0.0 : bit_read_BD (dat);\
+    }\
+  PRIOR_VERSIONS\
+    {\
+      FIELD_VALUE(name) = bit_read_BD (dat);\
+    }\
+  snprintf (tmp, 1024, "  " #name ": " FORMAT_BT "\n", FIELD_VALUE(name));\
+  LOG_TRACE (tmp);\
+  TEST_D(name);
 
 #define FIELD_HANDLE(name, handle_code)\
   if (bit_read_H (dat, &FIELD_VALUE(name)) )\
@@ -89,7 +118,28 @@
   snprintf (tmp, 1024, "  " #name ": %1X\n", FIELD_VALUE(name)); \
   LOG_TRACE (tmp);
 
-#define FIELD_BE(name) bit_read_BE(dat, &FIELD_VALUE(name).x, &FIELD_VALUE(name).y, &FIELD_VALUE(name).z);\
+#define FIELD_BE(name) \
+  SINCE(R_2000)\
+    {\
+      if (bit_read_B (dat))\
+        {\
+          FIELD_VALUE(name).x = 0.0;\
+          FIELD_VALUE(name).y = 0.0;\
+          FIELD_VALUE(name).z = 1.0;\
+        }\
+      else\
+        {\
+          FIELD_VALUE(name).x = bit_read_BD (dat);\
+          FIELD_VALUE(name).y = bit_read_BD (dat);\
+          FIELD_VALUE(name).z = bit_read_BD (dat);\
+        }\
+    }\
+  PRIOR_VERSIONS\
+    {\
+      FIELD_VALUE(name).x = bit_read_BD (dat);\
+      FIELD_VALUE(name).y = bit_read_BD (dat);\
+      FIELD_VALUE(name).z = bit_read_BD (dat);\
+    }\
   snprintf (tmp, 1024, "  " #name ".x: %g\n  " #name ".y: %g\n  " #name ".z: %g\n", \
 		  FIELD_VALUE(name).x, \
 		  FIELD_VALUE(name).y, \
@@ -112,16 +162,25 @@
       snprintf (tmp, 1024, "  " #name ": index %d\n", FIELD_VALUE(name).index); \
     LOG_TRACE(tmp);
 
+/* Vectors are read with the bulk readers of bits.c, and traced afterwards,
+ * only if tracing is on
+ */
+#define TRACE_ON (log_level_get () >= LOG_LEVEL_TRACE)
+
 //FIELD_VECTOR_N(name, type, size):
 // reads data of the type indicated by 'type' 'size' times and stores
-// it all in the vector called 'name'.
+// it all in the vector called 'name'. Its values are not tested.
 #define FIELD_VECTOR_N(name, type, size)\
   if (size > 0)\
     {\
       FIELD_VALUE(name) = (BITCODE_##type*) malloc(size * sizeof(BITCODE_##type));\
-      for (vcount=0; vcount < size; vcount++)\
+      if (FIELD_VALUE(name) == NULL)\
+        {\
+          return (0);\
+        }\
+      bit_read_##type##_array (dat, FIELD_VALUE(name), size);\
+      for (vcount=0; TRACE_ON && vcount < size; vcount++)\
         {\
-          FIELD_VALUE(name)[vcount] = bit_read_##type(dat);\
           snprintf (tmp, 1024, "  " #name "[%d]: " FORMAT_##type "\n", vcount, FIELD_VALUE(name)[vcount]); \
           LOG_TRACE(tmp);\
         }\
@@ -135,51 +194,84 @@
       FIELD_VALUE(name) = (BITCODE_TV*) malloc (FIELD_VALUE(size) * sizeof(BITCODE_TV*));\
       for (vcount=0; vcount < FIELD_VALUE(size); vcount++)\
         {\
-          FIELD_VALUE(name)[vcount] = bit_read_TV(dat);\
+          if (dwg->header.string_views)\
+            {\
+              FIELD_VALUE(name)[vcount] = object_read_TV_view (dat, dwg);\
+              TRACE_TV_VIEW(name, FIELD_VALUE(name)[vcount]);\
+              continue;\
+            }\
+          FIELD_VALUE(name)[vcount] = dwg_string_pool_adopt (dwg->header.string_pool, bit_read_TV(dat));\
           snprintf (tmp, 1024, "  " #name "[%d]: " FORMAT_TV "\n", vcount, FIELD_VALUE(name)[vcount]); \
           LOG_TRACE(tmp); \
         }\
     }
 
+#define TRACE_POINT_VECTOR(name, size)\
+  for (vcount=0; TRACE_ON && vcount < size; vcount++)\
+    {\
+      snprintf (tmp, 1024, "  " #name "[%d]: (%g, %g)\n", vcount,\
+                FIELD_VALUE(name)[vcount].x, FIELD_VALUE(name)[vcount].y);\
+      LOG_TRACE(tmp);\
+    }
+
 #define FIELD_2RD_VECTOR(name, size)\
   if (FIELD_VALUE(size) > 0)\
     {\
       FIELD_VALUE(name) = (BITCODE_2RD *) malloc(FIELD_VALUE(size) * sizeof(BITCODE_2RD));\
-    }\
-  for (vcount=0; vcount< FIELD_VALUE(size); vcount++)\
-    {\
-      FIELD_2RD(name[vcount]);\
+      if (FIELD_VALUE(name) == NULL\
+          || bit_read_RD_array (dat, &FIELD_VALUE(name)[0].x, 2 * FIELD_VALUE(size)))\
+        {\
+          return (0);\
+        }\
+      TRACE_POINT_VECTOR(name, FIELD_VALUE(size))\
     }
 
 #define FIELD_2DD_VECTOR(name, size)\
   if (FIELD_VALUE(size) > 0)\
     {\
       FIELD_VALUE(name) = (BITCODE_2RD *) malloc(FIELD_VALUE(size) * sizeof(BITCODE_2RD));\
-      FIELD_2RD(name[0]);\
-      for (vcount = 1; vcount < FIELD_VALUE(size); vcount++)\
+      if (FIELD_VALUE(name) == NULL\
+          || bit_read_2DD_array (dat, FIELD_VALUE(name), FIELD_VALUE(size)))\
         {\
-          FIELD_2DD(name[vcount], FIELD_VALUE(name[vcount - 1].x), FIELD_VALUE(name[vcount - 1].y));\
+          return (0);\
         }\
-    }\
+      TRACE_POINT_VECTOR(name, FIELD_VALUE(size))\
+    }
 
 #define FIELD_3DPOINT_VECTOR(name, size)\
   if (FIELD_VALUE(size) > 0)\
     {\
       FIELD_VALUE(name) = (BITCODE_3DPOINT *) malloc(FIELD_VALUE(size) * sizeof(BITCODE_3DPOINT));\
-    }\
-  for (vcount=0; vcount< FIELD_VALUE(size); vcount++)\
-    {\
-      FIELD_3DPOINT(name[vcount]);\
+      if (FIELD_VALUE(name) == NULL\
+          || bit_read_BD_array (dat, &FIELD_VALUE(name)[0].x, 3 * FIELD_VALUE(size)))\
+        {\
+          return (0);\
+        }\
+      for (vcount=0; TRACE_ON && vcount < FIELD_VALUE(size); vcount++)\
+        {\
+          snprintf (tmp, 1024, "  " #name "[%d]: (%g, %g, %g)\n", vcount, FIELD_VALUE(name)[vcount].x,\
+                    FIELD_VALUE(name)[vcount].y, FIELD_VALUE(name)[vcount].z);\
+          LOG_TRACE(tmp);\
+        }\
     }
 
-#define HANDLE_VECTOR_N(name, size, code)\
-  if (size > 0)\
-    {\
-      FIELD_VALUE(name) = (BITCODE_H*) malloc(sizeof(BITCODE_H) * size);\
-    }\
-  for (vcount=0; vcount < size; vcount++)\
+#define HANDLE_VECTOR_N(name, num, handle_code)\
+  if (num > 0)\
     {\
-      FIELD_HANDLE(name[vcount], code);\
+      FIELD_VALUE(name) = (BITCODE_H*) malloc(sizeof(BITCODE_H) * num);\
+      if (FIELD_VALUE(name) == NULL\
+          || bit_read_H_array (dat, FIELD_VALUE(name), num))\
+        {\
+          return (0);\
+        }\
+      for (vcount=0; TRACE_ON && vcount < num; vcount++)\
+        {\
+          snprintf (tmp, 1024, "  " #name "[%d]: HANDLE(%d.%d.%lu)\n", vcount,\
+                    FIELD_VALUE(name)[vcount].code,\
+                    FIELD_VALUE(name)[vcount].size,\
+                    FIELD_VALUE(name)[vcount].value);\
+          LOG_TRACE(tmp);\
+        }\
     }
 
 #define HANDLE_VECTOR(name, sizefield, code) HANDLE_VECTOR_N(name, FIELD_VALUE(sizefield), code)
@@ -251,11 +343,11 @@
 #define VECTOR_FREE(name) 
 
 #define COMMON_ENTITY_HANDLE_DATA \
-  dwg_decode_entity_handles (dat, obj)
+  DWG_DECODE_NAME(entity_handles) (dat, obj)
 
 #define DWG_ENTITY(token) \
 int \
-dwg_decode_##token (Bit_Chain * dat, Dwg_Object * obj)\
+DWG_DECODE_NAME(token) (Bit_Chain * dat, Dwg_Object * obj)\
 {\
   char tmp[1024];\
   unsigned vcount, rcount, rcount2, rcount3;\
@@ -282,7 +374,7 @@ dwg_decode_##token (Bit_Chain * dat, Dwg_Object * obj)\
 
 #define DWG_NONGRAPH(token) \
 int \
-dwg_decode_ ## token (Bit_Chain * dat, Dwg_Object * obj)\
+DWG_DECODE_NAME(token) (Bit_Chain * dat, Dwg_Object * obj)\
 {\
   char tmp[1024];\
   unsigned vcount, rcount, rcount2, rcount3;\
@@ -306,6 +398,9 @@ dwg_decode_ ## token (Bit_Chain * dat, Dwg_Object * obj)\
   LOG_TRACE (tmp);\
   return(1);}
 
+/* The hand written ACIS decoder is generated once per version family too */
+#define decode_3dsolid DWG_DECODE_NAME(3dsolid)
+
 #define IS_DECODER
 #include "dwg_object.spe.c"
 #undef IS_DECODER
@@ -1253,18 +1253,14 @@ DWG_ENTITY_END
 #ifndef IS_PRINT
 #ifdef IS_DECODER
 
-#define DECODE_3DSOLID decode_3dsolid(dat, obj, _obj);
+#define DECODE_3DSOLID if (!decode_3dsolid(dat, obj, _obj)) return (0);
 
 int
 decode_3dsolid (Bit_Chain* dat, Dwg_Object* obj, Dwg_Entity_3DSOLID* _obj)
 {
   Dwg_Struct* dwg = obj->parent;
   unsigned int vcount, rcount, rcount2;
-  unsigned int i=0;
-  unsigned int j=0;
-  int index;
-  int total_size=0;
-  unsigned int num_blocks=0;
+  BITCODE_BL size;
   char tmp[1024];
 
   FIELD_B(acis_empty);
@@ -1275,34 +1271,22 @@ decode_3dsolid (Bit_Chain* dat, Dwg_Object* obj, Dwg_Entity_3DSOLID* _obj)
       FIELD_BS (version);
       if (FIELD_VALUE(version)==1)
         {
-          do
+          /* The SAT blocks are only copied here, as they are, one after the
+           * other; they are de-obfuscated by dwg_solid_sat, when asked for */
+          FIELD_VALUE(sat_offset) = dwg->sat_size;
+          FIELD_VALUE(sat_size) = 0;
+          while ((size = bit_read_BL (dat)) != 0)
             {
-              FIELD_VALUE(sat_data) = (BITCODE_RC**) realloc(FIELD_VALUE(sat_data), i * sizeof(BITCODE_RC*));
-              FIELD_VALUE(block_size) = (BITCODE_BL*) realloc(FIELD_VALUE(block_size), i * sizeof(BITCODE_BL));
-              FIELD_BL (block_size[i]);
-              FIELD_VECTOR (sat_data[i], RC, block_size[i]);
-              total_size += FIELD_VALUE(block_size[i]);
-            } while(FIELD_VALUE(block_size[i++]));
-
-          //de-obfuscate SAT data
-          FIELD_VALUE(raw_sat_data) = (unsigned char*) malloc (total_size * sizeof(unsigned char*));
-          num_blocks=i-1;
-          index=0;
-          for (i=0;i<num_blocks;i++)
-            {
-              for (j=0;j<FIELD_VALUE(block_size[i]);j++)
+              if (dat->byte >= dat->size || size > dat->size - dat->byte)
                 {
-                  if (FIELD_VALUE(sat_data[i][j]<=32))
-                    {
-                      FIELD_VALUE(raw_sat_data)[index++] = FIELD_VALUE(sat_data[i][j]);
-                    }
-                  else
-                    {
-                      FIELD_VALUE(raw_sat_data)[index++] = 159-FIELD_VALUE(sat_data[i][j]);
-                    }
+                  LOG_ERROR ("SAT block beyond the end of the object data.\n");
+                  return (0);
                 }
+              if (dwg_sat_add (obj, dat, size))
+                return (0);
+              FIELD_VALUE(sat_size) += size;
             }
-          snprintf (tmp, 1024, "Raw SAT data:\n%s\n", FIELD_VALUE(raw_sat_data));
+          snprintf (tmp, 1024, "  SAT data: %lu bytes\n", (unsigned long) FIELD_VALUE(sat_size));
           LOG_TRACE (tmp);
         }
       else //if (FIELD_VALUE(version)==2)
@@ -1371,6 +1355,7 @@ decode_3dsolid (Bit_Chain* dat, Dwg_Object* obj, Dwg_Entity_3DSOLID* _obj)
           FIELD_HANDLE(history_id, ANYCODE);
         }
     }
+  return (1);
 }
 #else
 #  define DECODE_3DSOLID {}
@@ -1465,7 +1450,7 @@ DWG_NONGRAPH(DICTIONARY);
       fprintf(
           stderr,
           "Strange: dictionary with more than 10 thousand entries! Handle: %lu\n",
-          obj->handle.value);
+          (unsigned long) obj->handle.value);
       return 1;
     }
 
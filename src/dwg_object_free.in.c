@@ -31,13 +31,23 @@
 
 #define SKIP(name) obj_free_retzero() 
 
-#define FIELD_TV(name) \
+#define FIELD_FREE(name) \
 	if (FIELD_VALUE(name)) \
         {\
           free (FIELD_VALUE(name)); \
           FIELD_VALUE(name) = NULL;\
         }
 
+/* String views and interned strings belong to the dwg structure (see
+ * dwg_read_file_views and dwg_read_file_interned) */
+#define FIELD_TV(name) \
+	if (dwg && (dwg->header.string_views || dwg->header.string_pool)) \
+          FIELD_VALUE(name) = NULL;\
+        else\
+          {\
+            FIELD_FREE(name);\
+          }
+
 #define FIELD_T FIELD_TV
 
 #define FIELD_BD(name) 
@@ -54,31 +64,31 @@
 #define FIELD_3DPOINT(name) 
 
 #define FIELD_CMC(token) \
-	FIELD_TV(token.name); \
-	FIELD_TV(token.book_name);
+	FIELD_FREE(token.name); \
+	FIELD_FREE(token.book_name);
 
-#define FIELD_VECTOR_N(name, type, size) FIELD_TV(name)
+#define FIELD_VECTOR_N(name, type, size) FIELD_FREE(name)
 
-#define FIELD_VECTOR(name, type, size) FIELD_TV(name)
+#define FIELD_VECTOR(name, type, size) FIELD_FREE(name)
 
 #define FIELD_TV_VECTOR(name, size)\
       for (vcount=0; vcount < FIELD_VALUE(size); vcount++)\
         {\
           FIELD_TV(name[vcount]);\
         }\
-      FIELD_TV(name);
+      FIELD_FREE(name);
 
-#define FIELD_2RD_VECTOR(name, size) FIELD_TV(name)
+#define FIELD_2RD_VECTOR(name, size) FIELD_FREE(name)
 
-#define FIELD_2DD_VECTOR(name, size) FIELD_TV(name)
+#define FIELD_2DD_VECTOR(name, size) FIELD_FREE(name)
 
-#define FIELD_3DPOINT_VECTOR(name, size) FIELD_TV(name)
+#define FIELD_3DPOINT_VECTOR(name, size) FIELD_FREE(name)
 
-#define HANDLE_VECTOR_N(name, size, code) FIELD_TV(name)
+#define HANDLE_VECTOR_N(name, size, code) FIELD_FREE(name)
 
-#define HANDLE_VECTOR(name, sizefield, code) FIELD_TV(name)
+#define HANDLE_VECTOR(name, sizefield, code) FIELD_FREE(name)
 
-#define FIELD_XDATA(name, size) FIELD_TV(name)
+#define FIELD_XDATA(name, size) FIELD_FREE(name)
 
 #define REACTORS(code) \
   if (obj->reactors)\
@@ -105,7 +115,7 @@
 #define REPEAT3(times, name, type) \
   for (rcount3=0; rcount3 < FIELD_VALUE(times); rcount3++)
 
-#define VECTOR_FREE(name) FIELD_TV(name)
+#define VECTOR_FREE(name) FIELD_FREE(name)
 
 #define COMMON_ENTITY_HANDLE_DATA \
   if (obj->reactors)\
@@ -0,0 +1,177 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       dwg_resolve.in.c
+ *     \brief      Resolving the handle references of variables and objects
+ *                 into object indexes (input C file)
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Every handle field is visited the same way the decoder reads it, so only
+ * the handles actually present in the file are resolved.
+ */
+
+#define FIELD_VALUE(name) _obj->name
+
+#define FIELD(name,type)
+
+#include "dwg_macro.h"
+
+#define SKIP(name) resolve_retzero()
+
+#define FIELD_TV(name)
+#define FIELD_T FIELD_TV
+
+#define FIELD_BD(name)
+#define FIELD_RD(name)
+#define FIELD_BT(name)
+
+#define FIELD_HANDLE(name, handle_code) \
+  resolve_handle (dwg, &FIELD_VALUE(name), refhd);
+
+#define FIELD_HANDLE_NGR(name) \
+  resolve_handle (dwg, &obj->as.nongraph.name, refhd);
+
+#define FIELD_HANDLE_OBJ(name)
+#define FIELD_4BITS(name)
+#define FIELD_BE(name)
+#define FIELD_DD(name, _default)
+#define FIELD_2DD(name, d1, d2)
+#define FIELD_3DPOINT(name)
+
+#define FIELD_CMC(token)
+
+#define FIELD_VECTOR_N(name, type, size)
+#define FIELD_VECTOR(name, type, size)
+#define FIELD_TV_VECTOR(name, size)
+#define FIELD_2RD_VECTOR(name, size)
+#define FIELD_2DD_VECTOR(name, size)
+#define FIELD_3DPOINT_VECTOR(name, size)
+
+#define HANDLE_VECTOR_N(name, size, code) \
+  for (vcount=0; FIELD_VALUE(name) && vcount < (size); vcount++)\
+    {\
+      resolve_handle (dwg, &FIELD_VALUE(name)[vcount], refhd);\
+    }
+
+#define HANDLE_VECTOR(name, sizefield, code) \
+  HANDLE_VECTOR_N(name, FIELD_VALUE(sizefield), code)
+
+#define FIELD_XDATA(name, size)
+
+#define REACTORS(code) \
+  for (vcount=0; obj->reactors && vcount < obj->num_reactors; vcount++)\
+    {\
+      resolve_handle (dwg, &obj->reactors[vcount], refhd);\
+    }
+
+#define ENT_REACTORS REACTORS
+
+#define XDICOBJHANDLE(code) \
+  SINCE(R_2004)\
+    {\
+      if (!obj->xdic_missing_flag)\
+        resolve_handle (dwg, &obj->xdicobjhandle, refhd);\
+    }\
+  PRIOR_VERSIONS\
+    resolve_handle (dwg, &obj->xdicobjhandle, refhd);
+
+#define ENT_XDICOBJHANDLE XDICOBJHANDLE
+
+#define COMMON_ENTITY_HANDLE_DATA \
+  dwg_resolve_entity_handles (obj)
+
+#define REPEAT_N(times, name, type) \
+  for (rcount=0; FIELD_VALUE(name) && rcount < times; rcount++)
+
+#define REPEAT(times, name, type) \
+  for (rcount=0; FIELD_VALUE(name) && rcount < FIELD_VALUE(times); rcount++)
+
+#define REPEAT2(times, name, type) \
+  for (rcount2=0; FIELD_VALUE(name) && rcount2 < FIELD_VALUE(times); rcount2++)
+
+#define REPEAT3(times, name, type) \
+  for (rcount3=0; FIELD_VALUE(name) && rcount3 < FIELD_VALUE(times); rcount3++)
+
+#define VECTOR_FREE(name)
+
+/* The spec generates a function for every type, UNUSED, PROXY and TABLE
+ * included, though the dispatch (see OBJECT_CASE_SET) never reaches them;
+ * and not every type uses every loop counter */
+#ifdef __GNUC__
+#  define RESOLVE_FUNCTION static int __attribute__ ((unused))
+#else
+#  define RESOLVE_FUNCTION static int
+#endif
+
+#define RESOLVE_LOCALS \
+  char tmp[1024];\
+  unsigned vcount, rcount, rcount2, rcount3;\
+  Dwg_Struct * dwg = obj->parent;\
+  uint32_t refhd = obj->handle.value;
+
+#define RESOLVE_UNUSED \
+  (void) dat; (void) tmp; (void) vcount; (void) rcount; (void) rcount2; (void) rcount3;\
+  (void) dwg; (void) _obj; (void) refhd;
+
+#define DWG_ENTITY(token) \
+RESOLVE_FUNCTION \
+dwg_resolve_##token (Bit_Chain * dat, Dwg_Object * obj)\
+{\
+  RESOLVE_LOCALS\
+  Dwg_Entity_##token *ent, *_obj;\
+  ent = &obj->as.entity.as.token;\
+  _obj = ent;\
+  RESOLVE_UNUSED
+
+#define DWG_ENTITY_END return(1);}
+
+#define DWG_NONGRAPH(token) \
+RESOLVE_FUNCTION \
+dwg_resolve_##token (Bit_Chain * dat, Dwg_Object * obj)\
+{\
+  RESOLVE_LOCALS\
+  Dwg_Nongraph_##token *_obj;\
+  _obj = &obj->as.nongraph.as.token;\
+  RESOLVE_UNUSED
+
+#define DWG_NONGRAPH_END return(1);}
+
+static int resolve_retzero () {return (0);}
+
+/* Common entity handles */
+static void
+dwg_resolve_entity_handles (Dwg_Object * obj)
+{
+  unsigned vcount;
+  Dwg_Struct *dwg = obj->parent;
+  uint32_t refhd = obj->handle.value;
+  Dwg_Object_Entity *_obj = &obj->as.entity;
+
+# include "dwg_entity_handle.spe.c"
+}
+
+#define OBJECT_FREE
+#include "dwg_object.spe.c"
+#undef OBJECT_FREE
+
+static void
+dwg_resolve_variables (Dwg_Struct * dwg)
+{
+  uint32_t refhd = 0;
+  Dwg_Variables *_obj = &dwg->variable;
+
+# include "dwg_variables.spe.c"
+}
@@ -0,0 +1,178 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       dwg_snapshot.in.c
+ *     \brief      Copying the dynamic data of variables and objects into a
+ *                 snapshot (input C file)
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Every pointer field is copied as a block of the snapshot, the same way the
+ * freeing functions walk them (see dwg_object_free.in.c). Blocks which have
+ * pointers inside (REPEAT arrays, string vectors) are registered as containers,
+ * so that the pointers inside them can be located in the snapshot later.
+ */
+
+#define FIELD_VALUE(name) _obj->name
+
+#define FIELD(name,type)
+
+#include "dwg_macro.h"
+
+#define SKIP(name) snapshot_retzero()
+
+#define SNAP_BLOCK(name, size, container) \
+  snapshot_pointer (dat, &FIELD_VALUE(name), (size), container);
+
+#define FIELD_TV(name) \
+  if (FIELD_VALUE(name)) \
+    {\
+      SNAP_BLOCK(name, strlen ((char *) FIELD_VALUE(name)) + 1, 0);\
+    }
+
+#define FIELD_T FIELD_TV
+
+#define FIELD_BD(name)
+#define FIELD_RD(name)
+#define FIELD_BT(name)
+
+#define FIELD_HANDLE(name, handle_code)
+#define FIELD_HANDLE_NGR(name)
+#define FIELD_HANDLE_OBJ(name)
+#define FIELD_4BITS(name)
+#define FIELD_BE(name)
+#define FIELD_DD(name, _default)
+#define FIELD_2DD(name, d1, d2)
+#define FIELD_3DPOINT(name)
+
+#define FIELD_CMC(token) \
+	FIELD_TV(token.name); \
+	FIELD_TV(token.book_name);
+
+#define FIELD_VECTOR_N(name, type, size) \
+  SNAP_BLOCK(name, (size) * sizeof (BITCODE_##type), 0)
+
+#define FIELD_VECTOR(name, type, size) FIELD_VECTOR_N(name, type, _obj->size)
+
+#define FIELD_TV_VECTOR(name, size)\
+      SNAP_BLOCK(name, FIELD_VALUE(size) * sizeof (BITCODE_TV), 1);\
+      for (vcount=0; vcount < FIELD_VALUE(size); vcount++)\
+        {\
+          FIELD_TV(name[vcount]);\
+        }
+
+#define FIELD_2RD_VECTOR(name, size) \
+  SNAP_BLOCK(name, FIELD_VALUE(size) * sizeof (BITCODE_2RD), 0)
+
+#define FIELD_2DD_VECTOR(name, size) \
+  SNAP_BLOCK(name, FIELD_VALUE(size) * sizeof (BITCODE_2RD), 0)
+
+#define FIELD_3DPOINT_VECTOR(name, size) \
+  SNAP_BLOCK(name, FIELD_VALUE(size) * sizeof (BITCODE_3DPOINT), 0)
+
+#define HANDLE_VECTOR_N(name, size, code) \
+  SNAP_BLOCK(name, (size) * sizeof (BITCODE_H), 0)
+
+#define HANDLE_VECTOR(name, sizefield, code) \
+  HANDLE_VECTOR_N(name, FIELD_VALUE(sizefield), code)
+
+/* Never decoded (see dwg_object.in.c) */
+#define FIELD_XDATA(name, size) \
+  SNAP_BLOCK(name, 0, 0)
+
+/* Reactors, xdictionary and common handles are copied by snapshot_object */
+#define REACTORS(code)
+
+#define ENT_REACTORS REACTORS
+
+#define XDICOBJHANDLE(code)
+
+#define ENT_XDICOBJHANDLE(code)
+
+#define COMMON_ENTITY_HANDLE_DATA
+
+#define REPEAT_N(times, name, type) \
+  SNAP_BLOCK(name, (times) * sizeof (type), 1);\
+  for (rcount=0; rcount < times; rcount++)
+
+#define REPEAT(times, name, type) \
+  SNAP_BLOCK(name, FIELD_VALUE(times) * sizeof (type), 1);\
+  for (rcount=0; rcount < FIELD_VALUE(times); rcount++)
+
+#define REPEAT2(times, name, type) \
+  SNAP_BLOCK(name, FIELD_VALUE(times) * sizeof (type), 1);\
+  for (rcount2=0; rcount2 < FIELD_VALUE(times); rcount2++)
+
+#define REPEAT3(times, name, type) \
+  SNAP_BLOCK(name, FIELD_VALUE(times) * sizeof (type), 1);\
+  for (rcount3=0; rcount3 < FIELD_VALUE(times); rcount3++)
+
+#define VECTOR_FREE(name)
+
+/* The spec generates a function for every type, UNUSED, PROXY and TABLE
+ * included, though the dispatch (see OBJECT_CASE_SET) never reaches them;
+ * and not every type uses every loop counter */
+#ifdef __GNUC__
+#  define SNAPSHOT_FUNCTION static int __attribute__ ((unused))
+#else
+#  define SNAPSHOT_FUNCTION static int
+#endif
+
+#define SNAPSHOT_LOCALS \
+  char tmp[1024];\
+  unsigned vcount, rcount, rcount2, rcount3;\
+  Dwg_Struct * dwg = obj->parent;
+
+#define SNAPSHOT_UNUSED \
+  (void) dat; (void) tmp; (void) vcount; (void) rcount; (void) rcount2; (void) rcount3;\
+  (void) dwg; (void) _obj;
+
+#define DWG_ENTITY(token) \
+SNAPSHOT_FUNCTION \
+dwg_snapshot_##token (Dwg_Snapshot_Writer * dat, Dwg_Object * obj)\
+{\
+  SNAPSHOT_LOCALS\
+  Dwg_Entity_##token *ent, *_obj;\
+  ent = &obj->as.entity.as.token;\
+  _obj = ent;\
+  SNAPSHOT_UNUSED
+
+#define DWG_ENTITY_END return(1);}
+
+#define DWG_NONGRAPH(token) \
+SNAPSHOT_FUNCTION \
+dwg_snapshot_##token (Dwg_Snapshot_Writer * dat, Dwg_Object * obj)\
+{\
+  SNAPSHOT_LOCALS\
+  Dwg_Nongraph_##token *_obj;\
+  _obj = &obj->as.nongraph.as.token;\
+  SNAPSHOT_UNUSED
+
+#define DWG_NONGRAPH_END return(1);}
+
+static int snapshot_retzero () {return (0);}
+
+/* Same walk as the freeing functions, without the decoder skips */
+#define OBJECT_FREE
+#include "dwg_object.spe.c"
+#undef OBJECT_FREE
+
+static void
+dwg_snapshot_variables (Dwg_Snapshot_Writer * dat, Dwg_Struct * dwg)
+{
+  Dwg_Variables *_obj = &dwg->variable;
+
+# include "dwg_variables.spe.c"
+}
@@ -48,7 +48,17 @@
 
 #define FIELD_BD(name) FIELD(name, BD);
 #define FIELD_RD(name) FIELD(name, RD);
-#define FIELD_BT(name) FIELD(name, BT);
+#define FIELD_BT(name) \
+  SINCE(R_2000)\
+    {\
+      FIELD_VALUE(name) = bit_read_B (dat) ? 0.0 : bit_read_BD (dat);\
+    }\
+  PRIOR_VERSIONS\
+    {\
+      FIELD_VALUE(name) = bit_read_BD (dat);\
+    }\
+  snprintf (tmp, 1024, "  " #name ": " FORMAT_BT "\n", FIELD_VALUE(name));\
+  LOG_TRACE (tmp);
 
 #define FIELD_HANDLE(name, handle_code)\
   bit_read_H (dat, &FIELD_VALUE(name));\
@@ -64,7 +74,7 @@
   LOG_TRACE(tmp);
 
 int
-dwg_decode_variables (Bit_Chain *dat, Dwg_Struct *dwg)
+DWG_DECODE_NAME(variables) (Bit_Chain *dat, Dwg_Struct *dwg)
 {
   char tmp[1024];
   Dwg_Variables* _var = &dwg->variable;
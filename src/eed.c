@@ -0,0 +1,220 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       eed.c
+ *     \brief      Extended entity data (EED), kept whole and parsed on request
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Each EED record of an object (the data of one application) starts with
+ * its size. While decoding, the record is not walked value by value: its
+ * bytes are copied in one go to dwg->eed_data, and the record only keeps
+ * their offset and size. The EED bytes are at any bit position in the
+ * object stream, and this stream is freed after decoding (or only cached a
+ * few pages at a time for R2004), hence the copy. The values are parsed by
+ * dwg_eed_next, when asked for.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dwg.h"
+#include "bits.h"
+#include "object.h"
+#include "logging.h"
+
+/** Appends an EED record of size bytes, read from dat, to the records of
+ * obj, the last object being decoded.
+ * Returns 0 if OK, -1 if there is not enough memory (the bytes are then
+ * skipped).
+ */
+int
+dwg_eed_add (Dwg_Object * obj, Dwg_Handle * app, Bit_Chain * dat, uint32_t size)
+{
+  Dwg_Struct *dwg = obj->parent;
+  Dwg_Eed *eed;
+  uint8_t *data;
+  uint32_t num;
+
+  if (dwg->num_eed >= dwg->res_eed)
+    {
+      num = dwg->res_eed < 64 ? 64 : 2 * dwg->res_eed;
+      eed = (Dwg_Eed *) realloc (dwg->eed, num * sizeof (Dwg_Eed));
+      if (eed == NULL)
+        goto fail;
+      dwg->eed = eed;
+      dwg->res_eed = num;
+    }
+  if (dwg->eed_size + size > dwg->res_eed_data)
+    {
+      num = dwg->res_eed_data < 4096 ? 4096 : 2 * dwg->res_eed_data;
+      while (num < dwg->eed_size + size)
+        num *= 2;
+      data = (uint8_t *) realloc (dwg->eed_data, num);
+      if (data == NULL)
+        goto fail;
+      dwg->eed_data = data;
+      dwg->res_eed_data = num;
+    }
+
+  eed = &dwg->eed[dwg->num_eed++];
+  eed->app = *app;
+  eed->offset = dwg->eed_size;
+  eed->size = size;
+  bit_read_RC_array (dat, dwg->eed_data + dwg->eed_size, size);
+  dwg->eed_size += size;
+  obj->num_eed++;
+  return (0);
+
+fail:
+  LOG_ERROR ("Not enough memory for the extended data.\n");
+  dat->byte += size;
+  return (-1);
+}
+
+/** Frees the extended data of a dwg structure.
+ */
+void
+dwg_eed_free (Dwg_Struct * dwg)
+{
+  if (dwg->eed)
+    free (dwg->eed);
+  dwg->eed = NULL;
+  dwg->num_eed = 0;
+  dwg->res_eed = 0;
+  if (dwg->eed_data)
+    free (dwg->eed_data);
+  dwg->eed_data = NULL;
+  dwg->eed_size = 0;
+  dwg->res_eed_data = 0;
+}
+
+/** Gets the extended data of an object, one record per application: returns
+ * their number, and points *eed to the first one, the others following it.
+ */
+uint32_t
+dwg_object_eed (Dwg_Object * obj, Dwg_Eed ** eed)
+{
+  Dwg_Struct *dwg = obj->parent;
+
+  if (obj->num_eed == 0 || dwg == NULL || obj->eed_start + obj->num_eed > dwg->num_eed)
+    {
+      *eed = NULL;
+      return (0);
+    }
+  *eed = &dwg->eed[obj->eed_start];
+  return (obj->num_eed);
+}
+
+/** Parses the value at *pos (0 for the first one) of an EED record into
+ * value, and moves *pos to the next one.
+ * Returns 1 if a value was read, 0 at the end of the record, -1 if the
+ * record is malformed (truncated value or unknown group code).
+ */
+int
+dwg_eed_next (Dwg_Struct * dwg, Dwg_Eed * eed, uint32_t * pos, Dwg_Eed_Value * value)
+{
+  uint8_t *p, *end;
+  uint32_t need;
+  int i;
+
+  if (*pos >= eed->size)
+    return (0);
+  p = dwg->eed_data + eed->offset + *pos;
+  end = dwg->eed_data + eed->offset + eed->size;
+
+  value->code = 1000 + p[0];
+  p++;
+  switch (value->code)
+    {
+    case 1000:
+      if (dwg->header.version <= R_2004)
+        {
+          if (end - p < 3)
+            return (-1);
+          value->u.string.length = p[0];
+          value->u.string.codepage = p[1] | (p[2] << 8);
+          p += 3;
+          need = value->u.string.length;
+        }
+      else
+        {
+          if (end - p < 2)
+            return (-1);
+          value->u.string.length = p[0] | (p[1] << 8);
+          value->u.string.codepage = 0;
+          p += 2;
+          need = 2 * value->u.string.length;
+        }
+      value->u.string.chars = p;
+      break;
+    case 1002:
+      need = 1;
+      if (end - p >= 1)
+        value->u.brace = p[0];
+      break;
+    case 1003:
+    case 1005:
+      need = 8;
+      if (end - p >= 8)
+        for (value->u.handle = 0, i = 7; i >= 0; i--)
+          value->u.handle = (value->u.handle << 8) | p[i];
+      break;
+    case 1004:
+      if (end - p < 1)
+        return (-1);
+      value->u.binary.length = p[0];
+      value->u.binary.data = ++p;
+      need = value->u.binary.length;
+      break;
+    case 1010:
+    case 1011:
+    case 1012:
+    case 1013:
+      need = 24;
+      if (end - p >= 24)
+        {
+          memcpy (&value->u.point.x, p, 8);
+          memcpy (&value->u.point.y, p + 8, 8);
+          memcpy (&value->u.point.z, p + 16, 8);
+        }
+      break;
+    case 1040:
+    case 1041:
+    case 1042:
+      need = 8;
+      if (end - p >= 8)
+        memcpy (&value->u.real, p, 8);
+      break;
+    case 1070:
+      need = 2;
+      if (end - p >= 2)
+        value->u.short_int = (int16_t) (p[0] | (p[1] << 8));
+      break;
+    case 1071:
+      need = 4;
+      if (end - p >= 4)
+        value->u.long_int = (int32_t) (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24));
+      break;
+    default:
+      return (-1);
+    }
+  if ((uint32_t) (end - p) < need)
+    return (-1);
+  *pos = p + need - (dwg->eed_data + eed->offset);
+  return (1);
+}
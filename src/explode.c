@@ -0,0 +1,571 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       explode.c
+ *     \brief      Explosion of block insertions into world coordinates
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Each block is tessellated once, in its own coordinates, into polylines kept
+ * in a cache; the blocks inserted in it are exploded into the same polylines,
+ * so that a cached block is flat. An insertion is then only a copy of these
+ * vertices through one affine transform, two coordinates at a time (SSE2).
+ * The instances of a MINSERT differ only by the translation of the transform,
+ * which is stepped from one to the next.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dwg.h"
+#include "logging.h"
+
+#define EXPLODE_MAX_DEPTH 32
+#define EXPLODE_MIN_VERTICES 256
+#define EXPLODE_MIN_POLYLINES 32
+
+/* States of a cached block */
+#define BLOCK_TODO 0
+#define BLOCK_BUSY 1
+#define BLOCK_DONE 2
+
+/**
+ *    \struct  _dwg_block_geometry
+ *    \brief   Polylines of a block, in the coordinates of the block
+ */
+typedef struct _dwg_block_geometry
+{
+  int state;
+  Dwg_Tess_Buffer buf;
+} Dwg_Block_Geometry;
+
+/**
+ *    \struct  _explode_matrix
+ *    \brief   Affine transform: columns of the x, y and z axes, then the
+ *             translation
+ */
+typedef struct _explode_matrix
+{
+  double m[12];
+} Explode_Matrix;
+
+/*------------------------------------------------------------------------------
+ * Transforms
+ */
+
+/** Gets the transform of an insertion (of the base point base_pt of a block
+ * at ins_pt, rotated, scaled, in the coordinate system of ext), and the steps
+ * of its translation from one column and one row of a MINSERT to the next.
+ */
+static void
+explode_matrix (BITCODE_3DPOINT * ins_pt, BITCODE_3DPOINT * scale, double rotation,
+                BITCODE_3DPOINT * ext, BITCODE_3DPOINT * base_pt, double col_spacing,
+                double row_spacing, Explode_Matrix * mat, double *col_step, double *row_step)
+{
+  BITCODE_3BD ax, ay, az;
+  double c, s, l[12], *m = mat->m;
+  int k;
+
+  if (!dwg_ocs_axes (ext, &ax, &ay, &az))
+    {
+      ax.x = 1, ax.y = 0, ax.z = 0;
+      ay.x = 0, ay.y = 1, ay.z = 0;
+      az.x = 0, az.y = 0, az.z = 1;
+    }
+  c = cos (rotation);
+  s = sin (rotation);
+
+  /* Within the object coordinate system: rotation of the scaled axes, and
+   * the base point moved to the insertion point
+   */
+  l[0] = c * scale->x, l[1] = s * scale->x, l[2] = 0;
+  l[3] = -s * scale->y, l[4] = c * scale->y, l[5] = 0;
+  l[6] = 0, l[7] = 0, l[8] = scale->z;
+  l[9] = ins_pt->x - (l[0] * base_pt->x + l[3] * base_pt->y);
+  l[10] = ins_pt->y - (l[1] * base_pt->x + l[4] * base_pt->y);
+  l[11] = ins_pt->z - l[8] * base_pt->z;
+
+  /* Then to the world */
+  for (k = 0; k < 12; k += 3)
+    {
+      m[k] = l[k] * ax.x + l[k + 1] * ay.x + l[k + 2] * az.x;
+      m[k + 1] = l[k] * ax.y + l[k + 1] * ay.y + l[k + 2] * az.y;
+      m[k + 2] = l[k] * ax.z + l[k + 1] * ay.z + l[k + 2] * az.z;
+    }
+  for (k = 0; k < 3; k++)
+    {
+      col_step[k] = col_spacing * (c * (&ax.x)[k] + s * (&ay.x)[k]);
+      row_step[k] = row_spacing * (-s * (&ax.x)[k] + c * (&ay.x)[k]);
+    }
+}
+
+/** Writes num vertices of src, moved by mat, to dst */
+static void
+explode_transform (const Explode_Matrix * mat, const double *src, double *dst, uint32_t num)
+{
+  const double *m = mat->m;
+  uint32_t i;
+
+#ifdef __SSE2__
+  /* x and y together, then z */
+  __m128d cx = _mm_loadu_pd (m);
+  __m128d cy = _mm_loadu_pd (m + 3);
+  __m128d cz = _mm_loadu_pd (m + 6);
+  __m128d ct = _mm_loadu_pd (m + 9);
+  __m128d x, y, z;
+
+  for (i = 0; i < num; i++, src += 3, dst += 3)
+    {
+      x = _mm_set1_pd (src[0]);
+      y = _mm_set1_pd (src[1]);
+      z = _mm_set1_pd (src[2]);
+      _mm_storeu_pd (dst, _mm_add_pd (_mm_add_pd (ct, _mm_mul_pd (cx, x)),
+                                      _mm_add_pd (_mm_mul_pd (cy, y), _mm_mul_pd (cz, z))));
+      dst[2] = m[11] + m[2] * src[0] + m[5] * src[1] + m[8] * src[2];
+    }
+#else
+  for (i = 0; i < num; i++, src += 3, dst += 3)
+    {
+      dst[0] = m[9] + m[0] * src[0] + m[3] * src[1] + m[6] * src[2];
+      dst[1] = m[10] + m[1] * src[0] + m[4] * src[1] + m[7] * src[2];
+      dst[2] = m[11] + m[2] * src[0] + m[5] * src[1] + m[8] * src[2];
+    }
+#endif
+}
+
+/*------------------------------------------------------------------------------
+ * Block cache
+ */
+
+/** Makes room for num_vertices more vertices and num_polylines more
+ * polylines in a growing buffer.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+geometry_grow (Dwg_Tess_Buffer * buf, uint32_t num_vertices, uint32_t num_polylines)
+{
+  uint32_t size;
+  void *p;
+
+  if (num_vertices > buf->max_vertices - buf->num_vertices)
+    {
+      size = buf->max_vertices ? buf->max_vertices : EXPLODE_MIN_VERTICES;
+      while (size - buf->num_vertices < num_vertices)
+        size *= 2;
+      p = realloc (buf->vertex, 3 * (size_t) size * sizeof (double));
+      if (p == NULL)
+        return (-1);
+      buf->vertex = (double *) p;
+      buf->max_vertices = size;
+    }
+  if (num_polylines > buf->max_polylines - buf->num_polylines)
+    {
+      size = buf->max_polylines ? buf->max_polylines : EXPLODE_MIN_POLYLINES;
+      while (size - buf->num_polylines < num_polylines)
+        size *= 2;
+      p = realloc (buf->start, size * sizeof (uint32_t));
+      if (p == NULL)
+        return (-1);
+      buf->start = (uint32_t *) p;
+      p = realloc (buf->object, size * sizeof (uint32_t));
+      if (p == NULL)
+        return (-1);
+      buf->object = (uint32_t *) p;
+      buf->max_polylines = size;
+    }
+  return (0);
+}
+
+/** Adds to buf the polylines of a block geometry through the transform of an
+ * insertion, repeated numcols times numrows for a MINSERT.
+ * Returns 0 == OK; 1 == no room in buf, which is unchanged.
+ */
+static int
+geometry_insert (Dwg_Tess_Buffer * buf, Dwg_Tess_Buffer * geo, Explode_Matrix * mat,
+                 const double *col_step, const double *row_step, uint32_t numcols, uint32_t numrows)
+{
+  Explode_Matrix inst;
+  uint32_t r, c, i, count;
+  int k;
+
+  count = numcols * numrows;
+  if (count == 0 || geo->num_polylines == 0)
+    return (0);
+  if (geo->num_vertices > 0 && count > (buf->max_vertices - buf->num_vertices) / geo->num_vertices)
+    return (1);
+  if (count > (buf->max_polylines - buf->num_polylines) / geo->num_polylines)
+    return (1);
+
+  inst = *mat;
+  for (r = 0; r < numrows; r++)
+    for (c = 0; c < numcols; c++)
+      {
+        for (k = 0; k < 3; k++)
+          inst.m[9 + k] = mat->m[9 + k] + c * col_step[k] + r * row_step[k];
+        for (i = 0; i < geo->num_polylines; i++)
+          {
+            buf->start[buf->num_polylines + i] = buf->num_vertices + geo->start[i];
+            buf->object[buf->num_polylines + i] = geo->object[i];
+          }
+        explode_transform (&inst, geo->vertex, &buf->vertex[3 * buf->num_vertices],
+                           geo->num_vertices);
+        buf->num_polylines += geo->num_polylines;
+        buf->num_vertices += geo->num_vertices;
+      }
+  return (0);
+}
+
+/** Gets the object of a handle of obj, or NULL */
+static Dwg_Object *
+explode_handle (Dwg_Object * obj, Dwg_Handle * hd)
+{
+  Dwg_Struct *dwg = obj->parent;
+  uint32_t idx;
+
+  idx = dwg_handle_get_index (dwg, dwg_handle_absolute (hd, obj->handle.value));
+  if (idx >= dwg->num_objects)
+    return (NULL);
+  return (&dwg->object[idx]);
+}
+
+static Dwg_Tess_Buffer *block_geometry (Dwg_Block_Cache * cache, Dwg_Object * blk, int depth);
+
+/** Adds an insertion found in a block to the geometry of the block, or an
+ * insertion to be exploded to buf (then with the rules of dwg_explode).
+ * Returns 0 == OK; 1 == no room in buf; -1 == FAIL.
+ */
+static int
+explode_insert (Dwg_Block_Cache * cache, Dwg_Object * obj, Dwg_Tess_Buffer * buf, int grow,
+                int depth)
+{
+  Dwg_Object_Entity *ent = &obj->as.entity;
+  Dwg_Object *blk;
+  Dwg_Tess_Buffer *geo;
+  Explode_Matrix mat;
+  BITCODE_3DPOINT *base_pt;
+  double col_step[3], row_step[3];
+  uint32_t numcols = 1, numrows = 1;
+  uint64_t count;
+
+  if (obj->type == DWG_TYPE_INSERT)
+    blk = explode_handle (obj, &ent->as.INSERT.block_header);
+  else
+    blk = explode_handle (obj, &ent->as.MINSERT.block_header);
+  if (blk == NULL || blk->type != DWG_TYPE_BLOCK_HEADER)
+    return (-1);
+  geo = block_geometry (cache, blk, depth + 1);
+  if (geo == NULL)
+    return (-1);
+
+  base_pt = &blk->as.nongraph.as.BLOCK_HEADER.base_pt;
+  if (obj->type == DWG_TYPE_INSERT)
+    {
+      Dwg_Entity_INSERT *e = &ent->as.INSERT;
+      explode_matrix (&e->ins_pt, &e->scale, e->rotation_ang, &e->extrusion, base_pt, 0, 0,
+                      &mat, col_step, row_step);
+    }
+  else
+    {
+      Dwg_Entity_MINSERT *e = &ent->as.MINSERT;
+      explode_matrix (&e->ins_pt, &e->scale, e->rotation_ang, &e->extrusion, base_pt,
+                      e->col_spacing, e->row_spacing, &mat, col_step, row_step);
+      numcols = e->numcols;
+      numrows = e->numrows;
+    }
+
+  if (grow)
+    {
+      count = (uint64_t) numcols * numrows;
+      if (count * geo->num_vertices >= UINT32_MAX / 3 || count * geo->num_polylines >= UINT32_MAX
+          || geometry_grow (buf, count * geo->num_vertices, count * geo->num_polylines))
+        {
+          LOG_ERROR ("Not enough memory for the block cache.\n");
+          return (-1);
+        }
+    }
+  return (geometry_insert (buf, geo, &mat, col_step, row_step, numcols, numrows));
+}
+
+/** Adds an entity of a block to the geometry of the block, in the
+ * coordinates of the block: curves as dwg_tessellate does, lines, 3D
+ * polylines, and the blocks it inserts.
+ */
+static void
+block_add (Dwg_Block_Cache * cache, Dwg_Tess_Buffer * geo, Dwg_Object * obj, int depth)
+{
+  Dwg_Struct *dwg = obj->parent;
+  Dwg_Entity_LINE *line;
+  uint32_t i, n, closed;
+  int ret;
+
+  switch (obj->type)
+    {
+    case DWG_TYPE_INSERT:
+    case DWG_TYPE_MINSERT:
+      explode_insert (cache, obj, geo, 1, depth);
+      return;
+    case DWG_TYPE_LINE:
+      if (geometry_grow (geo, 2, 1))
+        break;
+      line = &obj->as.entity.as.LINE;
+      geo->start[geo->num_polylines] = geo->num_vertices;
+      geo->object[geo->num_polylines++] = obj->index;
+      memcpy (&geo->vertex[3 * geo->num_vertices++], &line->start, 3 * sizeof (double));
+      memcpy (&geo->vertex[3 * geo->num_vertices++], &line->end, 3 * sizeof (double));
+      return;
+    case DWG_TYPE_POLYLINE_3D:
+      /* The vertices follow, the first one repeated if closed */
+      for (n = obj->index + 1; n < dwg->num_objects && dwg->object[n].type == DWG_TYPE_VERTEX_3D; n++)
+        ;
+      n -= obj->index + 1;
+      if (n < 2)
+        return;
+      closed = obj->as.entity.as.POLYLINE_3D.flags_2 & 1;
+      if (geometry_grow (geo, n + closed, 1))
+        break;
+      geo->start[geo->num_polylines] = geo->num_vertices;
+      geo->object[geo->num_polylines++] = obj->index;
+      for (i = 0; i < n + closed; i++)
+        memcpy (&geo->vertex[3 * geo->num_vertices++],
+                &dwg->object[obj->index + 1 + i % n].as.entity.as.VERTEX_3D.point,
+                3 * sizeof (double));
+      return;
+    default:
+      /* Curves, tessellated in a buffer doubled until they fit */
+      while ((ret = dwg_tessellate (obj, cache->tolerance, geo)) == 1)
+        if (geometry_grow (geo, geo->max_vertices - geo->num_vertices + 1,
+                           geo->max_polylines - geo->num_polylines + 1))
+          break;
+      if (ret != 1)
+        return;
+    }
+  LOG_ERROR ("Not enough memory for the block cache.\n");
+}
+
+/** Gets the geometry of a block, tessellated the first time, or NULL if the
+ * block is too deeply nested or inserts itself.
+ */
+static Dwg_Tess_Buffer *
+block_geometry (Dwg_Block_Cache * cache, Dwg_Object * blk, int depth)
+{
+  Dwg_Struct *dwg = cache->dwg;
+  Dwg_Nongraph_BLOCK_HEADER *hdr = &blk->as.nongraph.as.BLOCK_HEADER;
+  Dwg_Block_Geometry *g;
+  Dwg_Object *first, *last, *obj;
+  uint32_t i;
+  char tmp[1024];
+
+  g = cache->block[blk->index];
+  if (g == NULL)
+    {
+      g = (Dwg_Block_Geometry *) calloc (1, sizeof (Dwg_Block_Geometry));
+      if (g == NULL)
+        {
+          LOG_ERROR ("Not enough memory for the block cache.\n");
+          return (NULL);
+        }
+      cache->block[blk->index] = g;
+    }
+  if (g->state == BLOCK_DONE)
+    return (&g->buf);
+  if (g->state == BLOCK_BUSY || depth > EXPLODE_MAX_DEPTH)
+    {
+      snprintf (tmp, 1024, "Block 0x%X inserted in itself or nested too deep, left out.\n",
+                blk->handle.value);
+      LOG_WARN (tmp);
+      return (NULL);
+    }
+
+  g->state = BLOCK_BUSY;
+  if (hdr->entities && hdr->owned_object_count > 0)
+    {
+      /* R2004+: the entities are listed */
+      for (i = 0; i < hdr->owned_object_count; i++)
+        {
+          obj = explode_handle (blk, &hdr->entities[i]);
+          if (obj && obj->supertype == DWG_SUPERTYPE_ENTITY)
+            block_add (cache, &g->buf, obj, depth);
+        }
+    }
+  else
+    {
+      /* The entities lie from the first to the last, among others */
+      first = explode_handle (blk, &hdr->first_entity);
+      last = explode_handle (blk, &hdr->last_entity);
+      for (i = first ? first->index : dwg->num_objects; last && i <= last->index; i++)
+        {
+          obj = &dwg->object[i];
+          if (obj->supertype != DWG_SUPERTYPE_ENTITY)
+            continue;
+          if (blk->handle.value != dwg_handle_absolute (&obj->as.entity.subentity, obj->handle.value))
+            continue;
+          block_add (cache, &g->buf, obj, depth);
+        }
+    }
+  g->state = BLOCK_DONE;
+  cache->num_blocks++;
+  cache->num_vertices += g->buf.num_vertices;
+  return (&g->buf);
+}
+
+/*------------------------------------------------------------------------------
+ * Public functions
+ */
+
+/** Creates an empty block cache for the insertions of a drawing, whose blocks
+ * will be tessellated no farther than tolerance from their curves. It holds
+ * until dwg_block_cache_free, which is due before dwg_free.
+ * Returns NULL if there is not enough memory.
+ */
+Dwg_Block_Cache *
+dwg_block_cache_new (Dwg_Struct * dwg, double tolerance)
+{
+  Dwg_Block_Cache *cache;
+
+  if (dwg == NULL || !(tolerance > 0))
+    return (NULL);
+  cache = (Dwg_Block_Cache *) calloc (1, sizeof (Dwg_Block_Cache));
+  if (cache == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the block cache.\n");
+      return (NULL);
+    }
+  cache->block = (struct _dwg_block_geometry **) calloc (dwg->num_objects + 1,
+                                                          sizeof (struct _dwg_block_geometry *));
+  if (cache->block == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the block cache.\n");
+      free (cache);
+      return (NULL);
+    }
+  cache->dwg = dwg;
+  cache->tolerance = tolerance;
+  return (cache);
+}
+
+/** Tessellates into a cache all the blocks inserted in its drawing (by the
+ * INSERT and MINSERT entities, wherever they are). Afterwards dwg_explode and
+ * dwg_explode_type only read the cache, which may then be shared by threads.
+ * Returns a fail status (0 == OK; -1 == FAIL, not enough memory).
+ */
+int
+dwg_block_cache_fill (Dwg_Block_Cache * cache)
+{
+  static const uint32_t type[2] = { DWG_TYPE_INSERT, DWG_TYPE_MINSERT };
+  Dwg_Struct *dwg;
+  Dwg_Object *obj, *blk;
+  uint32_t *indexes;
+  uint32_t i, num;
+  int t, fail = 0;
+
+  if (cache == NULL)
+    return (-1);
+  dwg = cache->dwg;
+  for (t = 0; t < 2; t++)
+    {
+      num = dwg_entities_by_type (dwg, type[t], &indexes);
+      for (i = 0; i < num; i++)
+        {
+          obj = &dwg->object[indexes[i]];
+          if (obj->type == DWG_TYPE_INSERT)
+            blk = explode_handle (obj, &obj->as.entity.as.INSERT.block_header);
+          else
+            blk = explode_handle (obj, &obj->as.entity.as.MINSERT.block_header);
+          if (blk == NULL || blk->type != DWG_TYPE_BLOCK_HEADER)
+            continue;
+          if (block_geometry (cache, blk, 1) == NULL)
+            fail = -1;
+        }
+    }
+  return (fail);
+}
+
+/** Frees a block cache with the geometry of its blocks.
+ */
+void
+dwg_block_cache_free (Dwg_Block_Cache * cache)
+{
+  Dwg_Block_Geometry *g;
+  uint32_t i;
+
+  if (cache == NULL)
+    return;
+  for (i = 0; i < cache->dwg->num_objects; i++)
+    {
+      g = cache->block[i];
+      if (g == NULL)
+        continue;
+      free (g->buf.vertex);
+      free (g->buf.start);
+      free (g->buf.object);
+      free (g);
+    }
+  free (cache->block);
+  free (cache);
+}
+
+/** Explodes a block insertion (INSERT, or MINSERT with all its instances)
+ * into polylines added to buf, in world coordinates: those of the curves
+ * (as dwg_tessellate), lines and 3D polylines of the block and of the blocks
+ * it inserts, each coming from the object of the block it was made of. The
+ * block is taken from the cache, or tessellated into it.
+ * Returns 0 == OK; 1 == no room left in buf, which is unchanged; -1 == FAIL
+ * (not an insertion, or a block not found).
+ */
+int
+dwg_explode (Dwg_Object * obj, Dwg_Block_Cache * cache, Dwg_Tess_Buffer * buf)
+{
+  if (obj == NULL || cache == NULL || buf == NULL || obj->parent != cache->dwg)
+    return (-1);
+  if (obj->type != DWG_TYPE_INSERT && obj->type != DWG_TYPE_MINSERT)
+    return (-1);
+  return (explode_insert (cache, obj, buf, 0, 0));
+}
+
+/** Explodes the insertions of one type (DWG_TYPE_INSERT or DWG_TYPE_MINSERT)
+ * into buf, as dwg_explode, from the entity of rank *next in the type until
+ * buf is full, as dwg_tessellate_type does.
+ * Returns the number of insertions done.
+ */
+uint32_t
+dwg_explode_type (Dwg_Struct * dwg, uint32_t type, Dwg_Block_Cache * cache, uint32_t * next,
+                  Dwg_Tess_Buffer * buf)
+{
+  uint32_t *indexes;
+  uint32_t num, done;
+
+  if (dwg == NULL || cache == NULL || next == NULL || buf == NULL || cache->dwg != dwg)
+    return (0);
+  if (type != DWG_TYPE_INSERT && type != DWG_TYPE_MINSERT)
+    return (0);
+  num = dwg_entities_by_type (dwg, type, &indexes);
+
+  done = 0;
+  for (; *next < num; (*next)++, done++)
+    {
+      if (explode_insert (cache, &dwg->object[indexes[*next]], buf, 0, 0) != 1)
+        continue;
+      if (buf->num_vertices > 0 || buf->num_polylines > 0)
+        break;
+      LOG_INFO ("Insertion too big for the explosion buffer, skipped.\n");
+    }
+  return (done);
+}
@@ -0,0 +1,306 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       geometry.c
+ *     \brief      Geometry of the common entity types, in columns
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Objects are big, and the few coordinates of a line or a circle are spread
+ * among their other fields. Here the geometry of each common type is copied
+ * once, from the type index, into one column of doubles per field, so that
+ * a pass over the lines (say) reads nothing else. Every column starts on 64
+ * bytes, for aligned vector loads, and all of them are in one allocation.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dwg.h"
+#include "logging.h"
+
+#define GEOMETRY_ALIGN 64
+
+/** Places a column of size bytes at *offset from base, the next column going
+ * on the next 64 bytes. Returns the column, or NULL if base is NULL (the
+ * layout is then only measured).
+ */
+static void *
+geometry_column (char *base, size_t * offset, size_t size)
+{
+  void *col;
+
+  col = base ? base + *offset : NULL;
+  *offset += (size + GEOMETRY_ALIGN - 1) & ~(size_t) (GEOMETRY_ALIGN - 1);
+  return (col);
+}
+
+#define COLUMN(col, type, num) \
+  col = (type *) geometry_column (base, &offset, (num) * sizeof (type))
+
+static void
+geometry_layout_arc (Dwg_Geometry_Arc * arc, char *base, size_t * offset_p)
+{
+  size_t offset = *offset_p;
+
+  COLUMN (arc->object, uint32_t, arc->num);
+  COLUMN (arc->center_x, double, arc->num);
+  COLUMN (arc->center_y, double, arc->num);
+  COLUMN (arc->center_z, double, arc->num);
+  COLUMN (arc->radius, double, arc->num);
+  COLUMN (arc->start_angle, double, arc->num);
+  COLUMN (arc->end_angle, double, arc->num);
+  COLUMN (arc->normal_x, double, arc->num);
+  COLUMN (arc->normal_y, double, arc->num);
+  COLUMN (arc->normal_z, double, arc->num);
+  *offset_p = offset;
+}
+
+/** Sets the columns of geo from base, given the number of entries of each
+ * type. Returns the size of all the columns.
+ */
+static size_t
+geometry_layout (Dwg_Geometry * geo, char *base)
+{
+  Dwg_Geometry_Line *line = &geo->line;
+  Dwg_Geometry_Point *point = &geo->point;
+  Dwg_Geometry_Lwpline *lw = &geo->lwpline;
+  size_t offset = 0;
+
+  COLUMN (line->object, uint32_t, line->num);
+  COLUMN (line->start_x, double, line->num);
+  COLUMN (line->start_y, double, line->num);
+  COLUMN (line->start_z, double, line->num);
+  COLUMN (line->end_x, double, line->num);
+  COLUMN (line->end_y, double, line->num);
+  COLUMN (line->end_z, double, line->num);
+
+  geometry_layout_arc (&geo->circle, base, &offset);
+  geometry_layout_arc (&geo->arc, base, &offset);
+
+  COLUMN (point->object, uint32_t, point->num);
+  COLUMN (point->x, double, point->num);
+  COLUMN (point->y, double, point->num);
+  COLUMN (point->z, double, point->num);
+
+  COLUMN (lw->object, uint32_t, lw->num);
+  COLUMN (lw->first, uint32_t, lw->num + 1);
+  COLUMN (lw->flags, uint32_t, lw->num);
+  COLUMN (lw->elevation, double, lw->num);
+  COLUMN (lw->normal_x, double, lw->num);
+  COLUMN (lw->normal_y, double, lw->num);
+  COLUMN (lw->normal_z, double, lw->num);
+  COLUMN (lw->x, double, lw->num_vertices);
+  COLUMN (lw->y, double, lw->num_vertices);
+  COLUMN (lw->bulge, double, lw->num_vertices);
+  return (offset);
+}
+
+/** Copies the CIRCLE or ARC entities of indexes to arc */
+static void
+geometry_fill_arc (Dwg_Struct * dwg, Dwg_Geometry_Arc * arc, uint32_t * indexes, int circle)
+{
+  Dwg_Object_Entity *ent;
+  uint32_t i;
+
+  for (i = 0; i < arc->num; i++)
+    {
+      ent = &dwg->object[indexes[i]].as.entity;
+      arc->object[i] = indexes[i];
+      if (circle)
+        {
+          Dwg_Entity_CIRCLE *e = &ent->as.CIRCLE;
+          arc->center_x[i] = e->center.x;
+          arc->center_y[i] = e->center.y;
+          arc->center_z[i] = e->center.z;
+          arc->radius[i] = e->radius;
+          arc->start_angle[i] = 0;
+          arc->end_angle[i] = 2 * M_PI;
+          arc->normal_x[i] = e->extrusion.x;
+          arc->normal_y[i] = e->extrusion.y;
+          arc->normal_z[i] = e->extrusion.z;
+        }
+      else
+        {
+          Dwg_Entity_ARC *e = &ent->as.ARC;
+          arc->center_x[i] = e->center.x;
+          arc->center_y[i] = e->center.y;
+          arc->center_z[i] = e->center.z;
+          arc->radius[i] = e->radius;
+          arc->start_angle[i] = e->start_angle;
+          arc->end_angle[i] = e->end_angle;
+          arc->normal_x[i] = e->extrusion.x;
+          arc->normal_y[i] = e->extrusion.y;
+          arc->normal_z[i] = e->extrusion.z;
+        }
+    }
+}
+
+/** Copies the LWPLINE entities of indexes to lw, from polyline lw->num and
+ * vertex lw->num_vertices on.
+ */
+static void
+geometry_fill_lwpline (Dwg_Struct * dwg, Dwg_Geometry_Lwpline * lw, uint32_t * indexes, uint32_t num)
+{
+  Dwg_Entity_LWPLINE *e;
+  uint32_t i, j, n;
+
+  for (i = 0; i < num; i++)
+    {
+      e = &dwg->object[indexes[i]].as.entity.as.LWPLINE;
+      n = lw->num;
+      lw->object[n] = indexes[i];
+      lw->first[n] = lw->num_vertices;
+      lw->flags[n] = e->flags;
+      lw->elevation[n] = e->elevation;
+      lw->normal_x[n] = e->normal.x;
+      lw->normal_y[n] = e->normal.y;
+      lw->normal_z[n] = e->normal.z;
+      for (j = 0; e->points && j < e->num_points; j++)
+        {
+          lw->x[lw->num_vertices] = e->points[j].x;
+          lw->y[lw->num_vertices] = e->points[j].y;
+          lw->bulge[lw->num_vertices] = e->bulges && j < e->num_bulges ? e->bulges[j] : 0;
+          lw->num_vertices++;
+        }
+      lw->num++;
+    }
+  lw->first[lw->num] = lw->num_vertices;
+}
+
+/** Is a type an LWPLINE, fixed or variable? */
+static int
+geometry_is_lwpline (Dwg_Struct * dwg, uint32_t type)
+{
+  if (type == DWG_TYPE_LWPLINE)
+    return (1);
+  return (type >= 500 && type - 500 < dwg->num_classes
+          && dwg->dwg_class[type - 500].vartype == DWG_CLASS_LWPLINE);
+}
+
+/** Packs the geometry of the LINE, CIRCLE, ARC, POINT and LWPLINE entities of
+ * a drawing (all of them, in model space, paper space or blocks) into
+ * columns, by type in index order, with the object index of each entry. The
+ * columns are a copy: they don't follow later changes to the objects, but
+ * they hold until dwg_geometry_free, even after dwg_free.
+ * Returns NULL if there is not enough memory.
+ */
+Dwg_Geometry *
+dwg_geometry_new (Dwg_Struct * dwg)
+{
+  Dwg_Geometry *geo;
+  Dwg_Entity_LINE *line;
+  Dwg_Entity_POINT *point;
+  uint32_t *indexes, *lines, *circles, *arcs, *points;
+  uint32_t i, j, n, type, num, num_vertices;
+  char *base;
+  char tmp[1024];
+
+  if (dwg == NULL)
+    return (NULL);
+  geo = (Dwg_Geometry *) calloc (1, sizeof (Dwg_Geometry));
+  if (geo == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the geometry columns.\n");
+      return (NULL);
+    }
+
+  /* Sizes, from the type index */
+  geo->line.num = dwg_entities_by_type (dwg, DWG_TYPE_LINE, &lines);
+  geo->circle.num = dwg_entities_by_type (dwg, DWG_TYPE_CIRCLE, &circles);
+  geo->arc.num = dwg_entities_by_type (dwg, DWG_TYPE_ARC, &arcs);
+  geo->point.num = dwg_entities_by_type (dwg, DWG_TYPE_POINT, &points);
+  num = num_vertices = 0;
+  for (type = 0; type < dwg->num_types; type++)
+    {
+      if (!geometry_is_lwpline (dwg, type))
+        continue;
+      n = dwg_entities_by_type (dwg, type, &indexes);
+      for (j = 0; j < n; j++)
+        {
+          Dwg_Entity_LWPLINE *e = &dwg->object[indexes[j]].as.entity.as.LWPLINE;
+          if (e->points)
+            num_vertices += e->num_points;
+        }
+      num += n;
+    }
+  geo->lwpline.num = num;
+  geo->lwpline.num_vertices = num_vertices;
+
+  /* One block for all the columns, aligned */
+  geo->size = geometry_layout (geo, NULL);
+  geo->block = malloc (geo->size + GEOMETRY_ALIGN);
+  if (geo->block == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the geometry columns.\n");
+      free (geo);
+      return (NULL);
+    }
+  base = (char *) (((uintptr_t) geo->block + GEOMETRY_ALIGN - 1) & ~(uintptr_t) (GEOMETRY_ALIGN - 1));
+  geometry_layout (geo, base);
+
+  for (i = 0; i < geo->line.num; i++)
+    {
+      line = &dwg->object[lines[i]].as.entity.as.LINE;
+      geo->line.object[i] = lines[i];
+      geo->line.start_x[i] = line->start.x;
+      geo->line.start_y[i] = line->start.y;
+      geo->line.start_z[i] = line->start.z;
+      geo->line.end_x[i] = line->end.x;
+      geo->line.end_y[i] = line->end.y;
+      geo->line.end_z[i] = line->end.z;
+    }
+  geometry_fill_arc (dwg, &geo->circle, circles, 1);
+  geometry_fill_arc (dwg, &geo->arc, arcs, 0);
+  for (i = 0; i < geo->point.num; i++)
+    {
+      point = &dwg->object[points[i]].as.entity.as.POINT;
+      geo->point.object[i] = points[i];
+      geo->point.x[i] = point->x;
+      geo->point.y[i] = point->y;
+      geo->point.z[i] = point->z;
+    }
+  geo->lwpline.num = geo->lwpline.num_vertices = 0;
+  geo->lwpline.first[0] = 0;
+  for (type = 0; type < dwg->num_types; type++)
+    {
+      if (!geometry_is_lwpline (dwg, type))
+        continue;
+      n = dwg_entities_by_type (dwg, type, &indexes);
+      geometry_fill_lwpline (dwg, &geo->lwpline, indexes, n);
+    }
+
+  snprintf (tmp, 1024, "Geometry columns: %lu lines, %lu circles, %lu arcs, %lu points, "
+            "%lu polylines (%lu vertices), %lu bytes\n", (unsigned long) geo->line.num,
+            (unsigned long) geo->circle.num, (unsigned long) geo->arc.num,
+            (unsigned long) geo->point.num, (unsigned long) geo->lwpline.num,
+            (unsigned long) geo->lwpline.num_vertices, (unsigned long) geo->size);
+  LOG_INFO (tmp);
+  return (geo);
+}
+
+/** Frees the geometry columns made by dwg_geometry_new.
+ */
+void
+dwg_geometry_free (Dwg_Geometry * geo)
+{
+  if (geo == NULL)
+    return;
+  free (geo->block);
+  free (geo);
+}
@@ -0,0 +1,238 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       intern.c
+ *     \brief      Interning of the strings of a drawing
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Names of layers, linetypes, styles, blocks and classes repeat a lot, in a
+ * drawing and from one drawing to the next. When interned, each distinct
+ * string is stored once in a pool, which may be shared by several drawings
+ * (though not by threads), and two interned strings are equal if and only if
+ * they are the same pointer. The pool is an open addressing hash table of the
+ * strings themselves, kept at most half full.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dwg.h"
+#include "logging.h"
+
+#define POOL_MIN_SIZE 256
+
+/** FNV-1a hash of a string, also giving its length */
+static uint32_t
+pool_hash (const uint8_t * str, uint32_t * length)
+{
+  uint32_t h = 2166136261u;
+  const uint8_t *p;
+
+  for (p = str; *p; p++)
+    h = (h ^ *p) * 16777619u;
+  *length = p - str;
+  return (h);
+}
+
+/** Finds the slot of a string, or the empty slot where it would go */
+static uint32_t
+pool_find (Dwg_String_Pool * pool, const uint8_t * str, uint32_t h)
+{
+  uint32_t i, mask;
+
+  mask = pool->size - 1;
+  for (i = h & mask; pool->slot[i]; i = (i + 1) & mask)
+    if (pool->hash[i] == h && !strcmp ((char *) pool->slot[i], (char *) str))
+      break;
+  return (i);
+}
+
+/** Doubles the slots of a pool.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+pool_grow (Dwg_String_Pool * pool)
+{
+  uint8_t **slot;
+  uint32_t *hash;
+  uint32_t i, j, size, mask;
+
+  size = pool->size ? pool->size * 2 : POOL_MIN_SIZE;
+  slot = (uint8_t **) calloc (size, sizeof (uint8_t *));
+  hash = (uint32_t *) malloc (size * sizeof (uint32_t));
+  if (slot == NULL || hash == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the string pool.\n");
+      if (slot)
+        free (slot);
+      if (hash)
+        free (hash);
+      return (-1);
+    }
+
+  mask = size - 1;
+  for (i = 0; i < pool->size; i++)
+    {
+      if (pool->slot[i] == NULL)
+        continue;
+      for (j = pool->hash[i] & mask; slot[j]; j = (j + 1) & mask)
+        ;
+      slot[j] = pool->slot[i];
+      hash[j] = pool->hash[i];
+    }
+  if (pool->slot)
+    free (pool->slot);
+  if (pool->hash)
+    free (pool->hash);
+  pool->slot = slot;
+  pool->hash = hash;
+  pool->size = size;
+  return (0);
+}
+
+/** Adds a string, not there yet, to a pool.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+pool_insert (Dwg_String_Pool * pool, uint8_t * str, uint32_t h, uint32_t length)
+{
+  uint32_t i;
+
+  if (2 * (pool->num_strings + 1) > pool->size && pool_grow (pool))
+    return (-1);
+  i = pool_find (pool, str, h);
+  pool->slot[i] = str;
+  pool->hash[i] = h;
+  pool->num_strings++;
+  pool->bytes += length + 1;
+  return (0);
+}
+
+/** Creates an empty string pool, to be given to dwg_read_file_interned for
+ * sharing it between drawings, and freed by dwg_string_pool_free after them.
+ * Returns NULL if there is not enough memory.
+ */
+Dwg_String_Pool *
+dwg_string_pool_new (void)
+{
+  Dwg_String_Pool *pool;
+
+  pool = (Dwg_String_Pool *) calloc (1, sizeof (Dwg_String_Pool));
+  if (pool == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the string pool.\n");
+      return (NULL);
+    }
+  if (pool_grow (pool))
+    {
+      free (pool);
+      return (NULL);
+    }
+  return (pool);
+}
+
+/** Frees a string pool with all its strings.
+ */
+void
+dwg_string_pool_free (Dwg_String_Pool * pool)
+{
+  uint32_t i;
+
+  if (pool == NULL)
+    return;
+  for (i = 0; i < pool->size; i++)
+    if (pool->slot[i])
+      free (pool->slot[i]);
+  free (pool->slot);
+  free (pool->hash);
+  free (pool);
+}
+
+/** Interns a string allocated by malloc: the pool takes it, or frees it if
+ * the same string is there already. Returns the interned string, or str
+ * itself, not interned, if there is not enough memory.
+ */
+uint8_t *
+dwg_string_pool_adopt (Dwg_String_Pool * pool, uint8_t * str)
+{
+  uint32_t h, i, length;
+
+  if (pool == NULL || str == NULL)
+    return (str);
+
+  h = pool_hash (str, &length);
+  pool->num_refs++;
+  pool->bytes_refs += length + 1;
+  i = pool_find (pool, str, h);
+  if (pool->slot[i])
+    {
+      free (str);
+      return (pool->slot[i]);
+    }
+  pool_insert (pool, str, h, length);
+  return (str);
+}
+
+/** Finds the slot of an interned string by its pointer: str must be the very
+ * string kept by the pool, not an equal one.
+ * Returns the slot, or (uint32_t) -1 if str is not in the pool.
+ */
+uint32_t
+dwg_string_pool_slot (Dwg_String_Pool * pool, const uint8_t * str)
+{
+  uint32_t h, i, length;
+
+  if (pool == NULL || str == NULL || pool->size == 0)
+    return ((uint32_t) -1);
+  h = pool_hash (str, &length);
+  i = pool_find (pool, str, h);
+  return (pool->slot[i] == str ? i : (uint32_t) -1);
+}
+
+/** Gets the interned copy of a string, adding it to the pool if needed: a
+ * name is looked for among interned strings by comparing this pointer.
+ * Returns NULL if there is not enough memory.
+ */
+uint8_t *
+dwg_string_intern (Dwg_String_Pool * pool, const uint8_t * str)
+{
+  uint32_t h, i, length;
+  uint8_t *copy;
+
+  if (pool == NULL || str == NULL)
+    return (NULL);
+
+  h = pool_hash (str, &length);
+  i = pool_find (pool, str, h);
+  if (pool->slot[i])
+    return (pool->slot[i]);
+
+  copy = (uint8_t *) malloc (length + 1);
+  if (copy == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the string pool.\n");
+      return (NULL);
+    }
+  memcpy (copy, str, length + 1);
+  if (pool_insert (pool, copy, h, length))
+    {
+      free (copy);
+      return (NULL);
+    }
+  return (copy);
+}
@@ -26,7 +26,7 @@
 
 #include "logging.h"
 
-static int log_level = LOG_LEVEL_DEFAULT;
+static LOG_THREAD int log_level = LOG_LEVEL_DEFAULT;
 
 /** 
  * Ask for log level defined in the env var LIBDWG_LOGLEVEL,
@@ -178,7 +178,7 @@ LOG_INSANE (char *string)
 /** Messages fifo for storing the errors circularly. ********************************************
  * It is implemented here so that it will not be accessible to the user, via dwg.h.
  */
-Error_Fifo err;
+LOG_THREAD Error_Fifo dwg_error_fifo;
 
 /**
  * Clear the error fifo.
@@ -186,9 +186,9 @@ Error_Fifo err;
 void
 dwg_error_clear ()
 {
-  err.first = 0;
-  err.last = 0;
-  err.msg[0][0] = '\0';
+  dwg_error_fifo.first = 0;
+  dwg_error_fifo.last = 0;
+  dwg_error_fifo.msg[0][0] = '\0';
 }
 
 /**
@@ -197,19 +197,19 @@ dwg_error_clear ()
 void
 dwg_error_push (char *errmsg)
 {
-  if (err.msg[err.last][0] != '\0')
+  if (dwg_error_fifo.msg[dwg_error_fifo.last][0] != '\0')
     {
-      if (++err.last >= ERR_FIFO_LEVELS)
-	err.last = 0;
-      if (err.last == err.first)
+      if (++dwg_error_fifo.last >= ERR_FIFO_LEVELS)
+	dwg_error_fifo.last = 0;
+      if (dwg_error_fifo.last == dwg_error_fifo.first)
 	{
-	  if (++err.first >= ERR_FIFO_LEVELS)
-	    err.first = 0;
+	  if (++dwg_error_fifo.first >= ERR_FIFO_LEVELS)
+	    dwg_error_fifo.first = 0;
 	}
-      strcpy (err.msg[err.last], errmsg);
+      strcpy (dwg_error_fifo.msg[dwg_error_fifo.last], errmsg);
     }
   else
     {
-      strcpy (err.msg[err.last], errmsg);
+      strcpy (dwg_error_fifo.msg[dwg_error_fifo.last], errmsg);
     }
 }
@@ -49,6 +49,15 @@
 #define LOG_HANDLER fprintf
 #define LOG_OUTPUT stderr
 
+/* The log level and the error fifo are kept per thread, so that several
+ * drawings can be decoded at the same time, one per thread.
+ */
+#ifdef __GNUC__
+#  define LOG_THREAD __thread
+#else
+#  define LOG_THREAD
+#endif
+
 /** Ask for log level defined in the env var LIBDWG_LOGLEVEL
  */
 void log_level_init (void);
@@ -33,27 +33,172 @@
 #include "decode.h"
 #include "logging.h"
 
-/* Object decoding functions (auto-generated) */
-#include "auto_object.c"
+/** Reads a text string of an object as a view into the source data (see
+ * dwg_read_file_views), returned in place of the string; NULL on failure.
+ */
+static BITCODE_TV
+object_read_TV_view (Bit_Chain * dat, Dwg_Struct * dwg)
+{
+  Dwg_String_View *view;
+
+  view = dwg_string_view_new (dwg);
+  if (view == NULL || bit_read_TV_view (dat, view))
+    return (NULL);
+  return ((BITCODE_TV) view);
+}
+
+/* Object decoding functions, one set per version family (auto-generated) */
+#include "auto_object_r13.c"
+#include "auto_object_r2000.c"
+#include "auto_object_r2004.c"
 
 /* Object freeing functions (auto-generated) */
 #include "auto_object_free.c"
 
-static long res_obj = 0;
+/* Classes whose objects are decoded, by DXF name */
+static const struct
+{
+  const char *dxfname;
+  Dwg_Class_Type vartype;
+} dwg_class_names[] = {
+  {"DICTIONARYVAR", DWG_CLASS_DICTIONARYVAR},
+  {"ACDBDICTIONARYWDFLT", DWG_CLASS_DICTIONARYWDLFT},
+  {"HATCH", DWG_CLASS_HATCH},
+  {"IDBUFFER", DWG_CLASS_IDBUFFER},
+  {"IMAGE", DWG_CLASS_IMAGE},
+  {"IMAGEDEF", DWG_CLASS_IMAGEDEF},
+  {"IMAGEDEF_REACTOR", DWG_CLASS_IMAGEDEFREACTOR},
+  {"LAYER_INDEX", DWG_CLASS_LAYER_INDEX},
+  {"LAYOUT", DWG_CLASS_LAYOUT},
+  {"LWPLINE", DWG_CLASS_LWPLINE},
+  {"OLE2FRAME", DWG_CLASS_OLE2FRAME},
+  {"ACDBPLACEHOLDER", DWG_CLASS_PLACEHOLDER},
+  {"RASTERVARIABLES", DWG_CLASS_RASTERVARIABLES},
+  {"SORTENTSTABLE", DWG_CLASS_SORTENTSTABLE},
+  {"SPATIAL_FILTER", DWG_CLASS_SPATIAL_FILTER},
+  {"SPATIAL_INDEX", DWG_CLASS_SPATIAL_INDEX},
+  {"XRECORD", DWG_CLASS_XRECORD},
+  {"WIPEOUT", DWG_CLASS_WIPEOUT},
+  {"WIPEOUTVARIABLES", DWG_CLASS_WIPEOUTVARIABLES},
+  {"WIPEOUTVARIABLE", DWG_CLASS_WIPEOUTVARIABLES}
+};
+
+/** Sets the type of each class of a dwg structure from its DXF name, so that
+ * objects of variable type are dispatched by it rather than by name.
+ */
 void
-dwg_objects_reset ()
+dwg_classes_init (Dwg_Struct * dwg)
 {
-  res_obj = 0;
+  uint32_t i, j;
+
+  for (i = 0; i < dwg->num_classes; i++)
+    {
+      dwg->dwg_class[i].vartype = DWG_CLASS_UNKNOWN;
+      if (dwg->dwg_class[i].dxfname == NULL)
+        continue;
+      for (j = 0; j < sizeof (dwg_class_names) / sizeof (dwg_class_names[0]); j++)
+        if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, dwg_class_names[j].dxfname))
+          {
+            dwg->dwg_class[i].vartype = dwg_class_names[j].vartype;
+            break;
+          }
+    }
 }
 
+/** Frees the data of all objects of a dwg structure, but keeps the
+ * reserved object slots (dwg->res_objects) for the next decoding.
+ */
+void
+dwg_objects_reset (Dwg_Struct * dwg)
+{
+  uint32_t i;
+
+  for (i = 0; i < dwg->num_objects; i++)
+    dwg_object_free (&dwg->object[i]);
+  if (dwg->res_objects > 0)
+    memset (dwg->object, 0, dwg->res_objects * sizeof (Dwg_Object));
+  dwg->num_objects = 0;
+}
+
+/** Reserves slots for at least num objects. Decoders call it with the number
+ * of entries of the object map, so that the objects never move while they
+ * are read; otherwise the slots grow geometrically, and the back-pointers of
+ * the objects already read follow them.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_objects_reserve (Dwg_Struct * dwg, uint32_t num)
+{
+  Dwg_Object *object;
+  uint32_t i;
+
+  if (num <= dwg->res_objects)
+    return (0);
+
+  object = (Dwg_Object *) realloc (dwg->object, num * sizeof (Dwg_Object));
+  if (object == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the objects.\n");
+      return (-1);
+    }
+  memset (object + dwg->res_objects, 0, (num - dwg->res_objects) * sizeof (Dwg_Object));
+
+  if (object != dwg->object)
+    for (i = 0; i < dwg->num_objects; i++)
+      {
+	if (object[i].supertype == DWG_SUPERTYPE_ENTITY)
+	  object[i].as.entity.parent = &object[i];
+	else if (object[i].supertype == DWG_SUPERTYPE_NONGRAPH)
+	  object[i].as.nongraph.parent = &object[i];
+      }
+  dwg->object = object;
+  dwg->res_objects = num;
+  return (0);
+}
+
+/* Type dispatch of the decoder of each version family, for the object types
+ * and the class types
+ */
+#define OBJECT_DECODE_FAMILY(family) \
+int \
+dwg_decode_##family##_object (Bit_Chain * dat, Dwg_Object * obj) \
+{ \
+  Dwg_Struct *dwg = obj->parent; \
+  int success; \
+  int32_t i; \
+ \
+  switch (obj->type) \
+    { \
+    OBJECT_CASE_SET (dwg_decode_##family##_) \
+    default: \
+      i = obj->type - 500; \
+      if (i >= dwg->num_classes || i < 0) \
+	{ \
+	  success = 0; \
+	  break; \
+	} \
+      switch (dwg->dwg_class[i].vartype) \
+	{ \
+	OBJECT_VARTYPE_CASE_SET (dwg_decode_##family##_) \
+	default: \
+	  success = 0; \
+	} \
+    } \
+  return (success); \
+}
+
+OBJECT_DECODE_FAMILY (r13)
+OBJECT_DECODE_FAMILY (r2000)
+OBJECT_DECODE_FAMILY (r2004)
+
 /** Decode object from bitchain */
 void
 dwg_object_add_from_chain (Dwg_Struct * dwg, Bit_Chain * dat, uint32_t address)
 {
   Dwg_Object *obj;
   uint32_t previous_address, object_address;
+  uint32_t num_eed, eed_size, sat_size;
   uint8_t previous_bit;
-  int32_t i;
   int success;
   char tmp[1024];
 
@@ -67,19 +212,16 @@ dwg_object_add_from_chain (Dwg_Struct * dwg, Bit_Chain * dat, uint32_t address)
 
   /* Reserve memory space for objects */
 # define OBJ_CHUNK 256
-  if (res_obj == 0)
+  if (dwg->num_objects >= dwg->res_objects)
     {
-      dwg->object = (Dwg_Object *) calloc (OBJ_CHUNK, sizeof (Dwg_Object));
-      res_obj = OBJ_CHUNK;
       snprintf (tmp, 1024, "sizeof(Dwg_Object): %lu\n", sizeof (Dwg_Object));
       LOG_MEMORY (tmp);
-    }
-  if (dwg->num_objects >= res_obj)
-    {
-      res_obj += OBJ_CHUNK;
-      dwg->object =
-	(Dwg_Object *) realloc (dwg->object, res_obj * sizeof (Dwg_Object));
-      memset (dwg->object + dwg->num_objects, 0, OBJ_CHUNK * sizeof (Dwg_Object));
+      if (dwg_objects_reserve (dwg, dwg->res_objects < OBJ_CHUNK ? OBJ_CHUNK : 2 * dwg->res_objects))
+	{
+	  dat->byte = previous_address;
+	  dat->bit = previous_bit;
+	  return;
+	}
     }
   obj = &dwg->object[dwg->num_objects];
   obj->index = dwg->num_objects;
@@ -90,28 +232,24 @@ dwg_object_add_from_chain (Dwg_Struct * dwg, Bit_Chain * dat, uint32_t address)
     bit_read_MS (dat);
 
   /* Check the type of the object */
+  num_eed = dwg->num_eed;
+  eed_size = dwg->eed_size;
+  sat_size = dwg->sat_size;
   obj->type = bit_read_BS (dat);
-  switch (obj->type)
-    {
-    /* XXX Apply same action for each object type */
-    OBJECT_CASE_SET (dwg_decode_)
-    default:
-      i = obj->type - 500;
-      if (i >= dwg->num_classes || i < 0)
-	success = 0;
-      else if (dwg->dwg_class[i].dxfname == NULL)
-	success = 0;
-      /* the same, for vartypes */
-      OBJECT_VARTYPE_ELSEIF_SET (dwg_decode_)
-      else
-        success = 0;
-    }
+  success = dwg->header.decoder->object (dat, obj);
   if (success)
     dwg->num_objects++;
-  else if (dwg->header.version <= R_2000)
+  else
     {
-      dwg_object_free (obj);
-      memset (obj, 0, sizeof (Dwg_Object));
+      /* Drop the extended and SAT data read before the failure */
+      dwg->num_eed = num_eed;
+      dwg->eed_size = eed_size;
+      dwg->sat_size = sat_size;
+      if (dwg->header.version <= R_2000)
+        {
+          dwg_object_free (obj);
+          memset (obj, 0, sizeof (Dwg_Object));
+        }
     }
 
   /* POP the previous bitchain addresses for return */
@@ -137,11 +275,17 @@ dwg_object_free (Dwg_Object * obj)
     default:
       i = obj->type - 500;
       if (i >= dwg->num_classes || i < 0)
-	success = 0;
+	{
+	  success = 0;
+	  break;
+	}
       /* XXX same for vartypes */
-      OBJECT_VARTYPE_ELSEIF_SET (dwg_free_)
-      else
-        success = 0;
+      switch (dwg->dwg_class[i].vartype)
+	{
+	OBJECT_VARTYPE_CASE_SET (dwg_free_)
+	default:
+	  success = 0;
+	}
     }
   return (success);
 }
@@ -27,12 +27,30 @@
 
 #include "dwg.h"
 
-void dwg_objects_reset (void);
+void dwg_objects_reset (Dwg_Struct *dwg);
 
 void dwg_object_add_from_chain (Dwg_Struct *dwg, Bit_Chain *dat, uint32_t address);
 
 int dwg_object_free (Dwg_Object * obj);
 
+int dwg_objects_reserve (Dwg_Struct * dwg, uint32_t num);
+
+int dwg_eed_add (Dwg_Object * obj, Dwg_Handle * app, Bit_Chain * dat, uint32_t size);
+
+void dwg_eed_free (Dwg_Struct * dwg);
+
+int dwg_sat_add (Dwg_Object * obj, Bit_Chain * dat, uint32_t size);
+
+void dwg_sat_free (Dwg_Struct * dwg);
+
+int dwg_decode_r13_object (Bit_Chain * dat, Dwg_Object * obj);
+
+int dwg_decode_r2000_object (Bit_Chain * dat, Dwg_Object * obj);
+
+int dwg_decode_r2004_object (Bit_Chain * dat, Dwg_Object * obj);
+
+void dwg_classes_init (Dwg_Struct * dwg);
+
 
 #define OBJECT_CASE_SET(action) \
       case DWG_TYPE_TEXT:\
@@ -252,44 +270,63 @@ int dwg_object_free (Dwg_Object * obj);
         success = action##LAYOUT(dat, obj);\
         break;
 
-#define OBJECT_VARTYPE_ELSEIF_SET(action) \
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "DICTIONARYVAR"))\
-	  success = action##DICTIONARYVAR (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "ACDBDICTIONARYWDFLT"))\
-	  success = action##DICTIONARYWDLFT (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "HATCH"))\
-	  success = action##HATCH (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IDBUFFER"))\
-	  success = action##IDBUFFER (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGE"))\
-	  success = action##IMAGE (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGEDEF"))\
-	success = action##IMAGEDEF (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "IMAGEDEF_REACTOR"))\
-	success = action##IMAGEDEFREACTOR (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LAYER_INDEX"))\
-	success = action##LAYER_INDEX (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LAYOUT"))\
-	success = action##LAYOUT (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "LWPLINE"))\
-	success = action##LWPLINE (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "OLE2FRAME"))\
-	success = action##OLE2FRAME (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "ACDBPLACEHOLDER"))\
-	success = action##PLACEHOLDER (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "RASTERVARIABLES"))\
-	success = action##RASTERVARIABLES (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "SORTENTSTABLE"))\
-	success = action##SORTENTSTABLE (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "SPATIAL_FILTER"))\
-	success = action##SPATIAL_FILTER (dat, obj);\
-      else if (!strcmp((const char *) dwg->dwg_class[i].dxfname, "SPATIAL_INDEX"))\
-	success = action##SPATIAL_INDEX (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "XRECORD"))\
-	success = action##XRECORD (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "WIPEOUT"))\
+#define OBJECT_VARTYPE_CASE_SET(action) \
+      case DWG_CLASS_DICTIONARYVAR:\
+        success = action##DICTIONARYVAR (dat, obj);\
+        break;\
+      case DWG_CLASS_DICTIONARYWDLFT:\
+        success = action##DICTIONARYWDLFT (dat, obj);\
+        break;\
+      case DWG_CLASS_HATCH:\
+        success = action##HATCH (dat, obj);\
+        break;\
+      case DWG_CLASS_IDBUFFER:\
+        success = action##IDBUFFER (dat, obj);\
+        break;\
+      case DWG_CLASS_IMAGE:\
         success = action##IMAGE (dat, obj);\
-      else if (!strcmp ((const char *) dwg->dwg_class[i].dxfname, "WIPEOUTVARIABLE"))\
-        success = action##WIPEOUTVARIABLES (dat, obj);
+        break;\
+      case DWG_CLASS_IMAGEDEF:\
+        success = action##IMAGEDEF (dat, obj);\
+        break;\
+      case DWG_CLASS_IMAGEDEFREACTOR:\
+        success = action##IMAGEDEFREACTOR (dat, obj);\
+        break;\
+      case DWG_CLASS_LAYER_INDEX:\
+        success = action##LAYER_INDEX (dat, obj);\
+        break;\
+      case DWG_CLASS_LAYOUT:\
+        success = action##LAYOUT (dat, obj);\
+        break;\
+      case DWG_CLASS_LWPLINE:\
+        success = action##LWPLINE (dat, obj);\
+        break;\
+      case DWG_CLASS_OLE2FRAME:\
+        success = action##OLE2FRAME (dat, obj);\
+        break;\
+      case DWG_CLASS_PLACEHOLDER:\
+        success = action##PLACEHOLDER (dat, obj);\
+        break;\
+      case DWG_CLASS_RASTERVARIABLES:\
+        success = action##RASTERVARIABLES (dat, obj);\
+        break;\
+      case DWG_CLASS_SORTENTSTABLE:\
+        success = action##SORTENTSTABLE (dat, obj);\
+        break;\
+      case DWG_CLASS_SPATIAL_FILTER:\
+        success = action##SPATIAL_FILTER (dat, obj);\
+        break;\
+      case DWG_CLASS_SPATIAL_INDEX:\
+        success = action##SPATIAL_INDEX (dat, obj);\
+        break;\
+      case DWG_CLASS_XRECORD:\
+        success = action##XRECORD (dat, obj);\
+        break;\
+      case DWG_CLASS_WIPEOUT:\
+        success = action##IMAGE (dat, obj);\
+        break;\
+      case DWG_CLASS_WIPEOUTVARIABLES:\
+        success = action##WIPEOUTVARIABLES (dat, obj);\
+        break;
 
 #endif
@@ -0,0 +1,419 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       raster.c
+ *     \brief      Software rendering of the model space into a thumbnail
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* The drawing is fitted to the image from its extents, seen from above (x
+ * and y of the world). Everything is drawn as one pixel wide segments:
+ * lines as they are, curves (arcs, circles, ellipses, splines, polylines and
+ * hatch boundaries) tessellated half a pixel close, a type at a time, into
+ * one buffer; texts as their boxes. Segments are clipped to the image, then
+ * stepped along their longer axis in 16.16 fixed point.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dwg.h"
+#include "logging.h"
+
+#define RASTER_MAX_VERTICES (1 << 16)
+#define RASTER_MAX_POLYLINES (1 << 12)
+#define RASTER_MARGIN 0.02
+
+/* Colours of the entities */
+#define COLOR_BYBLOCK 0
+#define COLOR_BYLAYER 256
+#define COLOR_DEFAULT 7
+
+/* Width of a character, for its height */
+#define TEXT_ASPECT 0.6
+
+/**
+ *    \struct  _raster_pen
+ *    \brief   Target of the drawing, with the world to pixel transform
+ */
+typedef struct _raster_pen
+{
+  Dwg_Raster *raster;
+  uint8_t *layer_color; /* by object index, RGB images only */
+  uint8_t ink[3];
+} Raster_Pen;
+
+/* The standard colours 1 to 9; the others are drawn in grey */
+static const uint8_t raster_palette[10][3] = {
+  {0, 0, 0}, {255, 0, 0}, {255, 255, 0}, {0, 255, 0}, {0, 255, 255},
+  {0, 0, 255}, {255, 0, 255}, {0, 0, 0}, {128, 128, 128}, {192, 192, 192}
+};
+
+/*------------------------------------------------------------------------------
+ * Segments
+ */
+
+/** Clips one coordinate range of a segment (Liang-Barsky): p t <= q.
+ * Returns 0 if the segment is all out.
+ */
+static int
+raster_clip (double p, double q, double *t0, double *t1)
+{
+  double t;
+
+  if (p == 0)
+    return (q >= 0);
+  t = q / p;
+  if (p < 0)
+    {
+      if (t > *t1)
+        return (0);
+      if (t > *t0)
+        *t0 = t;
+    }
+  else
+    {
+      if (t < *t0)
+        return (0);
+      if (t < *t1)
+        *t1 = t;
+    }
+  return (1);
+}
+
+/** Draws a segment between two points, in pixels */
+static void
+raster_segment (Raster_Pen * pen, double x0, double y0, double x1, double y1)
+{
+  Dwg_Raster *r = pen->raster;
+  double dx = x1 - x0, dy = y1 - y0, t0 = 0, t1 = 1, xmax, ymax;
+  int32_t x, y, sx, sy;
+  uint32_t i, n;
+  uint8_t *p;
+
+  /* NaN and infinite ends (e.g. of a broken entity) pass the clipping, and
+   * would index the pixels out of the raster */
+  if (!isfinite (x0) || !isfinite (y0) || !isfinite (x1) || !isfinite (y1))
+    return;
+
+  /* Pixel i is from i - 0.5 to i + 0.5: kept a little inside */
+  xmax = r->width - 0.501;
+  ymax = r->height - 0.501;
+  if (!raster_clip (-dx, x0 + 0.499, &t0, &t1) || !raster_clip (dx, xmax - x0, &t0, &t1)
+      || !raster_clip (-dy, y0 + 0.499, &t0, &t1) || !raster_clip (dy, ymax - y0, &t0, &t1))
+    return;
+  x1 = x0 + t1 * dx;
+  y1 = y0 + t1 * dy;
+  x0 += t0 * dx;
+  y0 += t0 * dy;
+
+  /* At most one pixel per step along the longer axis; the steps, rounded
+   * toward 0, don't go past the end */
+  dx = x1 - x0;
+  dy = y1 - y0;
+  n = (uint32_t) (fabs (dx) > fabs (dy) ? fabs (dx) : fabs (dy)) + 1;
+  x = (int32_t) ((x0 + 0.5) * 65536);
+  y = (int32_t) ((y0 + 0.5) * 65536);
+  sx = (int32_t) (dx * 65536 / n);
+  sy = (int32_t) (dy * 65536 / n);
+  if (r->channels == 1)
+    {
+      for (i = 0; i <= n; i++, x += sx, y += sy)
+        r->pixel[(uint32_t) (y >> 16) * r->width + (uint32_t) (x >> 16)] = pen->ink[0];
+      return;
+    }
+  for (i = 0; i <= n; i++, x += sx, y += sy)
+    {
+      p = r->pixel + 3 * ((uint32_t) (y >> 16) * r->width + (uint32_t) (x >> 16));
+      p[0] = pen->ink[0];
+      p[1] = pen->ink[1];
+      p[2] = pen->ink[2];
+    }
+}
+
+/** Draws a segment between two points of the world */
+static void
+raster_world_segment (Raster_Pen * pen, double x0, double y0, double x1, double y1)
+{
+  Dwg_Raster *r = pen->raster;
+
+  raster_segment (pen, (x0 - r->origin_x) * r->scale, (r->origin_y - y0) * r->scale,
+                  (x1 - r->origin_x) * r->scale, (r->origin_y - y1) * r->scale);
+}
+
+/** Sets the ink to the colour of an entity */
+static void
+raster_ink (Raster_Pen * pen, Dwg_Object * obj)
+{
+  uint32_t color;
+
+  if (pen->raster->channels == 1)
+    return;
+  color = obj->as.entity.color.index;
+  if (color == COLOR_BYLAYER)
+    color = pen->layer_color[obj->index];
+  if (color == COLOR_BYBLOCK)
+    color = COLOR_DEFAULT;
+  if (color > 9)
+    color = 8;
+  memcpy (pen->ink, raster_palette[color], 3);
+}
+
+/*------------------------------------------------------------------------------
+ * Entities
+ */
+
+/** Draws the polylines of a tessellation buffer */
+static void
+raster_polylines (Raster_Pen * pen, Dwg_Struct * dwg, Dwg_Tess_Buffer * buf)
+{
+  Dwg_Object *obj;
+  double *v;
+  uint32_t i, j, end;
+
+  for (i = 0; i < buf->num_polylines; i++)
+    {
+      obj = &dwg->object[buf->object[i]];
+      if (obj->as.entity.entity_mode != 2)
+        continue;
+      raster_ink (pen, obj);
+      end = i + 1 < buf->num_polylines ? buf->start[i + 1] : buf->num_vertices;
+      for (j = buf->start[i]; j + 1 < end; j++)
+        {
+          v = buf->vertex + 3 * j;
+          raster_world_segment (pen, v[0], v[1], v[3], v[4]);
+        }
+    }
+}
+
+/** Draws a box of width w and height h, whose point (ax, ay) in the box (from
+ * its bottom left corner, along its axis (ux, uy)) is at (x, y).
+ */
+static void
+raster_box (Raster_Pen * pen, double x, double y, double ux, double uy, double w, double h,
+            double ax, double ay)
+{
+  double cx[4], cy[4], a[4] = { 0, 1, 1, 0 }, b[4] = { 0, 0, 1, 1 };
+  int k;
+
+  for (k = 0; k < 4; k++)
+    {
+      cx[k] = x + (a[k] * w - ax) * ux - (b[k] * h - ay) * uy;
+      cy[k] = y + (a[k] * w - ax) * uy + (b[k] * h - ay) * ux;
+    }
+  for (k = 0; k < 4; k++)
+    raster_world_segment (pen, cx[k], cy[k], cx[(k + 1) % 4], cy[(k + 1) % 4]);
+}
+
+/** Draws the boxes of the TEXT and MTEXT entities */
+static void
+raster_texts (Raster_Pen * pen, Dwg_Struct * dwg)
+{
+  Dwg_Object *obj;
+  uint32_t *indexes;
+  uint32_t i, num;
+  double w, h, len, ux, uy, col, row;
+  int length;
+
+  num = dwg_entities_by_type (dwg, DWG_TYPE_TEXT, &indexes);
+  for (i = 0; i < num; i++)
+    {
+      Dwg_Entity_TEXT *e = &dwg->object[indexes[i]].as.entity.as.TEXT;
+      obj = &dwg->object[indexes[i]];
+      if (obj->as.entity.entity_mode != 2)
+        continue;
+      length = dwg_string_utf8 (dwg, e->text_value, NULL, 0);
+      if (length <= 0 || !(e->height > 0))
+        continue;
+      w = e->height * length * TEXT_ASPECT * (e->width_factor > 0 ? e->width_factor : 1);
+      raster_ink (pen, obj);
+      raster_box (pen, e->insertion_pt.x, e->insertion_pt.y, cos (e->rotation_ang),
+                  sin (e->rotation_ang), w, e->height, 0, 0);
+    }
+
+  num = dwg_entities_by_type (dwg, DWG_TYPE_MTEXT, &indexes);
+  for (i = 0; i < num; i++)
+    {
+      Dwg_Entity_MTEXT *e = &dwg->object[indexes[i]].as.entity.as.MTEXT;
+      obj = &dwg->object[indexes[i]];
+      if (obj->as.entity.entity_mode != 2)
+        continue;
+      w = e->extends_wid > 0 ? e->extends_wid : e->rect_width;
+      h = e->extends_ht > 0 ? e->extends_ht : e->text_height;
+      len = sqrt (e->x_axis_dir.x * e->x_axis_dir.x + e->x_axis_dir.y * e->x_axis_dir.y);
+      if (!(w > 0) || !(h > 0))
+        continue;
+      ux = len > 0 ? e->x_axis_dir.x / len : 1;
+      uy = len > 0 ? e->x_axis_dir.y / len : 0;
+
+      /* Attachment 1 to 9: top left, center, right, then middle, bottom */
+      col = e->attachment >= 1 && e->attachment <= 9 ? (e->attachment - 1) % 3 : 0;
+      row = e->attachment >= 1 && e->attachment <= 9 ? (e->attachment - 1) / 3 : 0;
+      raster_ink (pen, obj);
+      raster_box (pen, e->insertion_pt.x, e->insertion_pt.y, ux, uy, w, h, col * w / 2,
+                  (2 - row) * h / 2);
+    }
+}
+
+/** Is a type drawn through the tessellation? */
+static int
+raster_is_curve (Dwg_Struct * dwg, uint32_t type)
+{
+  switch (type)
+    {
+    case DWG_TYPE_ARC:
+    case DWG_TYPE_CIRCLE:
+    case DWG_TYPE_ELLIPSE:
+    case DWG_TYPE_SPLINE:
+    case DWG_TYPE_LWPLINE:
+      return (1);
+    }
+  if (type < 500 || type - 500 >= dwg->num_classes)
+    return (0);
+  return (dwg->dwg_class[type - 500].vartype == DWG_CLASS_LWPLINE
+          || dwg->dwg_class[type - 500].vartype == DWG_CLASS_HATCH);
+}
+
+/** Sets the colour of the layer of each entity, by object index */
+static uint8_t *
+raster_layer_colors (Dwg_Struct * dwg)
+{
+  uint8_t *color;
+  uint32_t *layers, *entities;
+  uint32_t i, j, num_layers, num;
+  int16_t c;
+
+  color = (uint8_t *) malloc (dwg->num_objects + 1);
+  if (color == NULL)
+    return (NULL);
+  memset (color, COLOR_DEFAULT, dwg->num_objects + 1);
+  num_layers = dwg_entities_by_type (dwg, DWG_TYPE_LAYER, &layers);
+  for (i = 0; i < num_layers; i++)
+    {
+      /* Negative when the layer is off */
+      c = (int16_t) dwg->object[layers[i]].as.nongraph.as.LAYER.color.index;
+      c = c < 0 ? -c : c;
+      num = dwg_entities_on_layer (dwg, layers[i], &entities);
+      for (j = 0; j < num; j++)
+        color[entities[j]] = c > 0 && c < 256 ? c : COLOR_DEFAULT;
+    }
+  return (color);
+}
+
+/*------------------------------------------------------------------------------
+ * Public function
+ */
+
+/** Renders the model space of a drawing into raster, whose width, height,
+ * channels (1 == grey; 3 == RGB) and pixels (rows from the top, width times
+ * channels bytes each) are given by the caller: black (or the colours of the
+ * entities) on white. The drawing is fitted from its extents, computed if
+ * they are not (see dwg_compute_extents); origin_x, origin_y (the world
+ * point at the top left corner) and scale (pixels by unit) are set.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_render (Dwg_Struct * dwg, Dwg_Raster * raster)
+{
+  Raster_Pen pen;
+  Dwg_Tess_Buffer buf;
+  Dwg_Bbox *box;
+  Dwg_Object *obj;
+  uint32_t *indexes;
+  uint32_t i, num, type, next;
+  double dx, dy, tolerance;
+
+  if (dwg == NULL || raster == NULL || raster->pixel == NULL || raster->width == 0
+      || raster->height == 0 || (raster->channels != 1 && raster->channels != 3))
+    return (-1);
+  memset (raster->pixel, 255, (size_t) raster->width * raster->height * raster->channels);
+  if (dwg->extents.min_x == NULL && dwg_compute_extents (dwg, 1))
+    return (-1);
+
+  /* Fitted, centered, with a small margin */
+  box = &dwg->extents.drawing;
+  raster->scale = 0;
+  raster->origin_x = raster->origin_y = 0;
+  if (!(box->min.x <= box->max.x) || !(box->min.y <= box->max.y))
+    return (0);
+  dx = (box->max.x - box->min.x) * (1 + 2 * RASTER_MARGIN);
+  dy = (box->max.y - box->min.y) * (1 + 2 * RASTER_MARGIN);
+  if (dx * raster->height > dy * raster->width)
+    raster->scale = dx > 0 ? raster->width / dx : 1;
+  else
+    raster->scale = dy > 0 ? raster->height / dy : 1;
+  raster->origin_x = (box->min.x + box->max.x) / 2 - raster->width / raster->scale / 2;
+  raster->origin_y = (box->min.y + box->max.y) / 2 + raster->height / raster->scale / 2;
+  tolerance = 0.5 / raster->scale;
+
+  memset (&pen, 0, sizeof (Raster_Pen));
+  pen.raster = raster;
+  if (raster->channels == 3 && (pen.layer_color = raster_layer_colors (dwg)) == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the rendering.\n");
+      return (-1);
+    }
+  buf.vertex = (double *) malloc (3 * RASTER_MAX_VERTICES * sizeof (double));
+  buf.start = (uint32_t *) malloc (RASTER_MAX_POLYLINES * sizeof (uint32_t));
+  buf.object = (uint32_t *) malloc (RASTER_MAX_POLYLINES * sizeof (uint32_t));
+  buf.max_vertices = RASTER_MAX_VERTICES;
+  buf.max_polylines = RASTER_MAX_POLYLINES;
+  if (!buf.vertex || !buf.start || !buf.object)
+    {
+      LOG_ERROR ("Not enough memory for the rendering.\n");
+      free (buf.vertex);
+      free (buf.start);
+      free (buf.object);
+      free (pen.layer_color);
+      return (-1);
+    }
+
+  num = dwg_entities_by_type (dwg, DWG_TYPE_LINE, &indexes);
+  for (i = 0; i < num; i++)
+    {
+      Dwg_Entity_LINE *e = &dwg->object[indexes[i]].as.entity.as.LINE;
+      obj = &dwg->object[indexes[i]];
+      if (obj->as.entity.entity_mode != 2)
+        continue;
+      raster_ink (&pen, obj);
+      raster_world_segment (&pen, e->start.x, e->start.y, e->end.x, e->end.y);
+    }
+
+  for (type = 0; type < dwg->num_types; type++)
+    {
+      if (!raster_is_curve (dwg, type))
+        continue;
+      next = 0;
+      num = dwg_entities_by_type (dwg, type, &indexes);
+      while (next < num)
+        {
+          buf.num_vertices = buf.num_polylines = 0;
+          if (dwg_tessellate_type (dwg, type, tolerance, &next, &buf) == 0)
+            break;
+          raster_polylines (&pen, dwg, &buf);
+        }
+    }
+
+  raster_texts (&pen, dwg);
+
+  free (buf.vertex);
+  free (buf.start);
+  free (buf.object);
+  free (pen.layer_color);
+  return (0);
+}
@@ -0,0 +1,193 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       resolve.c
+ *     \brief      Resolving handle references into object indexes
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* After dwg_handle_resolve, each handle read from the file carries the index
+ * of the object it refers to, so following a reference is an array access
+ * (see dwg_handle_object) instead of a search in the handle index. Objects
+ * only read the handle index and write their own handles, so the pass is
+ * split in ranges of objects between threads.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "dwg.h"
+#include "bits.h"
+#include "object.h"
+#include "logging.h"
+
+/** Resolves one handle, relative to the handle of its owner */
+static void
+resolve_handle (Dwg_Struct * dwg, Dwg_Handle * hd, uint32_t refhd)
+{
+  uint32_t absolute;
+
+  absolute = dwg_handle_absolute (hd, refhd);
+  if (absolute == 0)
+    hd->index = (uint32_t) -1;
+  else
+    hd->index = dwg_handle_get_index (dwg, absolute);
+}
+
+#include "auto_resolve.c"
+
+/** Resolves the handles of one object.
+ * Returns 1 if the type of the object is known (as dwg_object_free), 0 if
+ * only its common handles were resolved.
+ */
+static int
+dwg_resolve_object (Dwg_Object * obj)
+{
+  Dwg_Struct *dwg = obj->parent;
+  Bit_Chain *dat = NULL;
+  uint32_t refhd = obj->handle.value;
+  unsigned vcount;
+  int success;
+  int32_t i;
+
+  if (obj->supertype == DWG_SUPERTYPE_NONGRAPH)
+    for (vcount = 0; obj->as.nongraph.handleref && vcount < obj->as.nongraph.num_handles; vcount++)
+      resolve_handle (dwg, &obj->as.nongraph.handleref[vcount], refhd);
+
+  switch (obj->type)
+    {
+    /* XXX Apply same action for each object type */
+    OBJECT_CASE_SET (dwg_resolve_)
+    default:
+      i = obj->type - 500;
+      if (i >= dwg->num_classes || i < 0)
+	{
+	  success = 0;
+	  break;
+	}
+      /* the same, for vartypes */
+      switch (dwg->dwg_class[i].vartype)
+	{
+	OBJECT_VARTYPE_CASE_SET (dwg_resolve_)
+	default:
+	  success = 0;
+	}
+    }
+  return (success);
+}
+
+/**
+ *    \struct  _dwg_resolve_range
+ *    \brief   Range of objects resolved by one thread
+ */
+typedef struct _dwg_resolve_range
+{
+  Dwg_Struct *dwg;
+  uint32_t first;
+  uint32_t last;
+} Dwg_Resolve_Range;
+
+static void *
+dwg_resolve_thread (void *arg)
+{
+  Dwg_Resolve_Range *range = (Dwg_Resolve_Range *) arg;
+  uint32_t i;
+
+  for (i = range->first; i < range->last; i++)
+    dwg_resolve_object (&range->dwg->object[i]);
+  return (NULL);
+}
+
+/** Resolves all the handle references of a dwg structure (header variables
+ * and objects) into object indexes, using up to num_threads threads.
+ * Needs the handle index (see dwg_handle_init); dwg_read_file does not call
+ * it, as not every program follows references.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_handle_resolve (Dwg_Struct * dwg, int num_threads)
+{
+  Dwg_Resolve_Range *range;
+  pthread_t *thread;
+  uint32_t chunk;
+  int i, started;
+
+  if (dwg == NULL || (dwg->num_objects > 0 && dwg->num_handles == 0))
+    return (-1);
+
+  dwg_resolve_variables (dwg);
+
+  if (num_threads < 1)
+    num_threads = 1;
+  if ((uint32_t) num_threads > dwg->num_objects / 1024 + 1)
+    num_threads = dwg->num_objects / 1024 + 1;
+
+  range = (Dwg_Resolve_Range *) malloc (num_threads * sizeof (Dwg_Resolve_Range));
+  thread = (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+  if (range == NULL || thread == NULL)
+    {
+      LOG_ERROR ("Not enough memory for resolving the handles.\n");
+      if (range)
+        free (range);
+      if (thread)
+        free (thread);
+      return (-1);
+    }
+
+  chunk = (dwg->num_objects + num_threads - 1) / num_threads;
+  for (i = 0; i < num_threads; i++)
+    {
+      range[i].dwg = dwg;
+      range[i].first = i * chunk;
+      range[i].last = (i + 1) * chunk;
+      if (range[i].first > dwg->num_objects)
+        range[i].first = dwg->num_objects;
+      if (range[i].last > dwg->num_objects)
+        range[i].last = dwg->num_objects;
+    }
+
+  /* The first range goes in this thread, and so do the ranges whose thread
+   * can't start
+   */
+  started = 1;
+  while (started < num_threads
+         && !pthread_create (&thread[started], NULL, dwg_resolve_thread, &range[started]))
+    started++;
+  dwg_resolve_thread (&range[0]);
+  for (i = started; i < num_threads; i++)
+    dwg_resolve_thread (&range[i]);
+  for (i = 1; i < started; i++)
+    pthread_join (thread[i], NULL);
+
+  free (range);
+  free (thread);
+  return (0);
+}
+
+/** Gets the object a resolved handle refers to (see dwg_handle_resolve), or
+ * NULL if it refers to none.
+ */
+Dwg_Object *
+dwg_handle_object (Dwg_Struct * dwg, Dwg_Handle * hd)
+{
+  if (dwg == NULL || hd == NULL)
+    return (NULL);
+  if ((hd->code == 0 && hd->value == 0) || hd->index >= dwg->num_objects)
+    return (NULL);
+  return (&dwg->object[hd->index]);
+}
@@ -0,0 +1,711 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       snapshot.c
+ *     \brief      Memory mappable snapshots of decoded dwg structures
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* A snapshot is an image of the decoded Dwg_Struct and of every block it
+ * points to, laid out as it would be in memory at a preferred base address.
+ * The offsets of all the pointers in the image are kept in a relocation
+ * table at its end. Opening a snapshot maps the file at the preferred base;
+ * if the system places the mapping elsewhere, the pointers are moved by the
+ * difference. In both cases the drawing is used directly, with no decoding.
+ *
+ * The image depends on the layout of the structures in dwg.h, so snapshots
+ * are only portable between builds of the same library version.
+ *
+ * The string pool of an interned drawing is not part of the snapshot, but
+ * each of its strings is copied once, however many fields point to it, so
+ * that equal strings of the snapshot are still the same pointer.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dwg.h"
+#include "bits.h"
+#include "object.h"
+#include "logging.h"
+
+#define SNAPSHOT_MAGIC "LibDWG snapshot"
+#define SNAPSHOT_FORMAT 1
+#define SNAPSHOT_ALIGN 8
+
+/**
+ *    \struct  _dwg_snapshot_header
+ *    \brief   First bytes of a snapshot file
+ */
+typedef struct _dwg_snapshot_header
+{
+  char magic[16];
+  uint32_t format;
+  uint16_t sizeof_pointer;
+  uint16_t unused;
+  uint32_t sizeof_struct;
+  uint32_t sizeof_object;
+  uint64_t base;
+  uint64_t size;
+  uint64_t dwg_offset;
+  uint64_t reloc_offset;
+  uint64_t num_relocs;
+} Dwg_Snapshot_Header;
+
+/**
+ *    \struct  _dwg_snapshot_block
+ *    \brief   Memory block copied into the snapshot image
+ */
+typedef struct _dwg_snapshot_block
+{
+  void *src;
+  uint64_t size;
+  uint64_t offset;
+} Dwg_Snapshot_Block;
+
+/**
+ *    \struct  _dwg_snapshot_writer
+ *    \brief   Snapshot image being built
+ */
+typedef struct _dwg_snapshot_writer
+{
+  uint8_t *buf;
+  uint64_t size;
+  uint64_t res_size;
+  uintptr_t base;
+
+  uint64_t *reloc;
+  uint64_t num_relocs;
+  uint64_t res_relocs;
+
+  /* Blocks which may have pointers inside */
+  Dwg_Snapshot_Block *block;
+  uint32_t num_blocks;
+  uint32_t res_blocks;
+
+  /* Offsets of the interned strings copied so far, by pool slot (0 if not
+   * copied yet), when the drawing is interned */
+  Dwg_String_Pool *pool;
+  uint64_t *pool_offset;
+
+  int fail;
+} Dwg_Snapshot_Writer;
+
+/** Preferred address of the mapping. It varies with the source file, so that
+ * several snapshots opened at once can all be mapped without relocation.
+ */
+static uintptr_t
+snapshot_base (uint32_t crc)
+{
+#if UINTPTR_MAX > 0xFFFFFFFF
+  return ((uintptr_t) 0x200000000000 + ((uintptr_t) (crc & 0xFFFF) << 28));
+#else
+  return ((uintptr_t) 0x40000000);
+#endif
+}
+
+/** Computes the CRC of a whole file, which must be size bytes long.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+snapshot_file_crc (char *filename, uint64_t size, uint32_t * crc)
+{
+  uint8_t *chain;
+  size_t done;
+  FILE *fp;
+
+  fp = fopen (filename, "rb");
+  if (!fp)
+    return (-1);
+  chain = (uint8_t *) malloc (size > 0 ? size : 1);
+  if (!chain)
+    {
+      fclose (fp);
+      return (-1);
+    }
+  done = fread (chain, 1, size, fp);
+  fclose (fp);
+  *crc = bit_crc32_long (0, chain, done);
+  free (chain);
+  return (done == size ? 0 : -1);
+}
+
+/** Reserves size bytes at the end of the image. Returns their offset, or -1.
+ */
+static uint64_t
+snapshot_alloc (Dwg_Snapshot_Writer * w, uint64_t size)
+{
+  uint64_t offset;
+  uint8_t *buf;
+
+  offset = (w->size + SNAPSHOT_ALIGN - 1) & ~((uint64_t) SNAPSHOT_ALIGN - 1);
+  if (offset + size > w->res_size)
+    {
+      uint64_t res = w->res_size ? w->res_size : 65536;
+      while (offset + size > res)
+        res *= 2;
+      buf = (uint8_t *) realloc (w->buf, res);
+      if (buf == NULL)
+        {
+          LOG_ERROR ("Not enough memory for the snapshot.\n");
+          w->fail = 1;
+          return ((uint64_t) -1);
+        }
+      memset (buf + w->res_size, 0, res - w->res_size);
+      w->buf = buf;
+      w->res_size = res;
+    }
+  w->size = offset + size;
+  return (offset);
+}
+
+/** Offset in the image of an address inside a copied block, or -1 */
+static uint64_t
+snapshot_locate (Dwg_Snapshot_Writer * w, void *addr)
+{
+  uint32_t i;
+  uint8_t *p = (uint8_t *) addr;
+
+  for (i = w->num_blocks; i > 0; i--)
+    {
+      Dwg_Snapshot_Block *b = &w->block[i - 1];
+      if (p >= (uint8_t *) b->src && p < (uint8_t *) b->src + b->size)
+        return (b->offset + (p - (uint8_t *) b->src));
+    }
+  return ((uint64_t) -1);
+}
+
+static void
+snapshot_block_add (Dwg_Snapshot_Writer * w, void *src, uint64_t size, uint64_t offset)
+{
+  if (w->num_blocks >= w->res_blocks)
+    {
+      w->res_blocks = w->res_blocks ? 2 * w->res_blocks : 64;
+      w->block = (Dwg_Snapshot_Block *) realloc (w->block, w->res_blocks * sizeof (Dwg_Snapshot_Block));
+    }
+  w->block[w->num_blocks].src = src;
+  w->block[w->num_blocks].size = size;
+  w->block[w->num_blocks].offset = offset;
+  w->num_blocks++;
+}
+
+/** Makes the pointer at position pos of the image point to target */
+static void
+snapshot_reloc (Dwg_Snapshot_Writer * w, uint64_t pos, uint64_t target)
+{
+  uintptr_t value;
+
+  if (w->num_relocs >= w->res_relocs)
+    {
+      w->res_relocs = w->res_relocs ? 2 * w->res_relocs : 1024;
+      w->reloc = (uint64_t *) realloc (w->reloc, w->res_relocs * sizeof (uint64_t));
+    }
+  w->reloc[w->num_relocs++] = pos;
+  value = w->base + target;
+  memcpy (w->buf + pos, &value, sizeof (uintptr_t));
+}
+
+/** Position in the image of a pointer field (address of the original one) */
+static uint64_t
+snapshot_field (Dwg_Snapshot_Writer * w, void *field)
+{
+  uint64_t pos;
+  char tmp[1024];
+
+  pos = snapshot_locate (w, field);
+  if (pos == (uint64_t) -1)
+    {
+      snprintf (tmp, 1024, "Pointer field %p is outside the snapshot.\n", field);
+      LOG_ERROR (tmp);
+      w->fail = 1;
+    }
+  return (pos);
+}
+
+/** Copies the block pointed to by a pointer field into the image, and
+ * relocates the field. If container is set, the block may hold pointers
+ * which are copied later.
+ */
+static void
+snapshot_pointer (Dwg_Snapshot_Writer * w, void *field, uint64_t size, int container)
+{
+  void *src;
+  uintptr_t value;
+  uint64_t pos, offset;
+  uint32_t slot;
+
+  memcpy (&src, field, sizeof (void *));
+  if (w->fail || src == NULL)
+    return;
+
+  pos = snapshot_field (w, field);
+  if (pos == (uint64_t) -1)
+    return;
+
+  /* Blocks walked twice by the specs (e.g. TABLE cells) are copied once */
+  memcpy (&value, w->buf + pos, sizeof (uintptr_t));
+  if (value != (uintptr_t) src)
+    return;
+
+  /* And interned strings, once for all their fields */
+  slot = container ? (uint32_t) -1
+    : dwg_string_pool_slot (w->pool, (uint8_t *) src);
+  if (slot != (uint32_t) -1 && w->pool_offset[slot])
+    {
+      snapshot_reloc (w, pos, w->pool_offset[slot]);
+      return;
+    }
+
+  offset = snapshot_alloc (w, size);
+  if (offset == (uint64_t) -1)
+    return;
+  memcpy (w->buf + offset, src, size);
+  if (container)
+    snapshot_block_add (w, src, size, offset);
+  if (slot != (uint32_t) -1)
+    w->pool_offset[slot] = offset;
+  snapshot_reloc (w, pos, offset);
+}
+
+/** Relocates a pointer field to a given position of the image */
+static void
+snapshot_link (Dwg_Snapshot_Writer * w, void *field, uint64_t target)
+{
+  uint64_t pos;
+
+  if (w->fail)
+    return;
+  pos = snapshot_field (w, field);
+  if (pos != (uint64_t) -1)
+    snapshot_reloc (w, pos, target);
+}
+
+/** Clears a pointer field which is not kept in the snapshot */
+static void
+snapshot_null (Dwg_Snapshot_Writer * w, void *field)
+{
+  uint64_t pos;
+
+  if (w->fail)
+    return;
+  pos = snapshot_field (w, field);
+  if (pos != (uint64_t) -1)
+    memset (w->buf + pos, 0, sizeof (void *));
+}
+
+/* Object and variables copying functions (auto-generated) */
+#include "auto_snapshot.c"
+
+static void
+snapshot_wires (Dwg_Snapshot_Writer * w, Dwg_Entity_3DSOLID_wire ** wires, uint32_t num_wires)
+{
+  uint32_t i;
+
+  snapshot_pointer (w, wires, num_wires * sizeof (Dwg_Entity_3DSOLID_wire), 1);
+  for (i = 0; *wires && i < num_wires; i++)
+    snapshot_pointer (w, &(*wires)[i].points, (*wires)[i].num_points * sizeof (BITCODE_3BD), 0);
+}
+
+/** ACIS entities are decoded by hand (see decode_3dsolid) */
+static void
+snapshot_3dsolid (Dwg_Snapshot_Writer * w, Dwg_Entity_3DSOLID * _obj)
+{
+  uint32_t i;
+
+  /* The SAT data is in dwg->sat_data, found by offset */
+  snapshot_null (w, &_obj->acis_data);
+  snapshot_null (w, &_obj->extra_acis_data);
+
+  snapshot_wires (w, &_obj->wires, _obj->num_wires);
+  snapshot_pointer (w, &_obj->silhouettes, _obj->num_silhouettes * sizeof (Dwg_Entity_3DSOLID_silhouette), 1);
+  for (i = 0; _obj->silhouettes && i < _obj->num_silhouettes; i++)
+    snapshot_wires (w, &_obj->silhouettes[i].wires, _obj->silhouettes[i].num_wires);
+}
+
+/** Copies the data of an object, already in the image, and relocates it.
+ * Returns 1 if the type of the object is known (as dwg_object_free), 0 if
+ * only its common data was copied.
+ */
+static int
+snapshot_object (Dwg_Snapshot_Writer * w, Dwg_Object * obj, uint64_t dwg_offset)
+{
+  Dwg_Snapshot_Writer *dat = w;
+  Dwg_Struct *dwg = obj->parent;
+  uint64_t obj_offset;
+  int success;
+  int32_t i;
+
+  obj_offset = snapshot_locate (w, obj);
+  snapshot_link (w, &obj->parent, dwg_offset);
+  snapshot_pointer (w, &obj->reactors, obj->num_reactors * sizeof (BITCODE_H), 0);
+
+  if (obj->supertype == DWG_SUPERTYPE_ENTITY)
+    {
+      snapshot_link (w, &obj->as.entity.parent, obj_offset);
+      snapshot_pointer (w, &obj->as.entity.picture, obj->as.entity.picture_size, 0);
+    }
+  else
+    {
+      snapshot_link (w, &obj->as.nongraph.parent, obj_offset);
+      snapshot_pointer (w, &obj->as.nongraph.handleref, obj->as.nongraph.num_handles * sizeof (BITCODE_H), 0);
+    }
+
+  switch (obj->type)
+    {
+    /* XXX Apply same action for each object type */
+    OBJECT_CASE_SET (dwg_snapshot_)
+    default:
+      i = obj->type - 500;
+      if (i >= dwg->num_classes || i < 0)
+	{
+	  success = 0;
+	  break;
+	}
+      /* the same, for vartypes */
+      switch (dwg->dwg_class[i].vartype)
+	{
+	OBJECT_VARTYPE_CASE_SET (dwg_snapshot_)
+	default:
+	  success = 0;
+	}
+    }
+
+  if (obj->type == DWG_TYPE_3DSOLID || obj->type == DWG_TYPE_REGION || obj->type == DWG_TYPE_BODY)
+    snapshot_3dsolid (w, &obj->as.entity.as._3DSOLID);
+  return (success);
+}
+
+/** Writes a snapshot of the decoded dwg structure to a file, which can be
+ * opened later by dwg_snapshot_open. The file is written under a temporary
+ * name and renamed, so a snapshot being written is never seen half done.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_snapshot_write (Dwg_Struct * dwg, char *path)
+{
+  Dwg_Snapshot_Writer w;
+  Dwg_Snapshot_Header *hdr;
+  Dwg_Struct *copy;
+  uint64_t hdr_offset, dwg_offset, reloc_offset;
+  uint32_t i, num_fixed;
+  char *tmp_path;
+  char tmp[1024];
+  FILE *fp;
+  int ret = -1;
+
+  if (dwg == NULL || path == NULL)
+    return (-1);
+
+  /* Views point into the source data, which is not part of the snapshot
+   */
+  if (dwg->header.string_views)
+    {
+      LOG_ERROR ("Can't take a snapshot of string views.\n");
+      return (-1);
+    }
+
+  /* CRC of the source file, if not computed yet: the file must still be
+   * the one that was read
+   */
+  if (dwg->header.file_name)
+    {
+      struct stat attrib;
+      uint32_t crc;
+
+      if (stat (dwg->header.file_name, &attrib)
+          || (uint64_t) attrib.st_size != dwg->header.file_size
+          || (int64_t) attrib.st_mtime != dwg->header.file_mtime
+          || snapshot_file_crc (dwg->header.file_name, dwg->header.file_size, &crc))
+        {
+          snprintf (tmp, 1024, "Source file changed since it was read: %s\n", dwg->header.file_name);
+          LOG_ERROR (tmp);
+          return (-1);
+        }
+      dwg->header.file_crc = crc;
+      free (dwg->header.file_name);
+      dwg->header.file_name = NULL;
+    }
+
+  memset (&w, 0, sizeof (Dwg_Snapshot_Writer));
+  w.base = snapshot_base (dwg->header.file_crc);
+  if (dwg->header.string_pool && dwg->header.string_pool->size)
+    {
+      w.pool = dwg->header.string_pool;
+      w.pool_offset = (uint64_t *) calloc (w.pool->size, sizeof (uint64_t));
+      if (w.pool_offset == NULL)
+        {
+          LOG_ERROR ("Not enough memory for the snapshot.\n");
+          return (-1);
+        }
+    }
+
+  /* Header, main structure, classes, objects and handle index
+   */
+  hdr_offset = snapshot_alloc (&w, sizeof (Dwg_Snapshot_Header));
+  dwg_offset = snapshot_alloc (&w, sizeof (Dwg_Struct));
+  if (w.fail)
+    goto end;
+  memcpy (w.buf + dwg_offset, dwg, sizeof (Dwg_Struct));
+  snapshot_block_add (&w, dwg, sizeof (Dwg_Struct), dwg_offset);
+
+  copy = (Dwg_Struct *) (w.buf + dwg_offset);
+  copy->header.num_sections = 0;
+  copy->header.section = NULL;
+  copy->header.num_section_pages = 0;
+  copy->header.section_page = NULL;
+  copy->header.num_descriptions = 0;
+  copy->header.section_info = NULL;
+  copy->header.decoder = NULL;
+  copy->header.file_name = NULL;
+  copy->header.string_block = NULL;
+  copy->header.string_pool = NULL;
+  copy->header.string_pool_owned = 0;
+  copy->res_objects = 0;
+  copy->res_handles = 0;
+  copy->res_eed = 0;
+  copy->res_eed_data = 0;
+  copy->res_sat_data = 0;
+  copy->snapshot = NULL;
+  copy->snapshot_size = 0;
+  copy->num_rtree_nodes = 0;
+  copy->num_rtree_entities = 0;
+  copy->rtree = NULL;
+  memset (&copy->extents, 0, sizeof (Dwg_Extents));
+
+  snapshot_pointer (&w, &dwg->dwg_class, dwg->num_classes * sizeof (Dwg_Class), 1);
+  for (i = 0; dwg->dwg_class && i < dwg->num_classes; i++)
+    {
+      Dwg_Class *klass = &dwg->dwg_class[i];
+      if (klass->appname)
+        snapshot_pointer (&w, &klass->appname, strlen ((char *) klass->appname) + 1, 0);
+      if (klass->cppname)
+        snapshot_pointer (&w, &klass->cppname, strlen ((char *) klass->cppname) + 1, 0);
+      if (klass->dxfname)
+        snapshot_pointer (&w, &klass->dxfname, strlen ((char *) klass->dxfname) + 1, 0);
+    }
+
+  snapshot_pointer (&w, &dwg->object, dwg->num_objects * sizeof (Dwg_Object), 1);
+  snapshot_pointer (&w, &dwg->handle_map, dwg->num_handles * sizeof (Dwg_Handle_Map), 0);
+  snapshot_pointer (&w, &dwg->eed, dwg->num_eed * sizeof (Dwg_Eed), 0);
+  snapshot_pointer (&w, &dwg->eed_data, dwg->eed_size, 0);
+  snapshot_pointer (&w, &dwg->sat_data, dwg->sat_size, 0);
+  if (dwg->type_start)
+    {
+      snapshot_pointer (&w, &dwg->type_start, (dwg->num_types + 1) * sizeof (uint32_t), 0);
+      snapshot_pointer (&w, &dwg->type_index, dwg->type_start[dwg->num_types] * sizeof (uint32_t), 0);
+      snapshot_pointer (&w, &dwg->layer_start, (dwg->num_objects + 1) * sizeof (uint32_t), 0);
+      snapshot_pointer (&w, &dwg->layer_index, dwg->layer_start[dwg->num_objects] * sizeof (uint32_t), 0);
+    }
+
+  /* Strings of the header variables
+   */
+  dwg_snapshot_variables (&w, dwg);
+
+  /* Object data. Blocks of one object are never searched for another one.
+   */
+  num_fixed = w.num_blocks;
+  for (i = 0; i < dwg->num_objects && !w.fail; i++)
+    {
+      w.num_blocks = num_fixed;
+      snapshot_object (&w, &dwg->object[i], dwg_offset);
+    }
+
+  /* Relocation table
+   */
+  reloc_offset = snapshot_alloc (&w, w.num_relocs * sizeof (uint64_t));
+  if (w.fail)
+    goto end;
+  if (w.num_relocs)
+    memcpy (w.buf + reloc_offset, w.reloc, w.num_relocs * sizeof (uint64_t));
+
+  hdr = (Dwg_Snapshot_Header *) (w.buf + hdr_offset);
+  strncpy (hdr->magic, SNAPSHOT_MAGIC, 16);
+  hdr->format = SNAPSHOT_FORMAT;
+  hdr->sizeof_pointer = sizeof (void *);
+  hdr->sizeof_struct = sizeof (Dwg_Struct);
+  hdr->sizeof_object = sizeof (Dwg_Object);
+  hdr->base = w.base;
+  hdr->size = w.size;
+  hdr->dwg_offset = dwg_offset;
+  hdr->reloc_offset = reloc_offset;
+  hdr->num_relocs = w.num_relocs;
+
+  /* Output
+   */
+  tmp_path = (char *) malloc (strlen (path) + 5);
+  strcpy (tmp_path, path);
+  strcat (tmp_path, ".tmp");
+  fp = fopen (tmp_path, "wb");
+  if (!fp)
+    {
+      snprintf (tmp, 1024, "Could not open file: %s\n", tmp_path);
+      LOG_ERROR (tmp);
+    }
+  else if (fwrite (w.buf, 1, w.size, fp) != w.size)
+    {
+      snprintf (tmp, 1024, "Could not write the snapshot: %s\n", tmp_path);
+      LOG_ERROR (tmp);
+      fclose (fp);
+      unlink (tmp_path);
+    }
+  else if (fclose (fp) || rename (tmp_path, path))
+    {
+      snprintf (tmp, 1024, "Could not write the snapshot: %s\n", path);
+      LOG_ERROR (tmp);
+      unlink (tmp_path);
+    }
+  else
+    {
+      snprintf (tmp, 1024, "Snapshot written: %s (%lu bytes, %lu pointers)\n",
+                path, (unsigned long) w.size, (unsigned long) w.num_relocs);
+      LOG_INFO (tmp);
+      ret = 0;
+    }
+  free (tmp_path);
+
+end:
+  free (w.buf);
+  free (w.reloc);
+  free (w.block);
+  free (w.pool_offset);
+  return (ret);
+}
+
+/** Opens a snapshot written by dwg_snapshot_write. The returned structure
+ * lives inside the mapped file and is used like one filled by dwg_read_file;
+ * it is released with dwg_free (or dwg_snapshot_close).
+ * Returns NULL if the file is not a valid snapshot for this library build.
+ */
+Dwg_Struct *
+dwg_snapshot_open (char *path)
+{
+  Dwg_Snapshot_Header hdr;
+  Dwg_Struct *dwg;
+  struct stat attrib;
+  uint8_t *addr;
+  uint64_t *reloc;
+  uint64_t i;
+  char tmp[1024];
+  int fd;
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    {
+      snprintf (tmp, 1024, "Could not open file: %s\n", path);
+      LOG_ERROR (tmp);
+      return (NULL);
+    }
+  if (fstat (fd, &attrib)
+      || read (fd, &hdr, sizeof (Dwg_Snapshot_Header)) != sizeof (Dwg_Snapshot_Header)
+      || strncmp (hdr.magic, SNAPSHOT_MAGIC, 16)
+      || hdr.format != SNAPSHOT_FORMAT
+      || hdr.sizeof_pointer != sizeof (void *)
+      || hdr.sizeof_struct != sizeof (Dwg_Struct)
+      || hdr.sizeof_object != sizeof (Dwg_Object)
+      || hdr.size != (uint64_t) attrib.st_size
+      || hdr.dwg_offset + sizeof (Dwg_Struct) > hdr.size
+      || hdr.reloc_offset + hdr.num_relocs * sizeof (uint64_t) > hdr.size)
+    {
+      snprintf (tmp, 1024, "Not a snapshot of this library version: %s\n", path);
+      LOG_ERROR (tmp);
+      close (fd);
+      return (NULL);
+    }
+
+  addr = (uint8_t *) mmap ((void *) (uintptr_t) hdr.base, hdr.size,
+                           PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (addr == (uint8_t *) MAP_FAILED)
+    {
+      snprintf (tmp, 1024, "Could not map the snapshot: %s\n", path);
+      LOG_ERROR (tmp);
+      return (NULL);
+    }
+
+  /* Not at the preferred address: move all the pointers
+   */
+  if ((uintptr_t) addr != hdr.base)
+    {
+      uintptr_t delta = (uintptr_t) addr - (uintptr_t) hdr.base;
+
+      snprintf (tmp, 1024, "Relocating snapshot: %lu pointers\n", (unsigned long) hdr.num_relocs);
+      LOG_INFO (tmp);
+      reloc = (uint64_t *) (addr + hdr.reloc_offset);
+      for (i = 0; i < hdr.num_relocs; i++)
+        {
+          uintptr_t value;
+
+          if (reloc[i] + sizeof (uintptr_t) > hdr.size)
+            {
+              LOG_ERROR ("Corrupted snapshot relocation table.\n");
+              munmap (addr, hdr.size);
+              return (NULL);
+            }
+          memcpy (&value, addr + reloc[i], sizeof (uintptr_t));
+          value += delta;
+          memcpy (addr + reloc[i], &value, sizeof (uintptr_t));
+        }
+    }
+
+  dwg = (Dwg_Struct *) (addr + hdr.dwg_offset);
+  dwg->snapshot = addr;
+  dwg->snapshot_size = hdr.size;
+  return (dwg);
+}
+
+/** Checks whether a dwg structure is still current for a source file, by
+ * its size and modification time, or by its CRC if only the time changed
+ * (a structure whose CRC was never computed, see dwg_snapshot_write, is
+ * then taken as different).
+ * Returns a fail status (0 == OK; -1 == FAIL, i.e. the file is different).
+ */
+int
+dwg_snapshot_check (Dwg_Struct * dwg, char *filename)
+{
+  struct stat attrib;
+  uint32_t crc;
+
+  if (dwg == NULL || stat (filename, &attrib))
+    return (-1);
+  if ((uint64_t) attrib.st_size != dwg->header.file_size)
+    return (-1);
+  if ((int64_t) attrib.st_mtime == dwg->header.file_mtime)
+    return (0);
+
+  if (dwg->header.file_name
+      || snapshot_file_crc (filename, attrib.st_size, &crc)
+      || crc != dwg->header.file_crc)
+    return (-1);
+  return (0);
+}
+
+/** Unmaps a snapshot opened by dwg_snapshot_open. The structure is no longer
+ * valid after the call.
+ */
+void
+dwg_snapshot_close (Dwg_Struct * dwg)
+{
+  if (dwg == NULL || dwg->snapshot == NULL)
+    return;
+  dwg_spatial_free (dwg);
+  dwg_extents_free (dwg);
+  munmap (dwg->snapshot, dwg->snapshot_size);
+}
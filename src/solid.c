@@ -0,0 +1,141 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       solid.c
+ *     \brief      SAT data of the ACIS entities (REGION, 3DSOLID, BODY),
+ *                 de-obfuscated on request
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* The SAT data (version 1) of an ACIS entity comes in blocks, each one
+ * preceded by its size, and is obfuscated: every byte c above 32 is stored
+ * as 159 - c. While decoding, the blocks are only copied, as they are, to
+ * dwg->sat_data, one after the other, and the entity keeps their offset and
+ * total size. They are de-obfuscated by dwg_solid_sat, when asked for.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dwg.h"
+#include "bits.h"
+#include "object.h"
+#include "logging.h"
+
+/** Appends a SAT block of size bytes, read from dat, to the SAT data of the
+ * drawing; obj is the entity being decoded.
+ * Returns 0 if OK, -1 if there is not enough memory (or the SAT data of the
+ * drawing would pass 1 GB).
+ */
+int
+dwg_sat_add (Dwg_Object * obj, Bit_Chain * dat, uint32_t size)
+{
+  Dwg_Struct *dwg = obj->parent;
+  uint8_t *data;
+  uint32_t num;
+
+  if (size > 0x40000000U - dwg->sat_size)
+    goto fail;
+  if (dwg->sat_size + size > dwg->res_sat_data)
+    {
+      num = dwg->res_sat_data < 65536 ? 65536 : 2 * dwg->res_sat_data;
+      while (num < dwg->sat_size + size)
+        num *= 2;
+      data = (uint8_t *) realloc (dwg->sat_data, num);
+      if (data == NULL)
+        goto fail;
+      dwg->sat_data = data;
+      dwg->res_sat_data = num;
+    }
+
+  bit_read_RC_array (dat, dwg->sat_data + dwg->sat_size, size);
+  dwg->sat_size += size;
+  return (0);
+
+fail:
+  LOG_ERROR ("Not enough memory for the SAT data.\n");
+  return (-1);
+}
+
+/** Frees the SAT data of a dwg structure.
+ */
+void
+dwg_sat_free (Dwg_Struct * dwg)
+{
+  if (dwg->sat_data)
+    free (dwg->sat_data);
+  dwg->sat_data = NULL;
+  dwg->sat_size = 0;
+  dwg->res_sat_data = 0;
+}
+
+/** De-obfuscates length bytes of src into dst: bytes above 32 become
+ * 159 - c (modulo 256), the others are kept.
+ */
+static void
+sat_decode (const uint8_t * src, uint8_t * dst, uint32_t length)
+{
+  uint32_t i = 0;
+
+#ifdef __SSE2__
+  const __m128i limit = _mm_set1_epi8 (33);
+  const __m128i key = _mm_set1_epi8 ((char) 159);
+  __m128i x, above;
+
+  for (; i + 16 <= length; i += 16)
+    {
+      x = _mm_loadu_si128 ((const __m128i *) (src + i));
+      /* Unsigned x >= 33 */
+      above = _mm_cmpeq_epi8 (_mm_max_epu8 (x, limit), x);
+      x = _mm_or_si128 (_mm_and_si128 (above, _mm_sub_epi8 (key, x)), _mm_andnot_si128 (above, x));
+      _mm_storeu_si128 ((__m128i *) (dst + i), x);
+    }
+#endif
+  for (; i < length; i++)
+    dst[i] = src[i] > 32 ? (uint8_t) (159 - src[i]) : src[i];
+}
+
+/** Gets the SAT data of an ACIS entity (REGION, 3DSOLID or BODY), as text,
+ * in out, of cap bytes. Like snprintf, out is always null-terminated (unless
+ * cap is 0) and the data is cut if it does not fit.
+ * Returns the length of the whole SAT data, or -1 if obj is not an ACIS
+ * entity with SAT data of version 1.
+ */
+int
+dwg_solid_sat (Dwg_Struct * dwg, Dwg_Object * obj, char *out, uint32_t cap)
+{
+  Dwg_Entity_3DSOLID *_obj;
+  uint32_t len;
+
+  if (obj->supertype != DWG_SUPERTYPE_ENTITY
+      || (obj->type != DWG_TYPE_REGION && obj->type != DWG_TYPE_3DSOLID && obj->type != DWG_TYPE_BODY))
+    return (-1);
+  _obj = &obj->as.entity.as._3DSOLID;
+  if (_obj->acis_empty || _obj->version != 1 || _obj->sat_offset + _obj->sat_size > dwg->sat_size)
+    return (-1);
+
+  if (cap > 0)
+    {
+      len = _obj->sat_size < cap - 1 ? _obj->sat_size : cap - 1;
+      sat_decode (dwg->sat_data + _obj->sat_offset, (uint8_t *) out, len);
+      out[len] = '\0';
+    }
+  return (_obj->sat_size);
+}
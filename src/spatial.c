@@ -0,0 +1,944 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       spatial.c
+ *     \brief      Entity extents and spatial index (packed R-tree)
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* The spatial index is an R-tree bulk loaded with the Sort-Tile-Recursive
+ * method: the entity boxes are sorted in vertical slices by x, each slice by
+ * y, and packed RTREE_NODE_SIZE at a time into leaves; the same is done with
+ * the leaves, and so on up to a single root. All the nodes are kept in one
+ * array, level by level, the entity boxes first and the root last.
+ *
+ * The extents of all the entities are computed by ranges of objects in
+ * threads, each one reducing its range to a box of the drawing, and the
+ * threads' boxes are reduced at the end.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "dwg.h"
+#include "logging.h"
+
+#define RTREE_NODE_SIZE 16
+#define RTREE_STACK (RTREE_NODE_SIZE * 16)
+
+/* LWPLINE flag of closed polylines */
+#define LWPLINE_CLOSED 512
+
+/*------------------------------------------------------------------------------
+ * Extents
+ */
+
+static void
+box_empty (Dwg_Bbox * box)
+{
+  box->min.x = box->min.y = box->min.z = HUGE_VAL;
+  box->max.x = box->max.y = box->max.z = -HUGE_VAL;
+}
+
+static void
+box_add (Dwg_Bbox * box, double x, double y, double z)
+{
+  if (x < box->min.x) box->min.x = x;
+  if (y < box->min.y) box->min.y = y;
+  if (z < box->min.z) box->min.z = z;
+  if (x > box->max.x) box->max.x = x;
+  if (y > box->max.y) box->max.y = y;
+  if (z > box->max.z) box->max.z = z;
+}
+
+/** Object coordinate system of an extrusion vector (arbitrary axis algorithm).
+ * Returns 0 if it is the world system, so that no transform is needed.
+ */
+int
+dwg_ocs_axes (BITCODE_3BD * ext, BITCODE_3BD * ax, BITCODE_3BD * ay, BITCODE_3BD * az)
+{
+  double len;
+
+  len = sqrt (ext->x * ext->x + ext->y * ext->y + ext->z * ext->z);
+  if (len == 0 || (ext->x == 0 && ext->y == 0 && ext->z > 0))
+    return (0);
+
+  az->x = ext->x / len;
+  az->y = ext->y / len;
+  az->z = ext->z / len;
+  if (fabs (az->x) < 1.0 / 64 && fabs (az->y) < 1.0 / 64)
+    {
+      /* Wy x N */
+      ax->x = az->z;
+      ax->y = 0;
+      ax->z = -az->x;
+    }
+  else
+    {
+      /* Wz x N */
+      ax->x = -az->y;
+      ax->y = az->x;
+      ax->z = 0;
+    }
+  len = sqrt (ax->x * ax->x + ax->y * ax->y + ax->z * ax->z);
+  ax->x /= len;
+  ax->y /= len;
+  ax->z /= len;
+
+  /* N x Ax */
+  ay->x = az->y * ax->z - az->z * ax->y;
+  ay->y = az->z * ax->x - az->x * ax->z;
+  ay->z = az->x * ax->y - az->y * ax->x;
+  return (1);
+}
+
+/** Adds a point given in the object coordinate system of ext */
+static void
+box_add_ocs (Dwg_Bbox * box, BITCODE_3BD * ext, double x, double y, double z)
+{
+  BITCODE_3BD ax, ay, az;
+
+  if (!dwg_ocs_axes (ext, &ax, &ay, &az))
+    {
+      box_add (box, x, y, z);
+      return;
+    }
+  box_add (box,
+           x * ax.x + y * ay.x + z * az.x,
+           x * ax.y + y * ay.y + z * az.y,
+           x * ax.z + y * ay.z + z * az.z);
+}
+
+/** Adds the square of half side r around a point of the object system */
+static void
+box_add_ocs_square (Dwg_Bbox * box, BITCODE_3BD * ext, double x, double y, double z, double r)
+{
+  box_add_ocs (box, ext, x - r, y - r, z);
+  box_add_ocs (box, ext, x + r, y - r, z);
+  box_add_ocs (box, ext, x - r, y + r, z);
+  box_add_ocs (box, ext, x + r, y + r, z);
+}
+
+/** Adds a circle, whose center is in the object system of ext */
+static void
+box_add_circle (Dwg_Bbox * box, BITCODE_3BD * ext, BITCODE_3BD * center, double r)
+{
+  BITCODE_3BD ax, ay, az, c;
+
+  if (!dwg_ocs_axes (ext, &ax, &ay, &az))
+    {
+      box_add (box, center->x - r, center->y - r, center->z);
+      box_add (box, center->x + r, center->y + r, center->z);
+      return;
+    }
+  c.x = center->x * ax.x + center->y * ay.x + center->z * az.x;
+  c.y = center->x * ax.y + center->y * ay.y + center->z * az.y;
+  c.z = center->x * ax.z + center->y * ay.z + center->z * az.z;
+  box_add (box, c.x - r * sqrt (1 - az.x * az.x), c.y - r * sqrt (1 - az.y * az.y), c.z - r * sqrt (1 - az.z * az.z));
+  box_add (box, c.x + r * sqrt (1 - az.x * az.x), c.y + r * sqrt (1 - az.y * az.y), c.z + r * sqrt (1 - az.z * az.z));
+}
+
+/** Adds an arc or elliptical arc c + cos (a) u + sin (a) v, for a from start
+ * to start + sweep (vectors in world coordinates): its end points, and the
+ * points swept where it turns on each axis, at a = atan (v / u) (+ pi).
+ */
+static void
+box_add_conic (Dwg_Bbox * box, const double *c, const double *u, const double *v,
+               double start, double sweep)
+{
+  double a, t;
+  int k, j;
+
+  box_add (box, c[0] + cos (start) * u[0] + sin (start) * v[0],
+           c[1] + cos (start) * u[1] + sin (start) * v[1],
+           c[2] + cos (start) * u[2] + sin (start) * v[2]);
+  a = start + sweep;
+  box_add (box, c[0] + cos (a) * u[0] + sin (a) * v[0],
+           c[1] + cos (a) * u[1] + sin (a) * v[1],
+           c[2] + cos (a) * u[2] + sin (a) * v[2]);
+  for (k = 0; k < 3; k++)
+    for (j = 0; j < 2; j++)
+      {
+        t = atan2 (v[k], u[k]) + j * M_PI;
+        a = start + fmod (fmod (t - start, 2 * M_PI) + 2 * M_PI, 2 * M_PI);
+        if (a > start + sweep)
+          continue;
+        box_add (box, c[0] + cos (a) * u[0] + sin (a) * v[0],
+                 c[1] + cos (a) * u[1] + sin (a) * v[1],
+                 c[2] + cos (a) * u[2] + sin (a) * v[2]);
+      }
+}
+
+/** Angle swept from start to end, counterclockwise, in ]0, 2 pi] */
+static double
+box_sweep (double start, double end)
+{
+  double sweep;
+
+  sweep = fmod (end - start, 2 * M_PI);
+  if (sweep <= 0)
+    sweep += 2 * M_PI;
+  return (sweep);
+}
+
+/** Adds a polyline segment of the object system, with its bulge. A bulge up
+ * to 1 is at most a half circle, inside the circle on the segment; a bigger
+ * one is inside a circle of twice its radius around the segment middle.
+ */
+static void
+box_add_bulge (Dwg_Bbox * box, BITCODE_3BD * ext, BITCODE_2RD * p1, BITCODE_2RD * p2, double bulge, double z)
+{
+  double dx, dy, chord, r;
+
+  box_add_ocs (box, ext, p1->x, p1->y, z);
+  if (bulge == 0)
+    return;
+  dx = p2->x - p1->x;
+  dy = p2->y - p1->y;
+  chord = sqrt (dx * dx + dy * dy);
+  if (fabs (bulge) <= 1)
+    r = chord / 2;
+  else
+    r = chord * (1 + bulge * bulge) / (2 * fabs (bulge));
+  box_add_ocs_square (box, ext, (p1->x + p2->x) / 2, (p1->y + p2->y) / 2, z, r);
+}
+
+static void
+box_add_lwpline (Dwg_Bbox * box, Dwg_Entity_LWPLINE * e)
+{
+  uint32_t i, last;
+
+  if (e->points == NULL || e->num_points == 0)
+    return;
+  /* The last bulge closes the polyline, if it is closed */
+  last = e->flags & LWPLINE_CLOSED ? e->num_points : e->num_points - 1;
+  for (i = 0; i < e->num_points; i++)
+    box_add_bulge (box, &e->normal, &e->points[i], &e->points[(i + 1) % e->num_points],
+                   e->bulges && i < e->num_bulges && i < last ? e->bulges[i] : 0, e->elevation);
+}
+
+static void
+box_add_hatch (Dwg_Bbox * box, Dwg_Entity_HATCH * hatch)
+{
+  Dwg_Entity_HATCH_Path *path;
+  Dwg_Entity_HATCH_PathSeg *seg;
+  double z = hatch->z_coord;
+  double hx, hy;
+  uint32_t i, j, k;
+
+  for (i = 0; hatch->paths && i < hatch->num_paths; i++)
+    {
+      path = &hatch->paths[i];
+      if (path->flag & 2)
+        {
+          for (j = 0; path->polyline_paths && j < path->num_path_segs; j++)
+            box_add_bulge (box, &hatch->extrusion,
+                           &path->polyline_paths[j].point,
+                           &path->polyline_paths[(j + 1) % path->num_path_segs].point,
+                           path->bulges_present ? path->polyline_paths[j].bulge : 0, z);
+          continue;
+        }
+      for (j = 0; path->segs && j < path->num_path_segs; j++)
+        {
+          seg = &path->segs[j];
+          switch (seg->type_status)
+            {
+            case 1:
+              box_add_ocs (box, &hatch->extrusion, seg->first_endpoint.x, seg->first_endpoint.y, z);
+              box_add_ocs (box, &hatch->extrusion, seg->second_endpoint.x, seg->second_endpoint.y, z);
+              break;
+            case 2:
+              box_add_ocs_square (box, &hatch->extrusion, seg->center.x, seg->center.y, z, seg->radius);
+              break;
+            case 3:
+              /* endpoint is the major axis, relative to the center */
+              hx = sqrt (seg->endpoint.x * seg->endpoint.x
+                         + seg->minor_major_ratio * seg->minor_major_ratio * seg->endpoint.y * seg->endpoint.y);
+              hy = sqrt (seg->endpoint.y * seg->endpoint.y
+                         + seg->minor_major_ratio * seg->minor_major_ratio * seg->endpoint.x * seg->endpoint.x);
+              box_add_ocs (box, &hatch->extrusion, seg->center.x - hx, seg->center.y - hy, z);
+              box_add_ocs (box, &hatch->extrusion, seg->center.x + hx, seg->center.y - hy, z);
+              box_add_ocs (box, &hatch->extrusion, seg->center.x - hx, seg->center.y + hy, z);
+              box_add_ocs (box, &hatch->extrusion, seg->center.x + hx, seg->center.y + hy, z);
+              break;
+            case 4:
+              for (k = 0; seg->control_points && k < seg->num_control_points; k++)
+                box_add_ocs (box, &hatch->extrusion,
+                             seg->control_points[k].point.x, seg->control_points[k].point.y, z);
+              break;
+            }
+        }
+    }
+}
+
+/** Computes the bounding box of an entity, in world coordinates. Arcs and
+ * ellipses are bounded exactly, over the angles they sweep; other curves by
+ * their defining geometry (e.g. splines by their control points), texts and
+ * block insertions by their insertion points, and polyline headers by the
+ * vertices which follow them in the object list.
+ * Returns a fail status (0 == OK; -1 == FAIL, e.g. infinite or no geometry).
+ */
+int
+dwg_entity_extents (Dwg_Object * obj, Dwg_Bbox * box)
+{
+  Dwg_Object_Entity *ent;
+  Dwg_Struct *dwg;
+  BITCODE_3BD zaxis = { 0, 0, 1 };
+  BITCODE_3BD p;
+  uint32_t i;
+
+  box_empty (box);
+  if (obj == NULL || obj->supertype != DWG_SUPERTYPE_ENTITY)
+    return (-1);
+  ent = &obj->as.entity;
+  dwg = obj->parent;
+
+  switch (obj->type)
+    {
+    case DWG_TYPE_TEXT:
+      {
+        Dwg_Entity_TEXT *e = &ent->as.TEXT;
+        box_add_ocs (box, &e->extrusion, e->insertion_pt.x, e->insertion_pt.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->alignment_pt.x, e->alignment_pt.y, e->elevation);
+      }
+      break;
+    case DWG_TYPE_ATTRIB:
+      {
+        Dwg_Entity_ATTRIB *e = &ent->as.ATTRIB;
+        box_add_ocs (box, &e->extrusion, e->insertion_pt.x, e->insertion_pt.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->alignment_pt.x, e->alignment_pt.y, e->elevation);
+      }
+      break;
+    case DWG_TYPE_ATTDEF:
+      {
+        Dwg_Entity_ATTDEF *e = &ent->as.ATTDEF;
+        box_add_ocs (box, &e->extrusion, e->insertion_pt.x, e->insertion_pt.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->alignment_pt.x, e->alignment_pt.y, e->elevation);
+      }
+      break;
+    case DWG_TYPE_INSERT:
+      {
+        Dwg_Entity_INSERT *e = &ent->as.INSERT;
+        box_add_ocs (box, &e->extrusion, e->ins_pt.x, e->ins_pt.y, e->ins_pt.z);
+      }
+      break;
+    case DWG_TYPE_MINSERT:
+      {
+        Dwg_Entity_MINSERT *e = &ent->as.MINSERT;
+        double w = (e->numcols > 1 ? e->numcols - 1 : 0) * e->col_spacing;
+        double h = (e->numrows > 1 ? e->numrows - 1 : 0) * e->row_spacing;
+        double c = cos (e->rotation_ang), s = sin (e->rotation_ang);
+        box_add_ocs (box, &e->extrusion, e->ins_pt.x, e->ins_pt.y, e->ins_pt.z);
+        box_add_ocs (box, &e->extrusion, e->ins_pt.x + w * c, e->ins_pt.y + w * s, e->ins_pt.z);
+        box_add_ocs (box, &e->extrusion, e->ins_pt.x - h * s, e->ins_pt.y + h * c, e->ins_pt.z);
+        box_add_ocs (box, &e->extrusion, e->ins_pt.x + w * c - h * s, e->ins_pt.y + w * s + h * c, e->ins_pt.z);
+      }
+      break;
+    case DWG_TYPE_VERTEX_2D:
+      p = ent->as.VERTEX_2D.point;
+      box_add (box, p.x, p.y, p.z);
+      break;
+    case DWG_TYPE_VERTEX_3D:
+    case DWG_TYPE_VERTEX_MESH:
+    case DWG_TYPE_VERTEX_PFACE:
+      p = ent->as.VERTEX_3D.point;
+      box_add (box, p.x, p.y, p.z);
+      break;
+    case DWG_TYPE_POLYLINE_2D:
+    case DWG_TYPE_POLYLINE_3D:
+    case DWG_TYPE_POLYLINE_PFACE:
+    case DWG_TYPE_POLYLINE_MESH:
+      for (i = obj->index + 1; i < dwg->num_objects; i++)
+        {
+          Dwg_Object *v = &dwg->object[i];
+          if (v->type == DWG_TYPE_VERTEX_2D)
+            p = v->as.entity.as.VERTEX_2D.point;
+          else if (v->type == DWG_TYPE_VERTEX_3D || v->type == DWG_TYPE_VERTEX_MESH
+                   || v->type == DWG_TYPE_VERTEX_PFACE)
+            p = v->as.entity.as.VERTEX_3D.point;
+          else if (v->type == DWG_TYPE_VERTEX_PFACE_FACE)
+            continue;
+          else
+            break;
+          if (obj->type == DWG_TYPE_POLYLINE_2D)
+            box_add_ocs (box, &ent->as.POLYLINE_2D.extrusion, p.x, p.y, ent->as.POLYLINE_2D.elevation);
+          else
+            box_add (box, p.x, p.y, p.z);
+        }
+      break;
+    case DWG_TYPE_ARC:
+      {
+        Dwg_Entity_ARC *e = &ent->as.ARC;
+        BITCODE_3BD ax = { 1, 0, 0 }, ay = { 0, 1, 0 }, az = zaxis;
+        double c[3], u[3], v[3];
+        dwg_ocs_axes (&e->extrusion, &ax, &ay, &az);
+        c[0] = e->center.x * ax.x + e->center.y * ay.x + e->center.z * az.x;
+        c[1] = e->center.x * ax.y + e->center.y * ay.y + e->center.z * az.y;
+        c[2] = e->center.x * ax.z + e->center.y * ay.z + e->center.z * az.z;
+        u[0] = e->radius * ax.x, u[1] = e->radius * ax.y, u[2] = e->radius * ax.z;
+        v[0] = e->radius * ay.x, v[1] = e->radius * ay.y, v[2] = e->radius * ay.z;
+        box_add_conic (box, c, u, v, e->start_angle, box_sweep (e->start_angle, e->end_angle));
+      }
+      break;
+    case DWG_TYPE_CIRCLE:
+      box_add_circle (box, &ent->as.CIRCLE.extrusion, &ent->as.CIRCLE.center, ent->as.CIRCLE.radius);
+      break;
+    case DWG_TYPE_LINE:
+      box_add (box, ent->as.LINE.start.x, ent->as.LINE.start.y, ent->as.LINE.start.z);
+      box_add (box, ent->as.LINE.end.x, ent->as.LINE.end.y, ent->as.LINE.end.z);
+      break;
+    case DWG_TYPE_DIMENSION_ORDINATE:
+      {
+        Dwg_Entity_DIMENSION_ORDINATE *e = &ent->as.DIMENSION_ORDINATE;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_13_pt.x, e->_13_pt.y, e->_13_pt.z);
+        box_add (box, e->_14_pt.x, e->_14_pt.y, e->_14_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_LINEAR:
+      {
+        Dwg_Entity_DIMENSION_LINEAR *e = &ent->as.DIMENSION_LINEAR;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_13_pt.x, e->_13_pt.y, e->_13_pt.z);
+        box_add (box, e->_14_pt.x, e->_14_pt.y, e->_14_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_ALIGNED:
+      {
+        Dwg_Entity_DIMENSION_ALIGNED *e = &ent->as.DIMENSION_ALIGNED;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_13_pt.x, e->_13_pt.y, e->_13_pt.z);
+        box_add (box, e->_14_pt.x, e->_14_pt.y, e->_14_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_ANG3PT:
+      {
+        Dwg_Entity_DIMENSION_ANG3PT *e = &ent->as.DIMENSION_ANG3PT;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_13_pt.x, e->_13_pt.y, e->_13_pt.z);
+        box_add (box, e->_14_pt.x, e->_14_pt.y, e->_14_pt.z);
+        box_add (box, e->_15_pt.x, e->_15_pt.y, e->_15_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_ANG2LN:
+      {
+        Dwg_Entity_DIMENSION_ANG2LN *e = &ent->as.DIMENSION_ANG2LN;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_13_pt.x, e->_13_pt.y, e->_13_pt.z);
+        box_add (box, e->_14_pt.x, e->_14_pt.y, e->_14_pt.z);
+        box_add (box, e->_15_pt.x, e->_15_pt.y, e->_15_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_RADIUS:
+      {
+        Dwg_Entity_DIMENSION_RADIUS *e = &ent->as.DIMENSION_RADIUS;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_15_pt.x, e->_15_pt.y, e->_15_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_DIMENSION_DIAMETER:
+      {
+        Dwg_Entity_DIMENSION_DIAMETER *e = &ent->as.DIMENSION_DIAMETER;
+        box_add (box, e->_10_pt.x, e->_10_pt.y, e->_10_pt.z);
+        box_add (box, e->_15_pt.x, e->_15_pt.y, e->_15_pt.z);
+        box_add_ocs (box, &e->extrusion, e->text_midpt.x, e->text_midpt.y, e->elevation.ecs_11);
+      }
+      break;
+    case DWG_TYPE_POINT:
+      box_add (box, ent->as.POINT.x, ent->as.POINT.y, ent->as.POINT.z);
+      break;
+    case DWG_TYPE__3DFACE:
+      {
+        Dwg_Entity__3DFACE *e = &ent->as._3DFACE;
+        box_add (box, e->corner1.x, e->corner1.y, e->corner1.z);
+        box_add (box, e->corner2.x, e->corner2.y, e->corner2.z);
+        box_add (box, e->corner3.x, e->corner3.y, e->corner3.z);
+        box_add (box, e->corner4.x, e->corner4.y, e->corner4.z);
+      }
+      break;
+    case DWG_TYPE_SOLID:
+    case DWG_TYPE_TRACE:
+      {
+        Dwg_Entity_SOLID *e = &ent->as.SOLID;
+        box_add_ocs (box, &e->extrusion, e->corner1.x, e->corner1.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->corner2.x, e->corner2.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->corner3.x, e->corner3.y, e->elevation);
+        box_add_ocs (box, &e->extrusion, e->corner4.x, e->corner4.y, e->elevation);
+      }
+      break;
+    case DWG_TYPE_SHAPE:
+      box_add_ocs (box, &ent->as.SHAPE.extrusion,
+                   ent->as.SHAPE.ins_pt.x, ent->as.SHAPE.ins_pt.y, ent->as.SHAPE.ins_pt.z);
+      break;
+    case DWG_TYPE_VIEWPORT:
+      {
+        Dwg_Entity_VIEWPORT *e = &ent->as.VIEWPORT;
+        box_add (box, e->center.x - e->width / 2, e->center.y - e->height / 2, e->center.z);
+        box_add (box, e->center.x + e->width / 2, e->center.y + e->height / 2, e->center.z);
+      }
+      break;
+    case DWG_TYPE_ELLIPSE:
+      {
+        Dwg_Entity_ELLIPSE *e = &ent->as.ELLIPSE;
+        BITCODE_3BD n = e->extrusion;
+        double c[3], u[3], v[3];
+        double len = sqrt (n.x * n.x + n.y * n.y + n.z * n.z);
+        if (len == 0)
+          n = zaxis;
+        else
+          {
+            n.x /= len;
+            n.y /= len;
+            n.z /= len;
+          }
+        c[0] = e->center.x, c[1] = e->center.y, c[2] = e->center.z;
+        u[0] = e->sm_axis.x, u[1] = e->sm_axis.y, u[2] = e->sm_axis.z;
+        /* minor axis: ratio * (N x major) */
+        v[0] = e->axis_ratio * (n.y * u[2] - n.z * u[1]);
+        v[1] = e->axis_ratio * (n.z * u[0] - n.x * u[2]);
+        v[2] = e->axis_ratio * (n.x * u[1] - n.y * u[0]);
+        box_add_conic (box, c, u, v, e->start_angle, box_sweep (e->start_angle, e->end_angle));
+      }
+      break;
+    case DWG_TYPE_SPLINE:
+      {
+        Dwg_Entity_SPLINE *e = &ent->as.SPLINE;
+        for (i = 0; e->ctrl_pts && i < e->num_ctrl_pts; i++)
+          box_add (box, e->ctrl_pts[i].x, e->ctrl_pts[i].y, e->ctrl_pts[i].z);
+        for (i = 0; e->fit_pts && i < e->num_fit_pts; i++)
+          box_add (box, e->fit_pts[i].x, e->fit_pts[i].y, e->fit_pts[i].z);
+      }
+      break;
+    case DWG_TYPE_REGION:
+    case DWG_TYPE_3DSOLID:
+    case DWG_TYPE_BODY:
+      {
+        Dwg_Entity_3DSOLID *e = &ent->as._3DSOLID;
+        uint32_t j;
+        for (i = 0; e->wires && i < e->num_wires; i++)
+          for (j = 0; e->wires[i].points && j < e->wires[i].num_points; j++)
+            box_add (box, e->wires[i].points[j].x, e->wires[i].points[j].y, e->wires[i].points[j].z);
+      }
+      break;
+    case DWG_TYPE_MTEXT:
+      box_add (box, ent->as.MTEXT.insertion_pt.x, ent->as.MTEXT.insertion_pt.y, ent->as.MTEXT.insertion_pt.z);
+      break;
+    case DWG_TYPE_LEADER:
+      for (i = 0; ent->as.LEADER.points && i < ent->as.LEADER.numpts; i++)
+        box_add (box, ent->as.LEADER.points[i].x, ent->as.LEADER.points[i].y, ent->as.LEADER.points[i].z);
+      break;
+    case DWG_TYPE_TOLERANCE:
+      box_add (box, ent->as.TOLERANCE.ins_pt.x, ent->as.TOLERANCE.ins_pt.y, ent->as.TOLERANCE.ins_pt.z);
+      break;
+    case DWG_TYPE_LWPLINE:
+      box_add_lwpline (box, &ent->as.LWPLINE);
+      break;
+    case DWG_TYPE_MLINE:
+      for (i = 0; ent->as.MLINE.verts && i < ent->as.MLINE.num_verts; i++)
+        box_add (box, ent->as.MLINE.verts[i].vertex.x, ent->as.MLINE.verts[i].vertex.y,
+                 ent->as.MLINE.verts[i].vertex.z);
+      break;
+    default:
+      /* Variable types, by class */
+      i = obj->type - 500;
+      if (obj->type < 500 || i >= dwg->num_classes)
+        break;
+      switch (dwg->dwg_class[i].vartype)
+        {
+        case DWG_CLASS_LWPLINE:
+          box_add_lwpline (box, &ent->as.LWPLINE);
+          break;
+        case DWG_CLASS_HATCH:
+          box_add_hatch (box, &ent->as.HATCH);
+          break;
+        case DWG_CLASS_IMAGE:
+        case DWG_CLASS_WIPEOUT:
+          {
+            Dwg_Entity_IMAGE *e = &ent->as.IMAGE;
+            double w = e->size.width, h = e->size.height;
+            box_add (box, e->pt0.x, e->pt0.y, e->pt0.z);
+            box_add (box, e->pt0.x + w * e->uvec.x, e->pt0.y + w * e->uvec.y, e->pt0.z + w * e->uvec.z);
+            box_add (box, e->pt0.x + h * e->vvec.x, e->pt0.y + h * e->vvec.y, e->pt0.z + h * e->vvec.z);
+            box_add (box, e->pt0.x + w * e->uvec.x + h * e->vvec.x,
+                     e->pt0.y + w * e->uvec.y + h * e->vvec.y, e->pt0.z + w * e->uvec.z + h * e->vvec.z);
+          }
+          break;
+        default:
+          break;
+        }
+    }
+
+  if (box->min.x > box->max.x || isnan (box->min.x) || isnan (box->max.x))
+    {
+      box_empty (box);
+      return (-1);
+    }
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Drawing extents
+ */
+
+/**
+ *    \struct  _dwg_extents_range
+ *    \brief   Range of objects bounded by one thread
+ */
+typedef struct _dwg_extents_range
+{
+  Dwg_Struct *dwg;
+  uint32_t first;
+  uint32_t last;
+
+  /* Extents of the model space entities of the range */
+  Dwg_Bbox box;
+  uint32_t num_entities;
+} Dwg_Extents_Range;
+
+static void *
+dwg_extents_thread (void *arg)
+{
+  Dwg_Extents_Range *range = (Dwg_Extents_Range *) arg;
+  Dwg_Extents *ext = &range->dwg->extents;
+  Dwg_Object *obj;
+  Dwg_Bbox box;
+  uint32_t i;
+
+  box_empty (&range->box);
+  range->num_entities = 0;
+  for (i = range->first; i < range->last; i++)
+    {
+      obj = &range->dwg->object[i];
+      if (dwg_entity_extents (obj, &box) == 0 && obj->as.entity.entity_mode == 2)
+        {
+          box_add (&range->box, box.min.x, box.min.y, box.min.z);
+          box_add (&range->box, box.max.x, box.max.y, box.max.z);
+          range->num_entities++;
+        }
+      ext->min_x[i] = box.min.x;
+      ext->min_y[i] = box.min.y;
+      ext->min_z[i] = box.min.z;
+      ext->max_x[i] = box.max.x;
+      ext->max_y[i] = box.max.y;
+      ext->max_z[i] = box.max.z;
+    }
+  return (NULL);
+}
+
+/** Frees the entity extents of a dwg structure */
+void
+dwg_extents_free (Dwg_Struct * dwg)
+{
+  if (dwg == NULL)
+    return;
+  if (dwg->extents.min_x)
+    free (dwg->extents.min_x);
+  memset (&dwg->extents, 0, sizeof (Dwg_Extents));
+}
+
+/** Computes the bounding box of every entity (as dwg_entity_extents) into
+ * dwg->extents, by object index, and the extents of the drawing: the box of
+ * the model space entities, whatever the EXTMIN and EXTMAX variables say.
+ * Uses up to num_threads threads; the previous extents, if any, are replaced.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_compute_extents (Dwg_Struct * dwg, int num_threads)
+{
+  Dwg_Extents *ext;
+  Dwg_Extents_Range *range;
+  pthread_t *thread;
+  uint32_t chunk, n;
+  int i, started;
+  char tmp[1024];
+
+  if (dwg == NULL)
+    return (-1);
+  dwg_extents_free (dwg);
+  ext = &dwg->extents;
+  box_empty (&ext->drawing);
+
+  if (num_threads < 1)
+    num_threads = 1;
+  if ((uint32_t) num_threads > dwg->num_objects / 1024 + 1)
+    num_threads = dwg->num_objects / 1024 + 1;
+
+  /* Boxes, one array per coordinate, all in one block */
+  n = dwg->num_objects;
+  ext->min_x = (double *) malloc (6 * (size_t) (n ? n : 1) * sizeof (double));
+  range = (Dwg_Extents_Range *) malloc (num_threads * sizeof (Dwg_Extents_Range));
+  thread = (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+  if (ext->min_x == NULL || range == NULL || thread == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the entity extents.\n");
+      dwg_extents_free (dwg);
+      if (range)
+        free (range);
+      if (thread)
+        free (thread);
+      return (-1);
+    }
+  ext->min_y = ext->min_x + n;
+  ext->min_z = ext->min_y + n;
+  ext->max_x = ext->min_z + n;
+  ext->max_y = ext->max_x + n;
+  ext->max_z = ext->max_y + n;
+  ext->num_boxes = n;
+
+  chunk = (n + num_threads - 1) / num_threads;
+  for (i = 0; i < num_threads; i++)
+    {
+      range[i].dwg = dwg;
+      range[i].first = i * chunk;
+      range[i].last = (i + 1) * chunk;
+      if (range[i].first > n)
+        range[i].first = n;
+      if (range[i].last > n)
+        range[i].last = n;
+    }
+
+  /* The first range goes in this thread, and so do the ranges whose thread
+   * can't start
+   */
+  started = 1;
+  while (started < num_threads
+         && !pthread_create (&thread[started], NULL, dwg_extents_thread, &range[started]))
+    started++;
+  dwg_extents_thread (&range[0]);
+  for (i = started; i < num_threads; i++)
+    dwg_extents_thread (&range[i]);
+  for (i = 1; i < started; i++)
+    pthread_join (thread[i], NULL);
+
+  for (i = 0; i < num_threads; i++)
+    {
+      if (range[i].num_entities == 0)
+        continue;
+      box_add (&ext->drawing, range[i].box.min.x, range[i].box.min.y, range[i].box.min.z);
+      box_add (&ext->drawing, range[i].box.max.x, range[i].box.max.y, range[i].box.max.z);
+      ext->num_entities += range[i].num_entities;
+    }
+  free (range);
+  free (thread);
+
+  snprintf (tmp, 1024, "Extents: %lu model space entities, (%g, %g, %g) to (%g, %g, %g)\n",
+            (unsigned long) ext->num_entities, ext->drawing.min.x, ext->drawing.min.y,
+            ext->drawing.min.z, ext->drawing.max.x, ext->drawing.max.y, ext->drawing.max.z);
+  LOG_INFO (tmp);
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Packed R-tree
+ */
+
+static int
+node_cmp_x (const void *a, const void *b)
+{
+  const Dwg_Rtree_Node *na = (const Dwg_Rtree_Node *) a;
+  const Dwg_Rtree_Node *nb = (const Dwg_Rtree_Node *) b;
+  double ca = na->box.min.x + na->box.max.x;
+  double cb = nb->box.min.x + nb->box.max.x;
+
+  return (ca < cb ? -1 : ca > cb ? 1 : 0);
+}
+
+static int
+node_cmp_y (const void *a, const void *b)
+{
+  const Dwg_Rtree_Node *na = (const Dwg_Rtree_Node *) a;
+  const Dwg_Rtree_Node *nb = (const Dwg_Rtree_Node *) b;
+  double ca = na->box.min.y + na->box.max.y;
+  double cb = nb->box.min.y + nb->box.max.y;
+
+  return (ca < cb ? -1 : ca > cb ? 1 : 0);
+}
+
+/** Sorts the n nodes of a level into STR order */
+static void
+rtree_sort_level (Dwg_Rtree_Node * level, uint32_t n)
+{
+  uint32_t num_parents, num_slices, slice, i;
+
+  num_parents = (n + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+  num_slices = (uint32_t) ceil (sqrt ((double) num_parents));
+  slice = num_slices * RTREE_NODE_SIZE;
+
+  qsort (level, n, sizeof (Dwg_Rtree_Node), node_cmp_x);
+  for (i = 0; i < n; i += slice)
+    qsort (level + i, (n - i < slice ? n - i : slice), sizeof (Dwg_Rtree_Node), node_cmp_y);
+}
+
+/** Frees the spatial index of a dwg structure */
+void
+dwg_spatial_free (Dwg_Struct * dwg)
+{
+  if (dwg == NULL)
+    return;
+  if (dwg->rtree)
+    free (dwg->rtree);
+  dwg->rtree = NULL;
+  dwg->num_rtree_nodes = 0;
+  dwg->num_rtree_entities = 0;
+}
+
+/** Builds the spatial index of the entities of a dwg structure, replacing
+ * the current one, if any. Entities without extents (see dwg_entity_extents)
+ * are left out. Not needed before dwg_query_box, which builds it on first use,
+ * but that first use must then not happen in several threads at once.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+int
+dwg_spatial_init (Dwg_Struct * dwg)
+{
+  Dwg_Rtree_Node *node;
+  uint32_t i, n, total, level, level_size;
+  char tmp[1024];
+
+  if (dwg == NULL)
+    return (-1);
+  dwg_spatial_free (dwg);
+
+  /* Entity boxes: the first level
+   */
+  n = 0;
+  for (i = 0; i < dwg->num_objects; i++)
+    if (dwg->object[i].supertype == DWG_SUPERTYPE_ENTITY)
+      n++;
+  if (n == 0)
+    return (0);
+
+  total = n;
+  for (level_size = n; level_size > 1;)
+    {
+      level_size = (level_size + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+      total += level_size;
+    }
+  node = (Dwg_Rtree_Node *) malloc (total * sizeof (Dwg_Rtree_Node));
+  if (node == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the spatial index.\n");
+      return (-1);
+    }
+
+  n = 0;
+  for (i = 0; i < dwg->num_objects; i++)
+    {
+      if (dwg->object[i].supertype != DWG_SUPERTYPE_ENTITY)
+        continue;
+      if (dwg_entity_extents (&dwg->object[i], &node[n].box))
+        continue;
+      node[n].first = i;
+      node[n].count = 0;
+      n++;
+    }
+  if (n == 0)
+    {
+      free (node);
+      return (0);
+    }
+
+  /* Upper levels, packed from the sorted level below
+   */
+  level = 0;
+  level_size = n;
+  total = n;
+  while (level_size > 1)
+    {
+      uint32_t j, parents = 0;
+
+      rtree_sort_level (node + level, level_size);
+      for (i = 0; i < level_size; i += RTREE_NODE_SIZE)
+        {
+          Dwg_Rtree_Node *parent = &node[total + parents];
+
+          parent->first = level + i;
+          parent->count = (level_size - i < RTREE_NODE_SIZE ? level_size - i : RTREE_NODE_SIZE);
+          parent->box = node[level + i].box;
+          for (j = 1; j < parent->count; j++)
+            {
+              Dwg_Bbox *b = &node[level + i + j].box;
+              box_add (&parent->box, b->min.x, b->min.y, b->min.z);
+              box_add (&parent->box, b->max.x, b->max.y, b->max.z);
+            }
+          parents++;
+        }
+      level = total;
+      level_size = parents;
+      total += parents;
+    }
+
+  dwg->rtree = node;
+  dwg->num_rtree_nodes = total;
+  dwg->num_rtree_entities = n;
+
+  snprintf (tmp, 1024, "Spatial index: %lu entities, %lu nodes\n", (unsigned long) n, (unsigned long) total);
+  LOG_INFO (tmp);
+  return (0);
+}
+
+/** Calls callback for every entity whose box intersects the box [min, max]
+ * (use -HUGE_VAL and HUGE_VAL for z in 2D queries). The callback gets the
+ * entity and the data pointer; if it returns non zero, the search stops.
+ * Returns the number of entities found.
+ */
+uint32_t
+dwg_query_box (Dwg_Struct * dwg, BITCODE_3BD * min, BITCODE_3BD * max,
+               int (*callback) (Dwg_Object * obj, void *data), void *data)
+{
+  uint32_t stack[RTREE_STACK];
+  uint32_t top, found, i;
+
+  if (dwg == NULL || min == NULL || max == NULL)
+    return (0);
+  if (dwg->rtree == NULL && dwg_spatial_init (dwg))
+    return (0);
+  if (dwg->num_rtree_nodes == 0)
+    return (0);
+
+  found = 0;
+  top = 0;
+  stack[top++] = dwg->num_rtree_nodes - 1;
+  while (top > 0)
+    {
+      Dwg_Rtree_Node *node = &dwg->rtree[stack[--top]];
+
+      if (node->box.min.x > max->x || node->box.max.x < min->x
+          || node->box.min.y > max->y || node->box.max.y < min->y
+          || node->box.min.z > max->z || node->box.max.z < min->z)
+        continue;
+
+      if (node->count == 0)
+        {
+          found++;
+          if (callback && callback (&dwg->object[node->first], data))
+            break;
+          continue;
+        }
+      for (i = node->count; i > 0; i--)
+        stack[top++] = node->first + i - 1;
+    }
+  return (found);
+}
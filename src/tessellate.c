@@ -0,0 +1,671 @@
+/*****************************************************************************/
+/*  LibDWG - free implementation of the DWG file format                      */
+/*                                                                           */
+/*  Copyright (C) 2013 Free Software Foundation, Inc.                        */
+/*                                                                           */
+/*  This library is free software, licensed under the terms of the GNU       */
+/*  General Public License as published by the Free Software Foundation,     */
+/*  either version 3 of the License, or (at your option) any later version.  */
+/*  You should have received a copy of the GNU General Public License        */
+/*  along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+ *     \file       tessellate.c
+ *     \brief      Tessellation of curved entities into polylines
+ *     \version
+ *     \copyright  GNU General Public License (version 3 or later)
+ */
+
+/* Curves are cut in as many segments as needed for the distance between a
+ * curve and its chords to stay within the tolerance. Arcs and ellipses are
+ * all one kernel: the points are stepped by a rotation, so sine and cosine
+ * are computed once per curve and not per vertex; splines are evaluated by
+ * de Boor's algorithm, in homogeneous coordinates for the weights. Planar
+ * entities are tessellated in their object coordinate system, and the
+ * vertices are then moved to the world in one pass.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dwg.h"
+#include "logging.h"
+
+#define TESS_MAX_SEGMENTS 4096
+#define TESS_MAX_DEGREE 15
+
+/* LWPLINE flag of closed polylines */
+#define LWPLINE_CLOSED 512
+
+/**
+ *    \struct  _tess_writer
+ *    \brief   Output of the tessellation of one entity into a buffer
+ */
+typedef struct _tess_writer
+{
+  Dwg_Tess_Buffer *buf;
+  double tol;
+  int full;
+
+  /* Control points of a spline, homogeneous (x w, y w, z w, w) */
+  double *ctrl;
+  uint32_t max_ctrl;
+} Tess_Writer;
+
+/*------------------------------------------------------------------------------
+ * Output
+ */
+
+/** Starts a polyline of the object of index index */
+static void
+tess_begin (Tess_Writer * w, uint32_t index)
+{
+  Dwg_Tess_Buffer *buf = w->buf;
+
+  if (buf->num_polylines >= buf->max_polylines)
+    {
+      w->full = 1;
+      return;
+    }
+  buf->start[buf->num_polylines] = buf->num_vertices;
+  buf->object[buf->num_polylines] = index;
+  buf->num_polylines++;
+}
+
+/** Reserves count vertices at the end of the buffer, to be written by the
+ * caller. Returns NULL (and the writer is full) if there is no room.
+ */
+static double *
+tess_reserve (Tess_Writer * w, uint32_t count)
+{
+  Dwg_Tess_Buffer *buf = w->buf;
+  double *v;
+
+  if (w->full || count > buf->max_vertices - buf->num_vertices)
+    {
+      w->full = 1;
+      return (NULL);
+    }
+  v = &buf->vertex[3 * buf->num_vertices];
+  buf->num_vertices += count;
+  return (v);
+}
+
+static void
+tess_vertex (Tess_Writer * w, double x, double y, double z)
+{
+  double *v;
+
+  v = tess_reserve (w, 1);
+  if (v == NULL)
+    return;
+  v[0] = x;
+  v[1] = y;
+  v[2] = z;
+}
+
+/** Moves the vertices from index first, given in the object coordinate
+ * system of ext, to the world.
+ */
+static void
+tess_ocs (Tess_Writer * w, uint32_t first, BITCODE_3BD * ext)
+{
+  BITCODE_3BD ax, ay, az;
+  double *v, x, y, z;
+  uint32_t i;
+
+  if (w->full || !dwg_ocs_axes (ext, &ax, &ay, &az))
+    return;
+  v = w->buf->vertex;
+  for (i = 3 * first; i < 3 * w->buf->num_vertices; i += 3)
+    {
+      x = v[i];
+      y = v[i + 1];
+      z = v[i + 2];
+      v[i] = x * ax.x + y * ay.x + z * az.x;
+      v[i + 1] = x * ax.y + y * ay.y + z * az.y;
+      v[i + 2] = x * ax.z + y * ay.z + z * az.z;
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * Kernels
+ */
+
+/** Number of segments of an arc of radius r and angle sweep, whose chords
+ * stay within tol of it (1 - cos (step / 2) <= tol / r).
+ */
+static uint32_t
+tess_arc_segments (double r, double sweep, double tol)
+{
+  double step, n;
+
+  step = 2 * M_PI / 3;
+  if (tol < r && 2 * acos (1 - tol / r) < step)
+    step = 2 * acos (1 - tol / r);
+  n = ceil (fabs (sweep) / step);
+  if (!(n >= 1))
+    return (1);
+  if (n > TESS_MAX_SEGMENTS)
+    return (TESS_MAX_SEGMENTS);
+  return ((uint32_t) n);
+}
+
+/** Points c + cos (a) u + sin (a) v, for a from start to start + sweep, of an
+ * arc (u and v orthogonal, of length r) or an ellipse (u the major axis and v
+ * the minor one, r the major radius). The points of index first (0 or 1) to
+ * the last are written: the first is left out when it ends a previous piece.
+ */
+static void
+tess_conic (Tess_Writer * w, const double *c, const double *u, const double *v,
+            double start, double sweep, double r, uint32_t first)
+{
+  double cs, sn, dc, ds, t, *p;
+  uint32_t i, n;
+
+  n = tess_arc_segments (r, sweep, w->tol);
+  p = tess_reserve (w, n + 1 - first);
+  if (p == NULL)
+    return;
+
+  cs = cos (start);
+  sn = sin (start);
+  dc = cos (sweep / n);
+  ds = sin (sweep / n);
+  for (i = 0; i < n; i++)
+    {
+      if (i >= first)
+        {
+          p[0] = c[0] + cs * u[0] + sn * v[0];
+          p[1] = c[1] + cs * u[1] + sn * v[1];
+          p[2] = c[2] + cs * u[2] + sn * v[2];
+          p += 3;
+        }
+      t = cs * dc - sn * ds;
+      sn = sn * dc + cs * ds;
+      cs = t;
+    }
+
+  /* The end point exactly, not stepped */
+  cs = cos (start + sweep);
+  sn = sin (start + sweep);
+  p[0] = c[0] + cs * u[0] + sn * v[0];
+  p[1] = c[1] + cs * u[1] + sn * v[1];
+  p[2] = c[2] + cs * u[2] + sn * v[2];
+}
+
+/** Circular arc of the XY plane, at height z */
+static void
+tess_arc (Tess_Writer * w, double cx, double cy, double z, double r,
+          double start, double sweep, uint32_t first)
+{
+  double c[3], u[3], v[3];
+
+  c[0] = cx;
+  c[1] = cy;
+  c[2] = z;
+  u[0] = r;
+  u[1] = u[2] = 0;
+  v[0] = v[2] = 0;
+  v[1] = r;
+  tess_conic (w, c, u, v, start, sweep, r, first);
+}
+
+/** Counterclockwise sweep from angle start to angle end, in (0, 2 pi] */
+static double
+tess_sweep (double start, double end)
+{
+  double sweep;
+
+  sweep = fmod (end - start, 2 * M_PI);
+  if (sweep <= 0)
+    sweep += 2 * M_PI;
+  return (sweep);
+}
+
+/** Segment from p1 to p2 of the XY plane, with its bulge (the tangent of a
+ * quarter of the arc angle, negative clockwise), without its first point.
+ */
+static void
+tess_bulge (Tess_Writer * w, BITCODE_2RD * p1, BITCODE_2RD * p2, double bulge, double z)
+{
+  double dx, dy, cx, cy, k, sweep;
+
+  if (bulge == 0 || (p1->x == p2->x && p1->y == p2->y))
+    {
+      tess_vertex (w, p2->x, p2->y, z);
+      return;
+    }
+  dx = p2->x - p1->x;
+  dy = p2->y - p1->y;
+  k = (1 - bulge * bulge) / (4 * bulge);
+  cx = (p1->x + p2->x) / 2 - dy * k;
+  cy = (p1->y + p2->y) / 2 + dx * k;
+  sweep = 4 * atan (bulge);
+  tess_arc (w, cx, cy, z, hypot (p1->x - cx, p1->y - cy),
+            atan2 (p1->y - cy, p1->x - cx), sweep, 1);
+}
+
+/** Points of a NURBS curve of degree p, whose num homogeneous control points
+ * are in w->ctrl, from index first (0 or 1). Each knot span is cut in a
+ * number of segments bound by the second differences of its control points.
+ * Splines which are not well formed give their control polygon.
+ */
+static void
+tess_nurbs (Tess_Writer * w, uint32_t p, uint32_t num, const double *knots, uint32_t num_knots,
+            uint32_t first)
+{
+  double d[TESS_MAX_DEGREE + 1][4];
+  const double *P = w->ctrl;
+  double u, a, m, dd, e[3], *out;
+  uint32_t i, j, k, r, s, n;
+
+  if (p < 1 || p > TESS_MAX_DEGREE || num < p + 1 || knots == NULL || num_knots < num + p + 1)
+    {
+      for (i = first; i < num; i++)
+        if (P[4 * i + 3] != 0)
+          tess_vertex (w, P[4 * i] / P[4 * i + 3], P[4 * i + 1] / P[4 * i + 3], P[4 * i + 2] / P[4 * i + 3]);
+      return;
+    }
+
+  for (j = p; j < num; j++)
+    {
+      if (!(knots[j + 1] > knots[j]))
+        continue;
+
+      /* Segments of the span */
+      m = 0;
+      for (i = j - p + 1; i < j; i++)
+        {
+          for (k = 0; k < 3; k++)
+            e[k] = P[4 * (i - 1) + k] - 2 * P[4 * i + k] + P[4 * (i + 1) + k];
+          dd = sqrt (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+          if (dd > m)
+            m = dd;
+        }
+      n = 1;
+      if (p > 1 && m > 0 && w->tol > 0)
+        {
+          a = ceil (sqrt (p * (p - 1) * m / (8 * w->tol)));
+          n = a > TESS_MAX_SEGMENTS ? TESS_MAX_SEGMENTS : a < 1 ? 1 : (uint32_t) a;
+        }
+
+      out = tess_reserve (w, n + 1 - first);
+      if (out == NULL)
+        return;
+      for (s = first; s <= n; s++)
+        {
+          u = knots[j] + (knots[j + 1] - knots[j]) * s / n;
+
+          /* de Boor */
+          for (i = 0; i <= p; i++)
+            memcpy (d[i], &P[4 * (j - p + i)], 4 * sizeof (double));
+          for (r = 1; r <= p; r++)
+            for (i = p; i >= r; i--)
+              {
+                a = knots[i + 1 + j - r] - knots[i + j - p];
+                a = a > 0 ? (u - knots[i + j - p]) / a : 0;
+                for (k = 0; k < 4; k++)
+                  d[i][k] = (1 - a) * d[i - 1][k] + a * d[i][k];
+              }
+          a = d[p][3] != 0 ? 1 / d[p][3] : 1;
+          out[0] = d[p][0] * a;
+          out[1] = d[p][1] * a;
+          out[2] = d[p][2] * a;
+          out += 3;
+        }
+      first = 1;
+    }
+}
+
+/** Makes room for num homogeneous control points.
+ * Returns a fail status (0 == OK; -1 == FAIL).
+ */
+static int
+tess_ctrl_alloc (Tess_Writer * w, uint32_t num)
+{
+  double *ctrl;
+
+  if (num <= w->max_ctrl)
+    return (0);
+  ctrl = (double *) realloc (w->ctrl, 4 * num * sizeof (double));
+  if (ctrl == NULL)
+    {
+      LOG_ERROR ("Not enough memory for the spline control points.\n");
+      return (-1);
+    }
+  w->ctrl = ctrl;
+  w->max_ctrl = num;
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Entities
+ */
+
+static void
+tess_entity_arc (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_ARC *e = &obj->as.entity.as.ARC;
+  uint32_t from = w->buf->num_vertices;
+
+  tess_begin (w, obj->index);
+  tess_arc (w, e->center.x, e->center.y, e->center.z, e->radius,
+            e->start_angle, tess_sweep (e->start_angle, e->end_angle), 0);
+  tess_ocs (w, from, &e->extrusion);
+}
+
+static void
+tess_entity_circle (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_CIRCLE *e = &obj->as.entity.as.CIRCLE;
+  uint32_t from = w->buf->num_vertices;
+
+  tess_begin (w, obj->index);
+  tess_arc (w, e->center.x, e->center.y, e->center.z, e->radius, 0, 2 * M_PI, 0);
+  tess_ocs (w, from, &e->extrusion);
+}
+
+static void
+tess_entity_ellipse (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_ELLIPSE *e = &obj->as.entity.as.ELLIPSE;
+  BITCODE_3BD n = e->extrusion;
+  double c[3], u[3], v[3], len;
+
+  len = sqrt (n.x * n.x + n.y * n.y + n.z * n.z);
+  if (len == 0)
+    {
+      n.x = n.y = 0;
+      n.z = 1;
+    }
+  else
+    {
+      n.x /= len;
+      n.y /= len;
+      n.z /= len;
+    }
+  c[0] = e->center.x;
+  c[1] = e->center.y;
+  c[2] = e->center.z;
+  u[0] = e->sm_axis.x;
+  u[1] = e->sm_axis.y;
+  u[2] = e->sm_axis.z;
+  /* minor axis: ratio * (N x major) */
+  v[0] = e->axis_ratio * (n.y * u[2] - n.z * u[1]);
+  v[1] = e->axis_ratio * (n.z * u[0] - n.x * u[2]);
+  v[2] = e->axis_ratio * (n.x * u[1] - n.y * u[0]);
+
+  tess_begin (w, obj->index);
+  tess_conic (w, c, u, v, e->start_angle, tess_sweep (e->start_angle, e->end_angle),
+              sqrt (u[0] * u[0] + u[1] * u[1] + u[2] * u[2]), 0);
+}
+
+/** Splines with control points follow them; those with fit points only are
+ * given as their fit points.
+ */
+static void
+tess_entity_spline (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_SPLINE *e = &obj->as.entity.as.SPLINE;
+  uint32_t i;
+  double wt;
+
+  tess_begin (w, obj->index);
+  if (e->ctrl_pts == NULL || e->num_ctrl_pts == 0)
+    {
+      for (i = 0; e->fit_pts && i < e->num_fit_pts; i++)
+        tess_vertex (w, e->fit_pts[i].x, e->fit_pts[i].y, e->fit_pts[i].z);
+      return;
+    }
+  if (tess_ctrl_alloc (w, e->num_ctrl_pts))
+    {
+      w->full = 1;
+      return;
+    }
+  for (i = 0; i < e->num_ctrl_pts; i++)
+    {
+      wt = e->weighted ? e->ctrl_pts[i].w : 1;
+      w->ctrl[4 * i] = e->ctrl_pts[i].x * wt;
+      w->ctrl[4 * i + 1] = e->ctrl_pts[i].y * wt;
+      w->ctrl[4 * i + 2] = e->ctrl_pts[i].z * wt;
+      w->ctrl[4 * i + 3] = wt;
+    }
+  tess_nurbs (w, e->degree, e->num_ctrl_pts, e->knots, e->knots ? e->num_knots : 0, 0);
+}
+
+static void
+tess_entity_lwpline (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_LWPLINE *e = &obj->as.entity.as.LWPLINE;
+  uint32_t from = w->buf->num_vertices;
+  uint32_t i, num;
+
+  if (e->points == NULL || e->num_points == 0)
+    return;
+  tess_begin (w, obj->index);
+  tess_vertex (w, e->points[0].x, e->points[0].y, e->elevation);
+  num = e->flags & LWPLINE_CLOSED ? e->num_points : e->num_points - 1;
+  for (i = 0; i < num; i++)
+    tess_bulge (w, &e->points[i], &e->points[(i + 1) % e->num_points],
+                e->bulges && i < e->num_bulges ? e->bulges[i] : 0, e->elevation);
+  tess_ocs (w, from, &e->normal);
+}
+
+/** One closed polyline per boundary path */
+static void
+tess_entity_hatch (Tess_Writer * w, Dwg_Object * obj)
+{
+  Dwg_Entity_HATCH *e = &obj->as.entity.as.HATCH;
+  Dwg_Entity_HATCH_Path *path;
+  Dwg_Entity_HATCH_PathSeg *seg;
+  uint32_t from = w->buf->num_vertices;
+  uint32_t i, j, k, first;
+  double z = e->z_coord;
+  double c[3], u[3], v[3], start, sweep, wt;
+
+  for (i = 0; e->paths && i < e->num_paths; i++)
+    {
+      path = &e->paths[i];
+      if (path->flag & 2)
+        {
+          if (path->polyline_paths == NULL || path->num_path_segs == 0)
+            continue;
+          tess_begin (w, obj->index);
+          tess_vertex (w, path->polyline_paths[0].point.x, path->polyline_paths[0].point.y, z);
+          for (j = 0; j < path->num_path_segs; j++)
+            tess_bulge (w, &path->polyline_paths[j].point,
+                        &path->polyline_paths[(j + 1) % path->num_path_segs].point,
+                        path->bulges_present ? path->polyline_paths[j].bulge : 0, z);
+          continue;
+        }
+
+      if (path->segs == NULL || path->num_path_segs == 0)
+        continue;
+      tess_begin (w, obj->index);
+      for (j = 0; j < path->num_path_segs; j++)
+        {
+          seg = &path->segs[j];
+          first = j > 0;
+          switch (seg->type_status)
+            {
+            case 1:
+              if (!first)
+                tess_vertex (w, seg->first_endpoint.x, seg->first_endpoint.y, z);
+              tess_vertex (w, seg->second_endpoint.x, seg->second_endpoint.y, z);
+              break;
+            case 2:
+            case 3:
+              /* Clockwise arcs have their angles measured clockwise */
+              start = seg->is_ccw ? seg->start_angle : -seg->start_angle;
+              sweep = tess_sweep (seg->start_angle, seg->end_angle);
+              if (!seg->is_ccw)
+                sweep = -sweep;
+              c[0] = seg->center.x;
+              c[1] = seg->center.y;
+              c[2] = z;
+              u[2] = v[2] = 0;
+              if (seg->type_status == 2)
+                {
+                  tess_arc (w, c[0], c[1], z, seg->radius, start, sweep, first);
+                  break;
+                }
+              /* endpoint is the major axis, relative to the center */
+              u[0] = seg->endpoint.x;
+              u[1] = seg->endpoint.y;
+              v[0] = -seg->minor_major_ratio * u[1];
+              v[1] = seg->minor_major_ratio * u[0];
+              tess_conic (w, c, u, v, start, sweep, hypot (u[0], u[1]), first);
+              break;
+            case 4:
+              if (seg->control_points == NULL || tess_ctrl_alloc (w, seg->num_control_points))
+                break;
+              for (k = 0; k < seg->num_control_points; k++)
+                {
+                  wt = seg->is_rational ? seg->control_points[k].weigth : 1;
+                  w->ctrl[4 * k] = seg->control_points[k].point.x * wt;
+                  w->ctrl[4 * k + 1] = seg->control_points[k].point.y * wt;
+                  w->ctrl[4 * k + 2] = z * wt;
+                  w->ctrl[4 * k + 3] = wt;
+                }
+              tess_nurbs (w, seg->degree, seg->num_control_points, seg->knots,
+                          seg->knots ? seg->num_knots : 0, first);
+              break;
+            }
+        }
+    }
+  tess_ocs (w, from, &e->extrusion);
+}
+
+typedef void (*Tess_Kernel) (Tess_Writer * w, Dwg_Object * obj);
+
+/** Gets the kernel of an object type, or NULL if it is not tessellated */
+static Tess_Kernel
+tess_kernel (Dwg_Struct * dwg, uint32_t type)
+{
+  switch (type)
+    {
+    case DWG_TYPE_ARC:
+      return (tess_entity_arc);
+    case DWG_TYPE_CIRCLE:
+      return (tess_entity_circle);
+    case DWG_TYPE_ELLIPSE:
+      return (tess_entity_ellipse);
+    case DWG_TYPE_SPLINE:
+      return (tess_entity_spline);
+    case DWG_TYPE_LWPLINE:
+      return (tess_entity_lwpline);
+    }
+  if (type < 500 || type - 500 >= dwg->num_classes)
+    return (NULL);
+  switch (dwg->dwg_class[type - 500].vartype)
+    {
+    case DWG_CLASS_LWPLINE:
+      return (tess_entity_lwpline);
+    case DWG_CLASS_HATCH:
+      return (tess_entity_hatch);
+    default:
+      return (NULL);
+    }
+}
+
+/** Runs a kernel on one object: on overflow the buffer is left as before.
+ * Returns 0 == OK; 1 == no room in the buffer.
+ */
+static int
+tess_run (Tess_Writer * w, Tess_Kernel kernel, Dwg_Object * obj)
+{
+  uint32_t num_vertices = w->buf->num_vertices;
+  uint32_t num_polylines = w->buf->num_polylines;
+
+  w->full = 0;
+  kernel (w, obj);
+  if (w->full)
+    {
+      w->buf->num_vertices = num_vertices;
+      w->buf->num_polylines = num_polylines;
+      return (1);
+    }
+  return (0);
+}
+
+/*------------------------------------------------------------------------------
+ * Public functions
+ */
+
+/** Tessellates a curved entity (ARC, CIRCLE, ELLIPSE, SPLINE, LWPLINE or
+ * HATCH boundaries) into polylines added to buf, in world coordinates, no
+ * farther than tolerance from the curves.
+ * Returns 0 == OK; 1 == no room left in buf, which is unchanged; -1 == FAIL
+ * (not a curved entity, or a tolerance not above 0).
+ */
+int
+dwg_tessellate (Dwg_Object * obj, double tolerance, Dwg_Tess_Buffer * buf)
+{
+  Tess_Writer w;
+  Tess_Kernel kernel;
+  int ret;
+
+  if (obj == NULL || buf == NULL || !(tolerance > 0) || obj->supertype != DWG_SUPERTYPE_ENTITY)
+    return (-1);
+  kernel = tess_kernel (obj->parent, obj->type);
+  if (kernel == NULL)
+    return (-1);
+
+  memset (&w, 0, sizeof (Tess_Writer));
+  w.buf = buf;
+  w.tol = tolerance;
+  ret = tess_run (&w, kernel, obj);
+  if (w.ctrl)
+    free (w.ctrl);
+  return (ret);
+}
+
+/** Tessellates the entities of one type (as in dwg_entities_by_type) into buf,
+ * as dwg_tessellate, from the entity of rank *next in the type until buf is
+ * full; *next is then the rank of the first entity left, so that the whole
+ * type is done by calls in a row, emptying buf in between. An entity which
+ * doesn't fit in the whole buffer is skipped.
+ * Returns the number of entities done.
+ */
+uint32_t
+dwg_tessellate_type (Dwg_Struct * dwg, uint32_t type, double tolerance, uint32_t * next,
+                     Dwg_Tess_Buffer * buf)
+{
+  Tess_Writer w;
+  Tess_Kernel kernel;
+  Dwg_Object *obj;
+  uint32_t *indexes;
+  uint32_t num, done;
+
+  if (dwg == NULL || next == NULL || buf == NULL || !(tolerance > 0))
+    return (0);
+  kernel = tess_kernel (dwg, type);
+  num = dwg_entities_by_type (dwg, type, &indexes);
+  if (kernel == NULL || num == 0)
+    return (0);
+
+  memset (&w, 0, sizeof (Tess_Writer));
+  w.buf = buf;
+  w.tol = tolerance;
+  done = 0;
+  for (; *next < num; (*next)++, done++)
+    {
+      obj = &dwg->object[indexes[*next]];
+      if (obj->supertype != DWG_SUPERTYPE_ENTITY)
+        continue;
+      if (tess_run (&w, kernel, obj) == 0)
+        continue;
+      if (buf->num_vertices > 0 || buf->num_polylines > 0)
+        break;
+      LOG_INFO ("Entity too big for the tessellation buffer, skipped.\n");
+    }
+  if (w.ctrl)
+    free (w.ctrl);
+  return (done);
+}
@@ -30,9 +30,11 @@
 #include "decode.h"
 #include "logging.h"
 
-/* Variables decoding function (auto-generated) */
+/* Variables decoding functions, one per version family (auto-generated) */
 #include "bits.h"
-#include "auto_variables.c"
+#include "auto_variables_r13.c"
+#include "auto_variables_r2000.c"
+#include "auto_variables_r2004.c"
 
 /* Variables freeing function (auto-generated) */
 #include "auto_variables_free.c"
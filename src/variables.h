@@ -28,7 +28,13 @@
 #include "dwg.h"
 
 int
-dwg_decode_variables(Bit_Chain *dat, Dwg_Struct *dwg);
+dwg_decode_r13_variables (Bit_Chain *dat, Dwg_Struct *dwg);
+
+int
+dwg_decode_r2000_variables (Bit_Chain *dat, Dwg_Struct *dwg);
+
+int
+dwg_decode_r2004_variables (Bit_Chain *dat, Dwg_Struct *dwg);
 
 int
 dwg_variables_free (Dwg_Struct *dwg);